@@ -361,6 +361,32 @@ SOURCES += \
     widgets/OverviewWidget.cpp \
     common/JsonTreeItem.cpp \
     common/JsonModel.cpp \
+    common/JsonReader.cpp \
+    common/MemoryAccounting.cpp \
+    common/AnalysisServer.cpp \
+    common/FunctionSimilarity.cpp \
+    dialogs/SimilarFunctionsDialog.cpp \
+    common/RopGadgetIndex.cpp \
+    common/InstructionBoundaryIndex.cpp \
+    common/CfgRegions.cpp \
+    common/ByteMapRenderer.cpp \
+    widgets/ByteMapWidget.cpp \
+    common/BackgroundIndex.cpp \
+    common/ConstantIndex.cpp \
+    common/DisassemblyTextIndex.cpp \
+    common/XrefGraph.cpp \
+    common/FunctionMetrics.cpp \
+    common/DataClassifier.cpp \
+    common/SwitchTableCache.cpp \
+    common/MemoryWatch.cpp \
+    widgets/MemoryWatchWidget.cpp \
+    common/CodePalette.cpp \
+    common/TokenIndex.cpp \
+    common/DebugInfo.cpp \
+    common/EditJournal.cpp \
+    common/Profiler.cpp \
+    widgets/FlameGraphWidget.cpp \
+    widgets/MemoryUsageWidget.cpp \
     dialogs/VersionInfoDialog.cpp \
     widgets/ZignaturesWidget.cpp \
     common/AsyncTask.cpp \
@@ -378,6 +404,7 @@ SOURCES += \
     widgets/DebugActions.cpp \
     widgets/MemoryMapWidget.cpp \
     dialogs/preferences/DebugOptionsWidget.cpp \
+    dialogs/preferences/AnalysisOptionsWidget.cpp \
     dialogs/preferences/PluginsOptionsWidget.cpp \
     widgets/BreakpointWidget.cpp \
     dialogs/BreakpointsDialog.cpp \
@@ -505,6 +532,32 @@ HEADERS  += \
     widgets/OverviewWidget.h \
     common/JsonTreeItem.h \
     common/JsonModel.h \
+    common/JsonReader.h \
+    common/MemoryAccounting.h \
+    common/AnalysisServer.h \
+    common/FunctionSimilarity.h \
+    dialogs/SimilarFunctionsDialog.h \
+    common/RopGadgetIndex.h \
+    common/InstructionBoundaryIndex.h \
+    common/CfgRegions.h \
+    common/ByteMapRenderer.h \
+    widgets/ByteMapWidget.h \
+    common/BackgroundIndex.h \
+    common/ConstantIndex.h \
+    common/DisassemblyTextIndex.h \
+    common/XrefGraph.h \
+    common/FunctionMetrics.h \
+    common/DataClassifier.h \
+    common/SwitchTableCache.h \
+    common/MemoryWatch.h \
+    widgets/MemoryWatchWidget.h \
+    common/CodePalette.h \
+    common/TokenIndex.h \
+    common/DebugInfo.h \
+    common/EditJournal.h \
+    common/Profiler.h \
+    widgets/FlameGraphWidget.h \
+    widgets/MemoryUsageWidget.h \
     dialogs/VersionInfoDialog.h \
     widgets/ZignaturesWidget.h \
     common/AsyncTask.h \
@@ -525,6 +578,7 @@ HEADERS  += \
     widgets/DebugActions.h \
     widgets/MemoryMapWidget.h \
     dialogs/preferences/DebugOptionsWidget.h \
+    dialogs/preferences/AnalysisOptionsWidget.h \
     dialogs/preferences/PluginsOptionsWidget.h \
     widgets/BreakpointWidget.h \
     dialogs/BreakpointsDialog.h \
@@ -628,6 +682,7 @@ FORMS    += \
     widgets/BacktraceWidget.ui \
     dialogs/MapFileDialog.ui \
     dialogs/preferences/DebugOptionsWidget.ui \
+    dialogs/preferences/AnalysisOptionsWidget.ui \
     widgets/BreakpointWidget.ui \
     dialogs/BreakpointsDialog.ui \
     dialogs/AttachProcDialog.ui \
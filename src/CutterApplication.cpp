@@ -4,6 +4,8 @@
 #include "plugins/PluginManager.h"
 #include "CutterConfig.h"
 #include "common/Decompiler.h"
+#include "common/AnalysisServer.h"
+#include "common/AnalTask.h"
 
 #include <QApplication>
 #include <QFileOpenEvent>
@@ -19,11 +21,13 @@
 #include <QTranslator>
 #include <QLibraryInfo>
 #include <QFontDatabase>
+#include <QTimer>
 #ifdef Q_OS_WIN
 #include <QtNetwork/QtNetwork>
 #endif // Q_OS_WIN
 
 #include <cstdlib>
+#include <memory>
 
 #if CUTTER_R2GHIDRA_STATIC
 #include <R2GhidraDecompiler.h>
@@ -123,24 +127,39 @@ CutterApplication::CutterApplication(int &argc, char **argv) : QApplication(argc
         plugin->registerDecompilers();
     }
 
-    mainWindow = new MainWindow();
-    installEventFilter(mainWindow);
+    if (!clOptions.serverName.isEmpty()) {
+        analysisServer = new AnalysisServer(this);
+        if (!analysisServer->listen(clOptions.serverName)) {
+            fprintf(stderr, "%s\n",
+                    QObject::tr("Failed to start analysis server \"%1\": %2")
+                    .arg(clOptions.serverName, analysisServer->errorString()).toLocal8Bit().constData());
+            std::exit(1);
+        }
+    }
+
+    if (clOptions.headless) {
+        // Started from the event loop so the r2 configuration below is in place before analysis
+        QTimer::singleShot(0, this, &CutterApplication::startHeadless);
+    } else {
+        mainWindow = new MainWindow();
+        installEventFilter(mainWindow);
 
-    // set up context menu shortcut display fix
+        // set up context menu shortcut display fix
 #if QT_VERSION_CHECK(5, 10, 0) < QT_VERSION
-    setStyle(new CutterProxyStyle());
+        setStyle(new CutterProxyStyle());
 #endif // QT_VERSION_CHECK(5, 10, 0) < QT_VERSION
 
-    if (clOptions.args.empty()) {
-        // check if this is the first execution of Cutter in this computer
-        // Note: the execution after the preferences been reset, will be considered as first-execution
-        if (Config()->isFirstExecution()) {
-            mainWindow->displayWelcomeDialog();
+        if (clOptions.args.empty()) {
+            // check if this is the first execution of Cutter in this computer
+            // Note: the execution after the preferences been reset, will be considered as first-execution
+            if (Config()->isFirstExecution()) {
+                mainWindow->displayWelcomeDialog();
+            }
+            mainWindow->displayNewFileDialog();
+        } else { // filename specified as positional argument
+            bool askOptions = clOptions.analLevel != AutomaticAnalysisLevel::Ask;
+            mainWindow->openNewFile(clOptions.fileOpenOptions, askOptions);
         }
-        mainWindow->displayNewFileDialog();
-    } else { // filename specified as positional argument
-        bool askOptions = clOptions.analLevel != AutomaticAnalysisLevel::Ask;
-        mainWindow->openNewFile(clOptions.fileOpenOptions, askOptions);
     }
 
 #ifdef CUTTER_APPVEYOR_R2DEC
@@ -190,12 +209,39 @@ CutterApplication::CutterApplication(int &argc, char **argv) : QApplication(argc
 CutterApplication::~CutterApplication()
 {
     Plugins()->destroyPlugins();
+    delete analysisServer;
     delete mainWindow;
 #ifdef CUTTER_ENABLE_PYTHON
     Python()->shutdown();
 #endif
 }
 
+void CutterApplication::startHeadless()
+{
+    setQuitOnLastWindowClosed(false);
+
+    AnalTask *analTask = new AnalTask();
+    analTask->setOptions(clOptions.fileOpenOptions);
+    // logChanged always carries the whole log, only print what was appended
+    auto printedLength = std::make_shared<int>(0);
+    connect(analTask, &AsyncTask::logChanged, this, [printedLength](const QString &log) {
+        fprintf(stderr, "%s", log.mid(*printedLength).toLocal8Bit().constData());
+        *printedLength = log.length();
+    });
+    connect(analTask, &AsyncTask::finished, this, [this, analTask]() {
+        if (analTask->getOpenFileFailed()) {
+            fprintf(stderr, "%s\n", QObject::tr("Failed to open file.").toLocal8Bit().constData());
+            exit(1);
+            return;
+        }
+        Core()->updateSeek();
+        Core()->triggerRefreshAll();
+        fprintf(stderr, "%s\n",
+                QObject::tr("Serving analysis on \"%1\"").arg(clOptions.serverName).toLocal8Bit().constData());
+    });
+    Core()->getAsyncTaskManager()->start(AsyncTask::Ptr(analTask));
+}
+
 void CutterApplication::launchNewInstance(const QStringList &args)
 {
     QProcess process(this);
@@ -213,7 +259,7 @@ void CutterApplication::launchNewInstance(const QStringList &args)
 
 bool CutterApplication::event(QEvent *e)
 {
-    if (e->type() == QEvent::FileOpen) {
+    if (e->type() == QEvent::FileOpen && mainWindow) {
         QFileOpenEvent *openEvent = static_cast<QFileOpenEvent *>(e);
         if (openEvent) {
             if (m_FileAlreadyDropped) {
@@ -354,6 +400,17 @@ bool CutterApplication::parseCommandLineOptions()
                                         QObject::tr("Do not load radare2 plugins"));
     cmd_parser.addOption(disableR2Plugins);
 
+    QCommandLineOption serverOption("server",
+                                    QObject::tr("Serve the analysis to other processes on a local socket "
+                                                "with the given name"),
+                                    QObject::tr("name"));
+    cmd_parser.addOption(serverOption);
+
+    QCommandLineOption headlessOption("headless",
+                                      QObject::tr("Do not show the main window, only serve the analysis. "
+                                                  "Requires filename and --server to be specified."));
+    cmd_parser.addOption(headlessOption);
+
     cmd_parser.process(*this);
 
     CutterCommandLineOptions opts;
@@ -434,6 +491,14 @@ bool CutterApplication::parseCommandLineOptions()
         opts.enableR2Plugins = false;
     }
 
+    opts.serverName = cmd_parser.value(serverOption);
+    opts.headless = cmd_parser.isSet(headlessOption);
+    if (opts.headless && (opts.args.empty() || opts.serverName.isEmpty())) {
+        fprintf(stderr, "%s\n",
+                QObject::tr("Headless mode requires a filename and --server.").toLocal8Bit().constData());
+        return false;
+    }
+
     this->clOptions = opts;
     return true;
 }
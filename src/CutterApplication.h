@@ -8,6 +8,8 @@
 
 #include "core/MainWindow.h"
 
+class AnalysisServer;
+
 enum class AutomaticAnalysisLevel {
     Ask, None, AAA, AAAA
 };
@@ -20,6 +22,8 @@ struct CutterCommandLineOptions {
     bool outputRedirectionEnabled = true;
     bool enableCutterPlugins = true;
     bool enableR2Plugins = true;
+    QString serverName;
+    bool headless = false;
 };
 
 class CutterApplication : public QApplication
@@ -50,9 +54,15 @@ private:
      * @return false if options have error
      */
     bool parseCommandLineOptions();
+    /**
+     * @brief Load and analyze the file from the command line without a MainWindow,
+     * the analysis is then only available through the AnalysisServer.
+     */
+    void startHeadless();
 private:
     bool m_FileAlreadyDropped;
-    MainWindow *mainWindow;
+    MainWindow *mainWindow = nullptr;
+    AnalysisServer *analysisServer = nullptr;
     CutterCommandLineOptions clOptions;
 };
 
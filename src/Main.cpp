@@ -5,6 +5,7 @@
 #include "CutterConfig.h"
 #include "common/CrashHandler.h"
 #include "common/SettingsUpgrade.h"
+#include "common/DebugInfo.h"
 
 #include <QJsonObject>
 #include <QJsonArray>
@@ -68,6 +69,7 @@ int main(int argc, char *argv[])
 
     qRegisterMetaType<QList<StringDescription>>();
     qRegisterMetaType<QList<FunctionDescription>>();
+    qRegisterMetaType<QSharedPointer<DebugInfoData>>();
 
     QCoreApplication::setOrganizationName("RadareOrg");
     QCoreApplication::setApplicationName("Cutter");
@@ -1,5 +1,6 @@
 #include "core/Cutter.h"
 #include "common/AnalTask.h"
+#include "common/DebugInfo.h"
 #include "core/MainWindow.h"
 #include "dialogs/InitialOptionsDialog.h"
 #include <QJsonArray>
@@ -68,7 +69,8 @@ void AnalTask::runTask()
 
     if (!options.pdbFile.isNull()) {
         log(tr("Loading PDB file..."));
-        Core()->loadPDB(options.pdbFile);
+        // Named before the analysis, which keeps the names
+        DebugInfo::loadNow(options.pdbFile);
     }
 
     if (isInterrupted()) {
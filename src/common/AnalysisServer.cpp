@@ -0,0 +1,404 @@
+#include "AnalysisServer.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QtEndian>
+
+// Frames larger than this are treated as a protocol error and the client is dropped
+static const quint32 MAX_FRAME_SIZE = 64 * 1024 * 1024;
+static const int FRAME_HEADER_SIZE = 9;
+static const int MAX_READ_LENGTH = 16 * 1024 * 1024;
+
+namespace {
+
+class MessageWriter
+{
+public:
+    QByteArray data;
+
+    void u8(quint8 value)
+    {
+        data.append(static_cast<char>(value));
+    }
+
+    void u32(quint32 value)
+    {
+        char buf[sizeof(value)];
+        qToLittleEndian(value, buf);
+        data.append(buf, sizeof(buf));
+    }
+
+    void u64(quint64 value)
+    {
+        char buf[sizeof(value)];
+        qToLittleEndian(value, buf);
+        data.append(buf, sizeof(buf));
+    }
+
+    void bytes(const QByteArray &value)
+    {
+        u32(static_cast<quint32>(value.size()));
+        data.append(value);
+    }
+
+    void string(const QString &value)
+    {
+        bytes(value.toUtf8());
+    }
+};
+
+class MessageReader
+{
+public:
+    explicit MessageReader(const QByteArray &data)
+        : p(data.constData()),
+          end(data.constData() + data.size())
+    {
+    }
+
+    bool isOk() const { return ok; }
+
+    quint8 u8()
+    {
+        if (!require(1)) {
+            return 0;
+        }
+        return static_cast<quint8>(*p++);
+    }
+
+    quint32 u32()
+    {
+        if (!require(sizeof(quint32))) {
+            return 0;
+        }
+        quint32 value = qFromLittleEndian<quint32>(p);
+        p += sizeof(value);
+        return value;
+    }
+
+    quint64 u64()
+    {
+        if (!require(sizeof(quint64))) {
+            return 0;
+        }
+        quint64 value = qFromLittleEndian<quint64>(p);
+        p += sizeof(value);
+        return value;
+    }
+
+    QString string()
+    {
+        quint32 size = u32();
+        if (!require(size)) {
+            return QString();
+        }
+        QString value = QString::fromUtf8(p, static_cast<int>(size));
+        p += size;
+        return value;
+    }
+
+private:
+    const char *p;
+    const char *end;
+    bool ok = true;
+
+    bool require(size_t size)
+    {
+        ok = ok && static_cast<size_t>(end - p) >= size;
+        return ok;
+    }
+};
+
+}
+
+AnalysisServer::AnalysisServer(QObject *parent)
+    : QObject(parent),
+      server(new QLocalServer(this))
+{
+    connect(server, &QLocalServer::newConnection, this, &AnalysisServer::acceptClients);
+
+    connect(Core(), &CutterCore::refreshAll, this, [this]() {
+        notify(Event::Refresh);
+    });
+    connect(Core(), &CutterCore::functionsChanged, this, [this]() {
+        notify(Event::FunctionsChanged);
+    });
+    connect(Core(), &CutterCore::functionRenamed, this, [this](const QString &prevName,
+                                                               const QString &newName) {
+        MessageWriter writer;
+        writer.string(prevName);
+        writer.string(newName);
+        notify(Event::FunctionRenamed, writer.data);
+    });
+    connect(Core(), &CutterCore::flagsChanged, this, [this]() {
+        notify(Event::FlagsChanged);
+    });
+    connect(Core(), &CutterCore::commentsChanged, this, [this]() {
+        notify(Event::CommentsChanged);
+    });
+    connect(Core(), &CutterCore::instructionChanged, this, [this](RVA offset) {
+        MessageWriter writer;
+        writer.u64(offset);
+        notify(Event::InstructionChanged, writer.data);
+    });
+}
+
+AnalysisServer::~AnalysisServer()
+{
+    close();
+}
+
+bool AnalysisServer::listen(const QString &name)
+{
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    if (server->listen(name)) {
+        return true;
+    }
+    if (server->serverError() == QAbstractSocket::AddressInUseError && QLocalServer::removeServer(name)) {
+        return server->listen(name);
+    }
+    return false;
+}
+
+void AnalysisServer::close()
+{
+    server->close();
+    while (!clients.isEmpty()) {
+        removeClient(clients.first());
+    }
+}
+
+bool AnalysisServer::isListening() const
+{
+    return server->isListening();
+}
+
+QString AnalysisServer::errorString() const
+{
+    return server->errorString();
+}
+
+void AnalysisServer::acceptClients()
+{
+    while (QLocalSocket *socket = server->nextPendingConnection()) {
+        Client *client = new Client;
+        client->socket = socket;
+        clients.append(client);
+        connect(socket, &QLocalSocket::readyRead, this, [this, client]() {
+            readRequests(client);
+        });
+        connect(socket, &QLocalSocket::disconnected, this, [this, client]() {
+            removeClient(client);
+        });
+        emit clientCountChanged(clients.size());
+    }
+}
+
+void AnalysisServer::removeClient(Client *client)
+{
+    if (!clients.removeOne(client)) {
+        return;
+    }
+    client->socket->disconnect(this);
+    client->socket->abort();
+    client->socket->deleteLater();
+    delete client;
+    emit clientCountChanged(clients.size());
+}
+
+void AnalysisServer::readRequests(Client *client)
+{
+    client->buffer.append(client->socket->readAll());
+    if (client->busy) {
+        // Re-entered from a nested event loop, the outer call picks up the new data
+        return;
+    }
+    client->busy = true;
+
+    // Handle every complete frame in the buffer, replies are queued in the socket's
+    // write buffer and leave together once control returns to the event loop
+    int pos = 0;
+    while (client->buffer.size() - pos >= 4) {
+        quint32 length = qFromLittleEndian<quint32>(client->buffer.constData() + pos);
+        if (length < FRAME_HEADER_SIZE - 4 || length > MAX_FRAME_SIZE) {
+            client->busy = false;
+            removeClient(client);
+            return;
+        }
+        if (static_cast<quint32>(client->buffer.size() - pos - 4) < length) {
+            break;
+        }
+        const char *frame = client->buffer.constData() + pos + 4;
+        quint32 requestId = qFromLittleEndian<quint32>(frame);
+        auto type = static_cast<Request>(static_cast<quint8>(frame[4]));
+        QByteArray payload(frame + 5, static_cast<int>(length - 5));
+        pos += 4 + static_cast<int>(length);
+
+        if (type == Request::Subscribe) {
+            MessageReader reader(payload);
+            client->subscribed = reader.u8() != 0;
+        }
+
+        Status status = Status::Ok;
+        QByteArray reply = handleRequest(type, payload, &status);
+        if (!clients.contains(client)) {
+            // A mutation above may have run a nested event loop which dropped this client
+            return;
+        }
+
+        MessageWriter writer;
+        writer.u32(static_cast<quint32>(FRAME_HEADER_SIZE - 4 + reply.size()));
+        writer.u32(requestId);
+        writer.u8(static_cast<quint8>(status));
+        writer.data.append(reply);
+        client->socket->write(writer.data);
+    }
+    client->buffer.remove(0, pos);
+    client->busy = false;
+}
+
+QByteArray AnalysisServer::handleRequest(Request type, const QByteArray &payload, Status *status)
+{
+    MessageReader reader(payload);
+    MessageWriter writer;
+
+    auto error = [status](const QString &message) {
+        *status = Status::Error;
+        MessageWriter writer;
+        writer.string(message);
+        return writer.data;
+    };
+
+    switch (type) {
+    case Request::Hello:
+        writer.u32(ProtocolVersion);
+        writer.string(Core()->getConfig("file.path"));
+        break;
+    case Request::Functions: {
+        QList<FunctionDescription> functions = Core()->getAllFunctions();
+        writer.u32(static_cast<quint32>(functions.size()));
+        for (const FunctionDescription &function : functions) {
+            writer.u64(function.offset);
+            writer.u64(function.linearSize);
+            writer.u64(function.nbbs);
+            writer.string(function.name);
+        }
+        break;
+    }
+    case Request::XRefs: {
+        RVA addr = reader.u64();
+        bool to = reader.u8() != 0;
+        if (!reader.isOk()) {
+            break;
+        }
+        QList<XrefDescription> xrefs = Core()->getXRefs(addr, to, false);
+        writer.u32(static_cast<quint32>(xrefs.size()));
+        for (const XrefDescription &xref : xrefs) {
+            writer.u64(xref.from);
+            writer.u64(xref.to);
+            writer.string(xref.type);
+            writer.string(xref.from_str);
+        }
+        break;
+    }
+    case Request::Disassemble: {
+        RVA addr = reader.u64();
+        quint32 lines = reader.u32();
+        if (!reader.isOk()) {
+            break;
+        }
+        QList<DisassemblyLine> disassembly = Core()->disassembleLines(addr, static_cast<int>(qMin(lines, 100000u)));
+        writer.u32(static_cast<quint32>(disassembly.size()));
+        for (const DisassemblyLine &line : disassembly) {
+            writer.u64(line.offset);
+            writer.string(line.text);
+        }
+        break;
+    }
+    case Request::ReadMemory: {
+        RVA addr = reader.u64();
+        quint32 length = reader.u32();
+        if (!reader.isOk()) {
+            break;
+        }
+        if (length > MAX_READ_LENGTH) {
+            return error(tr("Read of %1 bytes exceeds the limit of %2").arg(length).arg(MAX_READ_LENGTH));
+        }
+        writer.bytes(Core()->ioRead(addr, static_cast<int>(length)));
+        break;
+    }
+    case Request::Command: {
+        QString command = reader.string();
+        if (!reader.isOk()) {
+            break;
+        }
+        writer.string(Core()->cmd(command));
+        break;
+    }
+    case Request::RenameFunction: {
+        QString oldName = reader.string();
+        QString newName = reader.string();
+        if (!reader.isOk()) {
+            break;
+        }
+        Core()->renameFunction(oldName, newName);
+        break;
+    }
+    case Request::SetComment: {
+        RVA addr = reader.u64();
+        QString comment = reader.string();
+        if (!reader.isOk()) {
+            break;
+        }
+        if (comment.isEmpty()) {
+            Core()->delComment(addr);
+        } else {
+            Core()->setComment(addr, comment);
+        }
+        break;
+    }
+    case Request::SetFlag: {
+        RVA addr = reader.u64();
+        QString name = reader.string();
+        RVA size = reader.u64();
+        if (!reader.isOk()) {
+            break;
+        }
+        Core()->addFlag(addr, name, size);
+        break;
+    }
+    case Request::DeleteFlag: {
+        QString name = reader.string();
+        if (!reader.isOk()) {
+            break;
+        }
+        Core()->delFlag(name);
+        break;
+    }
+    case Request::Subscribe:
+        // Handled by readRequests(), only the payload is validated here
+        reader.u8();
+        break;
+    default:
+        return error(tr("Unknown request type %1").arg(static_cast<int>(type)));
+    }
+
+    if (!reader.isOk()) {
+        return error(tr("Truncated request"));
+    }
+    return writer.data;
+}
+
+void AnalysisServer::notify(Event event, const QByteArray &payload)
+{
+    MessageWriter writer;
+    writer.u32(static_cast<quint32>(FRAME_HEADER_SIZE - 4 + payload.size()));
+    writer.u32(0);
+    writer.u8(0x80 | static_cast<quint8>(event));
+    writer.data.append(payload);
+    for (Client *client : clients) {
+        if (client->subscribed) {
+            client->socket->write(writer.data);
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef ANALYSISSERVER_H
+#define ANALYSISSERVER_H
+
+#include "core/Cutter.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+
+class QLocalServer;
+class QLocalSocket;
+
+/**
+ * @brief Serves the analysis held by Core() to other processes over a local socket.
+ *
+ * All integers are little endian. Every message is a frame:
+ * @code
+ * u32 length      // size of everything after this field
+ * u32 requestId   // chosen by the client, 0 for notifications
+ * u8  type        // Request for requests, Status for replies, 0x80 | Event for notifications
+ * ...             // payload
+ * @endcode
+ * Strings are a u32 byte count followed by UTF-8, byte arrays use the same encoding.
+ *
+ * Clients may send any number of requests without waiting for replies. Requests of one
+ * client are executed in the order they were sent and replies carry the requestId of the
+ * request they answer. A reply with Status::Error carries a string describing the error.
+ *
+ * After Request::Subscribe, the client additionally receives notifications for the changes
+ * CutterCore signals: those made with the typed requests of any client and with the editing
+ * actions of the GUI. Changes made with Request::Command or in the r2 console are only
+ * notified if they trigger a refresh.
+ *
+ * The GUI does not connect to a server, it keeps working on Core() in process.
+ */
+class AnalysisServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr quint32 ProtocolVersion = 1;
+
+    enum class Request : quint8 {
+        Hello = 0,          ///< -> u32 protocol version, string file name
+        Functions,          ///< -> u32 count, count * (u64 offset, u64 size, u64 basic blocks, string name)
+        XRefs,              ///< u64 address, u8 to -> u32 count, count * (u64 from, u64 to, string type, string from)
+        Disassemble,        ///< u64 address, u32 lines -> u32 count, count * (u64 offset, string text)
+        ReadMemory,         ///< u64 address, u32 length -> bytes
+        Command,            ///< string command -> string output
+        RenameFunction,     ///< string old name, string new name -> (empty)
+        SetComment,         ///< u64 address, string comment, an empty comment deletes it -> (empty)
+        SetFlag,            ///< u64 address, string name, u64 size -> (empty)
+        DeleteFlag,         ///< string name -> (empty)
+        Subscribe,          ///< u8 enable -> (empty)
+        RequestCount
+    };
+
+    enum class Status : quint8 {
+        Ok = 0,
+        Error = 1
+    };
+
+    enum class Event : quint8 {
+        Refresh = 0,        ///< (empty), everything may have changed
+        FunctionsChanged,   ///< (empty)
+        FunctionRenamed,    ///< string old name, string new name
+        FlagsChanged,       ///< (empty)
+        CommentsChanged,    ///< (empty)
+        InstructionChanged  ///< u64 address
+    };
+
+    explicit AnalysisServer(QObject *parent = nullptr);
+    ~AnalysisServer() override;
+
+    /**
+     * @brief Start listening on a local socket, a named pipe on Windows.
+     * A stale socket left behind by a crashed server with the same name is removed.
+     */
+    bool listen(const QString &name);
+    void close();
+    bool isListening() const;
+    QString errorString() const;
+
+    int clientCount() const     { return clients.size(); }
+
+signals:
+    void clientCountChanged(int count);
+
+private:
+    struct Client {
+        QLocalSocket *socket;
+        QByteArray buffer;
+        bool subscribed = false;
+        bool busy = false;
+    };
+
+    QLocalServer *server;
+    QList<Client *> clients;
+
+    void acceptClients();
+    void readRequests(Client *client);
+    void removeClient(Client *client);
+    QByteArray handleRequest(Request type, const QByteArray &payload, Status *status);
+    void notify(Event event, const QByteArray &payload = QByteArray());
+};
+
+#endif // ANALYSISSERVER_H
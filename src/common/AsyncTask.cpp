@@ -7,6 +7,7 @@ AsyncTask::AsyncTask()
 {
     setAutoDelete(false);
     running = false;
+    interrupted = false;
 }
 
 AsyncTask::~AsyncTask()
@@ -64,6 +65,11 @@ void AsyncTask::log(QString s)
     emit logChanged(logBuffer);
 }
 
+void AsyncTask::setProgress(int value, int maximum)
+{
+    emit progressChanged(value, maximum);
+}
+
 AsyncTaskManager::AsyncTaskManager(QObject *parent)
     : QObject(parent)
 {
@@ -42,9 +42,16 @@ protected:
 
     void log(QString s);
 
+    /**
+     * @brief Report determinate progress of the task
+     * @param maximum total amount of work, 0 if unknown
+     */
+    void setProgress(int value, int maximum);
+
 signals:
     void finished();
     void logChanged(const QString &log);
+    void progressChanged(int value, int maximum);
 
 private:
     bool running;
@@ -0,0 +1,171 @@
+#include "BackgroundIndex.h"
+
+constexpr int BackgroundIndex::DefaultBuildDelay;
+
+BackgroundIndex::BackgroundIndex(int buildDelayMs)
+{
+    buildTimer.setSingleShot(true);
+    buildTimer.setInterval(buildDelayMs);
+    connect(&buildTimer, &QTimer::timeout, this, &BackgroundIndex::build);
+}
+
+void BackgroundIndex::build()
+{
+    buildTimer.stop();
+    if (task) {
+        return;
+    }
+    buildPending = false;
+    // Set first, so that no other thread takes the index for ready in between
+    building = true;
+    AsyncTask::Ptr newTask = createBuildTask();
+    if (!newTask) {
+        building = false;
+        buildFinished(nullptr);
+        return;
+    }
+    task = newTask;
+    connect(task.data(), &AsyncTask::finished, this, &BackgroundIndex::onTaskFinished);
+    Core()->getAsyncTaskManager()->start(task);
+}
+
+void BackgroundIndex::onTaskFinished()
+{
+    if (!task || sender() != task.data()) {
+        // Cancelled while it was running
+        return;
+    }
+    AsyncTask::Ptr finished = task;
+    task.clear();
+    building = false;
+    buildFinished(finished.data());
+    // An interrupted build is not repeated by itself, only by the next explicit one
+    if (buildPending && !finished->isInterrupted()) {
+        buildTimer.start();
+    }
+    buildPending = false;
+}
+
+void BackgroundIndex::scheduleBuild()
+{
+    if (task) {
+        buildPending = true;
+    } else {
+        buildTimer.start();
+    }
+}
+
+void BackgroundIndex::cancelBuild()
+{
+    if (task) {
+        task->interrupt();
+        task.clear();
+        building = false;
+    }
+    buildTimer.stop();
+    buildPending = false;
+}
+
+FunctionIndex::FunctionIndex()
+{
+    connect(Core(), &CutterCore::functionsChanged, this, &FunctionIndex::scheduleUpdate);
+    connect(Core(), &CutterCore::instructionChanged, this, &FunctionIndex::onInstructionChanged);
+    connect(Core(), &CutterCore::refreshAll, this, &FunctionIndex::scheduleUpdate);
+    connect(Core(), &CutterCore::codeRebased, this, &FunctionIndex::invalidate);
+}
+
+AsyncTask::Ptr FunctionIndex::createBuildTask()
+{
+    QList<FunctionDescription> changed;
+    QSet<RVA> present;
+    for (const FunctionDescription &function : Core()->getAllFunctions()) {
+        present.insert(function.offset);
+        auto it = shapes.constFind(function.offset);
+        if (it == shapes.constEnd()
+                || it->size != function.linearSize
+                || it->blocks != static_cast<int>(function.nbbs)
+                || dirtyFunctions.contains(function.offset)) {
+            changed.append(function);
+        }
+    }
+    QList<RVA> removed;
+    for (auto it = shapes.begin(); it != shapes.end();) {
+        if (present.contains(it.key())) {
+            ++it;
+        } else {
+            removed.append(it.key());
+            it = shapes.erase(it);
+        }
+    }
+    dirtyFunctions.clear();
+    built = true;
+    stale = false;
+    if (!removed.isEmpty()) {
+        removeFunctions(removed);
+    }
+    if (changed.isEmpty()) {
+        return nullptr;
+    }
+
+    buildingShapes.clear();
+    for (const FunctionDescription &function : changed) {
+        buildingShapes.insert(function.offset, { function.linearSize, static_cast<int>(function.nbbs) });
+    }
+    return createTask(changed);
+}
+
+void FunctionIndex::buildFinished(AsyncTask *task)
+{
+    if (task) {
+        for (RVA offset : takeResults(task)) {
+            shapes.insert(offset, buildingShapes.value(offset));
+        }
+        buildingShapes.clear();
+        if (task->isInterrupted()) {
+            // The next build() picks up the functions the task did not get to
+            stale = true;
+        }
+    }
+    indexChanged();
+    if (isReady()) {
+        emit ready();
+    }
+}
+
+void FunctionIndex::invalidate()
+{
+    cancelBuild();
+    shapes.clear();
+    buildingShapes.clear();
+    dirtyFunctions.clear();
+    built = false;
+    stale = false;
+    clearFunctions();
+    indexChanged();
+}
+
+void FunctionIndex::markDirty(RVA function)
+{
+    dirtyFunctions.insert(function);
+    scheduleUpdate();
+}
+
+void FunctionIndex::scheduleUpdate()
+{
+    if (!built) {
+        return;
+    }
+    stale = true;
+    scheduleBuild();
+}
+
+void FunctionIndex::onInstructionChanged(RVA offset)
+{
+    if (!built) {
+        return;
+    }
+    RAnalFunction *fcn = Core()->functionIn(offset);
+    if (fcn) {
+        markDirty(fcn->addr);
+    }
+}
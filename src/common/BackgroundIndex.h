@@ -0,0 +1,130 @@
+#ifndef BACKGROUNDINDEX_H
+#define BACKGROUNDINDEX_H
+
+#include "core/Cutter.h"
+#include "common/AsyncTask.h"
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+
+#include <atomic>
+
+/**
+ * @brief Base of the caches built from the analysis by an AsyncTask, like XrefIndex.
+ *
+ * At most one build task runs at a time. The results of a task are dropped if cancelBuild()
+ * was called while it ran. scheduleBuild() starts the next build after a delay, so that a
+ * burst of changes to the analysis is handled by one build, or once the running one is done.
+ * Subclasses create the task in createBuildTask() and take its results in buildFinished().
+ *
+ * It must only be used from the GUI thread, except for isBuilding().
+ */
+class BackgroundIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultBuildDelay = 1000;
+
+    bool isBuilding() const         { return building; }
+
+public slots:
+    /**
+     * @brief Start a build unless one is running already
+     */
+    void build();
+
+protected:
+    explicit BackgroundIndex(int buildDelayMs = DefaultBuildDelay);
+
+    /**
+     * @return the task building the index, nullptr if there is nothing to build
+     */
+    virtual AsyncTask::Ptr createBuildTask() = 0;
+    /**
+     * @brief Take the results of task, which may have been interrupted.
+     * Called with nullptr when createBuildTask() had nothing to build.
+     */
+    virtual void buildFinished(AsyncTask *task) = 0;
+
+    void scheduleBuild();
+    /**
+     * @brief Interrupt the running build and forget about scheduled ones
+     */
+    void cancelBuild();
+
+private:
+    AsyncTask::Ptr task;
+    std::atomic<bool> building { false };
+    bool buildPending = false;
+    QTimer buildTimer;
+
+    void onTaskFinished();
+};
+
+/**
+ * @brief BackgroundIndex holding data per analyzed function, like ConstantIndex.
+ *
+ * A build only indexes the functions that were added, changed in size or block count or
+ * were marked with markDirty(), and removes the ones that are gone. Functions containing a
+ * patched instruction are marked automatically. Once built, the index follows the analysis.
+ *
+ * isReady() may be called from any thread.
+ */
+class FunctionIndex : public BackgroundIndex
+{
+    Q_OBJECT
+
+public:
+    bool isReady() const            { return built && !stale && !isBuilding(); }
+
+signals:
+    void ready();
+
+protected:
+    FunctionIndex();
+
+    bool isBuilt() const            { return built; }
+    /**
+     * @brief Index function again with the next build
+     */
+    void markDirty(RVA function);
+    void scheduleUpdate();
+    /**
+     * @brief Drop everything, e.g. when the code was rebased, the next build() starts over
+     */
+    void invalidate();
+
+    virtual AsyncTask::Ptr createTask(const QList<FunctionDescription> &functions) = 0;
+    /**
+     * @brief Store the results of a finished task
+     * @return the functions it indexed, fewer than it was given if it was interrupted
+     */
+    virtual QList<RVA> takeResults(AsyncTask *task) = 0;
+    virtual void removeFunctions(const QList<RVA> &functions) = 0;
+    virtual void clearFunctions() = 0;
+    /**
+     * @brief Called after every build and invalidate(), e.g. to update the memory account
+     */
+    virtual void indexChanged() {}
+
+private:
+    struct Shape {
+        RVA size;
+        int blocks;
+    };
+
+    QHash<RVA, Shape> shapes;           ///< of the indexed functions
+    QHash<RVA, Shape> buildingShapes;   ///< of the functions given to the running task
+    QSet<RVA> dirtyFunctions;
+    std::atomic<bool> built { false };
+    std::atomic<bool> stale { false };
+
+    AsyncTask::Ptr createBuildTask() override;
+    void buildFinished(AsyncTask *task) override;
+    void onInstructionChanged(RVA offset);
+};
+
+#endif // BACKGROUNDINDEX_H
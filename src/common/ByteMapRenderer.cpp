@@ -0,0 +1,404 @@
+#include "ByteMapRenderer.h"
+#include "common/JsonReader.h"
+
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+constexpr int ByteMapRenderer::TileSize;
+constexpr int ByteMapRenderer::MaxZoomLevel;
+constexpr RVA ByteMapRenderer::SampleBytes;
+constexpr RVA ByteMapRenderer::EntropyWindow;
+
+namespace {
+
+/**
+ * Largest single read, the core is unlocked in between so the UI stays responsive.
+ */
+const RVA MAX_READ_SIZE = 1024 * 1024;
+
+double entropy(const quint8 *data, size_t size)
+{
+    if (!size) {
+        return 0.0;
+    }
+    std::array<quint32, 256> counts;
+    counts.fill(0);
+    for (size_t i = 0; i < size; i++) {
+        counts[data[i]]++;
+    }
+    double result = 0.0;
+    for (quint32 count : counts) {
+        if (count) {
+            double p = double(count) / size;
+            result -= p * std::log2(p);
+        }
+    }
+    return result / 8.0;
+}
+
+}
+
+ByteMapLayout ByteMapLayout::fromCore()
+{
+    std::vector<std::pair<RVA, RVA>> maps;
+    Core()->cmdjStream("omj", [&maps](JsonReader &reader) {
+        reader.readArray([&maps](JsonReader &reader) {
+            RVA from = RVA_INVALID;
+            RVA to = RVA_INVALID;
+            reader.readObject([&from, &to](const JsonReader::Key &key, JsonReader &reader) {
+                if (key == "from") {
+                    from = reader.readUInt64(RVA_INVALID);
+                } else if (key == "to") {
+                    to = reader.readUInt64(RVA_INVALID);
+                }
+            });
+            if (from != RVA_INVALID && to != RVA_INVALID && to > from) {
+                maps.emplace_back(from, to);
+            }
+        });
+    });
+    if (maps.empty()) {
+        for (const SectionDescription &section : Core()->getAllSections()) {
+            if (section.vsize) {
+                maps.emplace_back(section.vaddr, section.vaddr + section.vsize);
+            }
+        }
+    }
+
+    std::sort(maps.begin(), maps.end());
+    ByteMapLayout layout;
+    RVA start = RVA_INVALID;
+    RVA end = 0;
+    for (const auto &map : maps) {
+        if (start != RVA_INVALID && map.first <= end) {
+            end = std::max(end, map.second);
+            continue;
+        }
+        if (start != RVA_INVALID) {
+            layout.addRange(start, end - start);
+        }
+        start = map.first;
+        end = map.second;
+    }
+    if (start != RVA_INVALID) {
+        layout.addRange(start, end - start);
+    }
+    return layout;
+}
+
+void ByteMapLayout::addRange(RVA address, RVA size)
+{
+    ranges.push_back({address, size, totalSize});
+    totalSize += size;
+}
+
+RVA ByteMapLayout::addressAt(RVA position) const
+{
+    if (position >= totalSize) {
+        return RVA_INVALID;
+    }
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), position,
+    [](RVA position, const Range &range) {
+        return position < range.position;
+    });
+    --it;
+    return it->address + (position - it->position);
+}
+
+RVA ByteMapLayout::positionOf(RVA address) const
+{
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), address,
+    [](RVA address, const Range &range) {
+        return address < range.address;
+    });
+    if (it == ranges.begin()) {
+        return RVA_INVALID;
+    }
+    --it;
+    if (address - it->address >= it->size) {
+        return RVA_INVALID;
+    }
+    return it->position + (address - it->address);
+}
+
+ByteMapRenderer::ByteMapRenderer(const ByteMapLayout &layout, ByteMapColoring coloring,
+                                 int zoomLevel)
+    : layout(layout), coloring(coloring), zoomLevel(qBound(0, zoomLevel, MaxZoomLevel)),
+      analysis(std::make_shared<Analysis>())
+{
+}
+
+ByteMapRenderer ByteMapRenderer::withView(ByteMapColoring coloring, int zoomLevel) const
+{
+    ByteMapRenderer renderer(*this);
+    renderer.coloring = coloring;
+    renderer.zoomLevel = qBound(0, zoomLevel, MaxZoomLevel);
+    return renderer;
+}
+
+quint64 ByteMapRenderer::tileKey(ByteMapColoring coloring, int zoomLevel, quint64 tile)
+{
+    return (tile << 8) | (quint64(zoomLevel) << 3) | quint64(coloring);
+}
+
+void ByteMapRenderer::loadAnalysis()
+{
+    if (coloring != ByteMapColoring::AnalysisType) {
+        return;
+    }
+    QMutexLocker locker(&analysis->mutex);
+    if (analysis->loaded) {
+        return;
+    }
+    Intervals &functions = analysis->functions;
+    Intervals &strings = analysis->strings;
+    Intervals &executable = analysis->executable;
+    for (const FunctionDescription &function : Core()->getAllFunctions()) {
+        functions.emplace_back(function.offset, function.offset + qMax<RVA>(function.linearSize, 1));
+    }
+    for (const StringDescription &string : Core()->getAllStrings()) {
+        strings.emplace_back(string.vaddr, string.vaddr + qMax<RVA>(string.size, 1));
+    }
+    for (const SectionDescription &section : Core()->getAllSections()) {
+        if (section.perm.contains('x')) {
+            executable.emplace_back(section.vaddr, section.vaddr + section.vsize);
+        }
+    }
+    normalize(functions);
+    normalize(strings);
+    normalize(executable);
+    analysis->loaded = true;
+}
+
+void ByteMapRenderer::normalize(Intervals &intervals)
+{
+    std::sort(intervals.begin(), intervals.end());
+    size_t out = 0;
+    for (size_t i = 0; i < intervals.size(); i++) {
+        if (out > 0 && intervals[i].first <= intervals[out - 1].second) {
+            intervals[out - 1].second = std::max(intervals[out - 1].second, intervals[i].second);
+        } else {
+            intervals[out++] = intervals[i];
+        }
+    }
+    intervals.resize(out);
+}
+
+bool ByteMapRenderer::intervalsContain(const Intervals &intervals, RVA address)
+{
+    auto it = std::upper_bound(intervals.begin(), intervals.end(), address,
+    [](RVA address, const std::pair<RVA, RVA> &interval) {
+        return address < interval.first;
+    });
+    if (it == intervals.begin()) {
+        return false;
+    }
+    --it;
+    return address < it->second;
+}
+
+ByteMapRenderer::AnalysisType ByteMapRenderer::analysisTypeAt(RVA address) const
+{
+    if (intervalsContain(analysis->functions, address)) {
+        return AnalysisType::Function;
+    }
+    if (intervalsContain(analysis->strings, address)) {
+        return AnalysisType::String;
+    }
+    if (intervalsContain(analysis->executable, address)) {
+        return AnalysisType::Executable;
+    }
+    return AnalysisType::Unknown;
+}
+
+void ByteMapRenderer::readLinear(RVA position, RVA size, quint8 *out) const
+{
+    const auto &ranges = layout.getRanges();
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), position,
+    [](RVA position, const ByteMapLayout::Range &range) {
+        return position < range.position;
+    });
+    if (it == ranges.begin()) {
+        return;
+    }
+    --it;
+    while (size > 0 && it != ranges.end()) {
+        RVA offset = position - it->position;
+        RVA count = std::min(size, it->size - offset);
+        for (RVA done = 0; done < count;) {
+            RVA chunk = std::min(count - done, MAX_READ_SIZE);
+            RCoreLocked core = Core()->core();
+            if (!r_io_read_at(core->io, it->address + offset + done, out + done,
+                              static_cast<int>(chunk))) {
+                std::fill(out + done, out + done + chunk, 0xff);
+            }
+            done += chunk;
+        }
+        out += count;
+        position += count;
+        size -= count;
+        ++it;
+    }
+}
+
+QImage ByteMapRenderer::renderTile(quint64 tile) const
+{
+    QImage image(TileSize, TileSize, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+
+    const RVA total = layout.getTotalSize();
+    const RVA bpp = bytesPerPixel();
+    const RVA tileStart = tile * bytesPerTile();
+    if (tileStart >= total) {
+        return image;
+    }
+    const bool sampled = bpp > SampleBytes;
+    const RVA stride = sampled ? SampleBytes : bpp;
+    // Entropy is measured over windows of at least EntropyWindow bytes, all pixels of a
+    // window get the same value
+    const RVA window = std::max(stride, EntropyWindow);
+    std::vector<quint8> data;
+    std::vector<double> windowEntropy;
+
+    for (int row = 0; row < TileSize; row++) {
+        const RVA rowStart = tileStart + RVA(row) * TileSize * bpp;
+        if (rowStart >= total) {
+            break;
+        }
+        const int rowPixels = static_cast<int>(std::min<RVA>(TileSize, (total - rowStart + bpp - 1) / bpp));
+
+        // Bytes of pixel i are data[i * stride, i * stride + length(i))
+        std::vector<RVA> lengths(static_cast<size_t>(rowPixels));
+        data.assign(static_cast<size_t>(rowPixels) * stride, 0);
+        if (!sampled) {
+            RVA size = std::min<RVA>(RVA(rowPixels) * bpp, total - rowStart);
+            readLinear(rowStart, size, data.data());
+            for (int i = 0; i < rowPixels; i++) {
+                lengths[static_cast<size_t>(i)] = std::min(bpp, size - RVA(i) * bpp);
+            }
+        } else {
+            for (int i = 0; i < rowPixels; i++) {
+                RVA pixelStart = rowStart + RVA(i) * bpp;
+                RVA length = std::min(stride, total - pixelStart);
+                readLinear(pixelStart, length, data.data() + RVA(i) * stride);
+                lengths[static_cast<size_t>(i)] = length;
+            }
+        }
+
+        if (coloring == ByteMapColoring::Entropy) {
+            windowEntropy.clear();
+            for (RVA start = 0; start < data.size(); start += window) {
+                RVA pixel = start / stride;
+                RVA length = 0;
+                for (RVA p = pixel; p < pixel + window / stride && p < RVA(rowPixels); p++) {
+                    length = (p - pixel) * stride + lengths[static_cast<size_t>(p)];
+                }
+                windowEntropy.push_back(entropy(data.data() + start, static_cast<size_t>(length)));
+            }
+        }
+
+        auto *line = reinterpret_cast<QRgb *>(image.scanLine(row));
+        for (int i = 0; i < rowPixels; i++) {
+            const quint8 *bytes = data.data() + RVA(i) * stride;
+            const RVA length = lengths[static_cast<size_t>(i)];
+            QColor color;
+            switch (coloring) {
+            case ByteMapColoring::ByteValue: {
+                RVA sum = 0;
+                for (RVA j = 0; j < length; j++) {
+                    sum += bytes[j];
+                }
+                color = byteValueColor(length ? double(sum) / (length * 255.0) : 0.0);
+                break;
+            }
+            case ByteMapColoring::Entropy:
+                color = entropyColor(windowEntropy[static_cast<size_t>(RVA(i) * stride / window)]);
+                break;
+            case ByteMapColoring::ByteClass: {
+                int r = 0, g = 0, b = 0;
+                for (RVA j = 0; j < length; j++) {
+                    QColor c = byteClassColor(bytes[j]);
+                    r += c.red();
+                    g += c.green();
+                    b += c.blue();
+                }
+                int n = static_cast<int>(std::max<RVA>(length, 1));
+                color = QColor(r / n, g / n, b / n);
+                break;
+            }
+            case ByteMapColoring::AnalysisType:
+                color = analysisColor(analysisTypeAt(layout.addressAt(rowStart + RVA(i) * bpp)));
+                break;
+            }
+            line[i] = color.rgba();
+        }
+    }
+    return image;
+}
+
+QColor ByteMapRenderer::byteValueColor(double value)
+{
+    return QColor::fromRgbF(value, value, value);
+}
+
+QColor ByteMapRenderer::entropyColor(double entropy)
+{
+    entropy = qBound(0.0, entropy, 1.0);
+    // Dark blue for uniform data up to bright red for compressed or encrypted data
+    return QColor::fromHsvF((1.0 - entropy) * 0.66, 1.0, 0.15 + 0.85 * entropy);
+}
+
+QColor ByteMapRenderer::byteClassColor(quint8 byte)
+{
+    if (byte == 0x00) {
+        return QColor(0, 0, 0);
+    }
+    if (byte == 0xff) {
+        return QColor(255, 255, 255);
+    }
+    if ((byte >= 0x20 && byte < 0x7f) || byte == '\t' || byte == '\n' || byte == '\r') {
+        return QColor(55, 126, 184);
+    }
+    if (byte < 0x20) {
+        return QColor(77, 175, 74);
+    }
+    return QColor(228, 26, 28);
+}
+
+QColor ByteMapRenderer::analysisColor(AnalysisType type)
+{
+    switch (type) {
+    case AnalysisType::Function:
+        return QColor(77, 175, 74);
+    case AnalysisType::String:
+        return QColor(255, 170, 0);
+    case AnalysisType::Executable:
+        return QColor(55, 126, 184);
+    case AnalysisType::Unknown:
+    default:
+        return QColor(60, 60, 60);
+    }
+}
+
+ByteMapTileTask::ByteMapTileTask(const ByteMapRenderer &renderer, const QList<quint64> &tiles)
+    : renderer(renderer), tiles(tiles)
+{
+}
+
+void ByteMapTileTask::runTask()
+{
+    renderer.loadAnalysis();
+    int done = 0;
+    for (quint64 tile : tiles) {
+        if (isInterrupted()) {
+            return;
+        }
+        QImage image = renderer.renderTile(tile);
+        emit tileRendered(ByteMapRenderer::tileKey(renderer.getColoring(),
+                                                   renderer.getZoomLevel(), tile), image);
+        setProgress(++done, tiles.size());
+    }
+}
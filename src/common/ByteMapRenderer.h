@@ -0,0 +1,161 @@
+#ifndef BYTEMAPRENDERER_H
+#define BYTEMAPRENDERER_H
+
+#include "core/Cutter.h"
+#include "common/AsyncTask.h"
+
+#include <QColor>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Mapped address ranges laid out back to back, so that the gaps between maps take
+ * no space in a byte map.
+ */
+class ByteMapLayout
+{
+public:
+    struct Range {
+        RVA address;
+        RVA size;
+        RVA position;   ///< offset of the first byte of the range within the layout
+    };
+
+    /**
+     * @brief Layout of the io maps of the current file, overlapping maps are merged.
+     */
+    static ByteMapLayout fromCore();
+
+    /**
+     * @brief Append a range, ranges must be added in ascending order without overlaps.
+     */
+    void addRange(RVA address, RVA size);
+
+    const std::vector<Range> &getRanges() const     { return ranges; }
+    RVA getTotalSize() const                        { return totalSize; }
+    bool isEmpty() const                            { return totalSize == 0; }
+
+    /**
+     * @return address at position, RVA_INVALID past the end of the layout
+     */
+    RVA addressAt(RVA position) const;
+
+    /**
+     * @return position of address, RVA_INVALID if it is not mapped
+     */
+    RVA positionOf(RVA address) const;
+
+private:
+    std::vector<Range> ranges;
+    RVA totalSize = 0;
+};
+
+enum class ByteMapColoring {
+    ByteValue,
+    Entropy,
+    ByteClass,
+    AnalysisType
+};
+
+/**
+ * @brief Renders square tiles of a byte map, one pixel standing for 2^zoomLevel bytes.
+ *
+ * Pixels are laid out in rows of TileSize pixels, so tile n covers the layout positions
+ * starting at n * TileSize * TileSize * bytesPerPixel. Pixels covering more than SampleBytes
+ * bytes are colored from the first SampleBytes of their span only, which keeps the amount
+ * of data read per tile bounded at every zoom level.
+ */
+class ByteMapRenderer
+{
+public:
+    static constexpr int TileSize = 256;
+    static constexpr int MaxZoomLevel = 16;
+    static constexpr RVA SampleBytes = 256;
+    static constexpr RVA EntropyWindow = 256;
+
+    enum class AnalysisType {
+        Unknown,
+        Executable,
+        String,
+        Function
+    };
+
+    ByteMapRenderer(const ByteMapLayout &layout, ByteMapColoring coloring, int zoomLevel);
+
+    /**
+     * @return renderer for the same data with a different coloring or zoom, sharing the analysis
+     */
+    ByteMapRenderer withView(ByteMapColoring coloring, int zoomLevel) const;
+
+    /**
+     * @brief Fetch the analysis data needed for ByteMapColoring::AnalysisType, once for all
+     * copies of this renderer.
+     */
+    void loadAnalysis();
+
+    QImage renderTile(quint64 tile) const;
+
+    const ByteMapLayout &getLayout() const  { return layout; }
+    ByteMapColoring getColoring() const     { return coloring; }
+    int getZoomLevel() const                { return zoomLevel; }
+    RVA bytesPerPixel() const   { return RVA(1) << zoomLevel; }
+    RVA bytesPerTile() const    { return bytesPerPixel() * TileSize * TileSize; }
+
+    /**
+     * @return cache key identifying a tile together with the coloring and zoom it was rendered with
+     */
+    static quint64 tileKey(ByteMapColoring coloring, int zoomLevel, quint64 tile);
+
+    static QColor byteValueColor(double value);
+    static QColor entropyColor(double entropy);
+    static QColor byteClassColor(quint8 byte);
+    static QColor analysisColor(AnalysisType type);
+
+private:
+    using Intervals = std::vector<std::pair<RVA, RVA>>;
+
+    struct Analysis {
+        QMutex mutex;
+        bool loaded = false;
+        Intervals functions;
+        Intervals strings;
+        Intervals executable;
+    };
+
+    ByteMapLayout layout;
+    ByteMapColoring coloring;
+    int zoomLevel;
+    std::shared_ptr<Analysis> analysis;
+
+    void readLinear(RVA position, RVA size, quint8 *out) const;
+    AnalysisType analysisTypeAt(RVA address) const;
+    static void normalize(Intervals &intervals);
+    static bool intervalsContain(const Intervals &intervals, RVA address);
+};
+
+class ByteMapTileTask : public AsyncTask
+{
+    Q_OBJECT
+
+public:
+    ByteMapTileTask(const ByteMapRenderer &renderer, const QList<quint64> &tiles);
+
+    QString getTitle() override     { return tr("Rendering Byte Map"); }
+
+signals:
+    void tileRendered(quint64 key, QImage image);
+
+protected:
+    void runTask() override;
+
+private:
+    ByteMapRenderer renderer;
+    QList<quint64> tiles;
+};
+
+#endif // BYTEMAPRENDERER_H
@@ -6,18 +6,50 @@
 #include <QObject>
 #include <QFont>
 #include <QFontMetrics>
+#include <QHash>
+
+#include <memory>
 
 template<typename T>
 class CachedFontMetrics
 {
 public:
     explicit CachedFontMetrics(const QFont &font)
-        : mFontMetrics(font)
+        : mFontMetrics(font),
+          mId(nextId())
     {
         memset(mWidths, 0, sizeof(mWidths));
         mHeight = mFontMetrics.height();
     }
 
+    /**
+     * @brief Get the metrics of font shared by all users of the same font in the process,
+     * so that the width table is only filled once. Must only be used from the GUI thread.
+     */
+    static std::shared_ptr<CachedFontMetrics<T>> shared(const QFont &font)
+    {
+        static QHash<QString, std::weak_ptr<CachedFontMetrics<T>>> cache;
+        const QString key = font.key();
+        std::shared_ptr<CachedFontMetrics<T>> metrics = cache.value(key).lock();
+        if (!metrics) {
+            for (auto it = cache.begin(); it != cache.end();) {
+                it = it.value().expired() ? cache.erase(it) : it + 1;
+            }
+            metrics = std::make_shared<CachedFontMetrics<T>>(font);
+            cache.insert(key, metrics);
+        }
+        return metrics;
+    }
+
+    /**
+     * @brief Unique identifier of this instance, used to tell whether measurements taken
+     * earlier are still valid
+     */
+    quint64 id() const
+    {
+        return mId;
+    }
+
     T width(const QChar &ch)
     {
         //return mFontMetrics.width(ch);
@@ -81,6 +113,13 @@ private:
     typename Metrics<T>::FontMetrics mFontMetrics;
     T mWidths[0x10000 - 0xE000 + 0xD800];
     T mHeight;
+    quint64 mId;
+
+    static quint64 nextId()
+    {
+        static quint64 counter = 0;
+        return ++counter;
+    }
 
     T fetchWidth(QChar c)
     {
@@ -0,0 +1,353 @@
+#include "CfgRegions.h"
+
+#include <QCoreApplication>
+
+#include <algorithm>
+#include <utility>
+
+constexpr size_t CfgRegions::MinRegionBlocks;
+
+namespace {
+
+/**
+ * @brief Graph with nodes numbered 0..n-1 in the order they are reached from node 0.
+ */
+struct IndexedGraph {
+    std::vector<std::vector<int>> successors;
+    std::vector<std::vector<int>> predecessors;
+};
+
+/**
+ * @return nodes reachable from root in reverse post order
+ */
+std::vector<int> reversePostOrder(const std::vector<std::vector<int>> &successors, int root)
+{
+    std::vector<int> order;
+    std::vector<bool> visited(successors.size(), false);
+    std::vector<std::pair<int, size_t>> stack;
+    stack.emplace_back(root, 0);
+    visited[static_cast<size_t>(root)] = true;
+    while (!stack.empty()) {
+        auto &top = stack.back();
+        const auto &next = successors[static_cast<size_t>(top.first)];
+        if (top.second < next.size()) {
+            int child = next[top.second++];
+            if (!visited[static_cast<size_t>(child)]) {
+                visited[static_cast<size_t>(child)] = true;
+                stack.emplace_back(child, 0);
+            }
+        } else {
+            order.push_back(top.first);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+/**
+ * @brief Immediate dominators by the algorithm of Cooper, Harvey and Kennedy.
+ * @return idom of every node, -1 for nodes not reachable from root and root itself
+ */
+std::vector<int> immediateDominators(const std::vector<std::vector<int>> &successors,
+                                     const std::vector<std::vector<int>> &predecessors, int root)
+{
+    const size_t n = successors.size();
+    std::vector<int> order = reversePostOrder(successors, root);
+    std::vector<int> orderIndex(n, -1);
+    for (size_t i = 0; i < order.size(); i++) {
+        orderIndex[static_cast<size_t>(order[i])] = static_cast<int>(i);
+    }
+
+    std::vector<int> idom(n, -1);
+    idom[static_cast<size_t>(root)] = root;
+    auto intersect = [&](int a, int b) {
+        while (a != b) {
+            while (orderIndex[static_cast<size_t>(a)] > orderIndex[static_cast<size_t>(b)]) {
+                a = idom[static_cast<size_t>(a)];
+            }
+            while (orderIndex[static_cast<size_t>(b)] > orderIndex[static_cast<size_t>(a)]) {
+                b = idom[static_cast<size_t>(b)];
+            }
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < order.size(); i++) {
+            int node = order[i];
+            int newIdom = -1;
+            for (int pred : predecessors[static_cast<size_t>(node)]) {
+                if (idom[static_cast<size_t>(pred)] == -1) {
+                    continue;
+                }
+                newIdom = newIdom == -1 ? pred : intersect(pred, newIdom);
+            }
+            if (newIdom != idom[static_cast<size_t>(node)]) {
+                idom[static_cast<size_t>(node)] = newIdom;
+                changed = true;
+            }
+        }
+    }
+    idom[static_cast<size_t>(root)] = -1;
+    return idom;
+}
+
+/**
+ * @brief Pre and post numbering of a dominator tree for constant time dominance checks.
+ */
+struct DominatorTree {
+    std::vector<int> pre;
+    std::vector<int> post;
+
+    explicit DominatorTree(const std::vector<int> &idom, int root)
+        : pre(idom.size(), -1), post(idom.size(), -1)
+    {
+        std::vector<std::vector<int>> children(idom.size());
+        for (size_t i = 0; i < idom.size(); i++) {
+            if (idom[i] >= 0) {
+                children[static_cast<size_t>(idom[i])].push_back(static_cast<int>(i));
+            }
+        }
+        int counter = 0;
+        std::vector<std::pair<int, size_t>> stack;
+        stack.emplace_back(root, 0);
+        pre[static_cast<size_t>(root)] = counter++;
+        while (!stack.empty()) {
+            auto &top = stack.back();
+            const auto &next = children[static_cast<size_t>(top.first)];
+            if (top.second < next.size()) {
+                int child = next[top.second++];
+                pre[static_cast<size_t>(child)] = counter++;
+                stack.emplace_back(child, 0);
+            } else {
+                post[static_cast<size_t>(top.first)] = counter++;
+                stack.pop_back();
+            }
+        }
+    }
+
+    bool dominates(int a, int b) const
+    {
+        size_t ia = static_cast<size_t>(a);
+        size_t ib = static_cast<size_t>(b);
+        return pre[ia] >= 0 && pre[ib] >= 0 && pre[ia] <= pre[ib] && post[ib] <= post[ia];
+    }
+};
+
+}
+
+void CfgRegions::clear()
+{
+    regions.clear();
+    innermost.clear();
+}
+
+void CfgRegions::compute(const Successors &successors, ut64 entry)
+{
+    clear();
+    if (successors.find(entry) == successors.end()) {
+        return;
+    }
+
+    // Number the blocks reachable from the entry
+    std::vector<ut64> addresses;
+    std::unordered_map<ut64, int> indices;
+    addresses.push_back(entry);
+    indices[entry] = 0;
+    for (size_t i = 0; i < addresses.size(); i++) {
+        auto it = successors.find(addresses[i]);
+        for (ut64 target : it->second) {
+            if (successors.find(target) != successors.end() && indices.find(target) == indices.end()) {
+                indices[target] = static_cast<int>(addresses.size());
+                addresses.push_back(target);
+            }
+        }
+    }
+    const int n = static_cast<int>(addresses.size());
+    IndexedGraph graph;
+    graph.successors.resize(static_cast<size_t>(n));
+    graph.predecessors.resize(static_cast<size_t>(n));
+    for (int i = 0; i < n; i++) {
+        for (ut64 target : successors.find(addresses[static_cast<size_t>(i)])->second) {
+            auto it = indices.find(target);
+            if (it != indices.end()) {
+                graph.successors[static_cast<size_t>(i)].push_back(it->second);
+                graph.predecessors[static_cast<size_t>(it->second)].push_back(i);
+            }
+        }
+    }
+
+    std::vector<int> idom = immediateDominators(graph.successors, graph.predecessors, 0);
+    DominatorTree dominators(idom, 0);
+
+    // Post dominators are the dominators of the reversed graph with a virtual exit node n
+    // that all blocks without successors lead to
+    std::vector<std::vector<int>> reversedSuccessors = graph.predecessors;
+    std::vector<std::vector<int>> reversedPredecessors = graph.successors;
+    reversedSuccessors.emplace_back();
+    reversedPredecessors.emplace_back();
+    for (int i = 0; i < n; i++) {
+        if (graph.successors[static_cast<size_t>(i)].empty()) {
+            reversedSuccessors[static_cast<size_t>(n)].push_back(i);
+            reversedPredecessors[static_cast<size_t>(i)].push_back(n);
+        }
+    }
+    std::vector<int> ipdom = immediateDominators(reversedSuccessors, reversedPredecessors, n);
+
+    std::vector<Region> candidates;
+    std::vector<int> mark(static_cast<size_t>(n), -1);
+    std::vector<int> queue;
+    auto addCandidate = [&](Kind kind, int header, int exit, std::vector<int> &body) {
+        if (body.size() < MinRegionBlocks || static_cast<int>(body.size()) >= n) {
+            return;
+        }
+        Region region;
+        region.kind = kind;
+        region.header = addresses[static_cast<size_t>(header)];
+        region.exit = exit >= 0 && exit < n ? addresses[static_cast<size_t>(exit)] : RVA_INVALID;
+        region.blocks.reserve(body.size());
+        for (int node : body) {
+            region.blocks.push_back(addresses[static_cast<size_t>(node)]);
+        }
+        candidates.push_back(std::move(region));
+    };
+
+    // Natural loops, all back edges to the same header form one loop
+    std::vector<std::vector<int>> backEdges(static_cast<size_t>(n));
+    for (int from = 0; from < n; from++) {
+        for (int to : graph.successors[static_cast<size_t>(from)]) {
+            if (dominators.dominates(to, from)) {
+                backEdges[static_cast<size_t>(to)].push_back(from);
+            }
+        }
+    }
+    for (int header = 0; header < n; header++) {
+        if (backEdges[static_cast<size_t>(header)].empty()) {
+            continue;
+        }
+        std::vector<int> body { header };
+        mark[static_cast<size_t>(header)] = header;
+        queue.clear();
+        for (int latch : backEdges[static_cast<size_t>(header)]) {
+            if (mark[static_cast<size_t>(latch)] != header) {
+                mark[static_cast<size_t>(latch)] = header;
+                body.push_back(latch);
+                queue.push_back(latch);
+            }
+        }
+        while (!queue.empty()) {
+            int node = queue.back();
+            queue.pop_back();
+            for (int pred : graph.predecessors[static_cast<size_t>(node)]) {
+                if (mark[static_cast<size_t>(pred)] != header) {
+                    mark[static_cast<size_t>(pred)] = header;
+                    body.push_back(pred);
+                    queue.push_back(pred);
+                }
+            }
+        }
+        int exit = ipdom[static_cast<size_t>(header)];
+        if (exit >= 0 && exit < n && mark[static_cast<size_t>(exit)] == header) {
+            exit = -1;
+        }
+        addCandidate(Kind::Loop, header, exit, body);
+    }
+
+    // Single entry regions from a branch to its immediate post dominator
+    std::fill(mark.begin(), mark.end(), -1);
+    for (int header = 0; header < n; header++) {
+        if (graph.successors[static_cast<size_t>(header)].size() < 2) {
+            continue;
+        }
+        int exit = ipdom[static_cast<size_t>(header)];
+        std::vector<int> body { header };
+        mark[static_cast<size_t>(header)] = header;
+        queue.assign(1, header);
+        bool valid = true;
+        while (!queue.empty() && valid) {
+            int node = queue.back();
+            queue.pop_back();
+            for (int next : graph.successors[static_cast<size_t>(node)]) {
+                if (next == exit || next == header || mark[static_cast<size_t>(next)] == header) {
+                    continue;
+                }
+                if (!dominators.dominates(header, next)) {
+                    // Entered from outside, not a single entry region
+                    valid = false;
+                    break;
+                }
+                mark[static_cast<size_t>(next)] = header;
+                body.push_back(next);
+                queue.push_back(next);
+            }
+        }
+        if (valid) {
+            bool isSwitch = graph.successors[static_cast<size_t>(header)].size() > 2;
+            addCandidate(isSwitch ? Kind::Switch : Kind::Conditional, header, exit, body);
+        }
+    }
+
+    // Keep the regions that nest properly, larger ones first and loops before other
+    // regions with the same blocks
+    std::vector<int> order(candidates.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = static_cast<int>(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&candidates](int a, int b) {
+        const Region &ra = candidates[static_cast<size_t>(a)];
+        const Region &rb = candidates[static_cast<size_t>(b)];
+        if (ra.blocks.size() != rb.blocks.size()) {
+            return ra.blocks.size() > rb.blocks.size();
+        }
+        return ra.kind == Kind::Loop && rb.kind != Kind::Loop;
+    });
+    for (int candidateIndex : order) {
+        Region &candidate = candidates[static_cast<size_t>(candidateIndex)];
+        auto parentIt = innermost.find(candidate.header);
+        int parent = parentIt == innermost.end() ? -1 : parentIt->second;
+        bool nested = true;
+        for (ut64 block : candidate.blocks) {
+            auto it = innermost.find(block);
+            int blockRegion = it == innermost.end() ? -1 : it->second;
+            if (blockRegion != parent) {
+                nested = false;
+                break;
+            }
+        }
+        if (!nested || (parent >= 0
+                        && regions[static_cast<size_t>(parent)].blocks.size() == candidate.blocks.size())) {
+            continue;
+        }
+        int index = static_cast<int>(regions.size());
+        candidate.parent = parent;
+        for (ut64 block : candidate.blocks) {
+            innermost[block] = index;
+        }
+        if (parent >= 0) {
+            regions[static_cast<size_t>(parent)].children.push_back(index);
+        }
+        regions.push_back(std::move(candidate));
+    }
+}
+
+int CfgRegions::innermostRegion(ut64 block) const
+{
+    auto it = innermost.find(block);
+    return it == innermost.end() ? -1 : it->second;
+}
+
+QString CfgRegions::kindName(Kind kind)
+{
+    switch (kind) {
+    case Kind::Loop:
+        return QCoreApplication::translate("CfgRegions", "Loop");
+    case Kind::Switch:
+        return QCoreApplication::translate("CfgRegions", "Switch");
+    case Kind::Conditional:
+    default:
+        return QCoreApplication::translate("CfgRegions", "Conditional");
+    }
+}
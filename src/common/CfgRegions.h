@@ -0,0 +1,58 @@
+#ifndef CFGREGIONS_H
+#define CFGREGIONS_H
+
+#include "core/CutterCommon.h"
+
+#include <QString>
+
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Structural analysis of a control flow graph into a tree of nested regions.
+ *
+ * Regions are natural loops and single entry subgraphs starting at a branch, which extend
+ * up to the immediate post dominator of the branch. Only regions that nest properly are
+ * kept, so every block belongs to a chain of regions from the innermost to a top level one.
+ * Regions spanning the whole function or with fewer than MinRegionBlocks blocks are dropped.
+ */
+class CfgRegions
+{
+public:
+    static constexpr size_t MinRegionBlocks = 3;
+
+    enum class Kind {
+        Loop,
+        Switch,
+        Conditional
+    };
+
+    struct Region {
+        Kind kind;
+        ut64 header;
+        ut64 exit;                  ///< block control continues at, RVA_INVALID if none
+        std::vector<ut64> blocks;   ///< including the header
+        int parent = -1;
+        std::vector<int> children;
+    };
+
+    using Successors = std::unordered_map<ut64, std::vector<ut64>>;
+
+    void compute(const Successors &successors, ut64 entry);
+    void clear();
+
+    const std::vector<Region> &getRegions() const   { return regions; }
+
+    /**
+     * @return index of the smallest region containing block, -1 if there is none
+     */
+    int innermostRegion(ut64 block) const;
+
+    static QString kindName(Kind kind);
+
+private:
+    std::vector<Region> regions;
+    std::unordered_map<ut64, int> innermost;
+};
+
+#endif // CFGREGIONS_H
@@ -0,0 +1,176 @@
+#include "CodePalette.h"
+#include "common/Configuration.h"
+
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+
+#include <functional>
+
+constexpr int CodePalette::NoRole;
+constexpr int CodePalette::RoleProperty;
+
+namespace {
+
+/**
+ * Probe colors are rgb(ProbeRed, ProbeGreen, role), unlikely to be used by anything else
+ * in r2's output.
+ */
+const int ProbeRed = 0x03;
+const int ProbeGreen = 0xc1;
+const int MaxRoles = 0x100;
+
+struct FragmentFormat {
+    int position;
+    int length;
+    QTextCharFormat format;
+};
+
+void forEachFragment(QTextDocument *doc, const std::function<void(const QTextFragment &)> &callback)
+{
+    for (QTextBlock block = doc->begin(); block != doc->end(); block = block.next()) {
+        for (QTextBlock::iterator it = block.begin(); it != block.end(); ++it) {
+            callback(it.fragment());
+        }
+    }
+}
+
+/**
+ * Formats are merged after iterating, merging changes the fragments of the document.
+ */
+void mergeFormats(QTextDocument *doc, const QVector<FragmentFormat> &formats)
+{
+    QTextCursor cursor(doc);
+    for (const FragmentFormat &f : formats) {
+        cursor.setPosition(f.position);
+        cursor.setPosition(f.position + f.length, QTextCursor::KeepAnchor);
+        cursor.mergeCharFormat(f.format);
+    }
+}
+
+}
+
+CodePalette *CodePalette::instance()
+{
+    static CodePalette *palette = new CodePalette();
+    return palette;
+}
+
+CodePalette::CodePalette()
+{
+    rebuild();
+    connect(Config(), &Configuration::colorsUpdated, this, &CodePalette::rebuild);
+}
+
+void CodePalette::rebuild()
+{
+    QVector<bool> newBackgrounds;
+    {
+        RCoreLocked core = Core()->core();
+        int count = qMin(r_cons_pal_len(), MaxRoles);
+        for (int i = 0; i < count; i++) {
+            const char *name = r_cons_pal_get_name(i);
+            // Roles are only appended, documents keep the index of theirs
+            if (name && !roles.contains(QString::fromUtf8(name))) {
+                roles << QString::fromUtf8(name);
+            }
+        }
+        newBackgrounds.reserve(roles.size());
+        for (const QString &role : roles) {
+            RColor color = r_cons_pal_get(role.toUtf8().constData());
+            newBackgrounds << (color.r2 || color.g2 || color.b2);
+        }
+    }
+    bool probedChanged = !backgrounds.isEmpty() && newBackgrounds != backgrounds;
+    backgrounds = newBackgrounds;
+    updateColors();
+    if (probedChanged) {
+        // Tokens of keys with a background are not probed, the code has to be fetched again
+        emit Core()->refreshCodeViews();
+    }
+}
+
+void CodePalette::updateColors()
+{
+    colors.resize(roles.size());
+    for (int i = 0; i < roles.size(); i++) {
+        colors[i] = ConfigColor(roles[i]);
+    }
+    emit colorsChanged();
+}
+
+int CodePalette::roleOf(const QColor &color) const
+{
+    if (color.red() != ProbeRed || color.green() != ProbeGreen || color.blue() >= roles.size()) {
+        return NoRole;
+    }
+    return color.blue();
+}
+
+QColor CodePalette::probeColor(int role)
+{
+    return QColor(ProbeRed, ProbeGreen, role);
+}
+
+void CodePalette::bindRoles(QTextDocument *doc) const
+{
+    QVector<FragmentFormat> formats;
+    forEachFragment(doc, [&](const QTextFragment &fragment) {
+        QTextCharFormat format = fragment.charFormat();
+        if (!format.hasProperty(QTextFormat::ForegroundBrush)) {
+            return;
+        }
+        int role = roleOf(format.foreground().color());
+        if (role == NoRole) {
+            return;
+        }
+        QTextCharFormat roleFormat;
+        roleFormat.setProperty(RoleProperty, role);
+        roleFormat.setForeground(colors[role]);
+        formats.append({ fragment.position(), fragment.length(), roleFormat });
+    });
+    mergeFormats(doc, formats);
+}
+
+void CodePalette::applyColors(QTextDocument *doc) const
+{
+    QVector<FragmentFormat> formats;
+    forEachFragment(doc, [&](const QTextFragment &fragment) {
+        QTextCharFormat format = fragment.charFormat();
+        if (!format.hasProperty(RoleProperty)) {
+            return;
+        }
+        QColor current = color(format.intProperty(RoleProperty));
+        if (format.foreground().color() == current) {
+            return;
+        }
+        QTextCharFormat colorFormat;
+        colorFormat.setForeground(current);
+        formats.append({ fragment.position(), fragment.length(), colorFormat });
+    });
+    mergeFormats(doc, formats);
+}
+
+CodeTokenProbe::CodeTokenProbe()
+    : core(Core()->core())
+{
+    savedPalette = r_cons_singleton()->context->cpal;
+    CodePalette *palette = CodePalette::instance();
+    for (int role = 0; role < palette->roleCount(); role++) {
+        QByteArray name = palette->roleName(role).toUtf8();
+        RColor color = r_cons_pal_get(name.constData());
+        if (color.r2 || color.g2 || color.b2) {
+            continue;
+        }
+        QByteArray probe = QStringLiteral("rgb:%1").arg(CodePalette::probeColor(role).rgb() & 0xffffff,
+                                                        6, 16, QLatin1Char('0')).toUtf8();
+        r_cons_pal_set(name.constData(), probe.constData());
+    }
+    r_cons_pal_update_event();
+}
+
+CodeTokenProbe::~CodeTokenProbe()
+{
+    r_cons_singleton()->context->cpal = savedPalette;
+    r_cons_pal_update_event();
+}
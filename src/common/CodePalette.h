@@ -0,0 +1,121 @@
+#ifndef CODEPALETTE_H
+#define CODEPALETTE_H
+
+#include "core/Cutter.h"
+
+#include <QColor>
+#include <QObject>
+#include <QStringList>
+#include <QTextFormat>
+#include <QVector>
+
+class QTextDocument;
+
+/**
+ * @brief Semantic roles of the tokens in colored code output of r2 (mnemonic, register,
+ * immediate, address, comment, flag name, ...) and their colors in the current theme.
+ *
+ * A role is a key of the r2 palette. Code views keep the role of every token and look up its
+ * color when painting, so that a theme change only repaints them, without fetching and
+ * parsing the code again. The palette is rebuilt on Configuration::colorsUpdated, code views
+ * should repaint on colorsChanged, which follows it.
+ *
+ * It must only be used from the GUI thread.
+ */
+class CodePalette : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int NoRole = -1;
+    /**
+     * @brief Format property of QTextDocument fragments holding their role
+     */
+    static constexpr int RoleProperty = QTextFormat::UserProperty + 0x100;
+
+    static CodePalette *instance();
+
+    int roleCount() const                   { return roles.size(); }
+    /**
+     * @return role of the r2 palette key name or NoRole
+     */
+    int role(const QString &name) const     { return roles.indexOf(name); }
+    const QString &roleName(int role) const { return roles[role]; }
+    QColor color(int role) const
+    {
+        return role >= 0 && role < colors.size() ? colors[role] : QColor();
+    }
+
+    /**
+     * @brief Role of a color found in output produced while a CodeTokenProbe was active
+     * @return NoRole if color does not belong to a role
+     */
+    int roleOf(const QColor &color) const;
+    static QColor probeColor(int role);
+
+    /**
+     * @brief Store the role of every fragment of doc colored by a CodeTokenProbe and set
+     * its color of the current theme
+     */
+    void bindRoles(QTextDocument *doc) const;
+    /**
+     * @brief Set the current colors on all fragments of doc with a role
+     */
+    void applyColors(QTextDocument *doc) const;
+
+public slots:
+    /**
+     * @brief Read the roles and colors of the current theme again, on
+     * Configuration::colorsUpdated. Code views are refreshed if keys gained or lost a
+     * background color, CodeTokenProbe only probes the keys without one.
+     */
+    void rebuild();
+    /**
+     * @brief Read the colors of the roles again, e.g. while a theme is being edited
+     */
+    void updateColors();
+
+signals:
+    void colorsChanged();
+
+private:
+    CodePalette();
+
+    QStringList roles;
+    QVector<QColor> colors;
+    QVector<bool> backgrounds;  ///< whether the key of a role has a background color
+};
+
+/**
+ * @brief Temporarily replaces the r2 palette so that colored output encodes the role of
+ * every token instead of its color, see CodePalette::roleOf.
+ *
+ * The palette is restored at the end of scope. The core stays locked in the meantime,
+ * other threads would get output in the probe colors otherwise.
+ *
+ * Keys with a background color keep their palette, the background would be lost.
+ *
+ * \code
+ * {
+ *     CodeTokenProbe probe;
+ *     TempConfig tempConfig;
+ *     tempConfig.set("scr.color", COLOR_MODE_16M);
+ *     text = Core()->cmdRaw("pd 10");
+ * }
+ * \endcode
+ */
+class CodeTokenProbe
+{
+public:
+    CodeTokenProbe();
+    ~CodeTokenProbe();
+
+private:
+    CodeTokenProbe(const CodeTokenProbe &) = delete;
+    CodeTokenProbe &operator=(const CodeTokenProbe &) = delete;
+
+    RCoreLocked core;
+    RConsPalette savedPalette;
+};
+
+#endif // CODEPALETTE_H
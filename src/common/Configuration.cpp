@@ -737,6 +737,36 @@ void Configuration::setDecompilerAutoRefreshEnabled(bool enabled)
     s.setValue("decompilerAutoRefresh", enabled);
 }
 
+bool Configuration::getSimilarityAutoIndex()
+{
+    return s.value("similarityAutoIndex", true).toBool();
+}
+
+void Configuration::setSimilarityAutoIndex(bool enabled)
+{
+    s.setValue("similarityAutoIndex", enabled);
+}
+
+bool Configuration::getCryptoConstantTagging()
+{
+    return s.value("cryptoConstantTagging", false).toBool();
+}
+
+void Configuration::setCryptoConstantTagging(bool enabled)
+{
+    s.setValue("cryptoConstantTagging", enabled);
+}
+
+bool Configuration::getRunPythonScriptsInCutter()
+{
+    return s.value("runPythonScriptsInCutter", false).toBool();
+}
+
+void Configuration::setRunPythonScriptsInCutter(bool enabled)
+{
+    s.setValue("runPythonScriptsInCutter", enabled);
+}
+
 bool Configuration::getBitmapTransparentState()
 {
     return s.value("bitmapGraphExportTransparency", false).value<bool>();
@@ -138,6 +138,18 @@ public:
     {
         s.setValue("graph.maxcols", ch);
     }
+    /**
+     * @brief Number of blocks above which the regions of a function graph start collapsed,
+     * 0 to never collapse them
+     */
+    int getGraphCollapseBlockCount() const
+    {
+        return s.value("graph.collapseBlocks", 300).toInt();
+    }
+    void setGraphCollapseBlockCount(int count)
+    {
+        s.setValue("graph.collapseBlocks", count);
+    }
 
     QString getColorTheme() const     { return s.value("theme", "cutter").toString(); }
     void setColorTheme(const QString &theme);
@@ -179,6 +191,27 @@ public:
     bool getDecompilerAutoRefreshEnabled();
     void setDecompilerAutoRefreshEnabled(bool enabled);
 
+    /**
+     * @brief Whether the functions of every opened binary are added to the similarity index,
+     * and added again whenever the project is saved
+     */
+    bool getSimilarityAutoIndex();
+    void setSimilarityAutoIndex(bool enabled);
+
+    /**
+     * @brief Whether the constants of opened binaries are indexed right away and the uses of
+     * well known cryptographic constants are tagged with flags, see ConstantIndex
+     */
+    bool getCryptoConstantTagging();
+    void setCryptoConstantTagging(bool enabled);
+
+    /**
+     * @brief Whether Python scripts run with "Run Script" are executed by Cutter's own
+     * interpreter instead of radare2's ". file", see RunScriptTask
+     */
+    bool getRunPythonScriptsInCutter();
+    void setRunPythonScriptsInCutter(bool enabled);
+
     /**
      * @brief Getters and setters for the transaparent option state and scale factor for bitmap graph exports.
      */
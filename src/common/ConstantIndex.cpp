@@ -0,0 +1,516 @@
+#include "ConstantIndex.h"
+#include "common/Configuration.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+/**
+ * Upper bound for the size of a single instruction on all supported architectures.
+ */
+const int MAX_INSTRUCTION_BYTES = 16;
+/**
+ * Blocks larger than this are most likely misanalyzed data and only indexed up to it.
+ */
+const RVA MAX_BLOCK_SIZE = 0x100000;
+/**
+ * Interval between two polls of a cancellable wait for the index.
+ */
+const unsigned long CANCEL_POLL_MS = 100;
+
+struct CryptoConstant {
+    ut64 value;
+    const char *algorithm;
+    const char *name;
+};
+
+const CryptoConstant CRYPTO_CONSTANTS[] = {
+    { 0x67452301, "md5_sha1", "MD5/SHA-1 H0" },
+    { 0xefcdab89, "md5_sha1", "MD5/SHA-1 H1" },
+    { 0x98badcfe, "md5_sha1", "MD5/SHA-1 H2" },
+    { 0x10325476, "md5_sha1", "MD5/SHA-1 H3" },
+    { 0xc3d2e1f0, "sha1", "SHA-1 H4" },
+    { 0xd76aa478, "md5", "MD5 T[1]" },
+    { 0xe8c7b756, "md5", "MD5 T[2]" },
+    { 0x242070db, "md5", "MD5 T[3]" },
+    { 0xc1bdceee, "md5", "MD5 T[4]" },
+    { 0x5a827999, "sha1", "SHA-1 K0" },
+    { 0x6ed9eba1, "sha1", "SHA-1 K1" },
+    { 0x8f1bbcdc, "sha1", "SHA-1 K2" },
+    { 0xca62c1d6, "sha1", "SHA-1 K3" },
+    { 0x6a09e667, "sha256", "SHA-256 H0" },
+    { 0xbb67ae85, "sha256", "SHA-256 H1" },
+    { 0x3c6ef372, "sha256", "SHA-256 H2" },
+    { 0xa54ff53a, "sha256", "SHA-256 H3" },
+    { 0x510e527f, "sha256", "SHA-256 H4" },
+    { 0x9b05688c, "sha256", "SHA-256 H5" },
+    { 0x1f83d9ab, "sha256", "SHA-256 H6" },
+    { 0x5be0cd19, "sha256", "SHA-256 H7" },
+    { 0x428a2f98, "sha256", "SHA-256 K[0]" },
+    { 0x71374491, "sha256", "SHA-256 K[1]" },
+    { 0xb5c0fbcf, "sha256", "SHA-256 K[2]" },
+    { 0xe9b5dba5, "sha256", "SHA-256 K[3]" },
+    { 0x6a09e667f3bcc908, "sha512", "SHA-512 H0" },
+    { 0xbb67ae8584caa73b, "sha512", "SHA-512 H1" },
+    { 0x3c6ef372fe94f82b, "sha512", "SHA-512 H2" },
+    { 0xa54ff53a5f1d36f1, "sha512", "SHA-512 H3" },
+    { 0xedb88320, "crc32", "CRC-32 polynomial (reflected)" },
+    { 0x04c11db7, "crc32", "CRC-32 polynomial" },
+    { 0x82f63b78, "crc32c", "CRC-32C polynomial (reflected)" },
+    { 0x9e3779b9, "tea", "TEA/XTEA delta" },
+    { 0xc6ef3720, "tea", "TEA sum after 32 rounds" },
+    { 0x61707865, "chacha_salsa", "ChaCha/Salsa20 \"expa\"" },
+    { 0x3320646e, "chacha_salsa", "ChaCha/Salsa20 \"nd 3\"" },
+    { 0x79622d32, "chacha_salsa", "ChaCha/Salsa20 \"2-by\"" },
+    { 0x6b206574, "chacha_salsa", "ChaCha/Salsa20 \"te k\"" },
+    { 0xb7e15163, "rc5_rc6", "RC5/RC6 P32" },
+    { 0x243f6a88, "blowfish", "Blowfish P[0]" },
+    { 0x85a308d3, "blowfish", "Blowfish P[1]" },
+    { 0xcc9e2d51, "murmur3", "MurmurHash3 c1" },
+    { 0x1b873593, "murmur3", "MurmurHash3 c2" },
+    { 0x85ebca6b, "murmur3", "MurmurHash3 fmix1" },
+    { 0xc2b2ae35, "murmur3", "MurmurHash3 fmix2" },
+    { 0x9e3779b1, "xxhash32", "xxHash32 PRIME1" },
+    { 0x85ebca77, "xxhash32", "xxHash32 PRIME2" },
+    { 0xc2b2ae3d, "xxhash32", "xxHash32 PRIME3" },
+    { 0x27d4eb2f, "xxhash32", "xxHash32 PRIME4" },
+    { 0x165667b1, "xxhash32", "xxHash32 PRIME5" },
+    { 0x811c9dc5, "fnv", "FNV-1 32 offset basis" },
+    { 0x01000193, "fnv", "FNV-1 32 prime" },
+    { 0xcbf29ce484222325, "fnv", "FNV-1 64 offset basis" },
+    { 0x00000100000001b3, "fnv", "FNV-1 64 prime" },
+    { 0x736f6d6570736575, "siphash", "SipHash v0" },
+    { 0x646f72616e646f6d, "siphash", "SipHash v1" },
+};
+
+const CryptoConstant *findCryptoConstant(ut64 value)
+{
+    for (const CryptoConstant &constant : CRYPTO_CONSTANTS) {
+        if (constant.value == value) {
+            return &constant;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Collects the distinct values used by one instruction, merging the flags of duplicates
+ * like an immediate that is also reported as op.val.
+ */
+struct OpValues {
+    ConstantUse uses[8];
+    int count = 0;
+
+    void add(ut64 value, quint8 flags)
+    {
+        if (!ConstantIndex::isIndexed(value)) {
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            if (uses[i].value == value) {
+                uses[i].flags |= flags;
+                return;
+            }
+        }
+        if (count < 8) {
+            uses[count].value = value;
+            uses[count].flags = flags;
+            count++;
+        }
+    }
+
+    void addValue(const RAnalValue *value)
+    {
+        if (!value) {
+            return;
+        }
+        if (value->memref || value->reg) {
+            add(static_cast<ut64>(value->delta), ConstantUse::Displacement);
+        } else {
+            add(static_cast<ut64>(value->imm), ConstantUse::Immediate);
+        }
+    }
+};
+
+bool isCompare(int type)
+{
+    switch (type & R_ANAL_OP_TYPE_MASK) {
+    case R_ANAL_OP_TYPE_CMP:
+    case R_ANAL_OP_TYPE_ACMP:
+        return true;
+    default:
+        return false;
+    }
+}
+
+}
+
+ConstantIndexTask::ConstantIndexTask(const QList<FunctionDescription> &functions)
+    : functions(functions)
+{
+}
+
+void ConstantIndexTask::runTask()
+{
+    log(tr("Indexing constants of %n functions...", nullptr, functions.size()));
+    for (int i = 0; i < functions.size(); i++) {
+        if (isInterrupted()) {
+            return;
+        }
+        {
+            // Locked per function, so that other users of the core are only delayed briefly
+            RCoreLocked core = Core()->core();
+            indexFunction(core, functions[i]);
+        }
+        setProgress(i + 1, functions.size());
+    }
+}
+
+void ConstantIndexTask::indexFunction(RCore *core, const FunctionDescription &function)
+{
+    FunctionConstants &result = results[function.offset];
+
+    RAnalFunction *fcn = r_anal_get_function_at(core->anal, function.offset);
+    if (!fcn) {
+        return;
+    }
+    QByteArray buffer;
+    RListIter *it;
+    RAnalBlock *bb;
+    r_list_foreach(fcn->bbs, it, bb) {
+        RVA blockSize = qMin<RVA>(bb->size, MAX_BLOCK_SIZE);
+        if (blockSize == 0) {
+            continue;
+        }
+        int readCount = static_cast<int>(blockSize) + MAX_INSTRUCTION_BYTES;
+        buffer.resize(readCount);
+        ut8 *bytes = reinterpret_cast<ut8 *>(buffer.data());
+        if (!r_io_read_at(core->io, bb->addr, bytes, readCount)) {
+            continue;
+        }
+        for (int offset = 0; offset < static_cast<int>(blockSize);) {
+            RAnalOp op;
+            int length = r_anal_op(core->anal, &op, bb->addr + offset, bytes + offset,
+                                   readCount - offset, R_ANAL_OP_MASK_VAL);
+            if (length <= 0 || op.size <= 0) {
+                r_anal_op_fini(&op);
+                offset++;
+                continue;
+            }
+            OpValues values;
+            values.add(op.val, ConstantUse::Immediate);
+            values.add(op.ptr, ConstantUse::Immediate);
+            for (const RAnalValue *src : op.src) {
+                values.addValue(src);
+            }
+            values.addValue(op.dst);
+            quint8 compareFlag = isCompare(op.type) ? ConstantUse::Compare : 0;
+            for (int i = 0; i < values.count; i++) {
+                ConstantUse use = values.uses[i];
+                use.address = bb->addr + offset;
+                use.size = static_cast<quint8>(qMin(op.size, 0xff));
+                use.flags |= compareFlag;
+                result.uses.push_back(use);
+            }
+            offset += op.size;
+            r_anal_op_fini(&op);
+        }
+    }
+    std::sort(result.uses.begin(), result.uses.end());
+    result.uses.shrink_to_fit();
+}
+
+ConstantIndex *ConstantIndex::instance()
+{
+    static ConstantIndex *index = new ConstantIndex();
+    return index;
+}
+
+ConstantIndex::ConstantIndex()
+    : account(QStringLiteral("Constant index"), [this](size_t) {
+          invalidate();
+      })
+{
+}
+
+bool ConstantIndex::waitUntilReady(int msecs, const std::function<bool()> &isCancelled)
+{
+    if (QThread::currentThread() == thread()) {
+        // Builds finish in the event loop of this thread
+        return isReady();
+    }
+    QElapsedTimer timer;
+    timer.start();
+    QMutexLocker locker(&mutex);
+    quint64 interruptions = interruptedBuilds;
+    while (!isReady()) {
+        if (interruptedBuilds != interruptions) {
+            return false;
+        }
+        if (!isBuilding()) {
+            QMetaObject::invokeMethod(this, "build", Qt::QueuedConnection);
+        }
+        unsigned long remaining = ULONG_MAX;
+        if (msecs >= 0) {
+            qint64 left = msecs - timer.elapsed();
+            if (left <= 0) {
+                return false;
+            }
+            remaining = static_cast<unsigned long>(left);
+        }
+        if (isCancelled) {
+            if (isCancelled()) {
+                return false;
+            }
+            remaining = qMin(remaining, CANCEL_POLL_MS);
+        }
+        readyCondition.wait(&mutex, remaining);
+    }
+    return true;
+}
+
+AsyncTask::Ptr ConstantIndex::createTask(const QList<FunctionDescription> &functions)
+{
+    return AsyncTask::Ptr(new ConstantIndexTask(functions));
+}
+
+QList<RVA> ConstantIndex::takeResults(AsyncTask *task)
+{
+    const QHash<RVA, FunctionConstants> &results = static_cast<ConstantIndexTask *>(task)->getResults();
+    QMutexLocker locker(&mutex);
+    for (auto it = results.constBegin(); it != results.constEnd(); ++it) {
+        functions.insert(it.key(), it.value());
+    }
+    mergedValid = false;
+    tagsOutdated = true;
+    if (task->isInterrupted()) {
+        interruptedBuilds++;
+    }
+    return results.keys();
+}
+
+void ConstantIndex::removeFunctions(const QList<RVA> &offsets)
+{
+    QMutexLocker locker(&mutex);
+    for (RVA offset : offsets) {
+        functions.remove(offset);
+    }
+    mergedValid = false;
+    tagsOutdated = true;
+}
+
+void ConstantIndex::clearFunctions()
+{
+    QMutexLocker locker(&mutex);
+    functions.clear();
+    merged.clear();
+    merged.shrink_to_fit();
+    mergedValid = false;
+    tagsOutdated = false;
+}
+
+void ConstantIndex::indexChanged()
+{
+    if (tagsOutdated) {
+        tagsOutdated = false;
+        if (Config()->getCryptoConstantTagging()) {
+            tagCryptoConstants();
+        }
+    }
+    updateAccount();
+    QMutexLocker locker(&mutex);
+    readyCondition.wakeAll();
+}
+
+void ConstantIndex::updateCryptoTags()
+{
+    if (isBuilt() || !Config()->getCryptoConstantTagging()) {
+        tagCryptoConstants();
+    } else {
+        build();
+    }
+}
+
+void ConstantIndex::tagCryptoConstants()
+{
+    // One flag per algorithm and function, at the first instruction using one of its constants
+    QHash<QByteArray, RVA> tags;
+    if (Config()->getCryptoConstantTagging()) {
+        for (auto it = functions.constBegin(); it != functions.constEnd(); ++it) {
+            QHash<QString, RVA> firstUses;
+            for (const ConstantUse &use : it->uses) {
+                const CryptoConstant *constant = findCryptoConstant(use.value);
+                if (!constant) {
+                    continue;
+                }
+                QString algorithm = QString::fromLatin1(constant->algorithm);
+                auto first = firstUses.find(algorithm);
+                if (first == firstUses.end()) {
+                    firstUses.insert(algorithm, use.address);
+                } else if (use.address < first.value()) {
+                    first.value() = use.address;
+                }
+            }
+            for (auto first = firstUses.constBegin(); first != firstUses.constEnd(); ++first) {
+                QString name = QStringLiteral("crypto.%1.%2").arg(first.key()).arg(it.key(), 0, 16);
+                tags.insert(name.toUtf8(), first.value());
+            }
+        }
+    }
+
+    bool changed = false;
+    RCoreLocked core = Core()->core();
+    // Flags of functions that changed or are gone, also from earlier sessions, are removed
+    QHash<QByteArray, RVA> oldTags;
+    RSpace *space = r_flag_space_get(core->flags, "crypto");
+    if (space) {
+        r_flag_foreach_space(core->flags, space, [](RFlagItem *fi, void *user) {
+            static_cast<QHash<QByteArray, RVA> *>(user)->insert(QByteArray(fi->name), fi->offset);
+            return true;
+        }, &oldTags);
+    }
+    for (auto it = oldTags.constBegin(); it != oldTags.constEnd(); ++it) {
+        if (tags.value(it.key(), RVA_INVALID) != it.value()) {
+            r_flag_unset_name(core->flags, it.key().constData());
+            changed = true;
+        }
+    }
+    r_flag_space_push(core->flags, "crypto");
+    for (auto it = tags.constBegin(); it != tags.constEnd(); ++it) {
+        if (oldTags.value(it.key(), RVA_INVALID) != it.value()) {
+            r_flag_set(core->flags, it.key().constData(), it.value(), 1);
+            changed = true;
+        }
+    }
+    r_flag_space_pop(core->flags);
+    if (changed) {
+        Core()->triggerFlagsChanged();
+    }
+}
+
+void ConstantIndex::updateMerged()
+{
+    if (mergedValid) {
+        return;
+    }
+    size_t total = 0;
+    for (const FunctionConstants &function : functions) {
+        total += function.uses.size();
+    }
+    merged.clear();
+    merged.reserve(total);
+    for (const FunctionConstants &function : functions) {
+        merged.insert(merged.end(), function.uses.begin(), function.uses.end());
+    }
+    std::sort(merged.begin(), merged.end());
+    // Overlapping functions share instructions
+    merged.erase(std::unique(merged.begin(), merged.end(), [](const ConstantUse &a, const ConstantUse &b) {
+        return a.value == b.value && a.address == b.address;
+    }), merged.end());
+    mergedValid = true;
+}
+
+void ConstantIndex::updateAccount()
+{
+    QMutexLocker locker(&mutex);
+    size_t bytes = merged.capacity() * sizeof(ConstantUse);
+    for (const FunctionConstants &function : functions) {
+        bytes += sizeof(RVA) + sizeof(FunctionConstants) + function.uses.capacity() * sizeof(ConstantUse);
+    }
+    size_t entries = merged.size();
+    // The evictor locks the mutex again
+    locker.unlock();
+    account.update(bytes, entries);
+}
+
+std::vector<ConstantUse> ConstantIndex::find(ut64 value, quint8 flagsFilter, size_t maxResults)
+{
+    std::vector<ConstantUse> results;
+    QMutexLocker locker(&mutex);
+    bool merging = !mergedValid;
+    updateMerged();
+
+    auto collect = [&](ut64 v) {
+        ConstantUse key = { v, 0, 0, 0 };
+        auto it = std::lower_bound(merged.begin(), merged.end(), key);
+        for (; it != merged.end() && it->value == v; ++it) {
+            if (it->flags & flagsFilter) {
+                results.push_back(*it);
+            }
+        }
+    };
+    collect(value);
+    // Negative 32 bit immediates are usually sign extended by the disassembler
+    if (value <= 0xffffffff && (value & 0x80000000)) {
+        collect(value | 0xffffffff00000000ULL);
+        std::sort(results.begin(), results.end(), [](const ConstantUse &a, const ConstantUse &b) {
+            return a.address < b.address;
+        });
+    }
+    locker.unlock();
+    if (results.size() > maxResults) {
+        results.resize(maxResults);
+    }
+
+    // Accounts belong to the GUI thread
+    if (QThread::currentThread() == thread()) {
+        account.touch();
+        if (merging) {
+            updateAccount();
+        }
+    } else if (merging) {
+        QMetaObject::invokeMethod(this, "updateAccount", Qt::QueuedConnection);
+    }
+    return results;
+}
+
+QList<SearchDescription> ConstantIndex::search(ut64 value, quint8 flagsFilter, int maxResults)
+{
+    QList<SearchDescription> results;
+    std::vector<ConstantUse> uses = find(value, flagsFilter, static_cast<size_t>(qMax(maxResults, 0)));
+    if (uses.empty()) {
+        return results;
+    }
+    QString cryptoName = cryptoConstantName(value);
+    RCoreLocked core = Core()->core();
+    ut8 bytes[MAX_INSTRUCTION_BYTES];
+    for (const ConstantUse &use : uses) {
+        SearchDescription description;
+        description.offset = use.address;
+        description.size = use.size;
+        if (r_io_read_at(core->io, use.address, bytes, sizeof(bytes))) {
+            RAsmOp asmOp;
+            r_asm_op_init(&asmOp);
+            r_asm_set_pc(core->rasm, use.address);
+            r_asm_disassemble(core->rasm, &asmOp, bytes, sizeof(bytes));
+            description.code = QString::fromUtf8(r_asm_op_get_asm(&asmOp));
+            r_asm_op_fini(&asmOp);
+        }
+        QStringList kinds;
+        if (use.flags & ConstantUse::Immediate) {
+            kinds << tr("immediate");
+        }
+        if (use.flags & ConstantUse::Displacement) {
+            kinds << tr("displacement");
+        }
+        if (use.flags & ConstantUse::Compare) {
+            kinds << tr("compared");
+        }
+        if (!cryptoName.isEmpty()) {
+            kinds << cryptoName;
+        }
+        description.data = kinds.join(QLatin1String(", "));
+        results.append(description);
+    }
+    return results;
+}
+
+QString ConstantIndex::cryptoConstantName(ut64 value)
+{
+    const CryptoConstant *constant = findCryptoConstant(value);
+    return constant ? QString::fromLatin1(constant->name) : QString();
+}
@@ -0,0 +1,165 @@
+#ifndef CONSTANTINDEX_H
+#define CONSTANTINDEX_H
+
+#include "core/Cutter.h"
+#include "common/AsyncTask.h"
+#include "common/BackgroundIndex.h"
+#include "common/MemoryAccounting.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Use of a constant value by one instruction.
+ */
+struct ConstantUse {
+    enum Flag : quint8 {
+        Immediate = 1 << 0,     ///< immediate operand or computed pointer
+        Displacement = 1 << 1,  ///< displacement of a memory operand
+        Compare = 1 << 2        ///< the instruction compares or tests the value
+    };
+
+    ut64 value;
+    RVA address;
+    quint8 flags;
+    quint8 size;    ///< size of the instruction
+
+    bool operator<(const ConstantUse &other) const
+    {
+        return value != other.value ? value < other.value : address < other.address;
+    }
+};
+
+/**
+ * @brief Constants used by the instructions of one function, sorted by value and address.
+ */
+struct FunctionConstants {
+    std::vector<ConstantUse> uses;
+};
+
+/**
+ * @brief Decodes the basic blocks of a list of functions and collects the constants their
+ * instructions use.
+ */
+class ConstantIndexTask : public AsyncTask
+{
+    Q_OBJECT
+
+public:
+    explicit ConstantIndexTask(const QList<FunctionDescription> &functions);
+
+    QString getTitle() override     { return tr("Indexing Constants"); }
+
+    const QHash<RVA, FunctionConstants> &getResults() const     { return results; }
+
+protected:
+    void runTask() override;
+
+private:
+    QList<FunctionDescription> functions;
+    QHash<RVA, FunctionConstants> results;
+
+    void indexFunction(RCore *core, const FunctionDescription &function);
+};
+
+/**
+ * @brief Index from constant values to the instructions of analyzed functions using them,
+ * answering questions like "which instructions compare with 0x1337" without decoding
+ * all code again.
+ *
+ * The constants are kept per function, see FunctionIndex for when they are indexed again.
+ * All uses are merged into one vector sorted by value when the index is queried.
+ *
+ * If enabled with
+ * Configuration::setCryptoConstantTagging(), constants of well known cryptographic
+ * algorithms are tagged with flags in the "crypto" flagspace whenever functions were
+ * indexed, replacing the flags of the previous build.
+ *
+ * Builds run from the GUI thread, find() and waitUntilReady() may also be called from
+ * other threads, e.g. by scripts.
+ */
+class ConstantIndex : public FunctionIndex
+{
+    Q_OBJECT
+
+public:
+    static ConstantIndex *instance();
+
+    int functionCount() const       { return functions.size(); }
+
+    /**
+     * @brief Start a build if needed and block until the index is ready.
+     * On the GUI thread, which finishes builds, it only returns isReady().
+     * @param msecs timeout, -1 to wait as long as it takes
+     * @param isCancelled polled while waiting, e.g. whether the waiting script was cancelled
+     * @return false on timeout, if the build was interrupted or the wait was cancelled
+     */
+    bool waitUntilReady(int msecs = -1, const std::function<bool()> &isCancelled = nullptr);
+
+    /**
+     * @brief Tag or untag the cryptographic constants after
+     * Configuration::setCryptoConstantTagging() changed, building the index if needed.
+     */
+    void updateCryptoTags();
+
+    /**
+     * @return false for 0 and -1, which r2 also gives for operands without a value and are
+     * therefore not indexed
+     */
+    static bool isIndexed(ut64 value)   { return value != 0 && value != UT64_MAX; }
+
+    /**
+     * @brief Uses of value sorted by address, restricted to uses having any of flagsFilter.
+     * Answers from the last build if the index is not ready.
+     */
+    std::vector<ConstantUse> find(ut64 value, quint8 flagsFilter = 0xff,
+                                  size_t maxResults = SIZE_MAX);
+
+    /**
+     * @brief Same as find() as search results, with the disassembly of each instruction.
+     */
+    QList<SearchDescription> search(ut64 value, quint8 flagsFilter, int maxResults);
+
+    /**
+     * @brief Name of the well known cryptographic constant value, empty if it is not one.
+     */
+    static QString cryptoConstantName(ut64 value);
+
+protected:
+    AsyncTask::Ptr createTask(const QList<FunctionDescription> &functions) override;
+    QList<RVA> takeResults(AsyncTask *task) override;
+    void removeFunctions(const QList<RVA> &offsets) override;
+    void clearFunctions() override;
+    void indexChanged() override;
+
+private slots:
+    void updateAccount();
+
+private:
+    ConstantIndex();
+
+    /**
+     * Guards the indexed constants, which are only changed on the GUI thread but read by
+     * find() from any thread. Waiters are woken with it held after every change of the
+     * readiness, so that none misses one.
+     */
+    QMutex mutex;
+    QWaitCondition readyCondition;
+    quint64 interruptedBuilds = 0;
+
+    QHash<RVA, FunctionConstants> functions;
+    std::vector<ConstantUse> merged;
+    bool mergedValid = false;
+    bool tagsOutdated = false;
+    MemoryAccount account;
+
+    void tagCryptoConstants();
+    void updateMerged();
+};
+
+#endif // CONSTANTINDEX_H
@@ -0,0 +1,462 @@
+#include "DataClassifier.h"
+#include "common/JsonReader.h"
+
+#include <QTimer>
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DATACLASSIFIER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+/**
+ * Largest single read, the core is unlocked in between so the UI stays responsive.
+ */
+const size_t MAX_READ_SIZE = 1024 * 1024;
+const size_t MIN_PADDING = 16;
+const size_t MIN_STRING = 5;
+/**
+ * Minimum number of elements of pointer tables and floating point arrays.
+ */
+const size_t MIN_ARRAY_ELEMENTS = 4;
+/**
+ * Regions marked per lock of the core, the event loop runs between two batches.
+ */
+const int APPLY_BATCH = 256;
+
+using Intervals = std::vector<std::pair<RVA, RVA>>;
+using BitMask = std::vector<quint64>;
+
+void normalize(Intervals &intervals)
+{
+    std::sort(intervals.begin(), intervals.end());
+    size_t out = 0;
+    for (size_t i = 0; i < intervals.size(); i++) {
+        if (out > 0 && intervals[i].first <= intervals[out - 1].second) {
+            intervals[out - 1].second = std::max(intervals[out - 1].second, intervals[i].second);
+        } else {
+            intervals[out++] = intervals[i];
+        }
+    }
+    intervals.resize(out);
+}
+
+/**
+ * @return normalized ranges of the non-executable sections, or of the non-executable maps
+ * if there are no sections. Code that was not analyzed yet must not be typed as data.
+ */
+Intervals dataRanges()
+{
+    Intervals ranges;
+    bool haveSections = false;
+    for (const SectionDescription &section : Core()->getAllSections()) {
+        if (!section.vsize) {
+            continue;
+        }
+        haveSections = true;
+        if (!section.perm.contains(QLatin1Char('x'))) {
+            ranges.emplace_back(section.vaddr, section.vaddr + section.vsize);
+        }
+    }
+    if (!haveSections) {
+        Core()->cmdjStream("omj", [&ranges](JsonReader &reader) {
+            reader.readArray([&ranges](JsonReader &reader) {
+                RVA from = RVA_INVALID;
+                RVA to = RVA_INVALID;
+                QString perm;
+                reader.readObject([&](const JsonReader::Key &key, JsonReader &reader) {
+                    if (key == "from") {
+                        from = reader.readUInt64(RVA_INVALID);
+                    } else if (key == "to") {
+                        to = reader.readUInt64(RVA_INVALID);
+                    } else if (key == "perm") {
+                        perm = reader.readString();
+                    }
+                });
+                if (from != RVA_INVALID && to != RVA_INVALID && to > from
+                        && !perm.contains(QLatin1Char('x'))) {
+                    ranges.emplace_back(from, to);
+                }
+            });
+        });
+    }
+    normalize(ranges);
+    return ranges;
+}
+
+/**
+ * @return parts of the normalized ranges not covered by the normalized intervals known
+ */
+Intervals subtract(const Intervals &ranges, const Intervals &known)
+{
+    Intervals gaps;
+    auto it = known.begin();
+    for (const auto &range : ranges) {
+        RVA start = range.first;
+        RVA end = range.second;
+        while (it != known.end() && it->second <= start) {
+            ++it;
+        }
+        for (auto k = it; k != known.end() && k->first < end; ++k) {
+            if (k->first > start) {
+                gaps.emplace_back(start, k->first);
+            }
+            start = std::max(start, k->second);
+        }
+        if (start < end) {
+            gaps.emplace_back(start, end);
+        }
+    }
+    return gaps;
+}
+
+bool isTextByte(quint8 byte)
+{
+    return (byte >= 0x20 && byte < 0x7f) || byte == '\t' || byte == '\n' || byte == '\r';
+}
+
+bool testBit(const BitMask &mask, size_t i)
+{
+    return (mask[i / 64] >> (i % 64)) & 1;
+}
+
+/**
+ * @return number of consecutive set bits from pos on, at most up to end
+ */
+size_t runLength(const BitMask &mask, size_t pos, size_t end)
+{
+    size_t start = pos;
+    while (pos < end) {
+        size_t available = 64 - pos % 64;
+        quint64 unset = ~(mask[pos / 64] >> (pos % 64));
+        size_t run = unset ? std::min<size_t>(qCountTrailingZeroBits(unset), available) : available;
+        pos += run;
+        if (run < available) {
+            break;
+        }
+    }
+    return std::min(pos, end) - start;
+}
+
+#ifdef DATACLASSIFIER_SSE2
+/**
+ * @brief Masks of zero bytes and text bytes of the 16 bytes at data
+ */
+void byteMasks16(const quint8 *data, quint32 *zero, quint32 *text)
+{
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+    // Signed comparison, so bytes from 0x80 on are below 0x20 as well
+    __m128i printable = _mm_andnot_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x7f)),
+                                         _mm_cmpgt_epi8(bytes, _mm_set1_epi8(0x1f)));
+    __m128i whitespace = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t')),
+                                      _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')),
+                                                   _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r'))));
+    *zero = static_cast<quint32>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128())));
+    *text = static_cast<quint32>(_mm_movemask_epi8(_mm_or_si128(printable, whitespace)));
+}
+#endif
+
+void computeMasks(const quint8 *data, size_t size, BitMask &zero, BitMask &text)
+{
+    zero.assign((size + 63) / 64, 0);
+    text.assign((size + 63) / 64, 0);
+    size_t i = 0;
+#ifdef DATACLASSIFIER_SSE2
+    for (; i + 16 <= size; i += 16) {
+        quint32 zeroBits;
+        quint32 textBits;
+        byteMasks16(data + i, &zeroBits, &textBits);
+        zero[i / 64] |= quint64(zeroBits) << (i % 64);
+        text[i / 64] |= quint64(textBits) << (i % 64);
+    }
+#endif
+    for (; i < size; i++) {
+        if (!data[i]) {
+            zero[i / 64] |= quint64(1) << (i % 64);
+        } else if (isTextByte(data[i])) {
+            text[i / 64] |= quint64(1) << (i % 64);
+        }
+    }
+}
+
+bool plausibleFloat(double value)
+{
+    if (value == 0.0) {
+        return true;
+    }
+    double magnitude = std::fabs(value);
+    return std::isfinite(value) && magnitude >= 1e-6 && magnitude <= 1e9;
+}
+
+}
+
+DataClassifier::DataClassifier(const ByteMapLayout &mapped, int pointerSize, bool bigEndian)
+    : mapped(mapped), pointerSize(pointerSize), bigEndian(bigEndian)
+{
+}
+
+QString DataClassifier::kindName(DataRegion::Kind kind)
+{
+    switch (kind) {
+    case DataRegion::Kind::Padding:
+        return QObject::tr("padding");
+    case DataRegion::Kind::Pointers:
+        return QObject::tr("pointer table");
+    case DataRegion::Kind::String:
+        return QObject::tr("string");
+    case DataRegion::Kind::Utf16String:
+        return QObject::tr("UTF-16 string");
+    case DataRegion::Kind::Floats:
+        return QObject::tr("float array");
+    case DataRegion::Kind::Doubles:
+        return QObject::tr("double array");
+    }
+    return QString();
+}
+
+quint64 DataClassifier::readValue(const quint8 *data, int size) const
+{
+    quint64 value = 0;
+    for (int i = 0; i < size; i++) {
+        int shift = bigEndian ? (size - 1 - i) * 8 : i * 8;
+        value |= quint64(data[i]) << shift;
+    }
+    return value;
+}
+
+size_t DataClassifier::pointerRun(const quint8 *data, size_t size) const
+{
+    size_t count = 0;
+    for (size_t i = 0; i + pointerSize <= size; i += pointerSize, count++) {
+        RVA value = readValue(data + i, pointerSize);
+        if (!value || mapped.positionOf(value) == RVA_INVALID) {
+            break;
+        }
+    }
+    return count;
+}
+
+size_t DataClassifier::floatRun(const quint8 *data, size_t size, int elementSize) const
+{
+    size_t count = 0;
+    size_t nonZero = 0;
+    for (size_t i = 0; i + elementSize <= size; i += elementSize, count++) {
+        quint64 bits = readValue(data + i, elementSize);
+        double value;
+        if (elementSize == 4) {
+            quint32 bits32 = static_cast<quint32>(bits);
+            float f;
+            memcpy(&f, &bits32, sizeof(f));
+            value = f;
+        } else {
+            memcpy(&value, &bits, sizeof(value));
+        }
+        // Text matches the float pattern surprisingly often
+        if (!plausibleFloat(value) || std::all_of(data + i, data + i + elementSize, isTextByte)) {
+            break;
+        }
+        if (bits) {
+            nonZero++;
+        }
+    }
+    return nonZero * 2 >= count ? count : 0;
+}
+
+size_t DataClassifier::classify(const quint8 *data, size_t size, RVA address, bool last,
+                                QList<DataRegion> &regions) const
+{
+    BitMask zero;
+    BitMask text;
+    computeMasks(data, size, zero, text);
+
+    size_t i = 0;
+    while (i < size) {
+        RVA current = address + i;
+
+        size_t zeros = runLength(zero, i, size);
+        if (zeros >= MIN_PADDING || (zeros && i + zeros == size)) {
+            if (i + zeros == size && !last) {
+                return i;
+            }
+            if (zeros >= MIN_PADDING) {
+                regions.append({ current, zeros, DataRegion::Kind::Padding, 1 });
+            }
+            i += zeros;
+            continue;
+        }
+
+        size_t chars = runLength(text, i, size);
+        if (chars >= MIN_STRING) {
+            if (i + chars == size) {
+                if (!last) {
+                    return i;
+                }
+            } else if (!data[i + chars]) {
+                regions.append({ current, chars + 1, DataRegion::Kind::String, 1 });
+                i += chars + 1;
+                continue;
+            }
+        }
+
+        // UTF-16 text of the Latin-1 range alternates text and zero bytes
+        size_t textByte = bigEndian ? 1 : 0;
+        size_t j = i;
+        while (j + 1 < size && testBit(text, j + textByte) && testBit(zero, j + 1 - textByte)) {
+            j += 2;
+        }
+        if ((j - i) / 2 >= MIN_STRING) {
+            if (j + 1 >= size && !last) {
+                return i;
+            }
+            if (j + 1 < size && !data[j] && !data[j + 1]) {
+                regions.append({ current, j + 2 - i, DataRegion::Kind::Utf16String, 2 });
+                i = j + 2;
+                continue;
+            }
+        }
+
+        if (current % pointerSize == 0) {
+            size_t count = pointerRun(data + i, size - i);
+            if (count >= MIN_ARRAY_ELEMENTS) {
+                if (i + (count + 1) * pointerSize > size && !last) {
+                    return i;
+                }
+                regions.append({ current, count * pointerSize, DataRegion::Kind::Pointers, pointerSize });
+                i += count * pointerSize;
+                continue;
+            }
+        }
+
+        bool found = false;
+        for (int elementSize : { 8, 4 }) {
+            if (current % elementSize) {
+                continue;
+            }
+            size_t count = floatRun(data + i, size - i, elementSize);
+            if (count >= MIN_ARRAY_ELEMENTS) {
+                if (i + (count + 1) * elementSize > size && !last) {
+                    return i;
+                }
+                DataRegion::Kind kind = elementSize == 8 ? DataRegion::Kind::Doubles
+                                                         : DataRegion::Kind::Floats;
+                regions.append({ current, count * elementSize, kind, elementSize });
+                i += count * elementSize;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            i++;
+        }
+    }
+    return size;
+}
+
+void DataClassifierTask::runTask()
+{
+    log(tr("Collecting unclassified regions..."));
+    ByteMapLayout mapped = ByteMapLayout::fromCore();
+    Intervals known;
+    for (const FunctionDescription &function : Core()->getAllFunctions()) {
+        known.emplace_back(function.offset, function.offset + qMax<RVA>(function.linearSize, 1));
+    }
+    Core()->cmdjStream("Cj", [&known](JsonReader &reader) {
+        reader.readArray([&known](JsonReader &reader) {
+            RVA offset = RVA_INVALID;
+            RVA size = 0;
+            QString type;
+            reader.readObject([&](const JsonReader::Key &key, JsonReader &reader) {
+                if (key == "offset") {
+                    offset = reader.readUInt64(RVA_INVALID);
+                } else if (key == "size") {
+                    size = reader.readUInt64();
+                } else if (key == "type") {
+                    type = reader.readString();
+                }
+            });
+            // Comments do not change how bytes are shown
+            if (offset != RVA_INVALID && !type.startsWith(QLatin1String("CC"))) {
+                known.emplace_back(offset, offset + qMax<RVA>(size, 1));
+            }
+        });
+    });
+    normalize(known);
+    Intervals gaps = subtract(dataRanges(), known);
+
+    int pointerSize = Core()->getConfigi("asm.bits") / 8;
+    if (pointerSize != 2 && pointerSize != 4 && pointerSize != 8) {
+        pointerSize = 4;
+    }
+    DataClassifier classifier(mapped, pointerSize, Core()->getConfigb("cfg.bigendian"));
+
+    RVA total = 0;
+    for (const auto &gap : gaps) {
+        total += gap.second - gap.first;
+    }
+    log(tr("Classifying %1 bytes...").arg(total));
+    RVA done = 0;
+    for (const auto &gap : gaps) {
+        RVA pos = gap.first;
+        while (pos < gap.second) {
+            if (isInterrupted()) {
+                return;
+            }
+            size_t length = static_cast<size_t>(std::min<RVA>(MAX_READ_SIZE, gap.second - pos));
+            bool last = pos + length >= gap.second;
+            QByteArray data = Core()->ioRead(pos, static_cast<int>(length));
+            const quint8 *bytes = reinterpret_cast<const quint8 *>(data.constData());
+            size_t consumed = classifier.classify(bytes, length, pos, last, regions);
+            if (!consumed) {
+                // A single region longer than one read, cut it at the end of the read
+                consumed = classifier.classify(bytes, length, pos, true, regions);
+            }
+            pos += consumed;
+            done += consumed;
+            setProgress(static_cast<int>(done * 1000 / qMax<RVA>(total, 1)), 1000);
+        }
+    }
+    log(tr("Found %n typed data regions.", nullptr, regions.size()));
+}
+
+void DataClassifierTask::apply(const QList<DataRegion> &regions)
+{
+    if (regions.isEmpty()) {
+        return;
+    }
+    applyBatch(regions, 0);
+}
+
+void DataClassifierTask::applyBatch(const QList<DataRegion> &regions, int first)
+{
+    int end = qMin(regions.size(), first + APPLY_BATCH);
+    {
+        RCoreLocked core = Core()->core();
+        for (int i = first; i < end; i++) {
+            const DataRegion &region = regions[i];
+            switch (region.kind) {
+            case DataRegion::Kind::String:
+                Core()->cmdRawAt(QString("Cs %1").arg(region.size), region.address);
+                break;
+            default:
+                // r2 has no UTF-16 or float metadata, these are shown as arrays of their element size
+                Core()->cmdRawAt(QString("Cd %1 %2").arg(region.elementSize).arg(region.count()),
+                                 region.address);
+                break;
+            }
+        }
+    }
+    if (end < regions.size()) {
+        QTimer::singleShot(0, Core(), [regions, end]() {
+            applyBatch(regions, end);
+        });
+        return;
+    }
+    emit Core()->refreshCodeViews();
+}
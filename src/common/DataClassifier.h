@@ -0,0 +1,93 @@
+#ifndef DATACLASSIFIER_H
+#define DATACLASSIFIER_H
+
+#include "core/Cutter.h"
+#include "common/AsyncTask.h"
+#include "common/ByteMapRenderer.h"
+
+#include <QList>
+
+#include <vector>
+
+struct DataRegion {
+    enum class Kind {
+        Padding,
+        Pointers,
+        String,
+        Utf16String,
+        Floats,
+        Doubles
+    };
+
+    RVA address;
+    RVA size;
+    Kind kind;
+    int elementSize;
+
+    RVA count() const       { return size / elementSize; }
+};
+
+/**
+ * @brief Recognizes typed data in raw bytes: zero padding, pointer tables, ASCII and UTF-16
+ * strings and arrays of floating point numbers.
+ *
+ * Bytes are first turned into bit masks of zero and text bytes, 16 at a time with SSE2 where
+ * available, so that runs can be measured a word at a time instead of byte by byte.
+ */
+class DataClassifier
+{
+public:
+    /**
+     * @param mapped addresses a pointer may point into
+     */
+    DataClassifier(const ByteMapLayout &mapped, int pointerSize, bool bigEndian);
+
+    /**
+     * @brief Classify data starting at address and append the regions found to regions.
+     * @param last whether data reaches the end of the region to classify. If not, regions
+     * that may continue past the end of data are left for the next call.
+     * @return number of bytes consumed, the next call should continue from there
+     */
+    size_t classify(const quint8 *data, size_t size, RVA address, bool last,
+                    QList<DataRegion> &regions) const;
+
+    static QString kindName(DataRegion::Kind kind);
+
+private:
+    ByteMapLayout mapped;
+    int pointerSize;
+    bool bigEndian;
+
+    quint64 readValue(const quint8 *data, int size) const;
+    size_t pointerRun(const quint8 *data, size_t size) const;
+    size_t floatRun(const quint8 *data, size_t size, int elementSize) const;
+};
+
+class DataClassifierTask : public AsyncTask
+{
+    Q_OBJECT
+
+public:
+    QString getTitle() override     { return tr("Detecting Data Types"); }
+
+    /**
+     * @return regions found in non-executable sections outside of functions and existing metadata
+     */
+    const QList<DataRegion> &getRegions() const     { return regions; }
+
+    /**
+     * @brief Mark all regions as data or strings, in batches between which the event loop
+     * runs, and refresh the code views a single time once all are marked.
+     */
+    static void apply(const QList<DataRegion> &regions);
+
+protected:
+    void runTask() override;
+
+private:
+    QList<DataRegion> regions;
+
+    static void applyBatch(const QList<DataRegion> &regions, int first);
+};
+
+#endif // DATACLASSIFIER_H
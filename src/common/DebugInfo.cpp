@@ -0,0 +1,544 @@
+#include "DebugInfo.h"
+#include "common/JsonReader.h"
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSet>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+/**
+ * Symbols named per lock of the core.
+ */
+const size_t SymbolBatch = 1000;
+
+/**
+ * Limit of nested types materialized along with one type.
+ */
+const int MaxTypeDepth = 32;
+
+void readGlobals(JsonReader &reader, std::vector<DebugInfoSymbol> &symbols)
+{
+    reader.readArray([&symbols](JsonReader &reader) {
+        DebugInfoSymbol symbol { 0, QString() };
+        reader.readObject([&symbol](const JsonReader::Key &key, JsonReader &reader) {
+            if (key == "gdata_name") {
+                symbol.name = reader.readString();
+            } else if (key == "address") {
+                symbol.address = reader.readUInt64();
+            }
+        });
+        if (!symbol.name.isEmpty() && symbol.address) {
+            symbols.push_back(std::move(symbol));
+        }
+    });
+}
+
+void readTypes(JsonReader &reader, std::vector<DebugInfoType> &types)
+{
+    reader.readArray([&types](JsonReader &reader) {
+        DebugInfoType type;
+        QString kind;
+        std::vector<DebugInfoType::Member> members;
+        std::vector<DebugInfoType::Member> cases;
+        type.size = 0;
+        reader.readObject([&](const JsonReader::Key &key, JsonReader &reader) {
+            if (key == "type") {
+                kind = reader.readString();
+            } else if (key == "name") {
+                type.name = reader.readString();
+            } else if (key == "size") {
+                type.size = reader.readUInt64();
+            } else if (key == "members") {
+                reader.readArray([&members](JsonReader &reader) {
+                    DebugInfoType::Member member { QString(), QString(), 0 };
+                    reader.readObject([&member](const JsonReader::Key &key, JsonReader &reader) {
+                        if (key == "member_type") {
+                            member.type = reader.readString();
+                        } else if (key == "member_name") {
+                            member.name = reader.readString();
+                        } else if (key == "offset") {
+                            member.offset = reader.readInt64();
+                        }
+                    });
+                    members.push_back(std::move(member));
+                });
+            } else if (key == "cases") {
+                reader.readArray([&cases](JsonReader &reader) {
+                    DebugInfoType::Member enumCase { QString(), QString(), 0 };
+                    reader.readObject([&enumCase](const JsonReader::Key &key, JsonReader &reader) {
+                        if (key == "enum_name") {
+                            enumCase.name = reader.readString();
+                        } else if (key == "enum_val") {
+                            enumCase.offset = reader.readInt64();
+                        }
+                    });
+                    cases.push_back(std::move(enumCase));
+                });
+            }
+        });
+        if (kind == "structure") {
+            type.kind = DebugInfoType::Kind::Struct;
+        } else if (kind == "union") {
+            type.kind = DebugInfoType::Kind::Union;
+        } else if (kind == "enum") {
+            type.kind = DebugInfoType::Kind::Enum;
+        } else {
+            return;
+        }
+        if (type.name.isEmpty()) {
+            return;
+        }
+        type.members = type.kind == DebugInfoType::Kind::Enum ? std::move(cases) : std::move(members);
+        types.push_back(std::move(type));
+    });
+}
+
+/**
+ * Collect the "gvars" and "types" arrays wherever they are nested in the output of idpij
+ */
+void readDebugInfo(JsonReader &reader, DebugInfoData *data)
+{
+    if (reader.atArray()) {
+        reader.readArray([data](JsonReader &reader) {
+            readDebugInfo(reader, data);
+        });
+    } else if (reader.atObject()) {
+        reader.readObject([data](const JsonReader::Key &key, JsonReader &reader) {
+            if (key == "gvars" && reader.atArray()) {
+                readGlobals(reader, data->symbols);
+            } else if (key == "types" && reader.atArray()) {
+                readTypes(reader, data->types);
+            } else {
+                readDebugInfo(reader, data);
+            }
+        });
+    }
+}
+
+/**
+ * Parsed member type like "const struct _LIST_ENTRY*" or "char[16]".
+ */
+struct MemberType {
+    QString prefix;         ///< struct, union, enum and qualifiers
+    QString base;           ///< name of the type as in the debug information
+    QString pointers;
+    QString array;
+    bool function = false;
+};
+
+MemberType parseMemberType(const QString &type)
+{
+    MemberType result;
+    QString rest = type.trimmed();
+    if (rest.contains('(')) {
+        result.function = true;
+        return result;
+    }
+    int arrayStart = rest.indexOf('[');
+    if (arrayStart >= 0) {
+        result.array = rest.mid(arrayStart);
+        rest = rest.left(arrayStart).trimmed();
+    }
+    while (rest.endsWith('*') || rest.endsWith(' ')) {
+        if (rest.endsWith('*')) {
+            result.pointers += '*';
+        }
+        rest.chop(1);
+    }
+    static const QStringList keywords = { "struct", "union", "enum", "const", "volatile" };
+    QStringList words = rest.split(' ', QString::SkipEmptyParts);
+    while (words.size() > 1 && keywords.contains(words.first())) {
+        result.prefix += words.takeFirst() + ' ';
+    }
+    result.base = words.join(' ');
+    return result;
+}
+
+}
+
+QString DebugInfoType::category() const
+{
+    switch (kind) {
+    case Kind::Struct:
+        return QStringLiteral("Struct");
+    case Kind::Union:
+        return QStringLiteral("Union");
+    case Kind::Enum:
+        return QStringLiteral("Enum");
+    }
+    return QString();
+}
+
+DebugInfoTask::DebugInfoTask(const QString &file)
+    : data(new DebugInfoData)
+{
+    data->file = file;
+}
+
+void DebugInfoTask::runTask()
+{
+    log(tr("Reading %1...").arg(data->file));
+    // The core is only locked while r2 reads the file, not while its output is parsed
+    Core()->cmdjStream("idpij " + CutterCore::sanitizeStringForCommand(data->file),
+    [this](JsonReader &reader) {
+        readDebugInfo(reader, data.data());
+    });
+    if (isInterrupted()) {
+        return;
+    }
+    std::sort(data->symbols.begin(), data->symbols.end(),
+    [](const DebugInfoSymbol &a, const DebugInfoSymbol &b) {
+        return a.address < b.address;
+    });
+    log(tr("Naming %n symbols...", nullptr, static_cast<int>(data->symbols.size())));
+    applySymbols();
+}
+
+void DebugInfoTask::applySymbols()
+{
+    const std::vector<DebugInfoSymbol> &symbols = data->symbols;
+    for (size_t first = 0; first < symbols.size(); first += SymbolBatch) {
+        if (isInterrupted()) {
+            return;
+        }
+        size_t end = std::min(symbols.size(), first + SymbolBatch);
+        {
+            RCoreLocked core = Core()->core();
+            r_flag_space_push(core->flags, "pdb");
+            for (size_t i = first; i < end; i++) {
+                QByteArray name = ("pdb." + symbols[i].name).toUtf8();
+                r_name_filter(name.data(), -1);
+                r_flag_set(core->flags, name.constData(), symbols[i].address, 1);
+                RAnalFunction *fcn = r_anal_get_function_at(core->anal, symbols[i].address);
+                if (fcn && fcn->name && !strncmp(fcn->name, "fcn.", 4)) {
+                    // Only names made up by the analysis are replaced
+                    r_anal_function_rename(fcn, name.constData());
+                }
+            }
+            r_flag_space_pop(core->flags);
+        }
+        setProgress(static_cast<int>(end), static_cast<int>(symbols.size()));
+    }
+}
+
+DebugInfo *DebugInfo::instance()
+{
+    static DebugInfo *info = new DebugInfo();
+    return info;
+}
+
+DebugInfo::DebugInfo()
+    : account(QStringLiteral("Debug information"))
+{
+}
+
+void DebugInfo::load(const QString &file)
+{
+    if (task) {
+        return;
+    }
+    task = QSharedPointer<DebugInfoTask>(new DebugInfoTask(file));
+    connect(task.data(), &AsyncTask::finished, this, &DebugInfo::onTaskFinished);
+    Core()->getAsyncTaskManager()->start(task);
+}
+
+void DebugInfo::onTaskFinished()
+{
+    if (!task || sender() != task.data()) {
+        return;
+    }
+    QSharedPointer<DebugInfoData> data = task->getData();
+    bool interrupted = task->isInterrupted();
+    task.clear();
+    add(data, !interrupted);
+}
+
+void DebugInfo::loadNow(const QString &file)
+{
+    DebugInfoTask task(file);
+    task.run();
+    QMetaObject::invokeMethod(instance(), "add", Qt::QueuedConnection,
+                              Q_ARG(QSharedPointer<DebugInfoData>, task.getData()),
+                              Q_ARG(bool, !task.isInterrupted()));
+}
+
+void DebugInfo::add(QSharedPointer<DebugInfoData> data, bool complete)
+{
+    symbols.insert(symbols.end(), data->symbols.begin(), data->symbols.end());
+    std::sort(symbols.begin(), symbols.end(), [](const DebugInfoSymbol &a, const DebugInfoSymbol &b) {
+        return a.address < b.address;
+    });
+    for (DebugInfoType &type : data->types) {
+        QString name = cName(type.name);
+        if (typeByName.contains(name) || isDefined(name)) {
+            continue;
+        }
+        size_t index = types.size();
+        typeByName.insert(name, index);
+        if (type.kind == DebugInfoType::Kind::Struct) {
+            for (const DebugInfoType::Member &member : type.members) {
+                structMembersByOffset.insert(member.offset, index);
+            }
+        }
+        types.push_back(std::move(type));
+        pendingCount++;
+    }
+    updateAccount();
+
+    if (!data->symbols.empty()) {
+        Core()->triggerFlagsChanged();
+        emit Core()->functionsChanged();
+    }
+    emit typesChanged();
+    if (complete) {
+        emit loaded(data->file);
+    }
+}
+
+QList<TypeDescription> DebugInfo::pendingTypes() const
+{
+    QList<TypeDescription> result;
+    result.reserve(pendingCount);
+    for (const DebugInfoType &type : types) {
+        if (type.materialized) {
+            continue;
+        }
+        TypeDescription description;
+        description.type = cName(type.name);
+        description.size = static_cast<int>(type.size);
+        description.category = type.category();
+        if (type.failed) {
+            description.format = tr("r2 could not parse the definition");
+        }
+        result << description;
+    }
+    return result;
+}
+
+bool DebugInfo::materializeType(const QString &name)
+{
+    auto it = typeByName.constFind(name);
+    if (it == typeByName.constEnd()) {
+        return false;
+    }
+    if (types[it.value()].materialized) {
+        return isDefined(name);
+    }
+    bool result = materialize(it.value(), 0);
+    updateAccount();
+    emit typesChanged();
+    return result;
+}
+
+void DebugInfo::discardType(const QString &name)
+{
+    auto it = typeByName.constFind(name);
+    if (it == typeByName.constEnd() || types[it.value()].materialized) {
+        return;
+    }
+    DebugInfoType &type = types[it.value()];
+    type.materialized = true;
+    std::vector<DebugInfoType::Member>().swap(type.members);
+    pendingCount--;
+    updateAccount();
+}
+
+void DebugInfo::materializeFunctionTypes(RVA function)
+{
+    if (!pendingCount) {
+        return;
+    }
+    QString used = Core()->cmdRawAt("afs", function);
+    QJsonObject vars = Core()->cmdj("afvj @ " + RAddressString(function)).object();
+    for (auto it = vars.constBegin(); it != vars.constEnd(); ++it) {
+        for (const QJsonValue &var : it.value().toArray()) {
+            used += ' ' + var.toObject()["type"].toString();
+        }
+    }
+
+    bool changed = false;
+    static const QRegularExpression identifier(R"([A-Za-z_][A-Za-z0-9_]*)");
+    QRegularExpressionMatchIterator match = identifier.globalMatch(used);
+    while (match.hasNext()) {
+        auto it = typeByName.constFind(match.next().captured());
+        if (it != typeByName.constEnd() && !types[it.value()].materialized
+                && !types[it.value()].failed) {
+            materialize(it.value(), 0);
+            changed = true;
+        }
+    }
+    if (changed) {
+        updateAccount();
+        emit typesChanged();
+    }
+}
+
+QStringList DebugInfo::pendingMembersAt(st64 offset, int max) const
+{
+    QStringList result;
+    for (auto it = structMembersByOffset.constFind(offset);
+            it != structMembersByOffset.constEnd() && it.key() == offset && result.size() < max; ++it) {
+        const DebugInfoType &type = types[it.value()];
+        if (type.materialized) {
+            continue;
+        }
+        for (const DebugInfoType::Member &member : type.members) {
+            if (member.offset == offset) {
+                result << cName(type.name) + '.' + cName(member.name);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+const DebugInfoSymbol *DebugInfo::symbolAt(RVA address) const
+{
+    auto it = std::lower_bound(symbols.begin(), symbols.end(), address,
+    [](const DebugInfoSymbol &symbol, RVA address) {
+        return symbol.address < address;
+    });
+    return it != symbols.end() && it->address == address ? &*it : nullptr;
+}
+
+bool DebugInfo::materialize(size_t index, int depth)
+{
+    DebugInfoType &type = types[index];
+    if (type.materialized || type.materializing) {
+        return true;
+    }
+    type.materializing = true;
+
+    if (depth < MaxTypeDepth && type.kind != DebugInfoType::Kind::Enum) {
+        // Types contained by value must be defined before
+        for (const DebugInfoType::Member &member : type.members) {
+            MemberType memberType = parseMemberType(member.type);
+            if (memberType.function || !memberType.pointers.isEmpty()) {
+                continue;
+            }
+            auto it = typeByName.constFind(cName(memberType.base));
+            if (it != typeByName.constEnd() && !types[it.value()].failed) {
+                materialize(it.value(), depth + 1);
+            }
+        }
+    }
+
+    QString name = cName(type.name);
+    Core()->addTypes(definition(type, false).toUtf8().constData());
+    if (!isDefined(name) && type.kind != DebugInfoType::Kind::Enum) {
+        // Members of types r2 does not know, keep at least the layout
+        Core()->addTypes(definition(type, true).toUtf8().constData());
+    }
+    type.materializing = false;
+    if (!isDefined(name)) {
+        // Stays pending with its members, so that it can be tried again or discarded
+        type.failed = true;
+        return false;
+    }
+    // r2 holds the definition now
+    type.materialized = true;
+    type.failed = false;
+    pendingCount--;
+    std::vector<DebugInfoType::Member>().swap(type.members);
+    return true;
+}
+
+QString DebugInfo::definition(const DebugInfoType &type, bool opaqueMembers) const
+{
+    QString name = cName(type.name);
+    QStringList lines;
+    QSet<QString> memberNames;
+    auto uniqueName = [&memberNames](const DebugInfoType::Member &member) {
+        QString memberName = cName(member.name);
+        if (memberName.isEmpty() || memberNames.contains(memberName)) {
+            memberName += QStringLiteral("_%1").arg(member.offset);
+        }
+        memberNames.insert(memberName);
+        return memberName;
+    };
+
+    if (type.kind == DebugInfoType::Kind::Enum) {
+        for (const DebugInfoType::Member &member : type.members) {
+            lines << QStringLiteral("%1 = %2").arg(uniqueName(member)).arg(member.offset);
+        }
+        return QStringLiteral("enum %1 { %2 };").arg(name, lines.join(QStringLiteral(", ")));
+    }
+
+    std::vector<DebugInfoType::Member> members = type.members;
+    std::stable_sort(members.begin(), members.end(),
+    [](const DebugInfoType::Member &a, const DebugInfoType::Member &b) {
+        return a.offset < b.offset;
+    });
+    for (size_t i = 0; i < members.size(); i++) {
+        const DebugInfoType::Member &member = members[i];
+        if (opaqueMembers) {
+            st64 end = static_cast<st64>(type.size);
+            if (type.kind == DebugInfoType::Kind::Struct) {
+                for (size_t next = i + 1; next < members.size(); next++) {
+                    if (members[next].offset > member.offset) {
+                        end = members[next].offset;
+                        break;
+                    }
+                }
+            }
+            if (end <= member.offset) {
+                // Bit fields sharing the bytes of the previous member
+                continue;
+            }
+            lines << QStringLiteral("unsigned char %1[%2];").arg(uniqueName(member))
+                  .arg(end - member.offset);
+            continue;
+        }
+        MemberType memberType = parseMemberType(member.type);
+        if (memberType.function) {
+            lines << QStringLiteral("void *%1;").arg(uniqueName(member));
+            continue;
+        }
+        QString base = memberType.base.contains(' ') ? memberType.base : cName(memberType.base);
+        lines << QStringLiteral("%1%2 %3%4%5;").arg(memberType.prefix, base, memberType.pointers,
+                                                    uniqueName(member), memberType.array);
+    }
+    return QStringLiteral("%1 %2 { %3 };")
+           .arg(type.kind == DebugInfoType::Kind::Union ? "union" : "struct", name,
+                lines.join(' '));
+}
+
+QString DebugInfo::cName(const QString &name)
+{
+    QString result = name;
+    for (QChar &c : result) {
+        if (!c.isLetterOrNumber() && c != '_') {
+            c = '_';
+        }
+    }
+    if (!result.isEmpty() && result[0].isDigit()) {
+        result.prepend('_');
+    }
+    return result;
+}
+
+bool DebugInfo::isDefined(const QString &name)
+{
+    RCoreLocked core = Core()->core();
+    return sdb_const_get(core->anal->sdb_types, name.toUtf8().constData(), nullptr) != nullptr;
+}
+
+void DebugInfo::updateAccount()
+{
+    size_t bytes = symbols.capacity() * sizeof(DebugInfoSymbol)
+                   + types.capacity() * sizeof(DebugInfoType);
+    for (const DebugInfoSymbol &symbol : symbols) {
+        bytes += symbol.name.size() * sizeof(QChar);
+    }
+    for (const DebugInfoType &type : types) {
+        if (!type.materialized) {
+            bytes += type.members.capacity() * sizeof(DebugInfoType::Member);
+        }
+    }
+    account.update(bytes, symbols.size() + types.size());
+}
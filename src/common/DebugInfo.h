@@ -0,0 +1,171 @@
+#ifndef DEBUGINFO_H
+#define DEBUGINFO_H
+
+#include "core/Cutter.h"
+#include "common/AsyncTask.h"
+#include "common/MemoryAccounting.h"
+
+#include <QHash>
+#include <QObject>
+#include <QSharedPointer>
+#include <QStringList>
+
+#include <vector>
+
+struct DebugInfoSymbol {
+    RVA address;
+    QString name;
+};
+
+struct DebugInfoType {
+    enum class Kind {
+        Struct,
+        Union,
+        Enum
+    };
+
+    struct Member {
+        QString type;       ///< type as written by the debug information, empty for enum cases
+        QString name;
+        st64 offset;        ///< offset in bytes or the value of an enum case
+    };
+
+    Kind kind;
+    QString name;
+    ut64 size;
+    std::vector<Member> members;
+    bool materialized = false;
+    bool materializing = false;     ///< types may contain each other through pointers
+    bool failed = false;            ///< r2 could not parse its definition, not retried lazily
+
+    QString category() const;
+};
+
+/**
+ * @brief Debug information read from a file, before anything was applied to r2
+ */
+struct DebugInfoData {
+    QString file;
+    std::vector<DebugInfoSymbol> symbols;
+    std::vector<DebugInfoType> types;
+};
+
+Q_DECLARE_METATYPE(QSharedPointer<DebugInfoData>)
+
+class DebugInfoTask : public AsyncTask
+{
+    Q_OBJECT
+
+public:
+    explicit DebugInfoTask(const QString &file);
+
+    QString getTitle() override     { return tr("Loading Debug Information"); }
+
+    QSharedPointer<DebugInfoData> getData() const   { return data; }
+
+protected:
+    void runTask() override;
+
+private:
+    QSharedPointer<DebugInfoData> data;
+
+    void applySymbols();
+};
+
+/**
+ * @brief Debug information of PDB files, loaded in the background.
+ *
+ * A DebugInfoTask reads the file through r2 and indexes its symbols and types, then names
+ * symbols and functions in batches, so that r2 is only locked briefly at a time. Types are
+ * kept as read and only added to the r2 type database once something needs their
+ * definition: the types widget, the decompiler for the types used by a function or a
+ * structure offset picked from the disassembly. Until then they are listed by pendingTypes().
+ *
+ * DWARF information is still read by r2 while loading the binary.
+ *
+ * It must only be used from the GUI thread.
+ */
+class DebugInfo : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DebugInfo *instance();
+
+    bool isLoading() const                          { return !task.isNull(); }
+
+    /**
+     * @return types not yet added to the r2 type database, the format of types r2 failed to
+     * parse tells so
+     */
+    QList<TypeDescription> pendingTypes() const;
+    bool hasPendingTypes() const                    { return pendingCount > 0; }
+
+    /**
+     * @brief Add the definition of the type called name and of the types it contains to
+     * the r2 type database, if it was not added yet
+     * @return false if there is no such type or r2 failed to parse it
+     */
+    bool materializeType(const QString &name);
+    /**
+     * @brief Drop the pending type called name without adding it
+     */
+    void discardType(const QString &name);
+    /**
+     * @brief Materialize all types named in the variables and the signature of function
+     */
+    void materializeFunctionTypes(RVA function);
+    /**
+     * @return "type.member" of the pending structures with a member at offset, as used by
+     * CutterCore::applyStructureOffset
+     */
+    QStringList pendingMembersAt(st64 offset, int max) const;
+
+    const DebugInfoSymbol *symbolAt(RVA address) const;
+
+    /**
+     * @brief Load file on the calling thread and return once its symbols are named, e.g.
+     * before the analysis so that it keeps the names. The types are handed to the instance
+     * on the GUI thread afterwards. May be called from any thread.
+     */
+    static void loadNow(const QString &file);
+
+public slots:
+    /**
+     * @brief Load file in the background, does nothing if a file is loading already
+     */
+    void load(const QString &file);
+
+signals:
+    void loaded(const QString &file);
+    void typesChanged();
+
+private slots:
+    /**
+     * @param complete false if the task reading data was interrupted
+     */
+    void add(QSharedPointer<DebugInfoData> data, bool complete);
+
+private:
+    DebugInfo();
+
+    QSharedPointer<DebugInfoTask> task;
+    std::vector<DebugInfoSymbol> symbols;   ///< sorted by address
+    std::vector<DebugInfoType> types;
+    QHash<QString, size_t> typeByName;      ///< by the name used in C, see cName()
+    QMultiHash<st64, size_t> structMembersByOffset;
+    int pendingCount = 0;
+    MemoryAccount account;
+
+    void onTaskFinished();
+    bool materialize(size_t index, int depth);
+    /**
+     * @param opaqueMembers declare members as byte arrays, for types r2 can not parse
+     */
+    QString definition(const DebugInfoType &type, bool opaqueMembers) const;
+    static QString cName(const QString &name);
+    static bool isDefined(const QString &name);
+    void updateAccount();
+};
+
+#endif // DEBUGINFO_H
@@ -0,0 +1,494 @@
+#include "DisassemblyTextIndex.h"
+#include "common/JsonReader.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+void appendVarint(QByteArray &out, quint32 value)
+{
+    while (value >= 0x80) {
+        out.append(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+void decodePostings(const QByteArray &postings, quint32 begin, quint32 end,
+                    std::vector<quint32> &out)
+{
+    out.clear();
+    const uchar *data = reinterpret_cast<const uchar *>(postings.constData());
+    quint32 index = 0;
+    quint32 pos = begin;
+    while (pos < end) {
+        quint32 delta = 0;
+        int shift = 0;
+        uchar byte;
+        do {
+            byte = data[pos++];
+            delta |= static_cast<quint32>(byte & 0x7f) << shift;
+            shift += 7;
+        } while ((byte & 0x80) && pos < end);
+        index += delta;
+        out.push_back(index);
+    }
+}
+
+void addRunTrigrams(const QString &run, std::vector<quint32> &out)
+{
+    for (int i = 0; i + 2 < run.size(); i++) {
+        out.push_back(DisassemblyText::trigram(run[i], run[i + 1], run[i + 2]));
+    }
+}
+
+/**
+ * @return whether the escaped character stands for itself in a regular expression
+ */
+bool isLiteralEscape(QChar c)
+{
+    return !c.isLetterOrNumber();
+}
+
+bool isHexDigit(QChar c)
+{
+    return c.isDigit() || (c.toLower() >= QLatin1Char('a') && c.toLower() <= QLatin1Char('f'));
+}
+
+/**
+ * @return index of the last character of the escape sequence at i, which is the backslash
+ */
+int escapeEnd(const QString &pattern, int i)
+{
+    int end = i + 1;
+    if (end >= pattern.size()) {
+        return i;
+    }
+    QChar c = pattern[end];
+    QChar next = end + 1 < pattern.size() ? pattern[end + 1] : QChar();
+    auto closing = [&pattern, end](QChar close) {
+        int found = pattern.indexOf(close, end + 2);
+        return found < 0 ? pattern.size() - 1 : found;
+    };
+    if (c == QLatin1Char('Q')) {
+        // Quoted up to \E, only breaks the run to keep this simple
+        int found = pattern.indexOf(QLatin1String("\\E"), end + 1);
+        return found < 0 ? pattern.size() - 1 : found + 1;
+    }
+    if (c == QLatin1Char('x') || c == QLatin1Char('u')) {
+        if (next == QLatin1Char('{')) {
+            return closing(QLatin1Char('}'));
+        }
+        int maxDigits = c == QLatin1Char('x') ? 2 : 4;
+        for (int digits = 0; digits < maxDigits && end + 1 < pattern.size()
+                && isHexDigit(pattern[end + 1]); digits++) {
+            end++;
+        }
+        return end;
+    }
+    if (c.isDigit()) {
+        // Octal code or back reference
+        while (end + 1 < pattern.size() && pattern[end + 1].isDigit()) {
+            end++;
+        }
+        return end;
+    }
+    if (c == QLatin1Char('c')) {
+        return qMin(end + 1, pattern.size() - 1);
+    }
+    if (QStringLiteral("opPNgk").contains(c)) {
+        if (next == QLatin1Char('{')) {
+            return closing(QLatin1Char('}'));
+        }
+        if (next == QLatin1Char('<')) {
+            return closing(QLatin1Char('>'));
+        }
+        if (next == QLatin1Char('\'')) {
+            return closing(QLatin1Char('\''));
+        }
+        if (c == QLatin1Char('g')) {
+            while (end + 1 < pattern.size()
+                    && (pattern[end + 1].isDigit() || pattern[end + 1] == QLatin1Char('-'))) {
+                end++;
+            }
+            return end;
+        }
+        if (c == QLatin1Char('p') || c == QLatin1Char('P')) {
+            return qMin(end + 1, pattern.size() - 1);
+        }
+    }
+    return end;
+}
+
+/**
+ * @return index of the ']' closing the character class opened at i
+ */
+int classEnd(const QString &pattern, int i)
+{
+    // A ']' right after the opening bracket is a member
+    int j = i + 1;
+    if (j < pattern.size() && pattern[j] == QLatin1Char('^')) {
+        j++;
+    }
+    if (j < pattern.size() && pattern[j] == QLatin1Char(']')) {
+        j++;
+    }
+    while (j < pattern.size() && pattern[j] != QLatin1Char(']')) {
+        if (pattern[j] == QLatin1Char('\\')) {
+            j = escapeEnd(pattern, j) + 1;
+        } else if (pattern[j] == QLatin1Char('[') && j + 1 < pattern.size()
+                   && QStringLiteral(":.=").contains(pattern[j + 1])) {
+            // POSIX class like [:alpha:], ends with the same character and ']'
+            QString close = QString(pattern[j + 1]) + QLatin1Char(']');
+            int found = pattern.indexOf(close, j + 2);
+            j = found < 0 ? j + 1 : found + 2;
+        } else {
+            j++;
+        }
+    }
+    return qMin(j, pattern.size());
+}
+
+}
+
+quint32 DisassemblyText::trigram(QChar a, QChar b, QChar c)
+{
+    // Collisions only weaken the prefilter, matches are always checked with the expression
+    return (static_cast<quint32>(a.toLower().unicode() & 0x3ff) << 20)
+           | (static_cast<quint32>(b.toLower().unicode() & 0x3ff) << 10)
+           | static_cast<quint32>(c.toLower().unicode() & 0x3ff);
+}
+
+void DisassemblyText::buildIndex()
+{
+    std::vector<std::pair<quint32, quint32>> pairs;
+    for (int i = 0; i < instructionCount(); i++) {
+        QStringRef instruction = instructionText(i);
+        for (int j = 0; j + 2 < instruction.size(); j++) {
+            pairs.emplace_back(trigram(instruction.at(j), instruction.at(j + 1),
+                                       instruction.at(j + 2)),
+                               static_cast<quint32>(i));
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    trigrams.clear();
+    postingOffsets.clear();
+    postings.clear();
+    quint32 previous = 0;
+    for (size_t i = 0; i < pairs.size(); i++) {
+        if (i == 0 || pairs[i].first != pairs[i - 1].first) {
+            trigrams.push_back(pairs[i].first);
+            postingOffsets.push_back(static_cast<quint32>(postings.size()));
+            previous = 0;
+        }
+        appendVarint(postings, pairs[i].second - previous);
+        previous = pairs[i].second;
+    }
+    postingOffsets.push_back(static_cast<quint32>(postings.size()));
+    trigrams.shrink_to_fit();
+    postingOffsets.shrink_to_fit();
+    postings.squeeze();
+    text.squeeze();
+    addresses.squeeze();
+    sizes.squeeze();
+    textOffsets.squeeze();
+}
+
+std::vector<quint32> DisassemblyText::candidates(const std::vector<quint32> &required) const
+{
+    std::vector<quint32> result;
+    if (required.empty()) {
+        result.resize(static_cast<size_t>(instructionCount()));
+        for (size_t i = 0; i < result.size(); i++) {
+            result[i] = static_cast<quint32>(i);
+        }
+        return result;
+    }
+
+    // Posting ranges of all required trigrams, intersected starting with the shortest
+    std::vector<std::pair<quint32, quint32>> ranges;
+    for (quint32 t : required) {
+        auto it = std::lower_bound(trigrams.begin(), trigrams.end(), t);
+        if (it == trigrams.end() || *it != t) {
+            return result;
+        }
+        size_t i = static_cast<size_t>(it - trigrams.begin());
+        ranges.emplace_back(postingOffsets[i], postingOffsets[i + 1]);
+    }
+    std::sort(ranges.begin(), ranges.end(), [](const std::pair<quint32, quint32> &a,
+                                               const std::pair<quint32, quint32> &b) {
+        return a.second - a.first < b.second - b.first;
+    });
+
+    decodePostings(postings, ranges[0].first, ranges[0].second, result);
+    std::vector<quint32> other;
+    std::vector<quint32> intersection;
+    for (size_t i = 1; i < ranges.size() && !result.empty(); i++) {
+        decodePostings(postings, ranges[i].first, ranges[i].second, other);
+        intersection.clear();
+        std::set_intersection(result.begin(), result.end(), other.begin(), other.end(),
+                              std::back_inserter(intersection));
+        result.swap(intersection);
+    }
+    return result;
+}
+
+size_t DisassemblyText::byteSize() const
+{
+    return sizeof(DisassemblyText) + MemoryAccounting::stringSize(text)
+           + static_cast<size_t>(addresses.capacity()) * sizeof(RVA)
+           + static_cast<size_t>(sizes.capacity())
+           + static_cast<size_t>(textOffsets.capacity()) * sizeof(quint32)
+           + (trigrams.capacity() + postingOffsets.capacity()) * sizeof(quint32)
+           + static_cast<size_t>(postings.capacity());
+}
+
+DisassemblyTextIndexTask::DisassemblyTextIndexTask(const QList<FunctionDescription> &functions)
+    : functions(functions)
+{
+}
+
+void DisassemblyTextIndexTask::runTask()
+{
+    log(tr("Indexing disassembly of %n functions...", nullptr, functions.size()));
+    for (int i = 0; i < functions.size(); i++) {
+        if (isInterrupted()) {
+            return;
+        }
+        const FunctionDescription &function = functions[i];
+        QSharedPointer<DisassemblyText> text(new DisassemblyText);
+
+        // The core is only locked while this function is disassembled
+        Core()->cmdjStream(QString("pdfj @ %1").arg(function.offset), [&text](JsonReader &reader) {
+            reader.readObject([&text](const JsonReader::Key &key, JsonReader &reader) {
+                if (key != "ops") {
+                    return;
+                }
+                reader.readArray([&text](JsonReader &reader) {
+                    RVA offset = RVA_INVALID;
+                    quint64 size = 0;
+                    QString disasm;
+                    bool invalid = false;
+                    reader.readObject([&](const JsonReader::Key &key, JsonReader &reader) {
+                        if (key == "offset") {
+                            offset = reader.readUInt64(RVA_INVALID);
+                        } else if (key == "size") {
+                            size = reader.readUInt64(0);
+                        } else if (key == "disasm") {
+                            disasm = reader.readString();
+                        } else if (key == "type") {
+                            invalid = reader.readString() == QLatin1String("invalid");
+                        }
+                    });
+                    if (invalid || offset == RVA_INVALID || disasm.isEmpty()) {
+                        return;
+                    }
+                    text->addresses.append(offset);
+                    text->sizes.append(static_cast<quint8>(qMin<quint64>(size, 0xff)));
+                    text->textOffsets.append(static_cast<quint32>(text->text.size()));
+                    text->text += disasm.simplified();
+                });
+            });
+        });
+        text->textOffsets.append(static_cast<quint32>(text->text.size()));
+        text->buildIndex();
+        results.insert(function.offset, text);
+        setProgress(i + 1, functions.size());
+    }
+}
+
+DisassemblyTextQuery::DisassemblyTextQuery(const QString &pattern,
+                                           const QVector<QSharedPointer<const DisassemblyText>> &functions)
+    : regex(pattern, QRegularExpression::CaseInsensitiveOption),
+      required(requiredTrigrams(pattern)),
+      functions(functions)
+{
+    if (!regex.isValid()) {
+        this->functions.clear();
+    }
+}
+
+void DisassemblyTextQuery::run(int timeBudgetMs, QList<SearchDescription> *results, int maxResults)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!isFinished() && resultCount < maxResults) {
+        const DisassemblyText &function = *functions[next++];
+        for (quint32 i : function.candidates(required)) {
+            QStringRef instruction = function.instructionText(static_cast<int>(i));
+            if (!regex.match(instruction).hasMatch()) {
+                continue;
+            }
+            SearchDescription description;
+            description.offset = function.addresses[static_cast<int>(i)];
+            description.size = function.sizes[static_cast<int>(i)];
+            description.code = instruction.toString();
+            results->append(description);
+            if (++resultCount >= maxResults) {
+                break;
+            }
+        }
+        if (timer.elapsed() >= timeBudgetMs) {
+            break;
+        }
+    }
+    if (resultCount >= maxResults) {
+        next = functions.size();
+    }
+}
+
+std::vector<quint32> DisassemblyTextQuery::requiredTrigrams(const QString &pattern)
+{
+    std::vector<quint32> result;
+    QString run;
+    int depth = 0;
+    for (int i = 0; i < pattern.size(); i++) {
+        QChar c = pattern[i];
+        bool literal = false;
+        QChar value;
+        if (c == QLatin1Char('\\') && i + 1 < pattern.size()) {
+            // Escapes with a code like \x41 or \101 break the run as a whole
+            int end = escapeEnd(pattern, i);
+            literal = end == i + 1 && isLiteralEscape(pattern[end]);
+            value = pattern[end];
+            i = end;
+        } else if (c == QLatin1Char('|')) {
+            if (depth == 0) {
+                // Nothing is required by all alternatives
+                return {};
+            }
+        } else if (c == QLatin1Char('(')) {
+            depth++;
+        } else if (c == QLatin1Char(')')) {
+            depth = qMax(0, depth - 1);
+        } else if (c == QLatin1Char('[')) {
+            i = classEnd(pattern, i);
+        } else if (c == QLatin1Char('{')) {
+            // Skip the repetition count of the preceding atom
+            int end = pattern.indexOf(QLatin1Char('}'), i);
+            i = end < 0 ? pattern.size() : end;
+        } else if (QStringLiteral(".^$*+?}").contains(c)) {
+            // Handled below as quantifiers or run breaks
+        } else {
+            literal = true;
+            value = c;
+        }
+
+        if (literal && depth == 0) {
+            QChar following = i + 1 < pattern.size() ? pattern[i + 1] : QChar();
+            if (following == QLatin1Char('*') || following == QLatin1Char('?')
+                    || following == QLatin1Char('{')) {
+                // Optional or repeated a variable number of times, ends the run without it
+                addRunTrigrams(run, result);
+                run.clear();
+            } else {
+                run += value;
+                if (following == QLatin1Char('+')) {
+                    addRunTrigrams(run, result);
+                    run.clear();
+                }
+            }
+        } else {
+            addRunTrigrams(run, result);
+            run.clear();
+        }
+    }
+    addRunTrigrams(run, result);
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+DisassemblyTextIndex *DisassemblyTextIndex::instance()
+{
+    static DisassemblyTextIndex *index = new DisassemblyTextIndex();
+    return index;
+}
+
+DisassemblyTextIndex::DisassemblyTextIndex()
+    : account(QStringLiteral("Disassembly text index"), [this](size_t) {
+          invalidate();
+      })
+{
+    connect(Core(), &CutterCore::functionRenamed, this, &DisassemblyTextIndex::onFunctionRenamed);
+}
+
+AsyncTask::Ptr DisassemblyTextIndex::createTask(const QList<FunctionDescription> &functions)
+{
+    return AsyncTask::Ptr(new DisassemblyTextIndexTask(functions));
+}
+
+QList<RVA> DisassemblyTextIndex::takeResults(AsyncTask *task)
+{
+    const QHash<RVA, QSharedPointer<const DisassemblyText>> &results =
+        static_cast<DisassemblyTextIndexTask *>(task)->getResults();
+    for (auto it = results.constBegin(); it != results.constEnd(); ++it) {
+        functions.insert(it.key(), it.value());
+    }
+    return results.keys();
+}
+
+void DisassemblyTextIndex::removeFunctions(const QList<RVA> &offsets)
+{
+    for (RVA offset : offsets) {
+        functions.remove(offset);
+    }
+}
+
+void DisassemblyTextIndex::clearFunctions()
+{
+    functions.clear();
+}
+
+void DisassemblyTextIndex::indexChanged()
+{
+    updateAccount();
+}
+
+void DisassemblyTextIndex::onFunctionRenamed(const QString &prevName, const QString &newName)
+{
+    Q_UNUSED(newName)
+    if (!isBuilt() || prevName.isEmpty()) {
+        return;
+    }
+    // Calls and references render the name of the function
+    for (auto it = functions.constBegin(); it != functions.constEnd(); ++it) {
+        if (it.value()->text.contains(prevName)) {
+            markDirty(it.key());
+        }
+    }
+}
+
+void DisassemblyTextIndex::updateAccount()
+{
+    size_t bytes = 0;
+    size_t instructions = 0;
+    for (const auto &function : functions) {
+        bytes += sizeof(RVA) + function->byteSize();
+        instructions += static_cast<size_t>(function->instructionCount());
+    }
+    account.update(bytes, instructions);
+}
+
+QSharedPointer<DisassemblyTextQuery> DisassemblyTextIndex::query(const QString &pattern)
+{
+    account.touch();
+    QVector<QSharedPointer<const DisassemblyText>> snapshot;
+    snapshot.reserve(functions.size());
+    for (const auto &function : functions) {
+        snapshot.append(function);
+    }
+    // Results in address order of the functions
+    std::sort(snapshot.begin(), snapshot.end(), [](const QSharedPointer<const DisassemblyText> &a,
+                                                   const QSharedPointer<const DisassemblyText> &b) {
+        RVA aStart = a->addresses.isEmpty() ? 0 : a->addresses.first();
+        RVA bStart = b->addresses.isEmpty() ? 0 : b->addresses.first();
+        return aStart < bStart;
+    });
+    return QSharedPointer<DisassemblyTextQuery>(new DisassemblyTextQuery(pattern, snapshot));
+}
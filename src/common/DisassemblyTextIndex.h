@@ -0,0 +1,147 @@
+#ifndef DISASSEMBLYTEXTINDEX_H
+#define DISASSEMBLYTEXTINDEX_H
+
+#include "core/Cutter.h"
+#include "common/AsyncTask.h"
+#include "common/BackgroundIndex.h"
+#include "common/MemoryAccounting.h"
+
+#include <QHash>
+#include <QRegularExpression>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <vector>
+
+/**
+ * @brief Rendered disassembly of one function together with a trigram index over it.
+ *
+ * The instruction texts are stored back to back in one string. For every distinct trigram
+ * of the lowercased texts, the indices of the instructions containing it are stored as
+ * varint coded deltas in one byte array.
+ */
+struct DisassemblyText {
+    QVector<RVA> addresses;
+    QVector<quint8> sizes;
+    QVector<quint32> textOffsets;   ///< start of every instruction in text, followed by the end
+    QString text;
+    std::vector<quint32> trigrams;  ///< sorted
+    std::vector<quint32> postingOffsets;    ///< start of every trigram in postings, followed by the end
+    QByteArray postings;
+
+    int instructionCount() const        { return addresses.size(); }
+    QStringRef instructionText(int i) const
+    {
+        return text.midRef(static_cast<int>(textOffsets[i]),
+                           static_cast<int>(textOffsets[i + 1] - textOffsets[i]));
+    }
+
+    /**
+     * @brief Fill trigrams, postingOffsets and postings from the instruction texts
+     */
+    void buildIndex();
+
+    /**
+     * @return indices of the instructions containing all trigrams, sorted
+     */
+    std::vector<quint32> candidates(const std::vector<quint32> &required) const;
+
+    size_t byteSize() const;
+
+    static quint32 trigram(QChar a, QChar b, QChar c);
+};
+
+class DisassemblyTextIndexTask : public AsyncTask
+{
+    Q_OBJECT
+
+public:
+    explicit DisassemblyTextIndexTask(const QList<FunctionDescription> &functions);
+
+    QString getTitle() override     { return tr("Indexing Disassembly"); }
+
+    const QHash<RVA, QSharedPointer<const DisassemblyText>> &getResults() const { return results; }
+
+protected:
+    void runTask() override;
+
+private:
+    QList<FunctionDescription> functions;
+    QHash<RVA, QSharedPointer<const DisassemblyText>> results;
+};
+
+/**
+ * @brief Regex search over a snapshot of the DisassemblyTextIndex, run in slices so that
+ * the results can be shown while it is running.
+ */
+class DisassemblyTextQuery
+{
+public:
+    DisassemblyTextQuery(const QString &pattern,
+                         const QVector<QSharedPointer<const DisassemblyText>> &functions);
+
+    bool isValid() const                { return regex.isValid(); }
+    QString errorString() const         { return regex.errorString(); }
+    bool isFinished() const             { return next >= functions.size(); }
+
+    /**
+     * @brief Continue the search for about timeBudgetMs milliseconds.
+     * @param results the matches found in this slice are appended to it
+     * @param maxResults the search finishes once this many matches have been found in total
+     */
+    void run(int timeBudgetMs, QList<SearchDescription> *results, int maxResults);
+
+    /**
+     * @brief Trigrams every match of pattern contains, from the literal parts of the pattern
+     * outside of groups, character classes and alternations.
+     */
+    static std::vector<quint32> requiredTrigrams(const QString &pattern);
+
+private:
+    QRegularExpression regex;
+    std::vector<quint32> required;
+    QVector<QSharedPointer<const DisassemblyText>> functions;
+    int next = 0;
+    int resultCount = 0;
+};
+
+/**
+ * @brief Full-text index over the rendered disassembly of all analyzed functions, answering
+ * regex searches by running the expression only on instructions containing all trigrams
+ * of its literal parts.
+ *
+ * Besides the changes FunctionIndex follows, functions referencing a renamed function are
+ * indexed again.
+ *
+ * It must only be used from the GUI thread.
+ */
+class DisassemblyTextIndex : public FunctionIndex
+{
+    Q_OBJECT
+
+public:
+    static DisassemblyTextIndex *instance();
+
+    /**
+     * @brief Start a search over the functions indexed so far, see DisassemblyTextQuery::run()
+     */
+    QSharedPointer<DisassemblyTextQuery> query(const QString &pattern);
+
+protected:
+    AsyncTask::Ptr createTask(const QList<FunctionDescription> &functions) override;
+    QList<RVA> takeResults(AsyncTask *task) override;
+    void removeFunctions(const QList<RVA> &offsets) override;
+    void clearFunctions() override;
+    void indexChanged() override;
+
+private:
+    DisassemblyTextIndex();
+
+    QHash<RVA, QSharedPointer<const DisassemblyText>> functions;
+    MemoryAccount account;
+
+    void onFunctionRenamed(const QString &prevName, const QString &newName);
+    void updateAccount();
+};
+
+#endif // DISASSEMBLYTEXTINDEX_H
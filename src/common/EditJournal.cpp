@@ -0,0 +1,176 @@
+#include "EditJournal.h"
+
+#include "core/Cutter.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QStandardPaths>
+
+EditJournal::EditJournal()
+{
+    connect(Core(), &CutterCore::projectSaved, this, &EditJournal::onProjectSaved);
+}
+
+EditJournal *EditJournal::instance()
+{
+    static EditJournal journal;
+    return &journal;
+}
+
+QString EditJournal::directory()
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)
+                  + QStringLiteral("/journal");
+    QDir().mkpath(dir);
+    return dir;
+}
+
+void EditJournal::openFile(const QString &path)
+{
+    projectName.clear();
+    QByteArray key = QCryptographicHash::hash(QFileInfo(path).absoluteFilePath().toUtf8(),
+                                              QCryptographicHash::Sha1).toHex();
+    open(directory() + QLatin1Char('/') + QString::fromLatin1(key) + QStringLiteral(".journal"));
+}
+
+void EditJournal::openProject(const QString &name)
+{
+    projectName = name;
+    // Pi gives the path of the project script
+    QFileInfo script(Core()->cmdRaw("Pi " + name).trimmed());
+    open(script.absolutePath() + QStringLiteral("/cutter.journal"));
+}
+
+void EditJournal::open(const QString &path)
+{
+    QMutexLocker locker(&mutex);
+    file.close();
+    file.setFileName(path);
+    recoverable = 0;
+    bool endsWithNewline = true;
+    if (file.open(QIODevice::ReadOnly)) {
+        while (!file.atEnd()) {
+            QByteArray line = file.readLine();
+            endsWithNewline = line.endsWith('\n');
+            if (QJsonDocument::fromJson(line).isObject()) {
+                recoverable++;
+            }
+        }
+        file.close();
+    }
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Can not open the edit journal" << path;
+        return;
+    }
+    if (!endsWithNewline) {
+        // The last edit was cut short by a crash, keep it apart from the next ones
+        file.write("\n");
+        file.flush();
+    }
+}
+
+void EditJournal::reset()
+{
+    QMutexLocker locker(&mutex);
+    if (file.isOpen()) {
+        file.resize(0);
+    }
+    recoverable = 0;
+}
+
+void EditJournal::append(const QJsonObject &entry)
+{
+    if (replaying) {
+        return;
+    }
+    QByteArray line = QJsonDocument(entry).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    QMutexLocker locker(&mutex);
+    if (!file.isOpen()) {
+        return;
+    }
+    file.write(line);
+    file.flush();
+}
+
+void EditJournal::recordCommand(const QString &command, RVA address)
+{
+    if (Core()->currentlyDebugging && command.startsWith(QLatin1Char('w'))) {
+        // Writes go to the memory of the debuggee, not to the binary
+        return;
+    }
+    QJsonObject entry;
+    entry[QStringLiteral("cmd")] = command;
+    if (address != RVA_INVALID) {
+        entry[QStringLiteral("at")] = RAddressString(address);
+    }
+    append(entry);
+}
+
+void EditJournal::recordTypes(const QString &definitions)
+{
+    QJsonObject entry;
+    entry[QStringLiteral("types")] = definitions;
+    append(entry);
+}
+
+int EditJournal::replay()
+{
+    QList<QJsonObject> entries;
+    {
+        QMutexLocker locker(&mutex);
+        QFile in(file.fileName());
+        if (!in.open(QIODevice::ReadOnly)) {
+            return 0;
+        }
+        while (!in.atEnd() && entries.size() < recoverable) {
+            QJsonDocument doc = QJsonDocument::fromJson(in.readLine());
+            if (doc.isObject()) {
+                entries.append(doc.object());
+            }
+        }
+    }
+
+    // The edits stay in the journal, they are still not part of the snapshot
+    replaying = true;
+    for (const QJsonObject &entry : entries) {
+        if (entry.contains(QStringLiteral("types"))) {
+            Core()->addTypes(entry[QStringLiteral("types")].toString());
+            continue;
+        }
+        QString command = entry[QStringLiteral("cmd")].toString();
+        if (entry.contains(QStringLiteral("at"))) {
+            Core()->cmdRawAt(command, Core()->math(entry[QStringLiteral("at")].toString()));
+        } else {
+            Core()->cmdRaw(command);
+        }
+    }
+    replaying = false;
+    recoverable = 0;
+    Core()->triggerRefreshAll();
+    return entries.size();
+}
+
+void EditJournal::discard()
+{
+    reset();
+}
+
+void EditJournal::onProjectSaved(bool successfully, const QString &name)
+{
+    if (!successfully) {
+        return;
+    }
+    if (projectName.isEmpty()) {
+        // The edits of the binary are part of the project now
+        QMutexLocker locker(&mutex);
+        file.close();
+        file.remove();
+    }
+    openProject(name);
+    reset();
+}
@@ -0,0 +1,92 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include "core/CutterCommon.h"
+
+#include <QFile>
+#include <QJsonObject>
+#include <QMutex>
+#include <QObject>
+
+#include <atomic>
+
+/**
+ * @brief Append-only journal of the edits made by the user since the last project snapshot:
+ * renames, comments, types, data definitions, patches, ...
+ *
+ * Every edit is appended as one line and flushed right away, so recording it costs the same
+ * on any size of project and the edits survive a crash of Cutter, the journal is the
+ * autosave. It is only compacted when the user saves the project, which writes a full
+ * snapshot with "Ps" and starts an empty journal. If the journal of a binary or project is
+ * not empty when it is opened again, the previous session ended without saving and its edits
+ * can be replayed on top of the snapshot or discarded.
+ *
+ * Binaries that were not saved to a project yet are journaled in the application data
+ * directory, projects next to their script.
+ *
+ * Edits are recorded from CutterCore::cmdEdit, the CutterCore methods editing the
+ * analysis and the dialogs adding types. Patches which depend on the code they replace,
+ * like reversing a jump, are recorded as the bytes they wrote, so that replaying them on
+ * the snapshot gives the same result. Types added by Cutter itself, e.g. from debug
+ * info, are not recorded.
+ */
+class EditJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    static EditJournal *instance();
+
+    /**
+     * @brief Journal the edits of the binary at path, which is not part of a project
+     */
+    void openFile(const QString &path);
+    /**
+     * @brief Journal the edits on top of the snapshot of the project called name, after it
+     * was loaded
+     */
+    void openProject(const QString &name);
+
+    /**
+     * @brief Append a command which was run at address to edit the analysis or the binary
+     * @param address RVA_INVALID if command was run at no specific address
+     */
+    void recordCommand(const QString &command, RVA address = RVA_INVALID);
+    /**
+     * @brief Append C type definitions the user added, with CutterCore::addTypes
+     */
+    void recordTypes(const QString &definitions);
+
+    /**
+     * @return number of edits left by a previous session which did not save them
+     */
+    int recoverableCount() const    { return recoverable; }
+    /**
+     * @brief Run the edits left by a previous session again
+     * @return number of edits replayed
+     */
+    int replay();
+    /**
+     * @brief Drop all edits not in the snapshot, when the user chose not to keep them
+     */
+    void discard();
+
+private:
+    EditJournal();
+
+    QMutex mutex;
+    QFile file;
+    QString projectName;
+    int recoverable = 0;
+    std::atomic<bool> replaying { false };   ///< set on the GUI thread, read by any recording thread
+
+    void open(const QString &path);
+    void reset();
+    void append(const QJsonObject &entry);
+    static QString directory();
+
+private slots:
+    void onProjectSaved(bool successfully, const QString &name);
+};
+
+#endif // EDITJOURNAL_H
@@ -0,0 +1,432 @@
+#include "FunctionMetrics.h"
+
+#include <QPair>
+#include <QVector>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+/**
+ * Blocks larger than this are most likely misanalyzed data and only analyzed up to it.
+ */
+const RVA MAX_BLOCK_SIZE = 0x100000;
+const int MAX_INSTRUCTION_BYTES = 16;
+
+quint64 hashBytes(quint64 hash, const void *data, size_t size)
+{
+    // FNV-1a
+    const quint8 *bytes = static_cast<const quint8 *>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+double ratio(int part, int total)
+{
+    return total > 0 ? 100.0 * part / total : 0.0;
+}
+
+void classifyOp(const RAnalOp &op, FunctionMetricsInput *input)
+{
+    switch (op.type & R_ANAL_OP_TYPE_MASK) {
+    case R_ANAL_OP_TYPE_ADD:
+    case R_ANAL_OP_TYPE_SUB:
+    case R_ANAL_OP_TYPE_MUL:
+    case R_ANAL_OP_TYPE_DIV:
+    case R_ANAL_OP_TYPE_MOD:
+    case R_ANAL_OP_TYPE_SHL:
+    case R_ANAL_OP_TYPE_SHR:
+    case R_ANAL_OP_TYPE_SAL:
+    case R_ANAL_OP_TYPE_SAR:
+    case R_ANAL_OP_TYPE_ROL:
+    case R_ANAL_OP_TYPE_ROR:
+    case R_ANAL_OP_TYPE_ABS:
+        input->arithmetic++;
+        break;
+    case R_ANAL_OP_TYPE_AND:
+    case R_ANAL_OP_TYPE_OR:
+    case R_ANAL_OP_TYPE_XOR:
+    case R_ANAL_OP_TYPE_NOR:
+    case R_ANAL_OP_TYPE_NOT:
+        input->logic++;
+        break;
+    case R_ANAL_OP_TYPE_MOV:
+    case R_ANAL_OP_TYPE_CMOV:
+    case R_ANAL_OP_TYPE_LOAD:
+    case R_ANAL_OP_TYPE_STORE:
+    case R_ANAL_OP_TYPE_PUSH:
+    case R_ANAL_OP_TYPE_UPUSH:
+    case R_ANAL_OP_TYPE_RPUSH:
+    case R_ANAL_OP_TYPE_POP:
+    case R_ANAL_OP_TYPE_LEA:
+    case R_ANAL_OP_TYPE_XCHG:
+        input->memory++;
+        break;
+    case R_ANAL_OP_TYPE_JMP:
+    case R_ANAL_OP_TYPE_UJMP:
+    case R_ANAL_OP_TYPE_RJMP:
+    case R_ANAL_OP_TYPE_IJMP:
+    case R_ANAL_OP_TYPE_IRJMP:
+    case R_ANAL_OP_TYPE_CJMP:
+    case R_ANAL_OP_TYPE_MJMP:
+    case R_ANAL_OP_TYPE_RET:
+    case R_ANAL_OP_TYPE_CRET:
+        input->branches++;
+        break;
+    case R_ANAL_OP_TYPE_CALL:
+    case R_ANAL_OP_TYPE_UCALL:
+    case R_ANAL_OP_TYPE_RCALL:
+    case R_ANAL_OP_TYPE_ICALL:
+    case R_ANAL_OP_TYPE_IRCALL:
+    case R_ANAL_OP_TYPE_CCALL:
+    case R_ANAL_OP_TYPE_UCCALL:
+        input->calls++;
+        break;
+    default:
+        break;
+    }
+}
+
+bool isStringFlag(RCore *core, ut64 address)
+{
+    if (address == UT64_MAX) {
+        return false;
+    }
+    RFlagItem *flag = r_flag_get_i(core->flags, address);
+    return flag && flag->name && !strncmp(flag->name, "str.", 4);
+}
+
+/**
+ * Count the edges of the control flow graph that close a cycle, in a depth first search
+ * from the entry block.
+ */
+int countBackEdges(RVA entry, const QHash<RVA, QVector<RVA>> &successors)
+{
+    enum State : quint8 { Unvisited, OnStack, Done };
+    QHash<RVA, State> states;
+    QVector<QPair<RVA, int>> stack;
+    int backEdges = 0;
+    if (!successors.contains(entry)) {
+        return 0;
+    }
+    stack.append({ entry, 0 });
+    states[entry] = OnStack;
+    while (!stack.isEmpty()) {
+        RVA block = stack.last().first;
+        int next = stack.last().second;
+        const QVector<RVA> &targets = successors[block];
+        if (next >= targets.size()) {
+            states[block] = Done;
+            stack.removeLast();
+            continue;
+        }
+        stack.last().second++;
+        RVA target = targets[next];
+        if (!successors.contains(target)) {
+            continue;
+        }
+        State state = states.value(target, Unvisited);
+        if (state == OnStack) {
+            backEdges++;
+        } else if (state == Unvisited) {
+            states[target] = OnStack;
+            stack.append({ target, 0 });
+        }
+    }
+    return backEdges;
+}
+
+}
+
+const QVector<FunctionMetricDefinition> &FunctionMetrics::definitions()
+{
+    static const QVector<FunctionMetricDefinition> metrics = {
+        { QStringLiteral("cc"), tr("Complexity"),
+          tr("Cyclomatic complexity, edges - blocks + 2"), false,
+          [](const FunctionMetricsInput &in) { return qMax(1, in.edges - in.blocks + 2); } },
+        { QStringLiteral("loops"), tr("Loops"),
+          tr("Number of back edges in the control flow graph"), false,
+          [](const FunctionMetricsInput &in) { return in.backEdges; } },
+        { QStringLiteral("calls"), tr("Calls"),
+          tr("Number of call instructions"), false,
+          [](const FunctionMetricsInput &in) { return in.calls; } },
+        { QStringLiteral("strings"), tr("String Refs"),
+          tr("Number of instructions referencing a string"), false,
+          [](const FunctionMetricsInput &in) { return in.stringRefs; } },
+        { QStringLiteral("insns"), tr("Instructions"),
+          tr("Number of instructions"), false,
+          [](const FunctionMetricsInput &in) { return in.instructions; } },
+        { QStringLiteral("arith"), tr("Arithmetic %"),
+          tr("Share of arithmetic and shift instructions"), true,
+          [](const FunctionMetricsInput &in) { return ratio(in.arithmetic, in.instructions); } },
+        { QStringLiteral("logic"), tr("Logic %"),
+          tr("Share of bitwise logic instructions"), true,
+          [](const FunctionMetricsInput &in) { return ratio(in.logic, in.instructions); } },
+        { QStringLiteral("mem"), tr("Memory %"),
+          tr("Share of moves, loads, stores and stack operations"), true,
+          [](const FunctionMetricsInput &in) { return ratio(in.memory, in.instructions); } },
+        { QStringLiteral("branch"), tr("Branch %"),
+          tr("Share of jumps and returns"), true,
+          [](const FunctionMetricsInput &in) { return ratio(in.branches, in.instructions); } },
+    };
+    return metrics;
+}
+
+int FunctionMetrics::metricIndex(const QString &id)
+{
+    const QVector<FunctionMetricDefinition> &metrics = definitions();
+    for (int i = 0; i < metrics.size(); i++) {
+        if (metrics[i].id.compare(id, Qt::CaseInsensitive) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+QString FunctionMetrics::formatValue(int metric, float value)
+{
+    if (definitions()[metric].percent) {
+        return QString::number(static_cast<double>(value), 'f', 1);
+    }
+    return QString::number(static_cast<qint64>(value));
+}
+
+FunctionMetricsTask::FunctionMetricsTask(const QList<RVA> &functions,
+                                         const QSet<quint64> &knownHashes)
+    : functions(functions),
+      knownHashes(knownHashes)
+{
+}
+
+void FunctionMetricsTask::runTask()
+{
+    log(tr("Computing metrics of %n functions...", nullptr, functions.size()));
+    const QVector<FunctionMetricDefinition> &metrics = FunctionMetrics::definitions();
+    for (int i = 0; i < functions.size(); i++) {
+        if (isInterrupted()) {
+            return;
+        }
+        quint64 hash;
+        FunctionMetricsInput input;
+        bool found;
+        {
+            // Locked per function, so that other users of the core are only delayed briefly
+            RCoreLocked core = Core()->core();
+            found = analyzeFunction(core, functions[i], &hash, &input);
+        }
+        if (found) {
+            hashes.insert(functions[i], hash);
+            if (!knownHashes.contains(hash) && !values.contains(hash)) {
+                QVector<float> functionValues(metrics.size());
+                for (int m = 0; m < metrics.size(); m++) {
+                    functionValues[m] = static_cast<float>(metrics[m].compute(input));
+                }
+                values.insert(hash, functionValues);
+            }
+        }
+        setProgress(i + 1, functions.size());
+    }
+}
+
+bool FunctionMetricsTask::analyzeFunction(RCore *core, RVA offset, quint64 *hash,
+                                          FunctionMetricsInput *input)
+{
+    RAnalFunction *fcn = r_anal_get_function_at(core->anal, offset);
+    if (!fcn) {
+        return false;
+    }
+
+    // Blocks in address order, so that the hash does not depend on the analysis order
+    QVector<RAnalBlock *> blocks;
+    RListIter *it;
+    RAnalBlock *bb;
+    r_list_foreach(fcn->bbs, it, bb) {
+        blocks.append(bb);
+    }
+    std::sort(blocks.begin(), blocks.end(), [](const RAnalBlock *a, const RAnalBlock *b) {
+        return a->addr < b->addr;
+    });
+
+    QHash<RVA, QVector<RVA>> successors;
+    QVector<QByteArray> blockBytes(blocks.size());
+    quint64 h = 0xcbf29ce484222325ULL;
+    h = hashBytes(h, &offset, sizeof(offset));
+    for (int i = 0; i < blocks.size(); i++) {
+        bb = blocks[i];
+        QVector<RVA> &targets = successors[bb->addr];
+        if (bb->jump != UT64_MAX) {
+            targets.append(bb->jump);
+        }
+        if (bb->fail != UT64_MAX) {
+            targets.append(bb->fail);
+        }
+        if (bb->switch_op && bb->switch_op->cases) {
+            RListIter *caseIt;
+            RAnalCaseOp *caseOp;
+            r_list_foreach(bb->switch_op->cases, caseIt, caseOp) {
+                targets.append(caseOp->jump);
+            }
+        }
+
+        RVA blockSize = qMin<RVA>(bb->size, MAX_BLOCK_SIZE);
+        QByteArray &bytes = blockBytes[i];
+        bytes.resize(static_cast<int>(blockSize) + MAX_INSTRUCTION_BYTES);
+        r_io_read_at(core->io, bb->addr, reinterpret_cast<ut8 *>(bytes.data()), bytes.size());
+
+        ut64 addr = bb->addr;
+        h = hashBytes(h, &addr, sizeof(addr));
+        h = hashBytes(h, &blockSize, sizeof(blockSize));
+        h = hashBytes(h, targets.constData(), static_cast<size_t>(targets.size()) * sizeof(RVA));
+        h = hashBytes(h, bytes.constData(), static_cast<size_t>(blockSize));
+    }
+    *hash = h;
+    if (knownHashes.contains(h) || values.contains(h)) {
+        return true;
+    }
+
+    input->blocks = blocks.size();
+    for (const QVector<RVA> &targets : successors) {
+        input->edges += targets.size();
+    }
+    input->backEdges = countBackEdges(fcn->addr, successors);
+
+    for (int i = 0; i < blocks.size(); i++) {
+        bb = blocks[i];
+        const QByteArray &bytes = blockBytes[i];
+        const ut8 *data = reinterpret_cast<const ut8 *>(bytes.constData());
+        int blockSize = bytes.size() - MAX_INSTRUCTION_BYTES;
+        for (int pos = 0; pos < blockSize;) {
+            RAnalOp op;
+            int length = r_anal_op(core->anal, &op, bb->addr + pos, data + pos, bytes.size() - pos,
+                                   R_ANAL_OP_MASK_BASIC);
+            if (length <= 0 || op.size <= 0) {
+                r_anal_op_fini(&op);
+                pos++;
+                continue;
+            }
+            input->instructions++;
+            classifyOp(op, input);
+            if (isStringFlag(core, op.ptr) || isStringFlag(core, op.val)) {
+                input->stringRefs++;
+            }
+            pos += op.size;
+            r_anal_op_fini(&op);
+        }
+    }
+    return true;
+}
+
+FunctionMetrics *FunctionMetrics::instance()
+{
+    static FunctionMetrics *metrics = new FunctionMetrics();
+    return metrics;
+}
+
+FunctionMetrics::FunctionMetrics()
+    : BackgroundIndex(0),
+      account(QStringLiteral("Function metrics"), [this](size_t) {
+          invalidate();
+      })
+{
+    connect(Core(), &CutterCore::codeRebased, this, &FunctionMetrics::invalidate);
+}
+
+void FunctionMetrics::update(const QList<FunctionDescription> &functions)
+{
+    requested.clear();
+    requested.reserve(functions.size());
+    for (const FunctionDescription &function : functions) {
+        requested.append(function.offset);
+    }
+    if (isBuilding()) {
+        // Started with the latest list once the running task is done
+        scheduleBuild();
+        return;
+    }
+    build();
+}
+
+AsyncTask::Ptr FunctionMetrics::createBuildTask()
+{
+    if (requested.isEmpty()) {
+        return nullptr;
+    }
+    QSet<quint64> knownHashes;
+    knownHashes.reserve(cache.size());
+    for (auto it = cache.constBegin(); it != cache.constEnd(); ++it) {
+        knownHashes.insert(it.key());
+    }
+    QList<RVA> functions = requested;
+    requested.clear();
+    return AsyncTask::Ptr(new FunctionMetricsTask(functions, knownHashes));
+}
+
+void FunctionMetrics::buildFinished(AsyncTask *task)
+{
+    if (!task) {
+        return;
+    }
+    FunctionMetricsTask *metricsTask = static_cast<FunctionMetricsTask *>(task);
+    const QHash<quint64, QVector<float>> &values = metricsTask->getValues();
+    for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+        cache.insert(it.key(), it.value());
+    }
+    if (task->isInterrupted()) {
+        // Only part of the functions was hashed, keep what is known about the others
+        const QHash<RVA, quint64> &hashes = metricsTask->getHashes();
+        for (auto it = hashes.constBegin(); it != hashes.constEnd(); ++it) {
+            functionHashes.insert(it.key(), it.value());
+        }
+    } else {
+        functionHashes = metricsTask->getHashes();
+        // Drop the metrics of functions that changed or were removed
+        QSet<quint64> used;
+        for (quint64 hash : functionHashes) {
+            used.insert(hash);
+        }
+        for (auto it = cache.begin(); it != cache.end();) {
+            if (used.contains(it.key())) {
+                ++it;
+            } else {
+                it = cache.erase(it);
+            }
+        }
+    }
+    updateAccount();
+    emit updated();
+}
+
+void FunctionMetrics::invalidate()
+{
+    cancelBuild();
+    functionHashes.clear();
+    cache.clear();
+    account.clear();
+    emit updated();
+    if (!requested.isEmpty()) {
+        build();
+    }
+}
+
+void FunctionMetrics::updateAccount()
+{
+    size_t metricCount = static_cast<size_t>(definitions().size());
+    size_t bytes = static_cast<size_t>(functionHashes.size()) * (sizeof(RVA) + sizeof(quint64))
+                   + static_cast<size_t>(cache.size())
+                     * (sizeof(quint64) + sizeof(QVector<float>) + metricCount * sizeof(float));
+    account.update(bytes, static_cast<size_t>(functionHashes.size()));
+}
+
+const QVector<float> *FunctionMetrics::metrics(RVA function) const
+{
+    auto hash = functionHashes.constFind(function);
+    if (hash == functionHashes.constEnd()) {
+        return nullptr;
+    }
+    auto values = cache.constFind(hash.value());
+    return values == cache.constEnd() ? nullptr : &values.value();
+}
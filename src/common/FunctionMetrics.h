@@ -0,0 +1,127 @@
+#ifndef FUNCTIONMETRICS_H
+#define FUNCTIONMETRICS_H
+
+#include "core/Cutter.h"
+#include "common/AsyncTask.h"
+#include "common/BackgroundIndex.h"
+#include "common/MemoryAccounting.h"
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+#include <functional>
+
+/**
+ * @brief Raw counts gathered from the blocks and instructions of one function, from which
+ * all metrics are derived.
+ */
+struct FunctionMetricsInput {
+    int blocks = 0;
+    int edges = 0;
+    int backEdges = 0;
+    int instructions = 0;
+    int calls = 0;
+    int stringRefs = 0;
+    int arithmetic = 0;
+    int logic = 0;
+    int memory = 0;
+    int branches = 0;
+};
+
+struct FunctionMetricDefinition {
+    QString id;             ///< name used in filters, like "cc>10"
+    QString name;           ///< column title
+    QString description;
+    bool percent;
+    std::function<double(const FunctionMetricsInput &)> compute;
+};
+
+class FunctionMetricsTask : public AsyncTask
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param knownHashes content hashes the metrics are cached for already
+     */
+    FunctionMetricsTask(const QList<RVA> &functions, const QSet<quint64> &knownHashes);
+
+    QString getTitle() override     { return tr("Computing Function Metrics"); }
+
+    const QHash<RVA, quint64> &getHashes() const                    { return hashes; }
+    const QHash<quint64, QVector<float>> &getValues() const         { return values; }
+
+protected:
+    void runTask() override;
+
+private:
+    QList<RVA> functions;
+    QSet<quint64> knownHashes;
+    QHash<RVA, quint64> hashes;
+    QHash<quint64, QVector<float>> values;
+
+    /**
+     * @return false if there is no function at offset
+     */
+    bool analyzeFunction(RCore *core, RVA offset, quint64 *hash, FunctionMetricsInput *input);
+};
+
+/**
+ * @brief Per-function metrics for triage, like cyclomatic complexity, loops or the instruction
+ * mix, computed in the background.
+ *
+ * Metrics are cached by a hash of the function's address, blocks and bytes, so after a
+ * reanalysis only functions whose content changed are decoded again. Metrics like the string
+ * references depend on what is at the addresses the code refers to, so copies of a function
+ * at other addresses are computed separately. New metrics are added to definitions(), derived
+ * from FunctionMetricsInput.
+ *
+ * It must only be used from the GUI thread.
+ */
+class FunctionMetrics : public BackgroundIndex
+{
+    Q_OBJECT
+
+public:
+    static FunctionMetrics *instance();
+
+    static const QVector<FunctionMetricDefinition> &definitions();
+    /**
+     * @return index of the metric in definitions(), -1 if there is none with id
+     */
+    static int metricIndex(const QString &id);
+
+    /**
+     * @brief Compute the metrics of all given functions that are not known yet. Functions
+     * are hashed again, so changed content is picked up.
+     */
+    void update(const QList<FunctionDescription> &functions);
+
+    /**
+     * @return values of all metrics in the order of definitions(), nullptr if not computed yet
+     */
+    const QVector<float> *metrics(RVA function) const;
+
+    static QString formatValue(int metric, float value);
+
+signals:
+    void updated();
+
+protected:
+    AsyncTask::Ptr createBuildTask() override;
+    void buildFinished(AsyncTask *task) override;
+
+private:
+    FunctionMetrics();
+
+    QHash<RVA, quint64> functionHashes;
+    QHash<quint64, QVector<float>> cache;
+    QList<RVA> requested;   ///< functions of the last update() not given to a task yet
+    MemoryAccount account;
+
+    void invalidate();
+    void updateAccount();
+};
+
+#endif // FUNCTIONMETRICS_H
@@ -0,0 +1,867 @@
+#include "FunctionSimilarity.h"
+#include "common/JsonReader.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonObject>
+#include <QLockFile>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QThread>
+#include <QtEndian>
+
+#include <algorithm>
+#include <queue>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+constexpr int FunctionFingerprint::HashCount;
+constexpr int FunctionSimilarityIndex::BandCount;
+constexpr int FunctionSimilarityIndex::RowsPerBand;
+constexpr quint32 FunctionSimilarityIndex::MinInstructions;
+constexpr int FunctionSimilarityIndex::MaxSegments;
+
+static const char RECORDS_MAGIC[4] = { 'C', 'S', 'R', '2' };
+static const char BUCKETS_MAGIC[4] = { 'C', 'S', 'B', '3' };
+static const char BINARIES_MAGIC[] = "CSI1";
+// Magic and generation, files of different generations do not belong together
+static const int FILE_HEADER_SIZE = 8;
+static const int SEGMENT_HEADER_SIZE = 16;
+static const int BUCKET_ENTRY_SIZE = 16;
+static const int RECORD_FIXED_SIZE = 8 + 4 * 4 + FunctionFingerprint::HashCount * 4 + 2;
+// Upper bound of candidates taken from a single bucket, keeps degenerate buckets cheap
+static const int MAX_BUCKET_SCAN = 2048;
+// Queries keep what they have while another instance writes the index
+static const int LOCK_TIMEOUT_MS = 100;
+
+static quint64 mix64(quint64 x)
+{
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * qHash() is seeded per process, the index needs hashes that are stable across sessions.
+ */
+static quint64 stableHash(const QString &str)
+{
+    quint64 hash = 0xcbf29ce484222325ULL;
+    for (QChar c : str) {
+        hash ^= c.unicode();
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Reduce operands to their kind, "mov rax, qword [rbp - 8]" becomes "mov R,M".
+ */
+static QString normalizeInstruction(const QString &opcode)
+{
+    int space = opcode.indexOf(QLatin1Char(' '));
+    if (space < 0) {
+        return opcode;
+    }
+    QString result = opcode.left(space);
+    result += QLatin1Char(' ');
+    const QStringList operands = opcode.mid(space + 1).split(QLatin1Char(','), QString::SkipEmptyParts);
+    for (int i = 0; i < operands.size(); i++) {
+        QString operand = operands[i].trimmed();
+        if (operand.isEmpty()) {
+            continue;
+        }
+        if (i > 0) {
+            result += QLatin1Char(',');
+        }
+        QChar first = operand.at(0);
+        if (operand.contains(QLatin1Char('['))) {
+            result += QLatin1Char('M');
+        } else if (first.isDigit() || first == QLatin1Char('-') || first == QLatin1Char('#')) {
+            result += QLatin1Char('I');
+        } else {
+            result += QLatin1Char('R');
+        }
+    }
+    return result;
+}
+
+static double countSimilarity(quint32 a, quint32 b)
+{
+    if (a == b) {
+        return 1.0;
+    }
+    return static_cast<double>(qMin(a, b)) / qMax(a, b);
+}
+
+double FunctionFingerprint::similarity(const FunctionFingerprint &other) const
+{
+    int equal = 0;
+    for (int i = 0; i < HashCount; i++) {
+        if (minHash[i] == other.minHash[i]) {
+            equal++;
+        }
+    }
+    double jaccard = static_cast<double>(equal) / HashCount;
+    double shape = (countSimilarity(instructions, other.instructions)
+                    + countSimilarity(basicBlocks, other.basicBlocks)
+                    + countSimilarity(edges, other.edges)) / 3;
+    return 0.8 * jaccard + 0.2 * shape;
+}
+
+QVector<quint64> FunctionSimilarity::instructionHashes(RVA offset)
+{
+    QVector<quint64> hashes;
+    Core()->cmdjStream(QString("pdfj @ %1").arg(offset), [&hashes](JsonReader &reader) {
+        reader.readObject([&hashes](const JsonReader::Key &key, JsonReader &reader) {
+            if (key != "ops") {
+                return;
+            }
+            reader.readArray([&hashes](JsonReader &reader) {
+                QString opcode;
+                bool invalid = false;
+                reader.readObject([&](const JsonReader::Key &key, JsonReader &reader) {
+                    if (key == "opcode") {
+                        opcode = reader.readString();
+                    } else if (key == "type") {
+                        invalid = reader.readString() == QLatin1String("invalid");
+                    }
+                });
+                if (!invalid && !opcode.isEmpty()) {
+                    hashes << stableHash(normalizeInstruction(opcode));
+                }
+            });
+        });
+    });
+    return hashes;
+}
+
+void FunctionSimilarity::computeMinHash(FunctionFingerprint *fingerprint,
+                                        const QVector<quint64> &instructionHashes)
+{
+    fingerprint->instructions = static_cast<quint32>(instructionHashes.size());
+    fingerprint->minHash.fill(UINT32_MAX);
+
+    int shingleCount = qMax(1, instructionHashes.size() - 2);
+    for (int i = 0; i < shingleCount && i < instructionHashes.size(); i++) {
+        // Instruction trigram, shorter functions use whatever they have
+        quint64 shingle = mix64(instructionHashes[i]);
+        if (i + 1 < instructionHashes.size()) {
+            shingle = mix64(shingle ^ instructionHashes[i + 1]);
+        }
+        if (i + 2 < instructionHashes.size()) {
+            shingle = mix64(shingle ^ instructionHashes[i + 2]);
+        }
+        for (int h = 0; h < FunctionFingerprint::HashCount; h++) {
+            quint32 value = static_cast<quint32>(mix64(shingle + (h + 1) * 0x9e3779b97f4a7c15ULL));
+            if (value < fingerprint->minHash[h]) {
+                fingerprint->minHash[h] = value;
+            }
+        }
+    }
+}
+
+FunctionFingerprint FunctionSimilarity::fingerprint(const FunctionDescription &function)
+{
+    FunctionFingerprint fingerprint;
+    fingerprint.offset = function.offset;
+    fingerprint.name = function.name;
+    fingerprint.basicBlocks = static_cast<quint32>(function.nbbs);
+    fingerprint.edges = static_cast<quint32>(function.edges);
+    computeMinHash(&fingerprint, instructionHashes(function.offset));
+    return fingerprint;
+}
+
+bool FunctionSimilarity::isAutoName(const QString &name)
+{
+    return name.isEmpty() || name.startsWith(QLatin1String("fcn."))
+           || name.startsWith(QLatin1String("loc."));
+}
+
+static QMutex binaryIdMutex;
+static QString knownIdPath;
+static QString knownId;
+
+QString FunctionSimilarity::currentBinaryId()
+{
+    QString path = Core()->getConfig("file.path");
+    {
+        QMutexLocker locker(&binaryIdMutex);
+        if (path == knownIdPath && !knownId.isEmpty()) {
+            return knownId;
+        }
+    }
+    QString id = path;
+    QJsonObject hashes = Core()->cmdj("itj").object();
+    for (const char *hash : { "sha256", "sha1", "md5" }) {
+        QString value = hashes.value(QLatin1String(hash)).toString();
+        if (!value.isEmpty()) {
+            id = value;
+            break;
+        }
+    }
+    QMutexLocker locker(&binaryIdMutex);
+    knownIdPath = path;
+    knownId = id;
+    return id;
+}
+
+QString FunctionSimilarity::knownBinaryId()
+{
+    QString path = Core()->getConfig("file.path");
+    QMutexLocker locker(&binaryIdMutex);
+    return path == knownIdPath ? knownId : QString();
+}
+
+QByteArray FunctionSimilarity::functionsDigest(const QList<FunctionDescription> &functions)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (const FunctionDescription &function : functions) {
+        hash.addData(QString("%1 %2 %3 %4\n").arg(function.offset).arg(function.linearSize)
+                     .arg(function.nbbs).arg(function.name).toUtf8());
+    }
+    return hash.result().toHex();
+}
+
+FunctionSimilarityIndex::FunctionSimilarityIndex()
+{
+    directory = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)
+                + QStringLiteral("/similarity");
+    QDir().mkpath(directory);
+    recordsFile.setFileName(directory + QStringLiteral("/records.dat"));
+    bucketsFile.setFileName(directory + QStringLiteral("/buckets.dat"));
+    refresh();
+}
+
+FunctionSimilarityIndex *FunctionSimilarityIndex::instance()
+{
+    static FunctionSimilarityIndex index;
+    return &index;
+}
+
+QString FunctionSimilarityIndex::binariesPath() const
+{
+    return directory + QStringLiteral("/binaries.txt");
+}
+
+static void initLock(QLockFile *lock)
+{
+    // Compacting a large index takes longer than the default stale time, locks left by
+    // crashed instances are still detected by their process id
+    lock->setStaleLockTime(0);
+}
+
+void FunctionSimilarityIndex::refresh()
+{
+    // Other instances rewrite the header with every change
+    QByteArray header;
+    QFile binariesFile(binariesPath());
+    if (binariesFile.open(QIODevice::ReadOnly)) {
+        header = binariesFile.readLine();
+    }
+    if (header == loadedHeader) {
+        return;
+    }
+    QLockFile lock(directory + QStringLiteral("/index.lock"));
+    initLock(&lock);
+    // Keep the previous state while another instance is writing, the header tells again
+    if (lock.tryLock(LOCK_TIMEOUT_MS)) {
+        load();
+    }
+}
+
+void FunctionSimilarityIndex::load()
+{
+    unmapFiles();
+    binaries.clear();
+    binaryById.clear();
+    recordsEnd = 0;
+    bucketsEnd = 0;
+    loadedHeader.clear();
+
+    QFile binariesFile(binariesPath());
+    if (!binariesFile.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    loadedHeader = binariesFile.readLine();
+    // Magic, generation and the ends of the records and buckets the binaries were written with
+    QList<QByteArray> header = loadedHeader.trimmed().split('\t');
+    if (header.size() < 4 || header[0] != BINARIES_MAGIC) {
+        return;
+    }
+    generation = header[1].toUInt();
+    recordsEnd = header[2].toLongLong();
+    bucketsEnd = header[3].toLongLong();
+    while (!binariesFile.atEnd()) {
+        // id, digest, function count and name separated by tabs
+        QString line = QString::fromUtf8(binariesFile.readLine());
+        if (line.endsWith(QLatin1Char('\n'))) {
+            line.chop(1);
+        }
+        QStringList fields = line.split(QLatin1Char('\t'));
+        if (fields.size() < 4) {
+            continue;
+        }
+        Binary binary;
+        binary.id = fields[0];
+        binary.digest = fields[1].toLatin1();
+        binary.functions = fields[2].toUInt();
+        binary.name = fields.mid(3).join(QLatin1Char('\t'));
+        binaryById[binary.id] = binaries.size();
+        binaries.append(binary);
+    }
+
+    if (!mapFiles()) {
+        // Cut short while compacting, the next addBinary() starts over
+        unmapFiles();
+        binaries.clear();
+        binaryById.clear();
+        recordsEnd = 0;
+        bucketsEnd = 0;
+    }
+}
+
+bool FunctionSimilarityIndex::hasFileHeader(const uchar *data, const char *magic) const
+{
+    return memcmp(data, magic, 4) == 0 && qFromLittleEndian<quint32>(data + 4) == generation;
+}
+
+bool FunctionSimilarityIndex::mapFiles()
+{
+    if (recordsEnd < FILE_HEADER_SIZE || bucketsEnd < FILE_HEADER_SIZE) {
+        return false;
+    }
+    // Anything behind the ends listed in binaries.txt was not committed
+    if (!recordsFile.open(QIODevice::ReadOnly) || recordsFile.size() < recordsEnd
+            || !bucketsFile.open(QIODevice::ReadOnly) || bucketsFile.size() < bucketsEnd) {
+        return false;
+    }
+    records = recordsFile.map(0, recordsEnd);
+    buckets = bucketsFile.map(0, bucketsEnd);
+    if (!records || !buckets || !hasFileHeader(records, RECORDS_MAGIC)
+            || !hasFileHeader(buckets, BUCKETS_MAGIC)) {
+        return false;
+    }
+
+    quint64 size = static_cast<quint64>(bucketsEnd);
+    quint64 position = FILE_HEADER_SIZE;
+    while (position < size) {
+        if (position + SEGMENT_HEADER_SIZE > size) {
+            return false;
+        }
+        quint64 count = qFromLittleEndian<quint64>(buckets + position);
+        if (count > (size - position - SEGMENT_HEADER_SIZE) / BUCKET_ENTRY_SIZE) {
+            return false;
+        }
+        segments.push_back({ position + SEGMENT_HEADER_SIZE, count });
+        position += SEGMENT_HEADER_SIZE + count * BUCKET_ENTRY_SIZE;
+    }
+    return true;
+}
+
+void FunctionSimilarityIndex::unmapFiles()
+{
+    if (records) {
+        recordsFile.unmap(const_cast<uchar *>(records));
+        records = nullptr;
+    }
+    if (buckets) {
+        bucketsFile.unmap(const_cast<uchar *>(buckets));
+        buckets = nullptr;
+    }
+    recordsFile.close();
+    bucketsFile.close();
+    segments.clear();
+}
+
+FunctionSimilarityIndex::BucketEntry FunctionSimilarityIndex::bucketAt(const Segment &segment,
+                                                                       quint64 i) const
+{
+    const uchar *entry = buckets + segment.offset + i * BUCKET_ENTRY_SIZE;
+    return { qFromLittleEndian<quint64>(entry), qFromLittleEndian<quint64>(entry + 8) };
+}
+
+quint64 FunctionSimilarityIndex::bandKey(const FunctionFingerprint &fingerprint, int band)
+{
+    quint64 key = mix64(static_cast<quint64>(band) + 1);
+    for (int row = 0; row < RowsPerBand; row++) {
+        key = mix64(key ^ fingerprint.minHash[band * RowsPerBand + row]);
+    }
+    return key;
+}
+
+quint64 FunctionSimilarityIndex::recordSize(quint64 position) const
+{
+    if (position + RECORD_FIXED_SIZE > static_cast<quint64>(recordsEnd)) {
+        return 0;
+    }
+    quint16 nameLength = qFromLittleEndian<quint16>(records + position + RECORD_FIXED_SIZE - 2);
+    if (position + RECORD_FIXED_SIZE + nameLength > static_cast<quint64>(recordsEnd)) {
+        return 0;
+    }
+    return RECORD_FIXED_SIZE + nameLength;
+}
+
+bool FunctionSimilarityIndex::readRecord(quint64 position, FunctionFingerprint *fingerprint,
+                                         quint32 *binaryIndex) const
+{
+    quint64 size = recordSize(position);
+    if (size == 0) {
+        return false;
+    }
+    const uchar *p = records + position;
+    fingerprint->offset = qFromLittleEndian<quint64>(p);
+    fingerprint->instructions = qFromLittleEndian<quint32>(p + 8);
+    fingerprint->basicBlocks = qFromLittleEndian<quint32>(p + 12);
+    fingerprint->edges = qFromLittleEndian<quint32>(p + 16);
+    *binaryIndex = qFromLittleEndian<quint32>(p + 20);
+    p += 24;
+    for (int i = 0; i < FunctionFingerprint::HashCount; i++, p += 4) {
+        fingerprint->minHash[i] = qFromLittleEndian<quint32>(p);
+    }
+    fingerprint->name = QString::fromUtf8(reinterpret_cast<const char *>(p + 2),
+                                          static_cast<int>(size - RECORD_FIXED_SIZE));
+    return true;
+}
+
+bool FunctionSimilarityIndex::isIndexed(const QString &binaryId, const QByteArray &digest)
+{
+    QMutexLocker locker(&mutex);
+    refresh();
+    int index = binaryById.value(binaryId, -1);
+    return index >= 0 && binaries[index].digest == digest;
+}
+
+quint64 FunctionSimilarityIndex::functionCount()
+{
+    QMutexLocker locker(&mutex);
+    refresh();
+    quint64 count = 0;
+    for (const Binary &binary : binaries) {
+        count += binary.functions;
+    }
+    return count;
+}
+
+void FunctionSimilarityIndex::writeFileHeader(QByteArray *out, const char *magic,
+                                              quint32 fileGeneration)
+{
+    uchar header[FILE_HEADER_SIZE];
+    memcpy(header, magic, 4);
+    qToLittleEndian<quint32>(fileGeneration, header + 4);
+    out->append(reinterpret_cast<const char *>(header), sizeof(header));
+}
+
+void FunctionSimilarityIndex::writeEntry(QByteArray *out, const BucketEntry &entry)
+{
+    uchar buf[BUCKET_ENTRY_SIZE];
+    qToLittleEndian<quint64>(entry.key, buf);
+    qToLittleEndian<quint64>(entry.record, buf + 8);
+    out->append(reinterpret_cast<const char *>(buf), sizeof(buf));
+}
+
+bool FunctionSimilarityIndex::writeBinaries(const QVector<Binary> &list, quint32 fileGeneration,
+                                            qint64 newRecordsEnd, qint64 newBucketsEnd)
+{
+    QSaveFile out(binariesPath());
+    if (!out.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QByteArray data = QString("%1\t%2\t%3\t%4\n").arg(QString::fromLatin1(BINARIES_MAGIC))
+                      .arg(fileGeneration).arg(newRecordsEnd).arg(newBucketsEnd).toUtf8();
+    for (const Binary &binary : list) {
+        data += QString("%1\t%2\t%3\t%4\n").arg(binary.id, QString::fromLatin1(binary.digest))
+                .arg(binary.functions).arg(binary.name).toUtf8();
+    }
+    return out.write(data) == data.size() && out.commit();
+}
+
+bool FunctionSimilarityIndex::appendSegment(const std::vector<BucketEntry> &entries,
+                                            qint64 *newBucketsEnd)
+{
+    QFile out(bucketsFile.fileName());
+    if (!out.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+    QByteArray chunk;
+    if (bucketsEnd < FILE_HEADER_SIZE) {
+        out.resize(0);
+        writeFileHeader(&chunk, BUCKETS_MAGIC, generation);
+    } else {
+        // Drop whatever a crash left behind the last committed segment
+        out.resize(bucketsEnd);
+        out.seek(bucketsEnd);
+    }
+
+    uchar header[SEGMENT_HEADER_SIZE] = {};
+    qToLittleEndian<quint64>(entries.size(), header);
+    chunk.append(reinterpret_cast<const char *>(header), sizeof(header));
+    for (const BucketEntry &entry : entries) {
+        writeEntry(&chunk, entry);
+        if (chunk.size() >= 1024 * 1024) {
+            if (out.write(chunk) != chunk.size()) {
+                return false;
+            }
+            chunk.clear();
+        }
+    }
+    if (out.write(chunk) != chunk.size() || !out.flush()) {
+        return false;
+    }
+    *newBucketsEnd = out.pos();
+    return true;
+}
+
+bool FunctionSimilarityIndex::compact(const QString &droppedBinaryId)
+{
+    quint32 newGeneration = generation + 1;
+    QVector<Binary> kept;
+    QVector<int> newIndex(binaries.size(), -1);
+    for (int i = 0; i < binaries.size(); i++) {
+        if (binaries[i].id != droppedBinaryId) {
+            newIndex[i] = kept.size();
+            kept.append(binaries[i]);
+        }
+    }
+
+    // Records of the kept binaries in their order, renumbered to their new index
+    QSaveFile recordsOut(recordsFile.fileName());
+    if (!recordsOut.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QHash<quint64, quint64> movedRecords;
+    QByteArray chunk;
+    writeFileHeader(&chunk, RECORDS_MAGIC, newGeneration);
+    qint64 newRecordsEnd = FILE_HEADER_SIZE;
+    quint64 position = FILE_HEADER_SIZE;
+    for (quint64 size; (size = recordSize(position)) > 0; position += size) {
+        quint32 binaryIndex = qFromLittleEndian<quint32>(records + position + 20);
+        if (binaryIndex >= static_cast<quint32>(newIndex.size()) || newIndex[binaryIndex] < 0) {
+            continue;
+        }
+        movedRecords.insert(position, static_cast<quint64>(newRecordsEnd));
+        int start = chunk.size();
+        chunk.append(reinterpret_cast<const char *>(records + position), static_cast<int>(size));
+        qToLittleEndian<quint32>(static_cast<quint32>(newIndex[binaryIndex]),
+                                 reinterpret_cast<uchar *>(chunk.data()) + start + 20);
+        newRecordsEnd += size;
+        if (chunk.size() >= 1024 * 1024) {
+            recordsOut.write(chunk);
+            chunk.clear();
+        }
+    }
+    recordsOut.write(chunk);
+
+    // k-way merge of the sorted segments into one, dropping the entries of dropped records
+    struct Cursor {
+        BucketEntry entry;
+        size_t segment;
+        quint64 next;
+    };
+    auto later = [](const Cursor &a, const Cursor &b) {
+        return a.entry.key > b.entry.key;
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(later)> cursors(later);
+    for (size_t i = 0; i < segments.size(); i++) {
+        if (segments[i].count > 0) {
+            cursors.push({ bucketAt(segments[i], 0), i, 1 });
+        }
+    }
+
+    QSaveFile bucketsOut(bucketsFile.fileName());
+    if (!bucketsOut.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    chunk.clear();
+    writeFileHeader(&chunk, BUCKETS_MAGIC, newGeneration);
+    uchar header[SEGMENT_HEADER_SIZE] = {};
+    chunk.append(reinterpret_cast<const char *>(header), sizeof(header));
+    quint64 total = 0;
+    while (!cursors.empty()) {
+        Cursor cursor = cursors.top();
+        cursors.pop();
+        auto moved = movedRecords.constFind(cursor.entry.record);
+        if (moved != movedRecords.constEnd()) {
+            writeEntry(&chunk, { cursor.entry.key, moved.value() });
+            total++;
+        }
+        const Segment &segment = segments[cursor.segment];
+        if (cursor.next < segment.count) {
+            cursors.push({ bucketAt(segment, cursor.next), cursor.segment, cursor.next + 1 });
+        }
+        if (chunk.size() >= 1024 * 1024) {
+            bucketsOut.write(chunk);
+            chunk.clear();
+        }
+    }
+    bucketsOut.write(chunk);
+    qint64 newBucketsEnd = bucketsOut.pos();
+    uchar count[8];
+    qToLittleEndian<quint64>(total, count);
+    bucketsOut.seek(FILE_HEADER_SIZE);
+    bucketsOut.write(reinterpret_cast<const char *>(count), sizeof(count));
+
+    // The old files must not be mapped while they are replaced. binaries.txt is replaced
+    // last, files of a newer generation left by a crash before are ignored by load().
+    unmapFiles();
+    return recordsOut.commit() && bucketsOut.commit()
+           && writeBinaries(kept, newGeneration, newRecordsEnd, newBucketsEnd);
+}
+
+bool FunctionSimilarityIndex::append(const QString &binaryId, const QByteArray &digest,
+                                     const QString &binaryName,
+                                     const QVector<FunctionFingerprint> &fingerprints)
+{
+    quint32 binaryIndex = static_cast<quint32>(binaries.size());
+
+    // Both files only grow here and are not kept mapped while they do
+    unmapFiles();
+    QFile out(recordsFile.fileName());
+    if (!out.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+    if (recordsEnd < FILE_HEADER_SIZE) {
+        QByteArray header;
+        writeFileHeader(&header, RECORDS_MAGIC, generation);
+        out.resize(0);
+        out.write(header);
+    } else {
+        // Drop whatever a crash left behind the last committed records
+        out.resize(recordsEnd);
+        out.seek(recordsEnd);
+    }
+
+    std::vector<BucketEntry> newEntries;
+    newEntries.reserve(static_cast<size_t>(fingerprints.size()) * BandCount);
+    QByteArray record;
+    quint32 functions = 0;
+    for (const FunctionFingerprint &fingerprint : fingerprints) {
+        if (fingerprint.instructions < MinInstructions) {
+            continue;
+        }
+        quint64 position = static_cast<quint64>(out.pos());
+        QByteArray name = fingerprint.name.toUtf8().left(UINT16_MAX);
+        record.resize(RECORD_FIXED_SIZE + name.size());
+        uchar *p = reinterpret_cast<uchar *>(record.data());
+        qToLittleEndian<quint64>(fingerprint.offset, p);
+        qToLittleEndian<quint32>(fingerprint.instructions, p + 8);
+        qToLittleEndian<quint32>(fingerprint.basicBlocks, p + 12);
+        qToLittleEndian<quint32>(fingerprint.edges, p + 16);
+        qToLittleEndian<quint32>(binaryIndex, p + 20);
+        p += 24;
+        for (int i = 0; i < FunctionFingerprint::HashCount; i++, p += 4) {
+            qToLittleEndian<quint32>(fingerprint.minHash[i], p);
+        }
+        qToLittleEndian<quint16>(static_cast<quint16>(name.size()), p);
+        memcpy(p + 2, name.constData(), static_cast<size_t>(name.size()));
+        if (out.write(record) != record.size()) {
+            return false;
+        }
+        for (int band = 0; band < BandCount; band++) {
+            newEntries.push_back({ bandKey(fingerprint, band), position });
+        }
+        functions++;
+    }
+    if (!out.flush()) {
+        return false;
+    }
+    qint64 newRecordsEnd = out.pos();
+    out.close();
+
+    std::sort(newEntries.begin(), newEntries.end(), [](const BucketEntry &a, const BucketEntry &b) {
+        return a.key < b.key;
+    });
+    qint64 newBucketsEnd;
+    if (!appendSegment(newEntries, &newBucketsEnd)) {
+        return false;
+    }
+
+    // The records and buckets only count once binaries.txt lists them
+    QVector<Binary> list = binaries;
+    Binary binary { binaryId, digest, functions, binaryName };
+    binary.name.replace(QLatin1Char('\n'), QLatin1Char(' '));
+    list.append(binary);
+    return writeBinaries(list, generation, newRecordsEnd, newBucketsEnd);
+}
+
+bool FunctionSimilarityIndex::addBinary(const QString &binaryId, const QByteArray &digest,
+                                        const QString &binaryName,
+                                        const QVector<FunctionFingerprint> &fingerprints)
+{
+    QMutexLocker locker(&mutex);
+    QLockFile lock(directory + QStringLiteral("/index.lock"));
+    initLock(&lock);
+    if (!lock.lock()) {
+        return false;
+    }
+    // Other instances may have changed the files since they were loaded
+    load();
+    bool written = true;
+    if (binaryById.contains(binaryId) || segments.size() >= static_cast<size_t>(MaxSegments)) {
+        // Replaces the records of the binary instead of piling up copies
+        written = compact(binaryId);
+        load();
+    }
+    written = written && append(binaryId, digest, binaryName, fingerprints);
+    load();
+    return written;
+}
+
+QList<SimilarFunctionMatch> FunctionSimilarityIndex::query(const FunctionFingerprint &fingerprint,
+                                                           int maxResults, double minSimilarity,
+                                                           const QString &excludeBinaryId)
+{
+    QList<SimilarFunctionMatch> matches;
+    if (fingerprint.instructions < MinInstructions) {
+        return matches;
+    }
+
+    QMutexLocker locker(&mutex);
+    refresh();
+    if (!buckets || !records) {
+        return matches;
+    }
+    int excludeIndex = excludeBinaryId.isEmpty() ? -1 : binaryById.value(excludeBinaryId, -1);
+
+    QSet<quint64> candidates;
+    for (const Segment &segment : segments) {
+        for (int band = 0; band < BandCount; band++) {
+            quint64 key = bandKey(fingerprint, band);
+            quint64 lo = 0;
+            quint64 hi = segment.count;
+            while (lo < hi) {
+                quint64 mid = lo + (hi - lo) / 2;
+                if (bucketAt(segment, mid).key < key) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            for (int scanned = 0; lo < segment.count && scanned < MAX_BUCKET_SCAN; lo++, scanned++) {
+                BucketEntry entry = bucketAt(segment, lo);
+                if (entry.key != key) {
+                    break;
+                }
+                candidates.insert(entry.record);
+            }
+        }
+    }
+
+    FunctionFingerprint candidate;
+    for (quint64 position : candidates) {
+        quint32 binaryIndex;
+        if (!readRecord(position, &candidate, &binaryIndex)
+                || binaryIndex >= static_cast<quint32>(binaries.size())
+                || static_cast<int>(binaryIndex) == excludeIndex) {
+            continue;
+        }
+        double similarity = fingerprint.similarity(candidate);
+        if (similarity < minSimilarity) {
+            continue;
+        }
+        matches.append({ candidate.name, binaries[static_cast<int>(binaryIndex)].name,
+                         candidate.offset, similarity });
+    }
+
+    std::sort(matches.begin(), matches.end(), [](const SimilarFunctionMatch &a, const SimilarFunctionMatch &b) {
+        return a.similarity > b.similarity;
+    });
+    if (matches.size() > maxResults) {
+        matches.erase(matches.begin() + maxResults, matches.end());
+    }
+    return matches;
+}
+
+void SimilarityIndexTask::runTask()
+{
+    FunctionSimilarityIndex *index = FunctionSimilarityIndex::instance();
+    QString binaryId = FunctionSimilarity::currentBinaryId();
+    if (binaryId.isEmpty()) {
+        return;
+    }
+    QList<FunctionDescription> functions = Core()->getAllFunctions();
+    QByteArray digest = FunctionSimilarity::functionsDigest(functions);
+    if (index->isIndexed(binaryId, digest)) {
+        log(tr("Functions of this binary are already indexed."));
+        return;
+    }
+
+    int count = functions.size();
+    QVector<FunctionFingerprint> fingerprints(count);
+    QVector<QVector<quint64>> hashes(count);
+
+    // Disassembling needs the core, so this part is sequential. The core is locked per
+    // function only, which keeps the GUI responsive.
+    log(tr("Disassembling %1 functions...").arg(count));
+    for (int i = 0; i < count; i++) {
+        if (isInterrupted()) {
+            return;
+        }
+        const FunctionDescription &function = functions[i];
+        fingerprints[i].offset = function.offset;
+        // Still useful to find the function by its code, the name follows once it is renamed
+        if (!FunctionSimilarity::isAutoName(function.name)) {
+            fingerprints[i].name = function.name;
+        }
+        fingerprints[i].basicBlocks = static_cast<quint32>(function.nbbs);
+        fingerprints[i].edges = static_cast<quint32>(function.edges);
+        hashes[i] = FunctionSimilarity::instructionHashes(function.offset);
+        setProgress(i, count);
+    }
+
+    log(tr("Computing fingerprints..."));
+    FunctionFingerprint *fingerprintData = fingerprints.data();
+    const QVector<quint64> *hashData = hashes.constData();
+    int threadCount = qMax(1, QThread::idealThreadCount());
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([fingerprintData, hashData, count, threadCount, t]() {
+            for (int i = t; i < count; i += threadCount) {
+                FunctionSimilarity::computeMinHash(&fingerprintData[i], hashData[i]);
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    log(tr("Writing index..."));
+    QString binaryName = QFileInfo(Core()->getConfig("file.path")).fileName();
+    if (!index->addBinary(binaryId, digest, binaryName, fingerprints)) {
+        log(tr("Failed to write the similarity index in %1").arg(index->getDirectory()));
+        return;
+    }
+    log(tr("%1 functions indexed.").arg(count));
+}
+
+SimilarFunctionsTask::SimilarFunctionsTask(const QList<FunctionDescription> &functions,
+                                           int maxResults, double minSimilarity)
+    : functions(functions), maxResults(maxResults), minSimilarity(minSimilarity)
+{
+}
+
+void SimilarFunctionsTask::runTask()
+{
+    FunctionSimilarityIndex *index = FunctionSimilarityIndex::instance();
+    // Known once the binary was indexed, computing it here would hash the whole file
+    QString binaryId = FunctionSimilarity::knownBinaryId();
+    for (int i = 0; i < functions.size(); i++) {
+        if (isInterrupted()) {
+            return;
+        }
+        FunctionFingerprint fingerprint = FunctionSimilarity::fingerprint(functions[i]);
+        results.append({ functions[i], index->query(fingerprint, maxResults, minSimilarity,
+                                                    binaryId) });
+        setProgress(i, functions.size());
+    }
+    indexedFunctionCount = index->functionCount();
+}
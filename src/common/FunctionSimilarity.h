@@ -0,0 +1,236 @@
+#ifndef FUNCTIONSIMILARITY_H
+#define FUNCTIONSIMILARITY_H
+
+#include "core/Cutter.h"
+#include "common/AsyncTask.h"
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+
+#include <array>
+#include <vector>
+
+/**
+ * @brief Compact description of a function used for similarity search.
+ *
+ * minHash is a MinHash signature over trigrams of normalized instructions, where operands
+ * are reduced to their kind (register, immediate, memory) so that register allocation and
+ * addresses do not matter. The CFG shape counts are compared separately.
+ */
+struct FunctionFingerprint {
+    static constexpr int HashCount = 64;
+
+    RVA offset = RVA_INVALID;
+    QString name;       ///< empty for functions with an auto generated name
+    quint32 instructions = 0;
+    quint32 basicBlocks = 0;
+    quint32 edges = 0;
+    std::array<quint32, HashCount> minHash;
+
+    bool isValid() const    { return instructions > 0; }
+
+    /**
+     * @return estimated similarity between 0 and 1
+     */
+    double similarity(const FunctionFingerprint &other) const;
+};
+
+struct SimilarFunctionMatch {
+    QString name;
+    QString binary;
+    RVA offset;
+    double similarity;
+};
+
+namespace FunctionSimilarity {
+
+/**
+ * @brief Compute the fingerprint of an analyzed function.
+ * Locks the core for the duration of the disassembly only.
+ */
+FunctionFingerprint fingerprint(const FunctionDescription &function);
+
+/**
+ * @brief Split fingerprint() so that only the disassembly needs the core.
+ */
+QVector<quint64> instructionHashes(RVA offset);
+void computeMinHash(FunctionFingerprint *fingerprint, const QVector<quint64> &instructionHashes);
+
+/**
+ * @return whether name was generated by the analysis like fcn.00401000 and tells nothing
+ */
+bool isAutoName(const QString &name);
+
+/**
+ * @return identifier of the currently opened binary, stable across sessions.
+ * It hashes the whole file, so it should not be called from the GUI thread.
+ */
+QString currentBinaryId();
+/**
+ * @return currentBinaryId() if it was already computed for the opened file, otherwise an
+ * empty string
+ */
+QString knownBinaryId();
+
+/**
+ * @return hash of the offsets, sizes and names of functions, changes whenever the binary
+ * has to be indexed again
+ */
+QByteArray functionsDigest(const QList<FunctionDescription> &functions);
+
+}
+
+/**
+ * @brief On-disk locality sensitive hashing index of function fingerprints shared by all projects.
+ *
+ * Fingerprints are appended to a record file and each of their BandCount bands of
+ * RowsPerBand MinHash values is hashed into a bucket file. Every addBinary() appends one
+ * sorted segment of buckets. Both files are memory mapped, so a query costs BandCount binary
+ * searches per segment plus scoring of the candidates that share at least one band,
+ * independent of the total number of indexed functions.
+ *
+ * binaries.txt lists the indexed binaries together with the ends of both files, it is
+ * replaced last by every change, so that whatever a crash leaves behind those ends is
+ * ignored. Binaries are identified by the hash of their file. Adding a binary again, e.g.
+ * after its functions were renamed, compacts the files without its old records first, as
+ * does having more than MaxSegments segments.
+ *
+ * The directory is shared by all Cutter instances, changes are made under a lock file and
+ * the other instances load them with their next call. All methods are thread safe.
+ */
+class FunctionSimilarityIndex
+{
+public:
+    static constexpr int BandCount = 16;
+    static constexpr int RowsPerBand = FunctionFingerprint::HashCount / BandCount;
+    /**
+     * Tiny functions such as thunks look alike everywhere and would only flood the buckets.
+     */
+    static constexpr quint32 MinInstructions = 8;
+    static constexpr int MaxSegments = 16;
+
+    static FunctionSimilarityIndex *instance();
+
+    /**
+     * @return whether the binary was added with functions of the given functionsDigest()
+     */
+    bool isIndexed(const QString &binaryId, const QByteArray &digest);
+    bool addBinary(const QString &binaryId, const QByteArray &digest, const QString &binaryName,
+                   const QVector<FunctionFingerprint> &fingerprints);
+    QList<SimilarFunctionMatch> query(const FunctionFingerprint &fingerprint, int maxResults,
+                                      double minSimilarity, const QString &excludeBinaryId = QString());
+
+    quint64 functionCount();
+    QString getDirectory() const    { return directory; }
+
+private:
+    FunctionSimilarityIndex();
+
+    struct BucketEntry {
+        quint64 key;
+        quint64 record;
+    };
+
+    struct Segment {
+        quint64 offset;     ///< of the first entry in the bucket file
+        quint64 count;
+    };
+
+    /**
+     * @brief One line of binaries.txt, records refer to binaries by their line
+     */
+    struct Binary {
+        QString id;
+        QByteArray digest;
+        quint32 functions;
+        QString name;
+    };
+
+    QMutex mutex;
+    QString directory;
+    QByteArray loadedHeader;    ///< first line of binaries.txt when it was loaded
+    quint32 generation = 0;     ///< bumped by every compaction
+    QVector<Binary> binaries;
+    QHash<QString, int> binaryById;
+    QFile recordsFile;
+    QFile bucketsFile;
+    const uchar *records = nullptr;
+    qint64 recordsEnd = 0;
+    const uchar *buckets = nullptr;
+    qint64 bucketsEnd = 0;
+    std::vector<Segment> segments;
+
+    QString binariesPath() const;
+    void refresh();
+    void load();
+    bool mapFiles();
+    void unmapFiles();
+    bool hasFileHeader(const uchar *data, const char *magic) const;
+    quint64 recordSize(quint64 position) const;
+    bool readRecord(quint64 position, FunctionFingerprint *fingerprint, quint32 *binaryIndex) const;
+    BucketEntry bucketAt(const Segment &segment, quint64 i) const;
+    bool append(const QString &binaryId, const QByteArray &digest, const QString &binaryName,
+                const QVector<FunctionFingerprint> &fingerprints);
+    bool appendSegment(const std::vector<BucketEntry> &entries, qint64 *newBucketsEnd);
+    bool compact(const QString &droppedBinaryId);
+    bool writeBinaries(const QVector<Binary> &list, quint32 fileGeneration, qint64 newRecordsEnd,
+                       qint64 newBucketsEnd);
+    static void writeFileHeader(QByteArray *out, const char *magic, quint32 fileGeneration);
+    static void writeEntry(QByteArray *out, const BucketEntry &entry);
+    static quint64 bandKey(const FunctionFingerprint &fingerprint, int band);
+};
+
+/**
+ * @brief Fingerprint all functions of the current binary and add them to FunctionSimilarityIndex.
+ */
+class SimilarityIndexTask : public AsyncTask
+{
+    Q_OBJECT
+
+public:
+    QString getTitle() override     { return tr("Indexing Functions for Similarity Search"); }
+
+protected:
+    void runTask() override;
+};
+
+/**
+ * @brief Look up functions similar to the given ones in FunctionSimilarityIndex, their
+ * fingerprints need the disassembly.
+ */
+class SimilarFunctionsTask : public AsyncTask
+{
+    Q_OBJECT
+
+public:
+    struct Result {
+        FunctionDescription function;
+        QList<SimilarFunctionMatch> matches;
+    };
+
+    SimilarFunctionsTask(const QList<FunctionDescription> &functions, int maxResults,
+                         double minSimilarity);
+
+    QString getTitle() override     { return tr("Searching for Similar Functions"); }
+
+    /**
+     * @return matches of every function searched for, valid once finished
+     */
+    const QList<Result> &getResults() const     { return results; }
+    quint64 getIndexedFunctionCount() const     { return indexedFunctionCount; }
+
+protected:
+    void runTask() override;
+
+private:
+    QList<FunctionDescription> functions;
+    int maxResults;
+    double minSimilarity;
+    QList<Result> results;
+    quint64 indexedFunctionCount = 0;
+};
+
+#endif // FUNCTIONSIMILARITY_H
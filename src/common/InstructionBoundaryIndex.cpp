@@ -0,0 +1,349 @@
+#include "InstructionBoundaryIndex.h"
+#include "common/JsonReader.h"
+
+#include <QMutexLocker>
+#include <QTimer>
+
+#include <algorithm>
+
+constexpr int InstructionBoundaryIndex::RegionBits;
+constexpr RVA InstructionBoundaryIndex::RegionSize;
+
+namespace {
+
+/**
+ * Regions built around a missing one, so that scrolling on does not miss again right away.
+ */
+const RVA PREFETCH_BEFORE = 1;
+const RVA PREFETCH_AFTER = 3;
+/**
+ * Regions a single walk step may cross, e.g. a large data block without any line start.
+ */
+const int MAX_EMPTY_REGIONS = 16;
+
+template<size_t N>
+int nextSetBit(const std::array<quint64, N> &bits, int from)
+{
+    const int size = static_cast<int>(N * 64);
+    for (int i = from; i < size;) {
+        quint64 word = bits[static_cast<size_t>(i / 64)] >> (i % 64);
+        if (word) {
+            while (!(word & 1)) {
+                word >>= 1;
+                i++;
+            }
+            return i;
+        }
+        i = (i / 64 + 1) * 64;
+    }
+    return -1;
+}
+
+template<size_t N>
+int previousSetBit(const std::array<quint64, N> &bits, int from)
+{
+    for (int i = from; i >= 0;) {
+        quint64 word = bits[static_cast<size_t>(i / 64)] << (63 - i % 64);
+        if (word) {
+            while (!(word & (quint64(1) << 63))) {
+                word <<= 1;
+                i--;
+            }
+            return i;
+        }
+        i = (i / 64) * 64 - 1;
+    }
+    return -1;
+}
+
+}
+
+InstructionBoundaryIndex *InstructionBoundaryIndex::instance()
+{
+    static InstructionBoundaryIndex *index = new InstructionBoundaryIndex();
+    return index;
+}
+
+InstructionBoundaryIndex::InstructionBoundaryIndex()
+    : account(QStringLiteral("Instruction boundaries"), [this](size_t) {
+          clear();
+      })
+{
+    connect(Core(), &CutterCore::instructionChanged, this, &InstructionBoundaryIndex::invalidate);
+    connect(Core(), &CutterCore::refreshAll, this, &InstructionBoundaryIndex::clear);
+    connect(Core(), &CutterCore::codeRebased, this, &InstructionBoundaryIndex::clear);
+    connect(Core(), &CutterCore::asmOptionsChanged, this, &InstructionBoundaryIndex::clear);
+    connect(Core(), &CutterCore::ioModeChanged, this, &InstructionBoundaryIndex::clear);
+    connect(Core(), &CutterCore::ioCacheChanged, this, &InstructionBoundaryIndex::clear);
+}
+
+bool InstructionBoundaryIndex::isUsable() const
+{
+    return !Core()->currentlyDebugging;
+}
+
+bool InstructionBoundaryIndex::next(RVA start, int count, RVA *result)
+{
+    if (!isUsable()) {
+        return false;
+    }
+    QMutexLocker locker(&mutex);
+    const Region *region = regionLocked(start >> RegionBits);
+    if (!region) {
+        return false;
+    }
+    int bit = static_cast<int>(start & (RegionSize - 1));
+    if (!(region->bits[static_cast<size_t>(bit / 64)] & (quint64(1) << (bit % 64)))) {
+        // Not a line start in the index, the caller disassembles in a different phase
+        return false;
+    }
+    RVA address = start;
+    for (int i = 0; i < count; i++) {
+        address = nextBoundaryLocked(address);
+        if (address == RVA_INVALID) {
+            return false;
+        }
+    }
+    *result = address;
+    return true;
+}
+
+bool InstructionBoundaryIndex::previous(RVA start, int count, RVA *result)
+{
+    if (!isUsable()) {
+        return false;
+    }
+    QMutexLocker locker(&mutex);
+    const Region *region = regionLocked(start >> RegionBits);
+    if (!region) {
+        return false;
+    }
+    int bit = static_cast<int>(start & (RegionSize - 1));
+    if (!(region->bits[static_cast<size_t>(bit / 64)] & (quint64(1) << (bit % 64)))) {
+        return false;
+    }
+    RVA address = start;
+    for (int i = 0; i < count; i++) {
+        address = previousBoundaryLocked(address);
+        if (address == RVA_INVALID) {
+            return false;
+        }
+    }
+    *result = address;
+    return true;
+}
+
+RVA InstructionBoundaryIndex::nextBoundaryLocked(RVA address)
+{
+    RVA index = address >> RegionBits;
+    const Region *region = regionLocked(index);
+    if (!region) {
+        return RVA_INVALID;
+    }
+    int bit = nextSetBit(region->bits, static_cast<int>(address & (RegionSize - 1)) + 1);
+    if (bit >= 0) {
+        return (index << RegionBits) + static_cast<RVA>(bit);
+    }
+    RVA exit = region->exit;
+    for (int i = 0; i < MAX_EMPTY_REGIONS && index < (RVA_MAX >> RegionBits); i++) {
+        index++;
+        const Region *following = regionLocked(index);
+        if (!following) {
+            return RVA_INVALID;
+        }
+        if (following->entry != exit) {
+            // Built before the previous region, it does not continue the same sweep
+            regions.remove(index);
+            scheduleLocked(index);
+            return RVA_INVALID;
+        }
+        bit = nextSetBit(following->bits, 0);
+        if (bit >= 0) {
+            return (index << RegionBits) + static_cast<RVA>(bit);
+        }
+        exit = following->exit;
+    }
+    return RVA_INVALID;
+}
+
+RVA InstructionBoundaryIndex::previousBoundaryLocked(RVA address)
+{
+    RVA index = address >> RegionBits;
+    const Region *region = regionLocked(index);
+    if (!region) {
+        return RVA_INVALID;
+    }
+    int bit = previousSetBit(region->bits, static_cast<int>(address & (RegionSize - 1)) - 1);
+    if (bit >= 0) {
+        return (index << RegionBits) + static_cast<RVA>(bit);
+    }
+    RVA entry = region->entry;
+    for (int i = 0; i < MAX_EMPTY_REGIONS && index > 0; i++) {
+        index--;
+        const Region *preceding = regionLocked(index);
+        if (!preceding) {
+            return RVA_INVALID;
+        }
+        if (preceding->exit != entry) {
+            regions.remove(index + 1);
+            scheduleLocked(index + 1);
+            return RVA_INVALID;
+        }
+        bit = previousSetBit(preceding->bits, static_cast<int>(RegionSize) - 1);
+        if (bit >= 0) {
+            return (index << RegionBits) + static_cast<RVA>(bit);
+        }
+        entry = preceding->entry;
+    }
+    return RVA_INVALID;
+}
+
+const InstructionBoundaryIndex::Region *InstructionBoundaryIndex::regionLocked(RVA index)
+{
+    auto it = regions.constFind(index);
+    if (it != regions.constEnd()) {
+        return &it.value();
+    }
+    RVA first = index > PREFETCH_BEFORE ? index - PREFETCH_BEFORE : 0;
+    for (RVA i = first; i <= index + PREFETCH_AFTER; i++) {
+        if (!regions.contains(i)) {
+            scheduleLocked(i);
+        }
+    }
+    return nullptr;
+}
+
+void InstructionBoundaryIndex::scheduleLocked(RVA index)
+{
+    if (pendingSet.contains(index)) {
+        return;
+    }
+    pendingSet.insert(index);
+    pending.append(index);
+    if (!task) {
+        QTimer::singleShot(0, this, &InstructionBoundaryIndex::startTask);
+    }
+}
+
+void InstructionBoundaryIndex::startTask()
+{
+    QList<RVA> regionIndices;
+    {
+        QMutexLocker locker(&mutex);
+        if (task || pending.isEmpty()) {
+            return;
+        }
+        regionIndices = pending;
+        pending.clear();
+        pendingSet.clear();
+        // Ascending order lets every region continue the sweep of the one before
+        std::sort(regionIndices.begin(), regionIndices.end());
+        task = QSharedPointer<InstructionBoundaryTask>(new InstructionBoundaryTask(regionIndices));
+    }
+    connect(task.data(), &AsyncTask::finished, this, &InstructionBoundaryIndex::onTaskFinished);
+    Core()->getAsyncTaskManager()->start(task);
+}
+
+void InstructionBoundaryIndex::onTaskFinished()
+{
+    size_t regionCount;
+    {
+        QMutexLocker locker(&mutex);
+        task.clear();
+        regionCount = static_cast<size_t>(regions.size());
+    }
+    account.update(regionCount * (sizeof(Region) + sizeof(RVA)), regionCount);
+    startTask();
+}
+
+void InstructionBoundaryIndex::invalidate(RVA offset)
+{
+    QMutexLocker locker(&mutex);
+    generation++;
+    RVA index = offset >> RegionBits;
+    regions.remove(index);
+    // The changed line may reach into the following region and shift its sweep
+    regions.remove(index + 1);
+    if (index > 0) {
+        regions.remove(index - 1);
+    }
+}
+
+void InstructionBoundaryIndex::clear()
+{
+    {
+        QMutexLocker locker(&mutex);
+        generation++;
+        regions.clear();
+        pending.clear();
+        pendingSet.clear();
+        if (task) {
+            task->interrupt();
+        }
+    }
+    account.clear();
+}
+
+void InstructionBoundaryIndex::buildRegion(RVA index)
+{
+    const RVA start = index << RegionBits;
+    const RVA last = start + (RegionSize - 1);
+    quint64 buildGeneration;
+    Region region;
+    region.bits.fill(0);
+    region.entry = start;
+    {
+        QMutexLocker locker(&mutex);
+        if (regions.contains(index)) {
+            return;
+        }
+        buildGeneration = generation;
+        if (index > 0) {
+            auto it = regions.constFind(index - 1);
+            if (it != regions.constEnd() && it.value().exit >= start) {
+                region.entry = it.value().exit;
+            }
+        }
+    }
+    region.exit = region.entry;
+
+    if (region.entry <= last) {
+        const RVA entry = region.entry;
+        Core()->cmdjStream(QString("pDj %1 @ %2").arg(last - entry + 1).arg(entry),
+        [&region, entry, last](JsonReader &reader) {
+            reader.readArray([&region, entry, last](JsonReader &reader) {
+                RVA offset = RVA_INVALID;
+                RVA size = 0;
+                reader.readObject([&offset, &size](const JsonReader::Key &key, JsonReader &reader) {
+                    if (key == "offset") {
+                        offset = reader.readUInt64(RVA_INVALID);
+                    } else if (key == "size") {
+                        size = reader.readUInt64();
+                    }
+                });
+                if (offset == RVA_INVALID || offset < entry || offset > last) {
+                    return;
+                }
+                RVA bit = offset & (RegionSize - 1);
+                region.bits[static_cast<size_t>(bit / 64)] |= quint64(1) << (bit % 64);
+                region.exit = qMax(region.exit, offset + qMax<RVA>(size, 1));
+            });
+        });
+    }
+
+    QMutexLocker locker(&mutex);
+    if (generation == buildGeneration) {
+        regions.insert(index, region);
+    }
+}
+
+void InstructionBoundaryTask::runTask()
+{
+    InstructionBoundaryIndex *index = InstructionBoundaryIndex::instance();
+    for (RVA region : regions) {
+        if (isInterrupted()) {
+            return;
+        }
+        index->buildRegion(region);
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef INSTRUCTIONBOUNDARYINDEX_H
+#define INSTRUCTIONBOUNDARYINDEX_H
+
+#include "core/Cutter.h"
+#include "common/AsyncTask.h"
+#include "common/MemoryAccounting.h"
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+
+#include <array>
+
+class InstructionBoundaryTask;
+
+/**
+ * @brief Start addresses of the lines of linear disassembly, so that moving a number of
+ * instructions forward or backward does not need to render any disassembly.
+ *
+ * The address space is split into regions of RegionSize bytes, each with a bitmap of the
+ * addresses where a line of "pD" starts. Regions are built in the background when they are
+ * first needed. A region continues the sweep where the previous one ended, so walking
+ * across regions is only possible while they are linked by entry and exit addresses.
+ *
+ * Lookups fail whenever the answer is not known yet, the caller is expected to fall back
+ * to asking the core directly. The index is not used while debugging, when memory may
+ * change at any time.
+ */
+class InstructionBoundaryIndex : public QObject
+{
+    Q_OBJECT
+
+    friend class InstructionBoundaryTask;
+
+public:
+    static constexpr int RegionBits = 12;
+    static constexpr RVA RegionSize = RVA(1) << RegionBits;
+
+    static InstructionBoundaryIndex *instance();
+
+    /**
+     * @param start address of an instruction
+     * @param result address of the instruction count instructions after start
+     * @return false if the result is not known from the index
+     */
+    bool next(RVA start, int count, RVA *result);
+
+    /**
+     * @param start address of an instruction
+     * @param result address of the instruction count instructions before start
+     * @return false if the result is not known from the index
+     */
+    bool previous(RVA start, int count, RVA *result);
+
+    /**
+     * @brief Drop the regions around offset, for example after the instruction there changed.
+     */
+    void invalidate(RVA offset);
+    void clear();
+
+private:
+    InstructionBoundaryIndex();
+
+    struct Region {
+        RVA entry;  ///< first address of the sweep, may lie after the region if it was skipped
+        RVA exit;   ///< address after the last line started in this region
+        std::array<quint64, RegionSize / 64> bits;
+    };
+
+    QMutex mutex;
+    QHash<RVA, Region> regions;
+    quint64 generation = 0;
+    QList<RVA> pending;
+    QSet<RVA> pendingSet;
+    QSharedPointer<InstructionBoundaryTask> task;
+    MemoryAccount account;
+
+    bool isUsable() const;
+    RVA nextBoundaryLocked(RVA address);
+    RVA previousBoundaryLocked(RVA address);
+    const Region *regionLocked(RVA index);
+    void scheduleLocked(RVA index);
+    void startTask();
+    void onTaskFinished();
+
+    /**
+     * @brief Build a region, called from the task thread
+     */
+    void buildRegion(RVA index);
+};
+
+class InstructionBoundaryTask : public AsyncTask
+{
+    Q_OBJECT
+
+public:
+    explicit InstructionBoundaryTask(const QList<RVA> &regions) : regions(regions) {}
+
+    QString getTitle() override     { return tr("Indexing Instructions"); }
+
+protected:
+    void runTask() override;
+
+private:
+    QList<RVA> regions;
+};
+
+#endif // INSTRUCTIONBOUNDARYINDEX_H
@@ -0,0 +1,387 @@
+#include "JsonReader.h"
+
+#include <cstdlib>
+
+JsonReader::JsonReader(const char *json)
+    : begin(json),
+      p(json)
+{
+    skipWhitespace();
+}
+
+QString JsonReader::errorString() const
+{
+    if (!error) {
+        return QString();
+    }
+    return QStringLiteral("%1 at offset %2").arg(QString::fromLatin1(error)).arg(p - begin);
+}
+
+void JsonReader::setError(const char *message)
+{
+    if (!error) {
+        error = message;
+    }
+}
+
+bool JsonReader::beginContainer(char open)
+{
+    if (error) {
+        return false;
+    }
+    skipWhitespace();
+    if (*p != open) {
+        skipValue();
+        return false;
+    }
+    p++;
+    skipWhitespace();
+    return true;
+}
+
+bool JsonReader::endElement(char close, bool *done)
+{
+    skipWhitespace();
+    if (*p == ',') {
+        p++;
+        skipWhitespace();
+        *done = false;
+        return true;
+    }
+    if (*p == close) {
+        p++;
+        *done = true;
+        return true;
+    }
+    setError(close == ']' ? "expected ',' or ']'" : "expected ',' or '}'");
+    return false;
+}
+
+bool JsonReader::readKey(Key *key)
+{
+    if (*p != '"') {
+        setError("expected object key");
+        return false;
+    }
+    const char *start = ++p;
+    while (*p != '"' && *p != '\\' && *p) {
+        p++;
+    }
+    if (*p == '"') {
+        key->data = start;
+        key->size = static_cast<int>(p - start);
+        p++;
+    } else {
+        // Escaped keys are rare enough to be decoded into a separate buffer
+        p = start - 1;
+        keyBuffer.clear();
+        const char *stringStart = p;
+        if (!skipString() || !decodeString(stringStart, &keyBuffer)) {
+            return false;
+        }
+        key->data = keyBuffer.constData();
+        key->size = keyBuffer.size();
+    }
+    skipWhitespace();
+    if (*p != ':') {
+        setError("expected ':'");
+        return false;
+    }
+    p++;
+    skipWhitespace();
+    return true;
+}
+
+bool JsonReader::skipString()
+{
+    // p is at the opening quote
+    p++;
+    while (true) {
+        switch (*p) {
+        case '"':
+            p++;
+            return true;
+        case '\\':
+            if (!p[1]) {
+                setError("unterminated string");
+                return false;
+            }
+            p += 2;
+            break;
+        case '\0':
+            setError("unterminated string");
+            return false;
+        default:
+            p++;
+            break;
+        }
+    }
+}
+
+static int hexDigitValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static bool readHex4(const char *s, ut32 *value)
+{
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hexDigitValue(s[i]);
+        if (digit < 0) {
+            return false;
+        }
+        *value = (*value << 4) | static_cast<ut32>(digit);
+    }
+    return true;
+}
+
+static void appendUtf8(QByteArray *out, ut32 cp)
+{
+    if (cp < 0x80) {
+        out->append(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out->append(static_cast<char>(0xc0 | (cp >> 6)));
+        out->append(static_cast<char>(0x80 | (cp & 0x3f)));
+    } else if (cp < 0x10000) {
+        out->append(static_cast<char>(0xe0 | (cp >> 12)));
+        out->append(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+        out->append(static_cast<char>(0x80 | (cp & 0x3f)));
+    } else {
+        out->append(static_cast<char>(0xf0 | (cp >> 18)));
+        out->append(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+        out->append(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+        out->append(static_cast<char>(0x80 | (cp & 0x3f)));
+    }
+}
+
+bool JsonReader::decodeString(const char *start, QByteArray *out)
+{
+    // start is at the opening quote of a string already validated by skipString()
+    const char *end = p - 1;
+    out->reserve(static_cast<int>(end - start));
+    for (const char *s = start + 1; s < end; s++) {
+        if (*s != '\\') {
+            out->append(*s);
+            continue;
+        }
+        s++;
+        switch (*s) {
+        case 'b': out->append('\b'); break;
+        case 'f': out->append('\f'); break;
+        case 'n': out->append('\n'); break;
+        case 'r': out->append('\r'); break;
+        case 't': out->append('\t'); break;
+        case 'u': {
+            ut32 cp;
+            if (end - s < 5 || !readHex4(s + 1, &cp)) {
+                setError("invalid unicode escape");
+                return false;
+            }
+            s += 4;
+            ut32 low;
+            if (cp >= 0xd800 && cp < 0xdc00 && end - s >= 7 && s[1] == '\\' && s[2] == 'u'
+                    && readHex4(s + 3, &low) && low >= 0xdc00 && low < 0xe000) {
+                cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                s += 6;
+            }
+            appendUtf8(out, cp);
+            break;
+        }
+        default:
+            // \" \\ \/ and anything unknown map to the character itself
+            out->append(*s);
+            break;
+        }
+    }
+    return true;
+}
+
+QString JsonReader::readString()
+{
+    if (error) {
+        return QString();
+    }
+    skipWhitespace();
+    if (*p != '"') {
+        skipValue();
+        return QString();
+    }
+    const char *start = p;
+    bool escaped = false;
+    p++;
+    while (*p != '"' && *p) {
+        if (*p == '\\') {
+            escaped = true;
+            p++;
+            if (!*p) {
+                break;
+            }
+        }
+        p++;
+    }
+    if (*p != '"') {
+        setError("unterminated string");
+        return QString();
+    }
+    p++;
+    if (!escaped) {
+        return QString::fromUtf8(start + 1, static_cast<int>(p - start - 2));
+    }
+    QByteArray decoded;
+    if (!decodeString(start, &decoded)) {
+        return QString();
+    }
+    return QString::fromUtf8(decoded);
+}
+
+bool JsonReader::readDecimal(ut64 *value, bool *negative)
+{
+    *negative = *p == '-';
+    const char *s = *negative ? p + 1 : p;
+    if (*s < '0' || *s > '9') {
+        return false;
+    }
+    ut64 result = 0;
+    while (*s >= '0' && *s <= '9') {
+        result = result * 10 + static_cast<ut64>(*s - '0');
+        s++;
+    }
+    if (*s == '.' || *s == 'e' || *s == 'E') {
+        // Not an integer, let the caller fall back to strtod()
+        return false;
+    }
+    p = s;
+    *value = result;
+    return true;
+}
+
+ut64 JsonReader::readUInt64(ut64 defaultValue)
+{
+    return static_cast<ut64>(readInt64(static_cast<st64>(defaultValue)));
+}
+
+st64 JsonReader::readInt64(st64 defaultValue)
+{
+    if (error) {
+        return defaultValue;
+    }
+    skipWhitespace();
+    if (*p == '"') {
+        bool ok;
+        ut64 value = readString().toULongLong(&ok);
+        return ok ? static_cast<st64>(value) : defaultValue;
+    }
+    ut64 value;
+    bool negative;
+    if (readDecimal(&value, &negative)) {
+        return negative ? -static_cast<st64>(value) : static_cast<st64>(value);
+    }
+    if (*p == '-' || (*p >= '0' && *p <= '9')) {
+        return static_cast<st64>(readDouble(static_cast<double>(defaultValue)));
+    }
+    skipValue();
+    return defaultValue;
+}
+
+double JsonReader::readDouble(double defaultValue)
+{
+    if (error) {
+        return defaultValue;
+    }
+    skipWhitespace();
+    if (*p == '-' || (*p >= '0' && *p <= '9')) {
+        char *end;
+        double value = strtod(p, &end);
+        if (end != p) {
+            p = end;
+            return value;
+        }
+    }
+    skipValue();
+    return defaultValue;
+}
+
+bool JsonReader::readBool(bool defaultValue)
+{
+    if (error) {
+        return defaultValue;
+    }
+    skipWhitespace();
+    if (strncmp(p, "true", 4) == 0) {
+        p += 4;
+        return true;
+    }
+    if (strncmp(p, "false", 5) == 0) {
+        p += 5;
+        return false;
+    }
+    skipValue();
+    return defaultValue;
+}
+
+void JsonReader::skipValue()
+{
+    if (error) {
+        return;
+    }
+    skipWhitespace();
+    switch (*p) {
+    case '"':
+        skipString();
+        return;
+    case '{':
+    case '[': {
+        // Only the structure is tracked, nested values are not validated
+        int depth = 0;
+        do {
+            switch (*p) {
+            case '"':
+                if (!skipString()) {
+                    return;
+                }
+                continue;
+            case '{':
+            case '[':
+                depth++;
+                break;
+            case '}':
+            case ']':
+                depth--;
+                break;
+            case '\0':
+                setError("unterminated container");
+                return;
+            default:
+                break;
+            }
+            p++;
+        } while (depth > 0);
+        return;
+    }
+    case '\0':
+        setError("unexpected end of input");
+        return;
+    default: {
+        // Numbers and literals
+        const char *start = p;
+        while ((*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z')
+                || *p == '-' || *p == '+' || *p == '.') {
+            p++;
+        }
+        if (p == start) {
+            setError("unexpected character");
+        }
+        return;
+    }
+    }
+}
@@ -0,0 +1,179 @@
+#ifndef JSONREADER_H
+#define JSONREADER_H
+
+#include "core/CutterCommon.h"
+
+#include <QByteArray>
+#include <QString>
+
+#include <cstring>
+
+/**
+ * @brief Pull parser for the JSON output of radare2 commands.
+ *
+ * Unlike QJsonDocument no DOM is built: the caller walks arrays and objects with
+ * readArray() and readObject() and decodes only the values it asks for, straight into
+ * its own structures. Values the caller does not read are skipped structurally without
+ * being decoded. Numbers are decoded as exact 64-bit integers.
+ *
+ * The input must be null-terminated and outlive the reader.
+ *
+ * Example:
+ * @code
+ * reader.readArray([&](JsonReader &reader) {
+ *     FlagDescription flag {};
+ *     reader.readObject([&](const JsonReader::Key &key, JsonReader &reader) {
+ *         if (key == "offset") {
+ *             flag.offset = reader.readUInt64();
+ *         } else if (key == "name") {
+ *             flag.name = reader.readString();
+ *         }
+ *     });
+ *     flags << flag;
+ * });
+ * @endcode
+ */
+class JsonReader
+{
+public:
+    struct Key {
+        const char *data;
+        int size;
+
+        template<int N>
+        bool operator==(const char (&str)[N]) const
+        {
+            return size == N - 1 && memcmp(data, str, N - 1) == 0;
+        }
+        template<int N>
+        bool operator!=(const char (&str)[N]) const { return !(*this == str); }
+        /**
+         * @brief Compare with one of the RJsonKey constants, keys of r2 output are ASCII
+         */
+        bool operator==(const QString &str) const   { return QLatin1String(data, size) == str; }
+        bool operator!=(const QString &str) const   { return !(*this == str); }
+
+        QString toString() const { return QString::fromUtf8(data, size); }
+    };
+
+    explicit JsonReader(const char *json);
+
+    bool hasError() const           { return error != nullptr; }
+    QString errorString() const;
+
+    /**
+     * @return whether the value at the current position is an array or an object, without
+     * consuming it
+     */
+    bool atArray()                  { skipWhitespace(); return !error && *p == '['; }
+    bool atObject()                 { skipWhitespace(); return !error && *p == '{'; }
+
+    /**
+     * @brief Call handler once for every element of the array at the current position.
+     * Elements the handler does not consume are skipped.
+     * @return false if the current value is not an array or on parse error
+     */
+    template<typename Handler>
+    bool readArray(Handler handler);
+
+    /**
+     * @brief Call handler(const Key &, JsonReader &) once for every member of the object at
+     * the current position. Members the handler does not consume are skipped.
+     * @return false if the current value is not an object or on parse error
+     */
+    template<typename Handler>
+    bool readObject(Handler handler);
+
+    /**
+     * @return the string at the current position, a null QString for other types
+     */
+    QString readString();
+    /**
+     * @return the number at the current position, defaultValue for other types.
+     * Strings containing a decimal number are accepted like QVariant::toULongLong() does.
+     */
+    ut64 readUInt64(ut64 defaultValue = 0);
+    st64 readInt64(st64 defaultValue = 0);
+    int readInt(int defaultValue = 0)           { return static_cast<int>(readInt64(defaultValue)); }
+    double readDouble(double defaultValue = 0);
+    bool readBool(bool defaultValue = false);
+    void skipValue();
+
+private:
+    const char *begin;
+    const char *p;
+    const char *error = nullptr;
+    QByteArray keyBuffer;
+
+    void skipWhitespace()
+    {
+        while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t') {
+            p++;
+        }
+    }
+    void setError(const char *message);
+    bool beginContainer(char open);
+    bool endElement(char close, bool *done);
+    bool readKey(Key *key);
+    bool skipString();
+    bool decodeString(const char *start, QByteArray *out);
+    bool readDecimal(ut64 *value, bool *negative);
+};
+
+template<typename Handler>
+bool JsonReader::readArray(Handler handler)
+{
+    if (!beginContainer('[')) {
+        return false;
+    }
+    bool done = *p == ']';
+    if (done) {
+        p++;
+    }
+    while (!done) {
+        const char *start = p;
+        handler(*this);
+        if (error) {
+            return false;
+        }
+        if (p == start) {
+            skipValue();
+        }
+        if (!endElement(']', &done)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename Handler>
+bool JsonReader::readObject(Handler handler)
+{
+    if (!beginContainer('{')) {
+        return false;
+    }
+    bool done = *p == '}';
+    if (done) {
+        p++;
+    }
+    while (!done) {
+        Key key;
+        if (!readKey(&key)) {
+            return false;
+        }
+        const char *start = p;
+        handler(static_cast<const Key &>(key), *this);
+        if (error) {
+            return false;
+        }
+        if (p == start) {
+            skipValue();
+        }
+        if (!endElement('}', &done)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif // JSONREADER_H
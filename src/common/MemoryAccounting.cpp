@@ -0,0 +1,237 @@
+#include "MemoryAccounting.h"
+
+#include <QSettings>
+#include <QTimer>
+
+#include <algorithm>
+#include <cstdint>
+
+static const char *BUDGETS_GROUP = "memory/budgets";
+static const char *GLOBAL_BUDGET_KEY = "memory/globalBudget";
+static const int NOTIFY_INTERVAL_MS = 250;
+
+MemoryAccount::MemoryAccount(const QString &category, Evictor evictor)
+    : category(category),
+      evictor(std::move(evictor))
+{
+    MemoryAccounting::instance()->registerAccount(this);
+}
+
+MemoryAccount::~MemoryAccount()
+{
+    MemoryAccounting::instance()->unregisterAccount(this);
+}
+
+void MemoryAccount::update(size_t bytes, size_t entries)
+{
+    size_t oldBytes = this->bytes;
+    this->bytes = bytes;
+    this->entries = entries;
+    MemoryAccounting::instance()->accountChanged(this, oldBytes);
+}
+
+void MemoryAccount::touch()
+{
+    lastUse = ++MemoryAccounting::instance()->useClock;
+}
+
+MemoryAccounting::MemoryAccounting(QObject *parent)
+    : QObject(parent)
+{
+    QSettings settings;
+    globalBudget = settings.value(GLOBAL_BUDGET_KEY, 0).toULongLong();
+    settings.beginGroup(BUDGETS_GROUP);
+    for (const QString &category : settings.childKeys()) {
+        budgets.insert(category, settings.value(category).toULongLong());
+    }
+}
+
+MemoryAccounting *MemoryAccounting::instance()
+{
+    static MemoryAccounting *accounting = new MemoryAccounting();
+    return accounting;
+}
+
+void MemoryAccounting::registerAccount(MemoryAccount *account)
+{
+    account->lastUse = ++useClock;
+    accounts.append(account);
+    scheduleNotify();
+}
+
+void MemoryAccounting::unregisterAccount(MemoryAccount *account)
+{
+    accounts.removeOne(account);
+    totalBytes -= account->bytes;
+    scheduleNotify();
+}
+
+void MemoryAccounting::accountChanged(MemoryAccount *account, size_t oldBytes)
+{
+    totalBytes = totalBytes - oldBytes + account->bytes;
+    scheduleNotify();
+
+    if (account->bytes <= oldBytes || enforcing || enforceScheduled) {
+        return;
+    }
+    if (overBudget(account->category) || (globalBudget && totalBytes > globalBudget)) {
+        // Evicting from inside update() would pull data out from under the caller
+        enforceScheduled = true;
+        QTimer::singleShot(0, this, [this]() {
+            enforceScheduled = false;
+            enforceBudgets();
+        });
+    }
+}
+
+size_t MemoryAccounting::categoryBytes(const QString &category) const
+{
+    size_t bytes = 0;
+    for (const MemoryAccount *account : accounts) {
+        if (account->category == category) {
+            bytes += account->bytes;
+        }
+    }
+    return bytes;
+}
+
+bool MemoryAccounting::overBudget(const QString &category) const
+{
+    size_t budget = budgets.value(category, 0);
+    return budget && categoryBytes(category) > budget;
+}
+
+void MemoryAccounting::evict(QList<MemoryAccount *> candidates,
+                             const std::function<size_t()> &excess)
+{
+    std::sort(candidates.begin(), candidates.end(), [](const MemoryAccount *a, const MemoryAccount *b) {
+        return a->lastUse < b->lastUse;
+    });
+    for (MemoryAccount *account : candidates) {
+        size_t bytesToFree = excess();
+        if (!bytesToFree) {
+            break;
+        }
+        // The evictor may destroy other accounts, only call it for ones still registered
+        if (accounts.contains(account) && account->bytes) {
+            account->evictor(bytesToFree);
+        }
+    }
+}
+
+void MemoryAccounting::enforceBudgets()
+{
+    if (enforcing) {
+        return;
+    }
+    enforcing = true;
+
+    for (auto it = budgets.constBegin(); it != budgets.constEnd(); ++it) {
+        const QString &category = it.key();
+        size_t budget = it.value();
+        if (!budget) {
+            continue;
+        }
+        QList<MemoryAccount *> candidates;
+        for (MemoryAccount *account : accounts) {
+            if (account->category == category && account->isEvictable()) {
+                candidates.append(account);
+            }
+        }
+        evict(candidates, [this, &category, budget]() -> size_t {
+            size_t bytes = categoryBytes(category);
+            return bytes > budget ? bytes - budget : 0;
+        });
+    }
+
+    if (globalBudget && totalBytes > globalBudget) {
+        QList<MemoryAccount *> candidates;
+        for (MemoryAccount *account : accounts) {
+            if (account->isEvictable()) {
+                candidates.append(account);
+            }
+        }
+        evict(candidates, [this]() -> size_t {
+            return totalBytes > globalBudget ? totalBytes - globalBudget : 0;
+        });
+    }
+
+    enforcing = false;
+}
+
+void MemoryAccounting::evictAll()
+{
+    enforcing = true;
+    QList<MemoryAccount *> candidates;
+    for (MemoryAccount *account : accounts) {
+        if (account->isEvictable()) {
+            candidates.append(account);
+        }
+    }
+    evict(candidates, []() -> size_t {
+        return SIZE_MAX;
+    });
+    enforcing = false;
+}
+
+QList<MemoryAccounting::CategoryUsage> MemoryAccounting::getUsage() const
+{
+    QList<CategoryUsage> result;
+    QHash<QString, int> categoryIndex;
+    for (const MemoryAccount *account : accounts) {
+        auto it = categoryIndex.find(account->category);
+        if (it == categoryIndex.end()) {
+            it = categoryIndex.insert(account->category, result.size());
+            result.append({account->category, 0, 0, 0, budgets.value(account->category, 0), false});
+        }
+        CategoryUsage &usage = result[it.value()];
+        usage.bytes += account->bytes;
+        usage.entries += account->entries;
+        usage.accounts++;
+        usage.evictable = usage.evictable || account->isEvictable();
+    }
+    std::sort(result.begin(), result.end(), [](const CategoryUsage &a, const CategoryUsage &b) {
+        return a.category < b.category;
+    });
+    return result;
+}
+
+size_t MemoryAccounting::getBudget(const QString &category) const
+{
+    return budgets.value(category, 0);
+}
+
+void MemoryAccounting::setBudget(const QString &category, size_t bytes)
+{
+    QSettings settings;
+    settings.beginGroup(BUDGETS_GROUP);
+    if (bytes) {
+        budgets.insert(category, bytes);
+        settings.setValue(category, static_cast<qulonglong>(bytes));
+    } else {
+        budgets.remove(category);
+        settings.remove(category);
+    }
+    enforceBudgets();
+    scheduleNotify();
+}
+
+void MemoryAccounting::setGlobalBudget(size_t bytes)
+{
+    globalBudget = bytes;
+    QSettings().setValue(GLOBAL_BUDGET_KEY, static_cast<qulonglong>(bytes));
+    enforceBudgets();
+    scheduleNotify();
+}
+
+void MemoryAccounting::scheduleNotify()
+{
+    if (notifyScheduled) {
+        return;
+    }
+    notifyScheduled = true;
+    QTimer::singleShot(NOTIFY_INTERVAL_MS, this, [this]() {
+        notifyScheduled = false;
+        emit usageChanged();
+    });
+}
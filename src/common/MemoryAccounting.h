@@ -0,0 +1,133 @@
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QHash>
+
+#include <functional>
+
+class MemoryAccounting;
+
+/**
+ * @brief Handle through which a cache or model reports its approximate memory footprint.
+ *
+ * The owner keeps the account next to the data it describes and calls update() whenever
+ * the data is replaced. Accounts with the same category are summed up and share a budget,
+ * so every instance of a widget can simply create its own account.
+ *
+ * An account constructed with an evictor can be asked to free memory when its category or
+ * the global budget is exceeded. Evictable accounts are trimmed in least recently used order,
+ * owners mark their data as used with touch(). The evictor is expected to drop data it can
+ * recreate and report the new footprint with update() before returning.
+ *
+ * Accounts must only be used from the GUI thread.
+ */
+class MemoryAccount
+{
+public:
+    using Evictor = std::function<void(size_t bytesToFree)>;
+
+    explicit MemoryAccount(const QString &category, Evictor evictor = nullptr);
+    ~MemoryAccount();
+
+    MemoryAccount(const MemoryAccount &) = delete;
+    MemoryAccount &operator=(const MemoryAccount &) = delete;
+
+    void update(size_t bytes, size_t entries);
+    void clear()                        { update(0, 0); }
+    void touch();
+
+    const QString &getCategory() const  { return category; }
+    size_t getBytes() const             { return bytes; }
+    size_t getEntries() const           { return entries; }
+    bool isEvictable() const            { return static_cast<bool>(evictor); }
+
+private:
+    friend class MemoryAccounting;
+
+    QString category;
+    Evictor evictor;
+    size_t bytes = 0;
+    size_t entries = 0;
+    quint64 lastUse = 0;
+};
+
+/**
+ * @brief Central registry of MemoryAccount instances with per-category and global budgets.
+ *
+ * Budgets are in bytes, 0 meaning unlimited, and are persisted in the settings.
+ */
+class MemoryAccounting : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct CategoryUsage {
+        QString category;
+        size_t bytes;
+        size_t entries;
+        int accounts;
+        size_t budget;
+        bool evictable;
+    };
+
+    static MemoryAccounting *instance();
+
+    QList<CategoryUsage> getUsage() const;
+    size_t getTotalBytes() const        { return totalBytes; }
+
+    size_t getBudget(const QString &category) const;
+    void setBudget(const QString &category, size_t bytes);
+    size_t getGlobalBudget() const      { return globalBudget; }
+    void setGlobalBudget(size_t bytes);
+
+    /**
+     * @brief Evict from evictable accounts until all budgets are met or nothing is left to evict.
+     */
+    void enforceBudgets();
+
+    /**
+     * @brief Ask every evictable account to release as much as it can.
+     */
+    void evictAll();
+
+    /**
+     * @return rough heap footprint of a QString, including its shared data header
+     */
+    static size_t stringSize(const QString &str)
+    {
+        return static_cast<size_t>(str.capacity()) * sizeof(QChar) + 3 * sizeof(void *);
+    }
+
+signals:
+    /**
+     * @brief Emitted at most a few times per second after accounts changed.
+     */
+    void usageChanged();
+
+private:
+    friend class MemoryAccount;
+
+    explicit MemoryAccounting(QObject *parent = nullptr);
+
+    QList<MemoryAccount *> accounts;
+    QHash<QString, size_t> budgets;
+    size_t globalBudget = 0;
+    size_t totalBytes = 0;
+    quint64 useClock = 0;
+    bool enforcing = false;
+    bool enforceScheduled = false;
+    bool notifyScheduled = false;
+
+    void registerAccount(MemoryAccount *account);
+    void unregisterAccount(MemoryAccount *account);
+    void accountChanged(MemoryAccount *account, size_t oldBytes);
+    size_t categoryBytes(const QString &category) const;
+    bool overBudget(const QString &category) const;
+    void evict(QList<MemoryAccount *> candidates, const std::function<size_t()> &excess);
+    void scheduleNotify();
+};
+
+#endif // MEMORYACCOUNTING_H
@@ -0,0 +1,224 @@
+#include "MemoryWatch.h"
+
+constexpr RVA MemoryWatch::PageSize;
+
+namespace {
+
+/**
+ * Changes kept in the log, the oldest quarter is dropped beyond.
+ */
+const size_t MAX_CHANGES = 1 << 20;
+
+}
+
+MemoryWatch *MemoryWatch::instance()
+{
+    static MemoryWatch *watch = new MemoryWatch();
+    return watch;
+}
+
+MemoryWatch::MemoryWatch()
+    : account(QStringLiteral("Memory watch log"))
+{
+    Core()->setDebugStopFilter([this]() {
+        return handleStop();
+    });
+    connect(Core(), &CutterCore::debugTaskStateChanged, this, &MemoryWatch::syncProtection);
+    connect(Core(), &CutterCore::registersChanged, this, &MemoryWatch::syncProtection);
+    connect(Core(), &CutterCore::debugProcessFinished, this, &MemoryWatch::onDebugProcessFinished);
+}
+
+bool MemoryWatch::addWatch(RVA address, int size)
+{
+    if (size != 1 && size != 2 && size != 4 && size != 8) {
+        return false;
+    }
+    if (pageOf(address) != pageOf(address + size - 1)) {
+        // Keeps the handling of a fault to a single page
+        return false;
+    }
+    bool mapped = false;
+    if (Core()->currentlyDebugging) {
+        for (const MemoryMapDescription &map : Core()->getMemoryMap()) {
+            if (address >= map.addrStart && address + size <= map.addrEnd) {
+                mapped = true;
+                break;
+            }
+        }
+        if (!mapped) {
+            return false;
+        }
+    }
+    watches.insert(address, { size, mapped ? readValue(address, size) : 0 });
+    syncProtection();
+    emit watchesChanged();
+    return true;
+}
+
+void MemoryWatch::removeWatch(RVA address)
+{
+    if (watches.remove(address)) {
+        syncProtection();
+        emit watchesChanged();
+    }
+}
+
+void MemoryWatch::clearWatches()
+{
+    watches.clear();
+    syncProtection();
+    emit watchesChanged();
+}
+
+void MemoryWatch::clearChanges()
+{
+    changes.clear();
+    changes.shrink_to_fit();
+    account.clear();
+    emit changesReset();
+}
+
+bool MemoryWatch::canProtect() const
+{
+    return Core()->currentlyDebugging && !Core()->currentlyEmulating
+           && !Core()->isDebugTaskInProgress();
+}
+
+void MemoryWatch::syncProtection()
+{
+    if (!Core()->currentlyDebugging) {
+        // Called before the debugger detaches, pages of a process that keeps running must
+        // not stay protected
+        for (RVA page : protectedPages.keys()) {
+            unprotectPage(page);
+        }
+        protectedPages.clear();
+        return;
+    }
+    if (!canProtect()) {
+        return;
+    }
+    QSet<RVA> pages;
+    for (auto it = watches.constBegin(); it != watches.constEnd(); ++it) {
+        pages.insert(pageOf(it.key()));
+    }
+    for (RVA page : protectedPages.keys()) {
+        if (!pages.contains(page)) {
+            unprotectPage(page);
+        }
+    }
+    bool newPages = false;
+    for (RVA page : pages) {
+        if (!protectedPages.contains(page)) {
+            protectPage(page);
+            newPages = true;
+        }
+    }
+    if (newPages) {
+        // Values may have changed while the pages were not watched
+        for (auto it = watches.begin(); it != watches.end(); ++it) {
+            it->value = readValue(it.key(), it->size);
+        }
+    }
+}
+
+void MemoryWatch::protectPage(RVA page)
+{
+    QString permissions;
+    for (const MemoryMapDescription &map : Core()->getMemoryMap()) {
+        if (page >= map.addrStart && page < map.addrEnd) {
+            permissions = map.permission;
+            break;
+        }
+    }
+    if (permissions.isEmpty() || !permissions.contains('w')) {
+        // Not writable anyway, nothing to trap
+        protectedPages.insert(page, QString());
+        return;
+    }
+    QString readOnly = permissions;
+    readOnly.replace('w', '-');
+    Core()->cmdRaw(QString("dmp %1 %2 %3").arg(page).arg(PageSize).arg(readOnly));
+    protectedPages.insert(page, permissions);
+}
+
+void MemoryWatch::unprotectPage(RVA page)
+{
+    QString permissions = protectedPages.take(page);
+    if (!permissions.isEmpty()) {
+        Core()->cmdRaw(QString("dmp %1 %2 %3").arg(page).arg(PageSize).arg(permissions));
+    }
+}
+
+bool MemoryWatch::handleStop()
+{
+    if (protectedPages.isEmpty()) {
+        return false;
+    }
+    RVA faultAddress;
+    {
+        RCoreLocked core = Core()->core();
+        if (core->dbg->reason.type != R_DEBUG_REASON_SEGFAULT) {
+            return false;
+        }
+        faultAddress = core->dbg->reason.addr;
+    }
+    RVA page = pageOf(faultAddress);
+    auto pageIt = protectedPages.constFind(page);
+    if (pageIt == protectedPages.constEnd() || pageIt->isEmpty()) {
+        // A real crash of the debuggee
+        return false;
+    }
+    QString permissions = pageIt.value();
+
+    RVA pc = Core()->getProgramCounterValue();
+    Core()->cmdRaw(QString("dmp %1 %2 %3").arg(page).arg(PageSize).arg(permissions));
+    {
+        // The fault was caused by the watch, it must not be delivered to the debuggee
+        RCoreLocked core = Core()->core();
+        core->dbg->reason.signum = 0;
+        core->dbg->reason.type = R_DEBUG_REASON_NONE;
+    }
+    Core()->cmdRaw("ds");
+
+    size_t first = changes.size();
+    for (auto it = watches.lowerBound(page); it != watches.end() && it.key() < page + PageSize; ++it) {
+        quint64 value = readValue(it.key(), it->size);
+        if (value != it->value) {
+            changes.push_back({ it.key(), pc, it->value, value, static_cast<quint8>(it->size) });
+            it->value = value;
+        }
+    }
+    QString readOnly = permissions;
+    readOnly.replace('w', '-');
+    Core()->cmdRaw(QString("dmp %1 %2 %3").arg(page).arg(PageSize).arg(readOnly));
+
+    if (changes.size() > first) {
+        if (changes.size() > MAX_CHANGES) {
+            changes.erase(changes.begin(), changes.begin() + MAX_CHANGES / 4);
+            emit changesReset();
+        } else {
+            emit changesAdded(static_cast<int>(first));
+        }
+        account.update(changes.capacity() * sizeof(MemoryWatchChange), changes.size());
+    }
+    return true;
+}
+
+void MemoryWatch::onDebugProcessFinished()
+{
+    // The pages are gone with the process
+    protectedPages.clear();
+}
+
+quint64 MemoryWatch::readValue(RVA address, int size)
+{
+    QByteArray bytes = Core()->ioRead(address, size);
+    quint64 value = 0;
+    bool bigEndian = Core()->getConfigb("cfg.bigendian");
+    for (int i = 0; i < bytes.size(); i++) {
+        int shift = bigEndian ? (bytes.size() - 1 - i) * 8 : i * 8;
+        value |= quint64(static_cast<quint8>(bytes[i])) << shift;
+    }
+    return value;
+}
@@ -0,0 +1,99 @@
+#ifndef MEMORYWATCH_H
+#define MEMORYWATCH_H
+
+#include "core/Cutter.h"
+#include "common/MemoryAccounting.h"
+
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QSet>
+
+#include <vector>
+
+struct MemoryWatchChange {
+    RVA address;
+    RVA pc;             ///< instruction that wrote the value
+    quint64 oldValue;
+    quint64 newValue;
+    quint8 size;
+};
+
+/**
+ * @brief Watches many memory locations for changes while the debuggee runs, without
+ * hardware breakpoints or stepping through the program.
+ *
+ * The pages of all watched locations are made read only. A write to one of them stops the
+ * debuggee with a segmentation fault, which is handled right after the continue returns:
+ * the page is made writable again, the faulting instruction is stepped, changed values are
+ * appended to the change log, the page is protected again and the continue is resumed.
+ * Only writes to watched pages cost a stop, everything else runs at full speed.
+ *
+ * The kernel does not fault on protected pages when writing for system calls, such
+ * calls fail with EFAULT instead, so buffers passed to them should not be watched.
+ *
+ * It must only be used from the GUI thread.
+ */
+class MemoryWatch : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr RVA PageSize = 0x1000;
+
+    struct Watch {
+        int size;
+        quint64 value;
+    };
+
+    static MemoryWatch *instance();
+
+    /**
+     * @param size 1, 2, 4 or 8 bytes
+     * @return false if size is invalid or address is not mapped
+     */
+    bool addWatch(RVA address, int size);
+    void removeWatch(RVA address);
+    void clearWatches();
+    const QMap<RVA, Watch> &getWatches() const                  { return watches; }
+
+    const std::vector<MemoryWatchChange> &getChanges() const    { return changes; }
+    void clearChanges();
+
+signals:
+    void watchesChanged();
+    /**
+     * @brief Changes from index first on were appended to the log
+     */
+    void changesAdded(int first);
+    /**
+     * @brief The log was cleared or its oldest entries dropped
+     */
+    void changesReset();
+
+private:
+    MemoryWatch();
+
+    QMap<RVA, Watch> watches;
+    /**
+     * Protected pages and their original permissions
+     */
+    QHash<RVA, QString> protectedPages;
+    std::vector<MemoryWatchChange> changes;
+    MemoryAccount account;
+
+    bool canProtect() const;
+    void syncProtection();
+    void protectPage(RVA page);
+    void unprotectPage(RVA page);
+    /**
+     * @brief Stop filter of the debugger, true if the stop was a write to a watched page
+     * that has been handled
+     */
+    bool handleStop();
+    void onDebugProcessFinished();
+    quint64 readValue(RVA address, int size);
+    static RVA pageOf(RVA address)  { return address & ~(PageSize - 1); }
+};
+
+#endif // MEMORYWATCH_H
@@ -0,0 +1,480 @@
+#include "Profiler.h"
+
+#include <QDir>
+#include <QMutexLocker>
+#include <QSet>
+
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+constexpr int Profiler::DefaultFrequency;
+
+namespace {
+
+#ifdef Q_OS_LINUX
+
+/**
+ * Pages of the ring buffer of every thread, must be a power of two.
+ */
+const size_t RING_PAGES = 64;
+
+/**
+ * Poll timeout, threads are looked for every few timeouts.
+ */
+const int POLL_TIMEOUT_MS = 250;
+const int THREAD_SCAN_POLLS = 4;
+
+struct SampleStream {
+    int tid;
+    int fd;
+    void *base;
+    size_t pageSize;
+    size_t dataSize;
+};
+
+void readRing(const SampleStream &stream, quint64 offset, void *dest, size_t size)
+{
+    const char *data = static_cast<const char *>(stream.base) + stream.pageSize;
+    size_t start = offset % stream.dataSize;
+    size_t first = qMin(size, stream.dataSize - start);
+    memcpy(dest, data + start, first);
+    memcpy(static_cast<char *>(dest) + first, data, size - first);
+}
+
+#endif
+
+}
+
+void ProfileSamples::append(const ProfileSamples &other)
+{
+    quint32 offset = static_cast<quint32>(frames.size());
+    frames.insert(frames.end(), other.frames.begin(), other.frames.end());
+    ends.reserve(ends.size() + other.ends.size());
+    for (quint32 end : other.ends) {
+        ends.push_back(offset + end);
+    }
+}
+
+ProfilerTask::ProfilerTask(int pid, int frequency)
+    : pid(pid), frequency(frequency)
+{
+}
+
+ProfileSamples ProfilerTask::takeSamples()
+{
+    QMutexLocker locker(&samplesMutex);
+    ProfileSamples taken;
+    std::swap(taken, samples);
+    return taken;
+}
+
+void ProfilerTask::runTask()
+{
+#ifdef Q_OS_LINUX
+    std::vector<SampleStream> streams;
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    auto openThread = [&](int tid) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = PERF_COUNT_SW_TASK_CLOCK;
+        attr.freq = 1;
+        attr.sample_freq = static_cast<quint64>(frequency);
+        attr.sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_CALLCHAIN;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.exclude_callchain_kernel = 1;
+        attr.wakeup_events = 16;
+        // Inherited counters can not be mapped, every thread gets its own
+        int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, tid, -1, -1,
+                                          PERF_FLAG_FD_CLOEXEC));
+        if (fd < 0) {
+            return errno;
+        }
+        size_t mapSize = (RING_PAGES + 1) * pageSize;
+        void *base = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            int err = errno;
+            close(fd);
+            return err;
+        }
+        streams.push_back({ tid, fd, base, pageSize, RING_PAGES * pageSize });
+        return 0;
+    };
+
+    auto scanThreads = [&]() {
+        int err = 0;
+        QDir taskDir(QStringLiteral("/proc/%1/task").arg(pid));
+        for (const QString &entry : taskDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            int tid = entry.toInt();
+            bool known = std::any_of(streams.begin(), streams.end(), [tid](const SampleStream &s) {
+                return s.tid == tid;
+            });
+            if (!known && tid > 0) {
+                err = openThread(tid);
+            }
+        }
+        return err;
+    };
+
+    int err = scanThreads();
+    if (streams.empty()) {
+        if (err == EACCES || err == EPERM) {
+            error = tr("Not allowed to sample process %1, see /proc/sys/kernel/perf_event_paranoid.")
+                    .arg(pid);
+        } else {
+            error = tr("Can not sample process %1: %2").arg(pid).arg(QString::fromLocal8Bit(strerror(err)));
+        }
+        log(error);
+        return;
+    }
+
+    std::vector<char> record;
+    quint64 lost = 0;
+    int polls = 0;
+    while (!isInterrupted()) {
+        std::vector<pollfd> fds;
+        for (const SampleStream &stream : streams) {
+            fds.push_back({ stream.fd, POLLIN, 0 });
+        }
+        poll(fds.data(), fds.size(), POLL_TIMEOUT_MS);
+
+        ProfileSamples batch;
+        for (const SampleStream &stream : streams) {
+            auto *meta = static_cast<perf_event_mmap_page *>(stream.base);
+            quint64 head = meta->data_head;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            quint64 tail = meta->data_tail;
+            while (tail < head) {
+                perf_event_header header;
+                readRing(stream, tail, &header, sizeof(header));
+                if (header.size < sizeof(header)) {
+                    tail = head;
+                    break;
+                }
+                if (header.type == PERF_RECORD_SAMPLE) {
+                    // ip, nr and nr callchain entries
+                    record.resize(header.size);
+                    readRing(stream, tail, record.data(), header.size);
+                    const quint64 *values = reinterpret_cast<const quint64 *>(record.data() + sizeof(header));
+                    size_t count = (header.size - sizeof(header)) / sizeof(quint64);
+                    if (count >= 2) {
+                        RVA ip = values[0];
+                        size_t nr = qMin<size_t>(values[1], count - 2);
+                        batch.frames.push_back(ip);
+                        bool first = true;
+                        for (size_t i = 0; i < nr; i++) {
+                            RVA address = values[2 + i];
+                            if (address >= static_cast<RVA>(PERF_CONTEXT_MAX)) {
+                                continue;
+                            }
+                            // The callchain starts with the ip again
+                            if (!(first && address == ip)) {
+                                batch.frames.push_back(address);
+                            }
+                            first = false;
+                        }
+                        batch.ends.push_back(static_cast<quint32>(batch.frames.size()));
+                    }
+                } else if (header.type == PERF_RECORD_LOST) {
+                    quint64 lostRecord[3];  // header, id, lost
+                    readRing(stream, tail, lostRecord, sizeof(lostRecord));
+                    lost += lostRecord[2];
+                }
+                tail += header.size;
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+            meta->data_tail = tail;
+        }
+
+        // Threads that exited hang up after their last samples were read
+        for (size_t i = fds.size(); i-- > 0;) {
+            if (fds[i].revents & POLLHUP) {
+                munmap(streams[i].base, (RING_PAGES + 1) * streams[i].pageSize);
+                close(streams[i].fd);
+                streams.erase(streams.begin() + static_cast<long>(i));
+            }
+        }
+
+        if (batch.count() > 0) {
+            QMutexLocker locker(&samplesMutex);
+            size_t offset = samples.frames.size();
+            samples.frames.insert(samples.frames.end(), batch.frames.begin(), batch.frames.end());
+            for (quint32 end : batch.ends) {
+                samples.ends.push_back(static_cast<quint32>(offset + end));
+            }
+        }
+
+        if (kill(pid, 0) != 0 && errno == ESRCH) {
+            break;
+        }
+        if (++polls % THREAD_SCAN_POLLS == 0) {
+            scanThreads();
+        }
+    }
+
+    for (const SampleStream &stream : streams) {
+        munmap(stream.base, (RING_PAGES + 1) * stream.pageSize);
+        close(stream.fd);
+    }
+    if (lost) {
+        log(tr("%1 samples were lost.").arg(lost));
+    }
+#else
+    error = tr("Sampling is only supported for local processes on Linux.");
+    log(error);
+#endif
+}
+
+Profiler *Profiler::instance()
+{
+    static Profiler *profiler = new Profiler();
+    return profiler;
+}
+
+Profiler::Profiler()
+    : account(QStringLiteral("Profile"))
+{
+    // Aggregate while the debuggee is stopped, r2 is busy while it runs
+    connect(Core(), &CutterCore::debugTaskStateChanged, this, [this]() {
+        if (!Core()->isDebugTaskInProgress()) {
+            collect();
+        }
+    });
+    connect(Core(), &CutterCore::debugProcessFinished, this, &Profiler::stop);
+    clear();
+}
+
+bool Profiler::canSample()
+{
+#ifdef Q_OS_LINUX
+    if (!Core()->currentlyDebugging || Core()->currentlyEmulating) {
+        return false;
+    }
+    RCoreLocked core = Core()->core();
+    // Other backends debug processes which are not local
+    return core->dbg && core->dbg->h && core->dbg->pid > 0
+           && !strcmp(core->dbg->h->name, "native");
+#else
+    return false;
+#endif
+}
+
+void Profiler::start(int frequency)
+{
+    if (isRunning()) {
+        return;
+    }
+    if (!canSample()) {
+        emit error(tr("Only processes debugged with the native backend on Linux can be sampled."));
+        return;
+    }
+    int pid;
+    {
+        RCoreLocked core = Core()->core();
+        pid = core->dbg->pid;
+    }
+    task = QSharedPointer<ProfilerTask>(new ProfilerTask(pid, frequency));
+    connect(task.data(), &AsyncTask::finished, this, &Profiler::onTaskFinished);
+    Core()->getAsyncTaskManager()->start(task);
+    emit runningChanged(true);
+}
+
+void Profiler::stop()
+{
+    if (task) {
+        task->interrupt();
+    }
+}
+
+void Profiler::onTaskFinished()
+{
+    if (!task) {
+        return;
+    }
+    QString message = task->getError();
+    // The debuggee may still run, aggregated once it stops
+    pending.append(task->takeSamples());
+    task.clear();
+    collect();
+    emit runningChanged(false);
+    if (!message.isEmpty()) {
+        emit error(message);
+    }
+}
+
+void Profiler::clear()
+{
+    profile = Profile();
+    pending = ProfileSamples();
+    profile.nodes.push_back({ -1, -1, 0, {} });
+    functionByAddress.clear();
+    functionByName.clear();
+    frameFunctions.clear();
+    childNodes.clear();
+    updateAccount();
+    emit profileChanged();
+}
+
+void Profiler::collect()
+{
+    if (Core()->isDebugTaskInProgress()) {
+        // Pending samples may have grown
+        updateAccount();
+        return;
+    }
+    ProfileSamples samples;
+    std::swap(samples, pending);
+    if (task) {
+        samples.append(task->takeSamples());
+    }
+    if (samples.count() == 0) {
+        return;
+    }
+
+    RCoreLocked core = Core()->core();
+    std::vector<int> stack;
+    QSet<int> seen;
+    quint32 begin = 0;
+    for (quint32 end : samples.ends) {
+        if (begin == end) {
+            continue;
+        }
+        profile.sampleCount++;
+        RVA pc = samples.frames[begin];
+        quint64 &instructionSamples = profile.instructionSamples[pc];
+        instructionSamples++;
+        profile.maxInstructionSamples = qMax(profile.maxInstructionSamples, instructionSamples);
+
+        // Outermost frame first, return addresses point behind their call
+        stack.clear();
+        for (quint32 i = end; i-- > begin;) {
+            RVA address = samples.frames[i];
+            stack.push_back(functionOf(core, i == begin ? address : address - 1));
+        }
+        begin = end;
+
+        ProfileFunction &leaf = profile.functions[static_cast<size_t>(stack.back())];
+        leaf.selfSamples++;
+        profile.maxSelfSamples = qMax(profile.maxSelfSamples, leaf.selfSamples);
+
+        seen.clear();
+        int node = 0;
+        profile.nodes[0].samples++;
+        for (int function : stack) {
+            if (!seen.contains(function)) {
+                seen.insert(function);
+                profile.functions[static_cast<size_t>(function)].totalSamples++;
+            }
+            node = childNode(node, function);
+            profile.nodes[static_cast<size_t>(node)].samples++;
+        }
+    }
+
+    updateAccount();
+    emit profileChanged();
+}
+
+int Profiler::functionOf(RCore *core, RVA address)
+{
+    auto cached = frameFunctions.constFind(address);
+    if (cached != frameFunctions.constEnd()) {
+        return cached.value();
+    }
+
+    int index;
+    RAnalFunction *fcn = r_anal_get_fcn_in(core->anal, address, 0);
+    if (fcn) {
+        index = functionByAddress.value(fcn->addr, -1);
+        if (index < 0) {
+            index = static_cast<int>(profile.functions.size());
+            ProfileFunction function;
+            function.address = fcn->addr;
+            function.name = QString::fromUtf8(fcn->name);
+            profile.functions.push_back(function);
+            functionByAddress.insert(fcn->addr, index);
+        }
+    } else {
+        // Code of libraries is usually not analyzed, group it by the closest flag
+        RFlagItem *flag = r_flag_get_at(core->flags, address, true);
+        QString name = flag ? QString::fromUtf8(flag->name) : tr("[unknown]");
+        index = functionByName.value(name, -1);
+        if (index < 0) {
+            index = static_cast<int>(profile.functions.size());
+            ProfileFunction function;
+            function.address = RVA_INVALID;
+            function.name = name;
+            profile.functions.push_back(function);
+            functionByName.insert(name, index);
+        }
+    }
+    frameFunctions.insert(address, index);
+    return index;
+}
+
+int Profiler::childNode(int parent, int function)
+{
+    quint64 key = (static_cast<quint64>(parent) << 32) | static_cast<quint32>(function);
+    auto it = childNodes.constFind(key);
+    if (it != childNodes.constEnd()) {
+        return it.value();
+    }
+    int node = static_cast<int>(profile.nodes.size());
+    profile.nodes.push_back({ function, parent, 0, {} });
+    profile.nodes[static_cast<size_t>(parent)].children.push_back(node);
+    childNodes.insert(key, node);
+    return node;
+}
+
+const ProfileFunction *Profiler::functionAt(RVA address) const
+{
+    int index = functionByAddress.value(address, -1);
+    return index < 0 ? nullptr : &profile.functions[static_cast<size_t>(index)];
+}
+
+double Profiler::functionHeat(RVA address) const
+{
+    const ProfileFunction *function = functionAt(address);
+    if (!function || !profile.maxSelfSamples) {
+        return 0;
+    }
+    return double(function->selfSamples) / profile.maxSelfSamples;
+}
+
+double Profiler::instructionHeat(RVA address) const
+{
+    if (!profile.maxInstructionSamples) {
+        return 0;
+    }
+    return double(profile.instructionSamples.value(address)) / profile.maxInstructionSamples;
+}
+
+QColor Profiler::heatColor(double heat)
+{
+    // From a faint yellow to an opaque red
+    heat = qBound(0.0, heat, 1.0);
+    return QColor(255, int(200 * (1 - heat)), 0, int(40 + 140 * heat));
+}
+
+void Profiler::updateAccount()
+{
+    size_t bytes = profile.nodes.size() * (sizeof(FlameNode) + sizeof(int) + 16)
+                   + profile.functions.size() * (sizeof(ProfileFunction) + 32)
+                   + static_cast<size_t>(profile.instructionSamples.size()) * 32
+                   + static_cast<size_t>(frameFunctions.size()) * 32
+                   + pending.frames.size() * sizeof(RVA) + pending.ends.size() * sizeof(quint32);
+    account.update(bytes, profile.sampleCount);
+}
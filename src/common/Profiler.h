@@ -0,0 +1,173 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "core/Cutter.h"
+#include "common/AsyncTask.h"
+#include "common/MemoryAccounting.h"
+
+#include <QColor>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSharedPointer>
+
+#include <vector>
+
+/**
+ * @brief Call stacks sampled from a process, stored back to back, innermost frame first.
+ * The first frame of a sample is the program counter, the others are return addresses.
+ */
+struct ProfileSamples {
+    std::vector<RVA> frames;
+    std::vector<quint32> ends;      ///< end of every sample in frames
+
+    size_t count() const    { return ends.size(); }
+    void append(const ProfileSamples &other);
+};
+
+/**
+ * @brief Samples the call stacks of a local Linux process with perf_event_open while it runs.
+ *
+ * The CPU time clock of every thread of the process is sampled, the kernel records the
+ * program counter and the stack unwound through frame pointers in a ring buffer per thread.
+ * Threads started later are picked up within a second. The task ends when it is interrupted
+ * or the process exits.
+ */
+class ProfilerTask : public AsyncTask
+{
+    Q_OBJECT
+
+public:
+    ProfilerTask(int pid, int frequency);
+
+    QString getTitle() override     { return tr("Sampling Process %1").arg(pid); }
+
+    /**
+     * @brief Take the samples recorded since the last call, may be called while running
+     */
+    ProfileSamples takeSamples();
+    /**
+     * @return why sampling could not start, empty if it did
+     */
+    QString getError() const        { return error; }
+
+protected:
+    void runTask() override;
+
+private:
+    int pid;
+    int frequency;
+    QString error;
+    QMutex samplesMutex;
+    ProfileSamples samples;
+};
+
+struct ProfileFunction {
+    RVA address;            ///< RVA_INVALID for code outside of functions, grouped by name
+    QString name;
+    quint64 selfSamples = 0;
+    quint64 totalSamples = 0;   ///< samples with the function anywhere on the stack
+};
+
+struct FlameNode {
+    int function;           ///< index in Profile::functions, -1 for the root
+    int parent;
+    quint64 samples = 0;
+    std::vector<int> children;
+};
+
+/**
+ * @brief Samples aggregated by function and instruction
+ */
+struct Profile {
+    quint64 sampleCount = 0;
+    std::vector<ProfileFunction> functions;
+    /**
+     * Call tree of the samples, nodes[0] is the root holding all samples
+     */
+    std::vector<FlameNode> nodes;
+    QHash<RVA, quint64> instructionSamples;
+    quint64 maxSelfSamples = 0;
+    quint64 maxInstructionSamples = 0;
+};
+
+/**
+ * @brief Sampling profiler for the process being debugged, see ProfilerTask.
+ *
+ * Samples are only taken while the debuggee runs, e.g. during a continue. They are
+ * aggregated whenever the debuggee stops and when sampling ends, so that the analysis is
+ * not read while r2 is busy with the debuggee. Samples left when sampling ends while the
+ * debuggee still runs are kept until it stops. Views showing the profile should update on
+ * profileChanged.
+ *
+ * It must only be used from the GUI thread.
+ */
+class Profiler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultFrequency = 1000;
+
+    static Profiler *instance();
+
+    /**
+     * @return whether the process being debugged can be sampled
+     */
+    static bool canSample();
+
+    bool isRunning() const                  { return !task.isNull(); }
+    /**
+     * @brief Start sampling the process being debugged frequency times per second of CPU
+     * time, adding to the current profile
+     */
+    void start(int frequency = DefaultFrequency);
+    void stop();
+    void clear();
+
+    const Profile &getProfile() const       { return profile; }
+    /**
+     * @return the function starting at address or nullptr if it was not sampled
+     */
+    const ProfileFunction *functionAt(RVA address) const;
+
+    /**
+     * @return self samples of the function starting at address relative to the hottest
+     * function, from 0 to 1
+     */
+    double functionHeat(RVA address) const;
+    /**
+     * @return samples of the instruction at address relative to the hottest instruction,
+     * from 0 to 1
+     */
+    double instructionHeat(RVA address) const;
+    /**
+     * @brief Translucent color to paint over the background of something with heat
+     */
+    static QColor heatColor(double heat);
+
+signals:
+    void runningChanged(bool running);
+    void profileChanged();
+    void error(const QString &message);
+
+private:
+    Profiler();
+
+    QSharedPointer<ProfilerTask> task;
+    Profile profile;
+    ProfileSamples pending;                 ///< taken from the task, not aggregated yet
+    QHash<RVA, int> functionByAddress;
+    QHash<QString, int> functionByName;     ///< functions without address
+    QHash<RVA, int> frameFunctions;         ///< function of every frame address seen
+    QHash<quint64, int> childNodes;         ///< by parent node and function
+    MemoryAccount account;
+
+    void collect();
+    int functionOf(RCore *core, RVA address);
+    int childNode(int parent, int function);
+    void onTaskFinished();
+    void updateAccount();
+};
+
+#endif // PROFILER_H
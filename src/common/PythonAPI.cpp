@@ -3,10 +3,20 @@
 
 #include "PythonAPI.h"
 #include "core/Cutter.h"
+#include "common/RunScriptTask.h"
 
 #include "CutterConfig.h"
 
 #include <QFile>
+#include <QThread>
+
+/**
+ * Lock on the core held by the parent while parallel_map() workers are forked,
+ * and the core inherited by a worker process. A worker never touches CutterCore
+ * or Qt, it runs commands on its private copy of the core directly.
+ */
+static RCoreLocked *forkCoreLock = nullptr;
+static RCore *workerCore = nullptr;
 
 PyObject *api_version(PyObject *self, PyObject *null)
 {
@@ -23,7 +33,16 @@ PyObject *api_cmd(PyObject *self, PyObject *args)
     QString cmdRes;
     QByteArray cmdBytes;
     if (PyArg_ParseTuple(args, "s:command", &command)) {
-        cmdRes = Core()->cmd(command);
+        if (workerCore) {
+            char *res = r_core_cmd_str(workerCore, command);
+            cmdRes = QString(res ? res : "");
+            r_mem_free(res);
+        } else {
+            // Never hold the GIL while waiting for the core lock
+            Py_BEGIN_ALLOW_THREADS
+            cmdRes = Core()->cmd(command);
+            Py_END_ALLOW_THREADS
+        }
         cmdBytes = cmdRes.toLocal8Bit();
         result = cmdBytes.data();
     }
@@ -54,6 +73,83 @@ PyObject *api_message(PyObject *self, PyObject *args, PyObject *kwargs)
     return Py_None;
 }
 
+PyObject *api_progress(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    Q_UNUSED(self);
+    int value;
+    int maximum = 0;
+    char *message = nullptr;
+    static const char *kwlist[] = { "", "maximum", "message", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "i|iz",
+                                     const_cast<char**>(kwlist),
+                                     &value, &maximum, &message)) {
+        return NULL;
+    }
+    RunScriptTask *task = RunScriptTask::current();
+    if (task) {
+        task->reportProgress(value, maximum, message ? QString(message) : QString());
+    }
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+PyObject *api_check_cancel(PyObject *self, PyObject *null)
+{
+    Q_UNUSED(self)
+    Q_UNUSED(null)
+    // Let Python code on other threads, e.g. plugins on the UI thread, run in between script steps
+    Py_BEGIN_ALLOW_THREADS
+    QThread::yieldCurrentThread();
+    Py_END_ALLOW_THREADS
+
+    RunScriptTask *task = RunScriptTask::current();
+    if (task && task->isInterrupted()) {
+        PyErr_SetString(PyExc_KeyboardInterrupt, "Script cancelled");
+        return NULL;
+    }
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+PyObject *api_fork_prepare(PyObject *self, PyObject *null)
+{
+    Q_UNUSED(self)
+    Q_UNUSED(null)
+    if (workerCore || forkCoreLock) {
+        PyErr_SetString(PyExc_RuntimeError, "parallel_map() can not be nested");
+        return NULL;
+    }
+    // Hold the core while forking so that no other thread is in the middle of a command
+    Py_BEGIN_ALLOW_THREADS
+    forkCoreLock = new RCoreLocked(Core());
+    Py_END_ALLOW_THREADS
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+PyObject *api_fork_parent(PyObject *self, PyObject *null)
+{
+    Q_UNUSED(self)
+    Q_UNUSED(null)
+    delete forkCoreLock;
+    forkCoreLock = nullptr;
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+PyObject *api_fork_child(PyObject *self, PyObject *null)
+{
+    Q_UNUSED(self)
+    Q_UNUSED(null)
+    if (forkCoreLock) {
+        // The lock stays held forever in the child, the worker owns its copy of the core
+        workerCore = *forkCoreLock;
+        forkCoreLock = nullptr;
+    }
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 PyMethodDef CutterMethods[] = {
     {
         "version", api_version, METH_NOARGS,
@@ -71,6 +167,26 @@ PyMethodDef CutterMethods[] = {
         "message", (PyCFunction)(void *)/* don't remove this double cast! */api_message, METH_VARARGS | METH_KEYWORDS,
         "Print message"
     },
+    {
+        "progress", (PyCFunction)(void *)/* don't remove this double cast! */api_progress, METH_VARARGS | METH_KEYWORDS,
+        "Report the progress of a running script: progress(value, maximum=0, message=None)"
+    },
+    {
+        "check_cancel", api_check_cancel, METH_NOARGS,
+        "Yield to other threads and raise KeyboardInterrupt if the running script was cancelled"
+    },
+    {
+        "_fork_prepare", api_fork_prepare, METH_NOARGS,
+        "Lock the core before forking parallel_map() workers"
+    },
+    {
+        "_fork_parent", api_fork_parent, METH_NOARGS,
+        "Release the core after all parallel_map() workers were forked"
+    },
+    {
+        "_fork_child", api_fork_child, METH_NOARGS,
+        "Switch a forked parallel_map() worker to its private copy of the core"
+    },
     {NULL, NULL, 0, NULL}
 };
 
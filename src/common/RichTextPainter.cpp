@@ -2,22 +2,60 @@
 #include "RichTextPainter.h"
 #include "CachedFontMetrics.h"
 #include "common/Configuration.h"
+#include "common/CodePalette.h"
 #include <QPainter>
 #include <QTextBlock>
 #include <QTextFragment>
 
-//TODO: fix performance (possibly use QTextLayout?)
+template<typename T>
+bool RichTextPainter::Layout<T>::isValidFor(const CachedFontMetrics<T> *fontMetrics) const
+{
+    return fontMetrics && metricsId == fontMetrics->id();
+}
 
+template struct RichTextPainter::Layout<qreal>;
+
+template<typename T>
+RichTextPainter::Layout<T> RichTextPainter::layout(const List &richText,
+                                                   CachedFontMetrics<T> *fontMetrics)
+{
+    Layout<T> result;
+    result.metricsId = fontMetrics->id();
+    result.positions.reserve(richText.size() + 1);
+    T position = 0;
+    for (const CustomRichText_t &curRichText : richText) {
+        result.positions.push_back(position);
+        position += fontMetrics->width(curRichText.text);
+    }
+    result.positions.push_back(position);
+    return result;
+}
+
+template
+RichTextPainter::Layout<qreal> RichTextPainter::layout<qreal>(const List &richText,
+                                                              CachedFontMetrics<qreal> *fontMetrics);
 
 template<typename T>
 void RichTextPainter::paintRichText(QPainter *painter, T x, T y, T w, T h, T xinc,
                           const List &richText, CachedFontMetrics<T> *fontMetrics)
+{
+    paintRichText<T>(painter, x, y, w, h, xinc, richText, layout<T>(richText, fontMetrics));
+}
+
+template
+void RichTextPainter::paintRichText<qreal>(QPainter *painter, qreal x, qreal y, qreal w, qreal h, qreal xinc,
+    const List &richText, CachedFontMetrics<qreal> *fontMetrics);
+
+template<typename T>
+void RichTextPainter::paintRichText(QPainter *painter, T x, T y, T w, T h, T xinc,
+                          const List &richText, const Layout<T> &layout)
 {
     QPen pen;
     QPen highlightPen;
     QBrush brush(Qt::cyan);
-    for (const CustomRichText_t &curRichText : richText) {
-        T textWidth = fontMetrics->width(curRichText.text);
+    for (size_t i = 0; i < richText.size(); i++) {
+        const CustomRichText_t &curRichText = richText[i];
+        T textWidth = layout.positions[i + 1] - layout.positions[i];
         T backgroundWidth = textWidth;
         if (backgroundWidth + xinc > w)
             backgroundWidth = w - xinc;
@@ -29,7 +67,7 @@ void RichTextPainter::paintRichText(QPainter *painter, T x, T y, T w, T h, T xin
             painter->setPen(pen);
             break;
         case FlagColor: //color only
-            pen.setColor(curRichText.textColor);
+            pen.setColor(colorOf(curRichText));
             painter->setPen(pen);
             break;
         case FlagBackground: //background only
@@ -43,7 +81,7 @@ void RichTextPainter::paintRichText(QPainter *painter, T x, T y, T w, T h, T xin
                 brush.setColor(curRichText.textBackground);
                 painter->fillRect(QRectF(x + xinc, y, backgroundWidth, h), brush);
             }
-            pen.setColor(curRichText.textColor);
+            pen.setColor(colorOf(curRichText));
             painter->setPen(pen);
             break;
         }
@@ -62,7 +100,7 @@ void RichTextPainter::paintRichText(QPainter *painter, T x, T y, T w, T h, T xin
 
 template
 void RichTextPainter::paintRichText<qreal>(QPainter *painter, qreal x, qreal y, qreal w, qreal h, qreal xinc,
-    const List &richText, CachedFontMetrics<qreal> *fontMetrics);
+    const List &richText, const Layout<qreal> &layout);
 
 
 /**
@@ -84,7 +122,7 @@ void RichTextPainter::htmlRichText(const List &richText, QString &textHtml, QStr
             textHtml += "<span>";
             break;
         case FlagColor: //color only
-            textHtml += QString("<span style=\"color:%1\">").arg(curRichText.textColor.name());
+            textHtml += QString("<span style=\"color:%1\">").arg(colorOf(curRichText).name());
             break;
         case FlagBackground: //background only
             if (curRichText.textBackground !=
@@ -97,9 +135,9 @@ void RichTextPainter::htmlRichText(const List &richText, QString &textHtml, QStr
             if (curRichText.textBackground !=
                     Qt::transparent) // QColor::name() returns "#000000" for transparent color. That's not desired. Leave it blank.
                 textHtml += QString("<span style=\"color:%1; background-color:%2\">").arg(
-                                curRichText.textColor.name(), curRichText.textBackground.name());
+                                colorOf(curRichText).name(), curRichText.textBackground.name());
             else
-                textHtml += QString("<span style=\"color:%1\">").arg(curRichText.textColor.name());
+                textHtml += QString("<span style=\"color:%1\">").arg(colorOf(curRichText).name());
             break;
         }
         if (curRichText.highlight) //Underline highlighted token
@@ -112,6 +150,14 @@ void RichTextPainter::htmlRichText(const List &richText, QString &textHtml, QStr
     }
 }
 
+QColor RichTextPainter::colorOf(const CustomRichText_t &richText)
+{
+    if (richText.colorRole >= 0) {
+        return CodePalette::instance()->color(richText.colorRole);
+    }
+    return richText.textColor;
+}
+
 RichTextPainter::List RichTextPainter::fromTextDocument(const QTextDocument &doc)
 {
     List r;
@@ -125,6 +171,7 @@ RichTextPainter::List RichTextPainter::fromTextDocument(const QTextDocument &doc
             text.text = fragment.text();
             text.textColor = format.foreground().color();
             text.textBackground = format.background().color();
+            text.colorRole = CodePalette::instance()->roleOf(text.textColor);
 
             bool hasForeground = format.hasProperty(QTextFormat::ForegroundBrush);
             bool hasBackground = format.hasProperty(QTextFormat::BackgroundBrush);
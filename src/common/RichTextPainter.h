@@ -29,6 +29,7 @@ public:
         QColor textColor;
         QColor textBackground;
         CustomRichTextFlags flags;
+        int colorRole = -1; ///< CodePalette role, textColor is ignored when set
         bool highlight = false;
         QColor highlightColor;
         int highlightWidth = 2;
@@ -37,12 +38,35 @@ public:
 
     typedef std::vector<CustomRichText_t> List;
 
+    /**
+     * @brief Segment positions of a List measured once, so that painting the same List
+     * again only issues draw calls. Valid for the CachedFontMetrics it was measured with only.
+     */
+    template<typename T = qreal>
+    struct Layout {
+        std::vector<T> positions; ///< x offset of every segment followed by the total width
+        quint64 metricsId = 0;
+
+        T width() const { return positions.empty() ? 0 : positions.back(); }
+        bool isValidFor(const CachedFontMetrics<T> *fontMetrics) const;
+    };
+
     //functions
     template<typename T = qreal>
     static void paintRichText(QPainter *painter, T x, T y, T w, T h, T xinc,
                               const List &richText, CachedFontMetrics<T> *fontMetrics);
+    template<typename T = qreal>
+    static void paintRichText(QPainter *painter, T x, T y, T w, T h, T xinc,
+                              const List &richText, const Layout<T> &layout);
+    template<typename T = qreal>
+    static Layout<T> layout(const List &richText, CachedFontMetrics<T> *fontMetrics);
     static void htmlRichText(const List &richText, QString &textHtml, QString &textPlain);
 
+    static QColor colorOf(const CustomRichText_t &richText);
+
+    /**
+     * @brief Convert doc to a List, colors written by a CodeTokenProbe become color roles
+     */
     static List fromTextDocument(const QTextDocument &doc);
 
     static List cropped(const List &richText, int maxCols, const QString &indicator = nullptr,
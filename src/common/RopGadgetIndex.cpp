@@ -0,0 +1,387 @@
+#include "RopGadgetIndex.h"
+
+#include <QHash>
+#include <QRegularExpression>
+
+#include <algorithm>
+
+namespace {
+
+/**
+ * Executable ranges are decoded in chunks so that the core is only locked briefly.
+ */
+const RVA CHUNK_SIZE = 0x10000;
+/**
+ * Upper bound for the size of a single instruction on all supported architectures.
+ */
+const int MAX_INSTRUCTION_BYTES = 16;
+const int MAX_GADGET_INSTRUCTIONS = 16;
+
+enum OpKind : quint8 {
+    InvalidOp,
+    BodyOp,
+    EndOp
+};
+
+OpKind classifyOp(int type)
+{
+    switch (type & R_ANAL_OP_TYPE_MASK) {
+    case R_ANAL_OP_TYPE_RET:
+    case R_ANAL_OP_TYPE_UJMP:
+    case R_ANAL_OP_TYPE_UCALL:
+        return EndOp;
+    case R_ANAL_OP_TYPE_JMP:
+    case R_ANAL_OP_TYPE_CJMP:
+    case R_ANAL_OP_TYPE_CALL:
+    case R_ANAL_OP_TYPE_CRET:
+    case R_ANAL_OP_TYPE_TRAP:
+    case R_ANAL_OP_TYPE_ILL:
+        return InvalidOp;
+    default:
+        return BodyOp;
+    }
+}
+
+QVector<QPair<RVA, RVA>> executableRanges()
+{
+    QVector<QPair<RVA, RVA>> ranges;
+    for (const SectionDescription &section : Core()->getAllSections()) {
+        if (section.perm.contains('x') && section.vsize > 0) {
+            ranges.append({ section.vaddr, section.vaddr + section.vsize });
+        }
+    }
+    if (ranges.isEmpty()) {
+        for (const SegmentDescription &segment : Core()->getAllSegments()) {
+            if (segment.perm.contains('x') && segment.size > 0) {
+                ranges.append({ segment.vaddr, segment.vaddr + segment.size });
+            }
+        }
+    }
+    return ranges;
+}
+
+struct GadgetBuilder {
+    QHash<QString, int> gadgetIndices;
+    QStringList texts;
+    QVector<quint8> instructionCounts;
+    QVector<quint16> sizes;
+    QVector<QVector<RVA>> addresses;
+
+    void add(const QString &text, int instructions, int size, RVA address)
+    {
+        auto it = gadgetIndices.constFind(text);
+        int index;
+        if (it == gadgetIndices.constEnd()) {
+            index = texts.size();
+            gadgetIndices.insert(text, index);
+            texts.append(text);
+            instructionCounts.append(static_cast<quint8>(instructions));
+            sizes.append(static_cast<quint16>(size));
+            addresses.append(QVector<RVA>());
+        } else {
+            index = it.value();
+        }
+        addresses[index].append(address);
+    }
+};
+
+bool instructionMatches(const QStringRef &instruction, const QString &pattern)
+{
+    if (pattern.isEmpty()) {
+        return true;
+    }
+    if (!instruction.startsWith(pattern)) {
+        return false;
+    }
+    return instruction.size() == pattern.size() || instruction.at(pattern.size()) == ' ';
+}
+
+bool gadgetMatches(const QVector<QStringRef> &instructions, const QStringList &patterns)
+{
+    for (int start = 0; start + patterns.size() <= instructions.size(); start++) {
+        int i = 0;
+        while (i < patterns.size() && instructionMatches(instructions[start + i], patterns[i])) {
+            i++;
+        }
+        if (i == patterns.size()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+size_t RopGadgetTable::byteSize() const
+{
+    return sizeof(RopGadgetTable) + MemoryAccounting::stringSize(text)
+           + static_cast<size_t>(gadgets.size()) * sizeof(Gadget)
+           + static_cast<size_t>(addresses.size()) * sizeof(RVA);
+}
+
+void RopGadgetIndexTask::runTask()
+{
+    QVector<QPair<RVA, RVA>> ranges = executableRanges();
+    int maxInstructions = qBound(2, Core()->getConfigi("rop.len"), MAX_GADGET_INSTRUCTIONS);
+    // How far before an end instruction a gadget may start
+    RVA window = static_cast<RVA>(maxInstructions - 1) * MAX_INSTRUCTION_BYTES;
+
+    RVA totalSize = 0;
+    for (const auto &range : ranges) {
+        totalSize += range.second - range.first;
+    }
+    log(tr("Scanning %1 bytes of executable memory...").arg(totalSize));
+
+    GadgetBuilder builder;
+    QByteArray buffer;
+    QVector<OpKind> kinds;
+    QVector<quint8> sizes;
+    QHash<RVA, QString> instructionTexts;
+    RVA scanned = 0;
+    for (const auto &range : ranges) {
+        for (RVA chunk = range.first; chunk < range.second; chunk += CHUNK_SIZE) {
+            if (isInterrupted()) {
+                return;
+            }
+            RVA chunkEnd = qMin(range.second, chunk + CHUNK_SIZE);
+            // Decode the window before the chunk again, gadgets ending in this chunk may start there
+            RVA decodeStart = chunk - range.first > window ? chunk - window : range.first;
+            RVA readEnd = qMin(range.second, chunkEnd + MAX_INSTRUCTION_BYTES);
+            int decodeCount = static_cast<int>(chunkEnd - decodeStart);
+            int readCount = static_cast<int>(readEnd - decodeStart);
+
+            buffer.resize(readCount);
+            kinds.fill(InvalidOp, decodeCount);
+            sizes.fill(0, decodeCount);
+            instructionTexts.clear();
+            const ut8 *bytes = reinterpret_cast<const ut8 *>(buffer.constData());
+
+            RCoreLocked core = Core()->core();
+            if (!r_io_read_at(core->io, decodeStart, reinterpret_cast<ut8 *>(buffer.data()), readCount)) {
+                scanned += chunkEnd - chunk;
+                continue;
+            }
+            for (int i = 0; i < decodeCount; i++) {
+                RAnalOp op;
+                int length = r_anal_op(core->anal, &op, decodeStart + i, bytes + i, readCount - i,
+                                       R_ANAL_OP_MASK_BASIC);
+                if (length > 0 && op.size > 0 && op.size <= MAX_INSTRUCTION_BYTES
+                        && i + op.size <= readCount) {
+                    kinds[i] = classifyOp(op.type);
+                    sizes[i] = static_cast<quint8>(op.size);
+                }
+                r_anal_op_fini(&op);
+            }
+
+            auto instructionText = [&](int i) -> QString {
+                RVA address = decodeStart + i;
+                auto it = instructionTexts.constFind(address);
+                if (it != instructionTexts.constEnd()) {
+                    return it.value();
+                }
+                RAsmOp asmOp;
+                r_asm_op_init(&asmOp);
+                r_asm_set_pc(core->rasm, address);
+                r_asm_disassemble(core->rasm, &asmOp, bytes + i, readCount - i);
+                QString text = RopGadgetIndex::normalizeInstruction(r_asm_op_get_asm(&asmOp));
+                r_asm_op_fini(&asmOp);
+                instructionTexts.insert(address, text);
+                return text;
+            };
+
+            for (int end = static_cast<int>(chunk - decodeStart); end < decodeCount; end++) {
+                if (kinds[end] != EndOp) {
+                    continue;
+                }
+                int gadgetEnd = end + sizes[end];
+                builder.add(instructionText(end), 1, sizes[end], decodeStart + end);
+                for (int start = end - 1; start >= 0 && static_cast<RVA>(end - start) <= window; start--) {
+                    // Only chains of body instructions landing exactly on the end instruction form a gadget
+                    int p = start;
+                    int count = 1;
+                    while (p < end && count < maxInstructions && kinds[p] == BodyOp) {
+                        p += sizes[p];
+                        count++;
+                    }
+                    if (p != end) {
+                        continue;
+                    }
+                    QString text;
+                    for (p = start; p < end; p += sizes[p]) {
+                        text += instructionText(p);
+                        text += QLatin1String("; ");
+                    }
+                    text += instructionText(end);
+                    builder.add(text, count, gadgetEnd - start, decodeStart + start);
+                }
+            }
+
+            scanned += chunkEnd - chunk;
+            setProgress(static_cast<int>(scanned * 100 / qMax<RVA>(totalSize, 1)), 100);
+        }
+    }
+
+    log(tr("Building index of %1 distinct gadgets...").arg(builder.texts.size()));
+    QVector<int> order(builder.texts.size());
+    for (int i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&builder](int a, int b) {
+        if (builder.instructionCounts[a] != builder.instructionCounts[b]) {
+            return builder.instructionCounts[a] < builder.instructionCounts[b];
+        }
+        return builder.texts[a] < builder.texts[b];
+    });
+
+    QSharedPointer<RopGadgetTable> result(new RopGadgetTable);
+    result->ranges = ranges;
+    result->gadgets.reserve(order.size());
+    for (int index : order) {
+        const QString &text = builder.texts[index];
+        QVector<RVA> &gadgetAddresses = builder.addresses[index];
+        std::sort(gadgetAddresses.begin(), gadgetAddresses.end());
+        RopGadgetTable::Gadget gadget;
+        gadget.textOffset = static_cast<quint32>(result->text.size());
+        gadget.textLength = static_cast<quint16>(qMin(text.size(), 0xffff));
+        gadget.size = builder.sizes[index];
+        gadget.instructions = builder.instructionCounts[index];
+        gadget.firstAddress = static_cast<quint32>(result->addresses.size());
+        gadget.addressCount = static_cast<quint32>(gadgetAddresses.size());
+        result->text += text.left(gadget.textLength);
+        result->addresses += gadgetAddresses;
+        result->gadgets.append(gadget);
+    }
+    result->text.squeeze();
+    table = result;
+    log(tr("Indexed %1 distinct gadgets at %2 addresses.")
+        .arg(result->gadgets.size())
+        .arg(result->addresses.size()));
+}
+
+RopGadgetIndex *RopGadgetIndex::instance()
+{
+    static RopGadgetIndex *index = new RopGadgetIndex();
+    return index;
+}
+
+RopGadgetIndex::RopGadgetIndex()
+    : account(QStringLiteral("ROP gadget index"), [this](size_t) {
+          invalidate();
+      })
+{
+    connect(Core(), &CutterCore::instructionChanged, this, &RopGadgetIndex::onInstructionChanged);
+    connect(Core(), &CutterCore::refreshAll, this, &RopGadgetIndex::invalidate);
+    connect(Core(), &CutterCore::codeRebased, this, &RopGadgetIndex::invalidate);
+}
+
+AsyncTask::Ptr RopGadgetIndex::createBuildTask()
+{
+    if (isReady()) {
+        return nullptr;
+    }
+    return AsyncTask::Ptr(new RopGadgetIndexTask());
+}
+
+void RopGadgetIndex::buildFinished(AsyncTask *task)
+{
+    if (!task) {
+        return;
+    }
+    table = static_cast<RopGadgetIndexTask *>(task)->getTable();
+    if (table) {
+        account.update(table->byteSize(), table->gadgets.size());
+        emit ready();
+    }
+}
+
+void RopGadgetIndex::invalidate()
+{
+    cancelBuild();
+    table.clear();
+    account.clear();
+}
+
+void RopGadgetIndex::onInstructionChanged(RVA offset)
+{
+    if (isBuilding()) {
+        invalidate();
+        return;
+    }
+    if (!table) {
+        return;
+    }
+    for (const auto &range : table->ranges) {
+        if (offset >= range.first && offset < range.second) {
+            invalidate();
+            return;
+        }
+    }
+}
+
+QString RopGadgetIndex::normalizeInstruction(const QString &instruction)
+{
+    QString result = instruction.simplified().toLower();
+    result.replace(QLatin1String(" ,"), QLatin1String(","));
+    result.replace(QLatin1String(", "), QLatin1String(","));
+    result.replace(QLatin1Char(','), QLatin1String(", "));
+    return result;
+}
+
+QList<SearchDescription> RopGadgetIndex::query(const QString &query, QueryMode mode,
+                                               int maxResults, QString *errorString)
+{
+    QList<SearchDescription> results;
+    if (!table) {
+        return results;
+    }
+    account.touch();
+
+    QRegularExpression regex;
+    QStringList patterns;
+    if (mode == QueryMode::Regex) {
+        regex = QRegularExpression(query, QRegularExpression::CaseInsensitiveOption);
+        if (!regex.isValid()) {
+            if (errorString) {
+                *errorString = regex.errorString();
+            }
+            return results;
+        }
+    } else {
+        for (const QString &pattern : query.split(QLatin1Char(';'))) {
+            patterns.append(normalizeInstruction(pattern));
+        }
+        if (patterns.size() == 1 && patterns.first().isEmpty()) {
+            patterns.clear();
+        }
+    }
+
+    QVector<QStringRef> instructions;
+    for (const RopGadgetTable::Gadget &gadget : table->gadgets) {
+        if (results.size() >= maxResults) {
+            break;
+        }
+        QStringRef text = table->gadgetText(gadget);
+        bool matches;
+        if (mode == QueryMode::Regex) {
+            matches = regex.match(text).hasMatch();
+        } else if (patterns.size() > gadget.instructions) {
+            matches = false;
+        } else {
+            instructions = text.split(QLatin1String("; "));
+            matches = gadgetMatches(instructions, patterns);
+        }
+        if (!matches) {
+            continue;
+        }
+
+        SearchDescription description;
+        description.offset = table->addresses[static_cast<int>(gadget.firstAddress)];
+        description.size = gadget.size;
+        description.code = text.toString();
+        if (gadget.addressCount > 1) {
+            description.data = tr("%n locations", nullptr, static_cast<int>(gadget.addressCount));
+        }
+        results.append(description);
+    }
+    return results;
+}
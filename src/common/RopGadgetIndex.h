@@ -0,0 +1,119 @@
+#ifndef ROPGADGETINDEX_H
+#define ROPGADGETINDEX_H
+
+#include "core/Cutter.h"
+#include "common/AsyncTask.h"
+#include "common/BackgroundIndex.h"
+#include "common/MemoryAccounting.h"
+
+#include <QPair>
+#include <QSharedPointer>
+#include <QVector>
+
+/**
+ * @brief Deduplicated ROP gadgets of all executable ranges.
+ *
+ * The normalized text of all distinct gadgets is stored in one string, instructions
+ * separated by "; ". Gadgets are sorted by instruction count and text, so the shortest
+ * gadgets are found first, and point into a shared list of the addresses they occur at.
+ */
+struct RopGadgetTable {
+    struct Gadget {
+        quint32 textOffset;
+        quint16 textLength;
+        quint16 size;
+        quint8 instructions;
+        quint32 firstAddress;
+        quint32 addressCount;
+    };
+
+    QString text;
+    QVector<Gadget> gadgets;
+    QVector<RVA> addresses;
+    QVector<QPair<RVA, RVA>> ranges;
+
+    QStringRef gadgetText(const Gadget &gadget) const
+    {
+        return text.midRef(static_cast<int>(gadget.textOffset), gadget.textLength);
+    }
+    size_t byteSize() const;
+};
+
+class RopGadgetIndexTask : public AsyncTask
+{
+    Q_OBJECT
+
+public:
+    QString getTitle() override     { return tr("Indexing ROP Gadgets"); }
+
+    QSharedPointer<const RopGadgetTable> getTable() const   { return table; }
+
+protected:
+    void runTask() override;
+
+private:
+    QSharedPointer<const RopGadgetTable> table;
+};
+
+/**
+ * @brief Answers ROP gadget queries from a RopGadgetTable built once in the background,
+ * instead of scanning and disassembling executable memory for every query like "/R".
+ *
+ * The table is dropped whenever an executable range is written to or a new file is loaded
+ * and built again on the next build() call. It must only be used from the GUI thread.
+ */
+class RopGadgetIndex : public BackgroundIndex
+{
+    Q_OBJECT
+
+public:
+    enum class QueryMode {
+        /**
+         * Instructions separated by ';' that must occur consecutively in the gadget.
+         * An instruction matches if it is equal or its mnemonic is equal, so "pop; ret"
+         * matches "pop rdi; ret". An empty instruction matches any, like in "pop;;ret".
+         */
+        Instructions,
+        /**
+         * Case insensitive regular expression on the normalized gadget text
+         */
+        Regex
+    };
+
+    static RopGadgetIndex *instance();
+
+    bool isReady() const            { return !table.isNull(); }
+    int gadgetCount() const         { return table ? table->gadgets.size() : 0; }
+
+    /**
+     * @return one SearchDescription per matching distinct gadget, at most maxResults
+     */
+    QList<SearchDescription> query(const QString &query, QueryMode mode, int maxResults,
+                                   QString *errorString = nullptr);
+
+    /**
+     * @brief Normalize the text of one instruction the way it is stored in the table
+     */
+    static QString normalizeInstruction(const QString &instruction);
+
+signals:
+    void ready();
+
+protected:
+    /**
+     * @return nullptr if the table is ready already
+     */
+    AsyncTask::Ptr createBuildTask() override;
+    void buildFinished(AsyncTask *task) override;
+
+private:
+    RopGadgetIndex();
+
+    QSharedPointer<const RopGadgetTable> table;
+    MemoryAccount account;
+
+    void invalidate();
+    void onInstructionChanged(RVA offset);
+};
+
+#endif // ROPGADGETINDEX_H
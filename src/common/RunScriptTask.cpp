@@ -1,9 +1,27 @@
+#ifdef CUTTER_ENABLE_PYTHON
+#include "common/PythonAPI.h"
+#include "common/PythonManager.h"
+#endif
+
 #include "core/Cutter.h"
+#include "common/Configuration.h"
 #include "common/RunScriptTask.h"
 #include "core/MainWindow.h"
 
+#include <QFile>
+
+#include <thread>
+
+static thread_local RunScriptTask *currentTask = nullptr;
+
+// Minimum delay between two progress updates sent to the UI
+static const qint64 progressInterval = 50;
+
 RunScriptTask::RunScriptTask() :
     AsyncTask()
+#ifdef CUTTER_ENABLE_PYTHON
+    , pythonThread(new PythonThread)
+#endif
 {
 }
 
@@ -11,19 +29,129 @@ RunScriptTask::~RunScriptTask()
 {
 }
 
+RunScriptTask *RunScriptTask::current()
+{
+    return currentTask;
+}
+
 void RunScriptTask::interrupt()
 {
     AsyncTask::interrupt();
     r_cons_singleton()->context->breaked = true;
+
+#ifdef CUTTER_ENABLE_PYTHON
+    {
+        QMutexLocker locker(&pythonThread->mutex);
+        if (!pythonThread->id) {
+            return;
+        }
+    }
+    // Abort scripts that never call cutter.check_cancel() as soon as they run Python code again.
+    // The GIL is taken on another thread, the script may hold it for as long as it likes.
+    QSharedPointer<PythonThread> thread = pythonThread;
+    std::thread([thread]() {
+        PyGILState_STATE gilState = PyGILState_Ensure();
+        {
+            // Taken after the GIL like in runPythonScript(), so the script is still running
+            QMutexLocker locker(&thread->mutex);
+            if (thread->id) {
+                PyThreadState_SetAsyncExc(thread->id, PyExc_KeyboardInterrupt);
+            }
+        }
+        PyGILState_Release(gilState);
+    }).detach();
+#endif
+}
+
+void RunScriptTask::reportProgress(int value, int maximum, const QString &message)
+{
+    if (!message.isEmpty()) {
+        log(message);
+    }
+    if (progressTimer.isValid() && progressTimer.elapsed() < progressInterval
+            && (maximum <= 0 || value < maximum)) {
+        return;
+    }
+    progressTimer.start();
+    setProgress(value, maximum);
 }
 
 void RunScriptTask::runTask()
 {
-    if (!this->fileName.isNull()) {
-        log(tr("Executing script..."));
-        Core()->cmdTask(". " + this->fileName);
-        if (isInterrupted()) {
-            return;
+    if (this->fileName.isNull()) {
+        return;
+    }
+
+    log(tr("Executing script..."));
+#ifdef CUTTER_ENABLE_PYTHON
+    if (Config()->getRunPythonScriptsInCutter()
+            && fileName.endsWith(QLatin1String(".py"), Qt::CaseInsensitive)) {
+        runPythonScript();
+        return;
+    }
+#endif
+    Core()->cmdTask(". " + this->fileName);
+}
+
+#ifdef CUTTER_ENABLE_PYTHON
+void RunScriptTask::runPythonScript()
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        log(tr("Failed to open %1").arg(fileName));
+        return;
+    }
+    QByteArray source = file.readAll();
+    QByteArray fileNameBytes = fileName.toUtf8();
+
+    currentTask = this;
+    PyGILState_STATE gilState = PyGILState_Ensure();
+
+    PyObject *threading = PyImport_ImportModule("threading");
+    if (threading) {
+        PyObject *ident = PyObject_CallMethod(threading, "get_ident", nullptr);
+        if (ident) {
+            QMutexLocker locker(&pythonThread->mutex);
+            pythonThread->id = PyLong_AsUnsignedLong(ident);
+            Py_DECREF(ident);
         }
+        Py_DECREF(threading);
     }
+
+    if (!isInterrupted()) {
+        PyObject *code = Py_CompileString(source.constData(), fileNameBytes.constData(), Py_file_input);
+        if (code) {
+            PyObject *globals = PyDict_New();
+            PyObject *name = PyUnicode_FromString("__main__");
+            PyObject *path = PyUnicode_FromString(fileNameBytes.constData());
+            PyDict_SetItemString(globals, "__name__", name);
+            PyDict_SetItemString(globals, "__file__", path);
+            PyDict_SetItemString(globals, "__builtins__", PyEval_GetBuiltins());
+            Py_DECREF(name);
+            Py_DECREF(path);
+
+            PyObject *result = PyEval_EvalCode(code, globals, globals);
+            Py_XDECREF(result);
+            Py_DECREF(globals);
+            Py_DECREF(code);
+        }
+    }
+
+    {
+        QMutexLocker locker(&pythonThread->mutex);
+        pythonThread->id = 0;
+    }
+    if (PyErr_Occurred()) {
+        if (PyErr_ExceptionMatches(PyExc_KeyboardInterrupt)) {
+            PyErr_Clear();
+            log(tr("Script cancelled."));
+        } else {
+            log(tr("Script failed, see the console output for details."));
+            PyErr_Print();
+        }
+    }
+
+    PyGILState_Release(gilState);
+    currentTask = nullptr;
 }
+#endif
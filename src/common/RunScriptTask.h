@@ -4,6 +4,18 @@
 #include "common/AsyncTask.h"
 #include "core/Cutter.h"
 
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSharedPointer>
+
+/**
+ * @brief Runs a script file on a worker thread.
+ *
+ * Scripts are passed to radare2 with ". file", so Python scripts run with r2pipe as before.
+ * If Configuration::getRunPythonScriptsInCutter() is enabled, Python scripts are executed
+ * directly by the embedded interpreter on the worker thread instead and can report progress
+ * and poll for cancellation through cutter.progress() and cutter.check_cancel().
+ */
 class RunScriptTask : public AsyncTask
 {
     Q_OBJECT
@@ -22,11 +34,37 @@ public:
 
     void interrupt() override;
 
+    /**
+     * @return the task running a Python script on the calling thread or nullptr
+     */
+    static RunScriptTask *current();
+
+    /**
+     * @brief Progress reported by the script, throttled before being passed to the UI
+     * @param maximum total amount of work, 0 if unknown
+     * @param message optional message appended to the task log
+     */
+    void reportProgress(int value, int maximum, const QString &message = QString());
+
 protected:
     void runTask() override;
 
 private:
     QString fileName;
+    QElapsedTimer progressTimer;
+
+#ifdef CUTTER_ENABLE_PYTHON
+    /**
+     * Shared with the thread interrupting the script, which may outlive the task
+     */
+    struct PythonThread {
+        QMutex mutex;
+        unsigned long id = 0;   ///< Python id of the thread running the script, 0 if none
+    };
+    QSharedPointer<PythonThread> pythonThread;
+
+    void runPythonScript();
+#endif
 };
 
 #endif // RUNSCRIPTTHREAD_H
@@ -1,36 +1,37 @@
 
 #include "SelectionHighlight.h"
 #include "Configuration.h"
+#include "TokenIndex.h"
 
 #include <QList>
 #include <QTextEdit>
 #include <QColor>
 #include <QTextCursor>
 #include <QPlainTextEdit>
+#include <QTextBlock>
 
-QList<QTextEdit::ExtraSelection> createSameWordsSelections(QPlainTextEdit *textEdit, const QString &word)
+QList<QTextEdit::ExtraSelection> createSameWordsSelections(QPlainTextEdit *textEdit,
+                                                           const TokenIndex &index,
+                                                           const QString &word)
 {
     QList<QTextEdit::ExtraSelection> selections;
-    QTextEdit::ExtraSelection highlightSelection;
-    QTextDocument *document = textEdit->document();
-    QColor highlightWordColor = ConfigColor("wordHighlight");
-
     if (word.isEmpty()) {
-        return QList<QTextEdit::ExtraSelection>();
+        return selections;
     }
 
-    highlightSelection.cursor = textEdit->textCursor();
-    highlightSelection.cursor.movePosition(QTextCursor::Start, QTextCursor::MoveAnchor);
-
-    while (!highlightSelection.cursor.isNull() && !highlightSelection.cursor.atEnd()) {
-        highlightSelection.cursor = document->find(word, highlightSelection.cursor,
-                                                   QTextDocument::FindWholeWords);
-
-        if (!highlightSelection.cursor.isNull()) {
-            highlightSelection.format.setBackground(highlightWordColor);
-
-            selections.append(highlightSelection);
+    QTextDocument *document = textEdit->document();
+    QTextEdit::ExtraSelection highlightSelection;
+    highlightSelection.format.setBackground(ConfigColor("wordHighlight"));
+    for (const TokenIndex::Occurrence &occurrence : index.find(word)) {
+        QTextBlock block = document->findBlockByNumber(occurrence.line);
+        if (!block.isValid() || occurrence.start + word.length() > block.length()) {
+            continue;
         }
+        highlightSelection.cursor = QTextCursor(block);
+        highlightSelection.cursor.setPosition(block.position() + occurrence.start);
+        highlightSelection.cursor.setPosition(block.position() + occurrence.start + word.length(),
+                                              QTextCursor::KeepAnchor);
+        selections.append(highlightSelection);
     }
     return selections;
 }
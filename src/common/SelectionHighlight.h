@@ -5,14 +5,15 @@
 
 class QPlainTextEdit;
 class QString;
+class TokenIndex;
 
 /**
- * @brief createSameWordsSelections se
- * @param textEdit
- * @param word
- * @return
+ * @brief Highlight all occurrences of word, looked up in index instead of searching the document
+ * @param index - TokenIndex of the current document of textEdit
  */
-QList<QTextEdit::ExtraSelection> createSameWordsSelections(QPlainTextEdit *textEdit, const QString &word);
+QList<QTextEdit::ExtraSelection> createSameWordsSelections(QPlainTextEdit *textEdit,
+                                                           const TokenIndex &index,
+                                                           const QString &word);
 
 /**
  * @brief createLineHighlight
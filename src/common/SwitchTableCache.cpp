@@ -0,0 +1,194 @@
+#include "SwitchTableCache.h"
+
+#include <QStringList>
+
+#include <algorithm>
+
+QString SwitchTable::caseLabel(quint32 target, int maxRanges) const
+{
+    QStringList ranges;
+    bool more = false;
+    bool open = false;
+    ut64 first = 0;
+    ut64 last = 0;
+    for (const Case &c : cases) {
+        if (c.target != target) {
+            continue;
+        }
+        if (open && c.value == last + 1) {
+            last = c.value;
+            continue;
+        }
+        if (open) {
+            if (ranges.size() == maxRanges) {
+                more = true;
+                open = false;
+                break;
+            }
+            ranges << (first == last ? QString::number(first)
+                       : QStringLiteral("%1-%2").arg(first).arg(last));
+        }
+        first = last = c.value;
+        open = true;
+    }
+    if (open) {
+        if (ranges.size() == maxRanges) {
+            more = true;
+        } else {
+            ranges << (first == last ? QString::number(first)
+                       : QStringLiteral("%1-%2").arg(first).arg(last));
+        }
+    }
+    QString label = ranges.join(QStringLiteral(", "));
+    if (more) {
+        label += QStringLiteral(", ...");
+    }
+    return label;
+}
+
+size_t SwitchTable::byteSize() const
+{
+    return sizeof(SwitchTable) + targets.capacity() * sizeof(RVA) + cases.capacity() * sizeof(Case);
+}
+
+SwitchTableCache *SwitchTableCache::instance()
+{
+    static SwitchTableCache *cache = new SwitchTableCache();
+    return cache;
+}
+
+SwitchTableCache::SwitchTableCache()
+    : account(QStringLiteral("Switch tables"), [this](size_t bytesToFree) {
+    evict(bytesToFree);
+})
+{
+    connect(Core(), &CutterCore::functionsChanged, this, &SwitchTableCache::clear);
+    connect(Core(), &CutterCore::refreshAll, this, &SwitchTableCache::clear);
+    connect(Core(), &CutterCore::codeRebased, this, &SwitchTableCache::clear);
+    connect(Core(), &CutterCore::instructionChanged, this, &SwitchTableCache::onInstructionChanged);
+}
+
+QSharedPointer<const SwitchTables> SwitchTableCache::tables(RVA function)
+{
+    auto it = cache.constFind(function);
+    if (it != cache.constEnd()) {
+        account.touch();
+        return it.value();
+    }
+    QSharedPointer<const SwitchTables> result(new SwitchTables(readTables(function)));
+    cache.insert(function, result);
+    updateAccount();
+    account.touch();
+    return result;
+}
+
+SwitchTables SwitchTableCache::readTables(RVA function)
+{
+    SwitchTables result;
+    RCoreLocked core = Core()->core();
+    RAnalFunction *fcn = r_anal_get_function_at(core->anal, function);
+    if (!fcn) {
+        return result;
+    }
+    RListIter *it;
+    RAnalBlock *bb;
+    r_list_foreach(fcn->bbs, it, bb) {
+        if (!bb->switch_op || !bb->switch_op->cases || r_list_empty(bb->switch_op->cases)) {
+            continue;
+        }
+        SwitchTable table;
+        table.block = bb->addr;
+        table.address = bb->switch_op->addr;
+        table.tableBase = RVA_INVALID;
+        table.stride = 0;
+
+        struct Entry {
+            RVA address;
+            ut64 value;
+            RVA jump;
+        };
+        std::vector<Entry> entries;
+        RListIter *caseIt;
+        RAnalCaseOp *caseOp;
+        r_list_foreach(bb->switch_op->cases, caseIt, caseOp) {
+            entries.push_back({ caseOp->addr, caseOp->value, caseOp->jump });
+            table.targets.push_back(caseOp->jump);
+        }
+        std::sort(table.targets.begin(), table.targets.end());
+        table.targets.erase(std::unique(table.targets.begin(), table.targets.end()),
+                            table.targets.end());
+        table.targets.shrink_to_fit();
+
+        // Entry addresses spaced evenly are a table of fixed size entries
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+            return a.address < b.address;
+        });
+        if (entries.size() > 1 && entries[1].address > entries[0].address) {
+            RVA stride = entries[1].address - entries[0].address;
+            bool regular = stride <= 0xffffffff;
+            for (size_t i = 2; regular && i < entries.size(); i++) {
+                regular = entries[i].address - entries[i - 1].address == stride;
+            }
+            if (regular) {
+                table.tableBase = entries.front().address;
+                table.stride = static_cast<quint32>(stride);
+            }
+        }
+
+        table.cases.reserve(entries.size());
+        for (const Entry &entry : entries) {
+            auto target = std::lower_bound(table.targets.begin(), table.targets.end(), entry.jump);
+            table.cases.push_back({ entry.value,
+                                    static_cast<quint32>(target - table.targets.begin()) });
+        }
+        std::sort(table.cases.begin(), table.cases.end(),
+        [](const SwitchTable::Case &a, const SwitchTable::Case &b) {
+            return a.value < b.value;
+        });
+        result.append(table);
+    }
+    std::sort(result.begin(), result.end(), [](const SwitchTable &a, const SwitchTable &b) {
+        return a.block < b.block;
+    });
+    return result;
+}
+
+void SwitchTableCache::onInstructionChanged(RVA offset)
+{
+    RAnalFunction *fcn = Core()->functionIn(offset);
+    if (fcn && cache.remove(fcn->addr)) {
+        updateAccount();
+    }
+}
+
+void SwitchTableCache::clear()
+{
+    cache.clear();
+    account.clear();
+}
+
+void SwitchTableCache::evict(size_t bytesToFree)
+{
+    size_t freed = 0;
+    for (auto it = cache.begin(); it != cache.end() && freed < bytesToFree;) {
+        for (const SwitchTable &table : *it.value()) {
+            freed += table.byteSize();
+        }
+        it = cache.erase(it);
+    }
+    updateAccount();
+}
+
+void SwitchTableCache::updateAccount()
+{
+    size_t bytes = 0;
+    size_t entries = 0;
+    for (const auto &tables : cache) {
+        bytes += sizeof(RVA) + sizeof(SwitchTables);
+        for (const SwitchTable &table : *tables) {
+            bytes += table.byteSize();
+            entries++;
+        }
+    }
+    account.update(bytes, entries);
+}
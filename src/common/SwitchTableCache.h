@@ -0,0 +1,75 @@
+#ifndef SWITCHTABLECACHE_H
+#define SWITCHTABLECACHE_H
+
+#include "core/Cutter.h"
+#include "common/MemoryAccounting.h"
+
+#include <QHash>
+#include <QObject>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <vector>
+
+/**
+ * @brief Compact form of the cases of one recovered switch.
+ *
+ * Targets are stored once, the cases only refer to them by index, so tables of dispatchers
+ * with thousands of cases leading to a few handlers stay small.
+ */
+struct SwitchTable {
+    struct Case {
+        ut64 value;
+        quint32 target;     ///< index into targets
+    };
+
+    RVA block;              ///< block ending in the indirect jump
+    RVA address;            ///< the switch instruction
+    RVA tableBase;          ///< first table entry, RVA_INVALID if unknown
+    quint32 stride;         ///< distance between table entries, 0 if not regular
+    std::vector<RVA> targets;   ///< sorted, without duplicates
+    std::vector<Case> cases;    ///< sorted by value
+
+    /**
+     * @return the case values leading to target in short form, like "1-3, 7"
+     */
+    QString caseLabel(quint32 target, int maxRanges = 4) const;
+
+    size_t byteSize() const;
+};
+
+using SwitchTables = QVector<SwitchTable>;
+
+/**
+ * @brief Switch tables recovered by the analysis per function, read from r2 once and kept
+ * until the function changes.
+ *
+ * It must only be used from the GUI thread.
+ */
+class SwitchTableCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static SwitchTableCache *instance();
+
+    /**
+     * @return switch tables of the function at address in order of their blocks, empty if
+     * there are none
+     */
+    QSharedPointer<const SwitchTables> tables(RVA function);
+
+private:
+    SwitchTableCache();
+
+    QHash<RVA, QSharedPointer<const SwitchTables>> cache;
+    MemoryAccount account;
+
+    static SwitchTables readTables(RVA function);
+    void onInstructionChanged(RVA offset);
+    void clear();
+    void evict(size_t bytesToFree);
+    void updateAccount();
+};
+
+#endif // SWITCHTABLECACHE_H
@@ -0,0 +1,84 @@
+#include "TokenIndex.h"
+
+#include <QTextBlock>
+#include <QTextDocument>
+
+void TokenIndex::clear()
+{
+    lines.clear();
+    words.clear();
+}
+
+void TokenIndex::addLine(const QString &text)
+{
+    int line = lines.size();
+    lines.append(text);
+    int i = 0;
+    while (i < text.size()) {
+        if (!isWordChar(text[i])) {
+            i++;
+            continue;
+        }
+        int start = i;
+        while (i < text.size() && isWordChar(text[i])) {
+            i++;
+        }
+        words[text.mid(start, i - start).toCaseFolded()].append({ line, start });
+    }
+}
+
+void TokenIndex::setDocument(const QTextDocument *doc)
+{
+    clear();
+    for (QTextBlock block = doc->begin(); block != doc->end(); block = block.next()) {
+        addLine(block.text());
+    }
+}
+
+QVector<TokenIndex::Occurrence> TokenIndex::find(const QString &token) const
+{
+    QVector<Occurrence> result;
+    int wordStart = 0;
+    while (wordStart < token.size() && !isWordChar(token[wordStart])) {
+        wordStart++;
+    }
+    if (wordStart == token.size()) {
+        // Nothing to look up, only punctuation
+        if (token.isEmpty()) {
+            return result;
+        }
+        for (int line = 0; line < lines.size(); line++) {
+            int pos = -1;
+            while ((pos = lines[line].indexOf(token, pos + 1, Qt::CaseInsensitive)) != -1) {
+                result.append({ line, pos });
+            }
+        }
+        return result;
+    }
+    int wordEnd = wordStart;
+    while (wordEnd < token.size() && isWordChar(token[wordEnd])) {
+        wordEnd++;
+    }
+    auto it = words.constFind(token.mid(wordStart, wordEnd - wordStart).toCaseFolded());
+    if (it == words.constEnd()) {
+        return result;
+    }
+    if (wordStart == 0 && wordEnd == token.size()) {
+        // Indexed words are whole words already
+        return it.value();
+    }
+    bool endsWithWord = isWordChar(token[token.size() - 1]);
+    for (const Occurrence &occurrence : it.value()) {
+        const QString &text = lines[occurrence.line];
+        int start = occurrence.start - wordStart;
+        int end = start + token.size();
+        if (start < 0 || end > text.size() || text.midRef(start, token.size()).compare(token, Qt::CaseInsensitive) != 0) {
+            continue;
+        }
+        if (endsWithWord && end < text.size() && isWordChar(text[end])) {
+            continue;
+        }
+        result.append({ occurrence.line, start });
+    }
+    return result;
+}
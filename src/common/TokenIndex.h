@@ -0,0 +1,51 @@
+#ifndef TOKENINDEX_H
+#define TOKENINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QTextDocument;
+
+/**
+ * @brief Occurrences of every word in the lines of a code view, so that all occurrences of a
+ * clicked token are found without searching the whole text again.
+ *
+ * Words are maximal runs of letters, digits and underscores. Tokens containing other
+ * characters are looked up by their first word and compared in place. Lookups ignore case
+ * like QTextDocument::find() does by default, so eax also finds EAX.
+ */
+class TokenIndex
+{
+public:
+    struct Occurrence {
+        int line;
+        int start;      ///< character offset in the line
+    };
+
+    void clear();
+    /**
+     * @brief Index text as the next line
+     */
+    void addLine(const QString &text);
+    /**
+     * @brief Index every block of doc as a line, replacing the current lines
+     */
+    void setDocument(const QTextDocument *doc);
+
+    int lineCount() const   { return lines.size(); }
+
+    /**
+     * @return occurrences of token as a whole word ignoring case, ordered by line and offset
+     */
+    QVector<Occurrence> find(const QString &token) const;
+
+    static bool isWordChar(QChar c)     { return c.isLetterOrNumber() || c == QLatin1Char('_'); }
+
+private:
+    QStringList lines;
+    QHash<QString, QVector<Occurrence>> words;
+};
+
+#endif // TOKENINDEX_H
@@ -0,0 +1,336 @@
+#include "XrefGraph.h"
+#include "common/JsonReader.h"
+
+#include <algorithm>
+
+namespace {
+
+/**
+ * Number of patched instructions kept in the overlay before the graph is built again.
+ */
+const int MAX_OVERLAY_SIZE = 4096;
+
+bool rawXrefLess(const XrefGraph::RawXref &a, const XrefGraph::RawXref &b)
+{
+    if (a.from != b.from) {
+        return a.from < b.from;
+    }
+    if (a.to != b.to) {
+        return a.to < b.to;
+    }
+    return a.type < b.type;
+}
+
+bool rawXrefEqual(const XrefGraph::RawXref &a, const XrefGraph::RawXref &b)
+{
+    return a.from == b.from && a.to == b.to && a.type == b.type;
+}
+
+/**
+ * Read references in the format of "axj" and "axfj".
+ */
+void readXrefs(JsonReader &reader, std::vector<XrefGraph::RawXref> &xrefs)
+{
+    reader.readArray([&xrefs](JsonReader &reader) {
+        XrefGraph::RawXref xref { RVA_INVALID, RVA_INVALID, XrefGraph::Type::Unknown };
+        reader.readObject([&xref](const JsonReader::Key &key, JsonReader &reader) {
+            if (key == "from") {
+                xref.from = reader.readUInt64(RVA_INVALID);
+            } else if (key == "to") {
+                xref.to = reader.readUInt64(RVA_INVALID);
+            } else if (key == "type") {
+                xref.type = XrefGraph::typeFromString(reader.readString());
+            }
+        });
+        if (xref.from != RVA_INVALID && xref.to != RVA_INVALID) {
+            xrefs.push_back(xref);
+        }
+    });
+}
+
+}
+
+XrefGraph::Type XrefGraph::typeFromString(const QString &type)
+{
+    if (type == QLatin1String("CODE")) {
+        return Type::Code;
+    } else if (type == QLatin1String("CALL")) {
+        return Type::Call;
+    } else if (type == QLatin1String("DATA")) {
+        return Type::Data;
+    } else if (type == QLatin1String("STRING") || type == QLatin1String("STRN")) {
+        return Type::String;
+    }
+    return Type::Unknown;
+}
+
+QString XrefGraph::typeName(Type type)
+{
+    switch (type) {
+    case Type::Code:
+        return QStringLiteral("CODE");
+    case Type::Call:
+        return QStringLiteral("CALL");
+    case Type::Data:
+        return QStringLiteral("DATA");
+    case Type::String:
+        return QStringLiteral("STRING");
+    case Type::Unknown:
+        break;
+    }
+    return QStringLiteral("NULL");
+}
+
+XrefGraph XrefGraph::build(std::vector<RawXref> &xrefs)
+{
+    XrefGraph graph;
+    std::sort(xrefs.begin(), xrefs.end(), rawXrefLess);
+    xrefs.erase(std::unique(xrefs.begin(), xrefs.end(), rawXrefEqual), xrefs.end());
+
+    graph.nodes.reserve(xrefs.size() * 2);
+    for (const RawXref &xref : xrefs) {
+        graph.nodes.push_back(xref.from);
+        graph.nodes.push_back(xref.to);
+    }
+    std::sort(graph.nodes.begin(), graph.nodes.end());
+    graph.nodes.erase(std::unique(graph.nodes.begin(), graph.nodes.end()), graph.nodes.end());
+    graph.nodes.shrink_to_fit();
+
+    size_t nodeCount = graph.nodes.size();
+    std::vector<quint32> from(xrefs.size());
+    std::vector<quint32> to(xrefs.size());
+    for (size_t i = 0; i < xrefs.size(); i++) {
+        from[i] = static_cast<quint32>(graph.nodeIndex(xrefs[i].from));
+        to[i] = static_cast<quint32>(graph.nodeIndex(xrefs[i].to));
+    }
+
+    // Counting sort into rows, the outgoing rows are already in order of the sorted references
+    graph.outOffsets.assign(nodeCount + 1, 0);
+    graph.inOffsets.assign(nodeCount + 1, 0);
+    for (size_t i = 0; i < xrefs.size(); i++) {
+        graph.outOffsets[from[i] + 1]++;
+        graph.inOffsets[to[i] + 1]++;
+    }
+    for (size_t i = 0; i < nodeCount; i++) {
+        graph.outOffsets[i + 1] += graph.outOffsets[i];
+        graph.inOffsets[i + 1] += graph.inOffsets[i];
+    }
+    graph.outNeighbors.resize(xrefs.size());
+    graph.outTypes.resize(xrefs.size());
+    graph.inNeighbors.resize(xrefs.size());
+    graph.inTypes.resize(xrefs.size());
+    std::vector<quint32> outFill(graph.outOffsets.begin(), graph.outOffsets.end() - 1);
+    std::vector<quint32> inFill(graph.inOffsets.begin(), graph.inOffsets.end() - 1);
+    for (size_t i = 0; i < xrefs.size(); i++) {
+        quint32 out = outFill[from[i]]++;
+        graph.outNeighbors[out] = to[i];
+        graph.outTypes[out] = xrefs[i].type;
+        quint32 in = inFill[to[i]]++;
+        graph.inNeighbors[in] = from[i];
+        graph.inTypes[in] = xrefs[i].type;
+    }
+    return graph;
+}
+
+int XrefGraph::nodeIndex(RVA address) const
+{
+    auto it = std::lower_bound(nodes.begin(), nodes.end(), address);
+    if (it == nodes.end() || *it != address) {
+        return -1;
+    }
+    return static_cast<int>(it - nodes.begin());
+}
+
+int XrefGraph::inDegree(RVA address) const
+{
+    int node = nodeIndex(address);
+    return node < 0 ? 0 : static_cast<int>(inOffsets[node + 1] - inOffsets[node]);
+}
+
+int XrefGraph::outDegree(RVA address) const
+{
+    int node = nodeIndex(address);
+    return node < 0 ? 0 : static_cast<int>(outOffsets[node + 1] - outOffsets[node]);
+}
+
+QVector<XrefGraph::Edge> XrefGraph::refsTo(RVA address) const
+{
+    QVector<Edge> edges;
+    int node = nodeIndex(address);
+    if (node < 0) {
+        return edges;
+    }
+    for (quint32 i = inOffsets[node]; i < inOffsets[node + 1]; i++) {
+        edges.append({ nodes[inNeighbors[i]], inTypes[i] });
+    }
+    return edges;
+}
+
+QVector<XrefGraph::Edge> XrefGraph::refsFrom(RVA address) const
+{
+    QVector<Edge> edges;
+    int node = nodeIndex(address);
+    if (node < 0) {
+        return edges;
+    }
+    for (quint32 i = outOffsets[node]; i < outOffsets[node + 1]; i++) {
+        edges.append({ nodes[outNeighbors[i]], outTypes[i] });
+    }
+    return edges;
+}
+
+size_t XrefGraph::byteSize() const
+{
+    return sizeof(XrefGraph) + nodes.capacity() * sizeof(RVA)
+           + (outOffsets.capacity() + inOffsets.capacity()) * sizeof(quint32)
+           + (outNeighbors.capacity() + inNeighbors.capacity()) * sizeof(quint32)
+           + (outTypes.capacity() + inTypes.capacity()) * sizeof(Type);
+}
+
+void XrefGraphTask::runTask()
+{
+    log(tr("Reading cross references..."));
+    std::vector<XrefGraph::RawXref> xrefs;
+    Core()->cmdjStream("axj", [&xrefs](JsonReader &reader) {
+        readXrefs(reader, xrefs);
+    });
+    if (isInterrupted()) {
+        return;
+    }
+    log(tr("Building graph of %n cross references...", nullptr, static_cast<int>(xrefs.size())));
+    graph = QSharedPointer<const XrefGraph>(new XrefGraph(XrefGraph::build(xrefs)));
+}
+
+XrefIndex *XrefIndex::instance()
+{
+    static XrefIndex *index = new XrefIndex();
+    return index;
+}
+
+XrefIndex::XrefIndex()
+    : account(QStringLiteral("Cross reference graph"))
+{
+    connect(Core(), &CutterCore::refreshAll, this, &XrefIndex::scheduleBuild);
+    connect(Core(), &CutterCore::functionsChanged, this, &XrefIndex::scheduleBuild);
+    connect(Core(), &CutterCore::instructionChanged, this, &XrefIndex::onInstructionChanged);
+    connect(Core(), &CutterCore::codeRebased, this, &XrefIndex::invalidate);
+}
+
+AsyncTask::Ptr XrefIndex::createBuildTask()
+{
+    return AsyncTask::Ptr(new XrefGraphTask());
+}
+
+void XrefIndex::buildFinished(AsyncTask *task)
+{
+    QSharedPointer<const XrefGraph> result = static_cast<XrefGraphTask *>(task)->getGraph();
+    if (!result) {
+        return;
+    }
+    graph = result;
+    replacedFrom.clear();
+    inDegreeDelta.clear();
+    updateAccount();
+    emit updated();
+}
+
+void XrefIndex::invalidate()
+{
+    cancelBuild();
+    graph.clear();
+    replacedFrom.clear();
+    inDegreeDelta.clear();
+    account.clear();
+    emit updated();
+    scheduleBuild();
+}
+
+void XrefIndex::onInstructionChanged(RVA offset)
+{
+    if (!graph) {
+        return;
+    }
+    if (replacedFrom.size() >= MAX_OVERLAY_SIZE) {
+        scheduleBuild();
+        return;
+    }
+    std::vector<XrefGraph::RawXref> xrefs;
+    Core()->cmdjStream(QString("axfj @ %1").arg(offset), [&xrefs](JsonReader &reader) {
+        readXrefs(reader, xrefs);
+    });
+    QVector<XrefGraph::Edge> edges;
+    for (const XrefGraph::RawXref &xref : xrefs) {
+        if (xref.from == offset) {
+            edges.append({ xref.to, xref.type });
+        }
+    }
+
+    for (const XrefGraph::Edge &edge : refsFrom(offset)) {
+        inDegreeDelta[edge.address]--;
+    }
+    for (const XrefGraph::Edge &edge : edges) {
+        inDegreeDelta[edge.address]++;
+    }
+    replacedFrom.insert(offset, edges);
+    updateAccount();
+    emit updated();
+}
+
+void XrefIndex::updateAccount()
+{
+    size_t bytes = graph ? graph->byteSize() : 0;
+    for (const auto &edges : replacedFrom) {
+        bytes += sizeof(RVA) + sizeof(edges) + static_cast<size_t>(edges.capacity()) * sizeof(XrefGraph::Edge);
+    }
+    bytes += static_cast<size_t>(inDegreeDelta.size()) * (sizeof(RVA) + sizeof(int));
+    account.update(bytes, graph ? graph->edgeCount() : 0);
+}
+
+int XrefIndex::inDegree(RVA address) const
+{
+    if (!graph) {
+        return 0;
+    }
+    return graph->inDegree(address) + inDegreeDelta.value(address, 0);
+}
+
+int XrefIndex::outDegree(RVA address) const
+{
+    if (!graph) {
+        return 0;
+    }
+    auto it = replacedFrom.constFind(address);
+    return it != replacedFrom.constEnd() ? it->size() : graph->outDegree(address);
+}
+
+QVector<XrefGraph::Edge> XrefIndex::refsTo(RVA address) const
+{
+    QVector<XrefGraph::Edge> edges;
+    if (!graph) {
+        return edges;
+    }
+    for (const XrefGraph::Edge &edge : graph->refsTo(address)) {
+        if (!replacedFrom.contains(edge.address)) {
+            edges.append(edge);
+        }
+    }
+    if (inDegreeDelta.contains(address)) {
+        for (auto it = replacedFrom.constBegin(); it != replacedFrom.constEnd(); ++it) {
+            for (const XrefGraph::Edge &edge : it.value()) {
+                if (edge.address == address) {
+                    edges.append({ it.key(), edge.type });
+                }
+            }
+        }
+    }
+    return edges;
+}
+
+QVector<XrefGraph::Edge> XrefIndex::refsFrom(RVA address) const
+{
+    if (!graph) {
+        return {};
+    }
+    auto it = replacedFrom.constFind(address);
+    return it != replacedFrom.constEnd() ? it.value() : graph->refsFrom(address);
+}
@@ -0,0 +1,148 @@
+#ifndef XREFGRAPH_H
+#define XREFGRAPH_H
+
+#include "core/Cutter.h"
+#include "common/AsyncTask.h"
+#include "common/BackgroundIndex.h"
+#include "common/MemoryAccounting.h"
+
+#include <QHash>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <vector>
+
+/**
+ * @brief All cross references of the analysis in compressed sparse row form, in both directions.
+ *
+ * Every address taking part in a reference is a node, identified by its index in the sorted
+ * node list. The references from node i are outNeighbors[outOffsets[i]] up to
+ * outNeighbors[outOffsets[i + 1]], the ones to it are stored the same way in the in* vectors,
+ * so degrees are a subtraction and neighbours a contiguous range.
+ */
+class XrefGraph
+{
+public:
+    enum class Type : quint8 {
+        Code,
+        Call,
+        Data,
+        String,
+        Unknown
+    };
+
+    struct Edge {
+        RVA address;    ///< the other end of the reference
+        Type type;
+    };
+
+    struct RawXref {
+        RVA from;
+        RVA to;
+        Type type;
+    };
+
+    /**
+     * @brief Build from a list of references in any order, duplicates are dropped.
+     */
+    static XrefGraph build(std::vector<RawXref> &xrefs);
+
+    static Type typeFromString(const QString &type);
+    static QString typeName(Type type);
+
+    bool isEmpty() const            { return nodes.empty(); }
+    size_t nodeCount() const        { return nodes.size(); }
+    size_t edgeCount() const        { return outNeighbors.size(); }
+
+    /**
+     * @return index of the node at address, -1 if no reference starts or ends there
+     */
+    int nodeIndex(RVA address) const;
+
+    int inDegree(RVA address) const;
+    int outDegree(RVA address) const;
+    QVector<Edge> refsTo(RVA address) const;
+    QVector<Edge> refsFrom(RVA address) const;
+
+    size_t byteSize() const;
+
+private:
+    std::vector<RVA> nodes;
+    std::vector<quint32> outOffsets;
+    std::vector<quint32> outNeighbors;
+    std::vector<Type> outTypes;
+    std::vector<quint32> inOffsets;
+    std::vector<quint32> inNeighbors;
+    std::vector<Type> inTypes;
+};
+
+class XrefGraphTask : public AsyncTask
+{
+    Q_OBJECT
+
+public:
+    QString getTitle() override     { return tr("Building Cross Reference Graph"); }
+
+    QSharedPointer<const XrefGraph> getGraph() const    { return graph; }
+
+protected:
+    void runTask() override;
+
+private:
+    QSharedPointer<const XrefGraph> graph;
+};
+
+/**
+ * @brief Keeps an XrefGraph of the current analysis for cross reference counts and quick
+ * neighbour lookups, like the "Xrefs" columns of the list widgets.
+ *
+ * The graph is built in bulk in the background whenever the analysis changes as a whole.
+ * References of single patched instructions are read again right away and kept in a small
+ * overlay on top of the graph, which is folded into the next bulk build.
+ *
+ * It must only be used from the GUI thread.
+ */
+class XrefIndex : public BackgroundIndex
+{
+    Q_OBJECT
+
+public:
+    static XrefIndex *instance();
+
+    bool isReady() const            { return !graph.isNull(); }
+
+    /**
+     * @return number of references to address, 0 until the graph is ready
+     */
+    int inDegree(RVA address) const;
+    int outDegree(RVA address) const;
+    QVector<XrefGraph::Edge> refsTo(RVA address) const;
+    QVector<XrefGraph::Edge> refsFrom(RVA address) const;
+
+signals:
+    /**
+     * @brief Emitted whenever the counts changed, after a build or an incremental update
+     */
+    void updated();
+
+protected:
+    AsyncTask::Ptr createBuildTask() override;
+    void buildFinished(AsyncTask *task) override;
+
+private:
+    XrefIndex();
+
+    QSharedPointer<const XrefGraph> graph;
+    /**
+     * References of patched instructions, replacing the ones of the graph from the same address
+     */
+    QHash<RVA, QVector<XrefGraph::Edge>> replacedFrom;
+    QHash<RVA, int> inDegreeDelta;
+    MemoryAccount account;
+
+    void invalidate();
+    void onInstructionChanged(RVA offset);
+    void updateAccount();
+};
+
+#endif // XREFGRAPH_H
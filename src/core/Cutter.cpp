@@ -6,6 +6,7 @@
 #include <QVector>
 #include <QStringList>
 #include <QStandardPaths>
+#include <QThread>
 
 #include <cassert>
 #include <memory>
@@ -16,6 +17,12 @@
 #include "common/AsyncTask.h"
 #include "common/R2Task.h"
 #include "common/Json.h"
+#include "common/JsonReader.h"
+#include "common/InstructionBoundaryIndex.h"
+#include "common/ConstantIndex.h"
+#include "common/DebugInfo.h"
+#include "common/EditJournal.h"
+#include "common/RunScriptTask.h"
 #include "core/Cutter.h"
 #include "Decompiler.h"
 #include "r_asm.h"
@@ -462,6 +469,13 @@ QString CutterCore::cmdRaw(const char *cmd)
     return res;
 }
 
+QString CutterCore::cmdEdit(const QString &cmd, RVA address)
+{
+    QString res = address == RVA_INVALID ? cmdRaw(cmd) : cmdRawAt(cmd, address);
+    EditJournal::instance()->recordCommand(cmd, address);
+    return res;
+}
+
 QJsonDocument CutterCore::cmdj(const char *str)
 {
     char *res;
@@ -492,6 +506,47 @@ QJsonDocument CutterCore::cmdjTask(const QString &str)
     return parseJson(task.getResultRaw(), str);
 }
 
+bool CutterCore::cmdjStream(const char *str, const std::function<void(JsonReader &)> &handler)
+{
+    char *res;
+    {
+        CORE_LOCK();
+        res = r_core_cmd_str(core, str);
+    }
+
+    bool ok = parseJsonStream(res, str, handler);
+    r_mem_free(res);
+
+    return ok;
+}
+
+bool CutterCore::cmdjTaskStream(const QString &str, const std::function<void(JsonReader &)> &handler)
+{
+    R2Task task(str);
+    task.startTask();
+    task.joinTask();
+    return parseJsonStream(task.getResultRaw(), str.toUtf8().constData(), handler);
+}
+
+static void printJsonError(const char *res, const char *cmd, const QString &error)
+{
+    if (cmd) {
+        eprintf("Failed to parse JSON for command \"%s\": %s\n", cmd,
+                error.toLocal8Bit().constData());
+    } else {
+        eprintf("Failed to parse JSON: %s\n", error.toLocal8Bit().constData());
+    }
+    QByteArray json(res);
+    const int MAX_JSON_DUMP_SIZE = 8 * 1024;
+    if (json.length() > MAX_JSON_DUMP_SIZE) {
+        int originalSize = json.length();
+        json.resize(MAX_JSON_DUMP_SIZE);
+        eprintf("%d bytes total: %s ...\n", originalSize, json.constData());
+    } else {
+        eprintf("%s\n", json.constData());
+    }
+}
+
 QJsonDocument CutterCore::parseJson(const char *res, const char *cmd)
 {
     QByteArray json(res);
@@ -504,25 +559,29 @@ QJsonDocument CutterCore::parseJson(const char *res, const char *cmd)
     QJsonDocument doc = QJsonDocument::fromJson(json, &jsonError);
 
     if (jsonError.error != QJsonParseError::NoError) {
-        if (cmd) {
-            eprintf("Failed to parse JSON for command \"%s\": %s\n", cmd,
-                    jsonError.errorString().toLocal8Bit().constData());
-        } else {
-            eprintf("Failed to parse JSON: %s\n", jsonError.errorString().toLocal8Bit().constData());
-        }
-        const int MAX_JSON_DUMP_SIZE = 8 * 1024;
-        if (json.length() > MAX_JSON_DUMP_SIZE) {
-            int originalSize = json.length();
-            json.resize(MAX_JSON_DUMP_SIZE);
-            eprintf("%d bytes total: %s ...\n", originalSize, json.constData());
-        } else {
-            eprintf("%s\n", json.constData());
-        }
+        printJsonError(res, cmd, jsonError.errorString());
     }
 
     return doc;
 }
 
+bool CutterCore::parseJsonStream(const char *res, const char *cmd,
+                                 const std::function<void(JsonReader &)> &handler)
+{
+    if (!res || !*res) {
+        return false;
+    }
+
+    JsonReader reader(res);
+    handler(reader);
+
+    if (reader.hasError()) {
+        printJsonError(res, cmd, reader.errorString());
+        return false;
+    }
+    return true;
+}
+
 QStringList CutterCore::autocomplete(const QString &cmd, RLinePromptType promptType, size_t limit)
 {
     RLineBuffer buf;
@@ -650,31 +709,31 @@ bool CutterCore::mapFile(QString path, RVA mapaddr)
 
 void CutterCore::renameFunction(const QString &oldName, const QString &newName)
 {
-    cmdRaw("afn " + newName + " " + oldName);
+    cmdEdit("afn " + newName + " " + oldName);
     emit functionRenamed(oldName, newName);
 }
 
 void CutterCore::delFunction(RVA addr)
 {
-    cmdRaw("af- " + RAddressString(addr));
+    cmdEdit("af- " + RAddressString(addr));
     emit functionsChanged();
 }
 
 void CutterCore::renameFlag(QString old_name, QString new_name)
 {
-    cmdRaw("fr " + old_name + " " + new_name);
+    cmdEdit("fr " + old_name + " " + new_name);
     emit flagsChanged();
 }
 
 void CutterCore::delFlag(RVA addr)
 {
-    cmdRawAt("f-", addr);
+    cmdEdit("f-", addr);
     emit flagsChanged();
 }
 
 void CutterCore::delFlag(const QString &name)
 {
-    cmdRaw("f-" + name);
+    cmdEdit("f-" + name);
     emit flagsChanged();
 }
 
@@ -688,27 +747,43 @@ QString CutterCore::getInstructionOpcode(RVA addr)
     return cmdj("aoj @ " + RAddressString(addr)).array().first().toObject()[RJsonKey::opcode].toString();
 }
 
+void CutterCore::writeCode(const QString &cmd, RVA address, int maxBytes)
+{
+    QByteArray before = ioRead(address, maxBytes);
+    cmdRawAt(cmd, address);
+    QByteArray after = ioRead(address, maxBytes);
+    int end = after.size();
+    while (end > 0 && end <= before.size() && before[end - 1] == after[end - 1]) {
+        end--;
+    }
+    if (end > 0) {
+        EditJournal::instance()->recordCommand("wx " + QString::fromLatin1(after.left(end).toHex()),
+                                               address);
+    }
+}
+
 void CutterCore::editInstruction(RVA addr, const QString &inst)
 {
-    cmdRawAt(QString("wa %1").arg(inst), addr);
+    // At most 16 bytes per instruction, they are separated by ';'
+    writeCode(QString("wa %1").arg(inst), addr, 16 * (inst.count(QLatin1Char(';')) + 1));
     emit instructionChanged(addr);
 }
 
 void CutterCore::nopInstruction(RVA addr)
 {
-    cmdRawAt("wao nop", addr);
+    writeCode("wao nop", addr, 16);
     emit instructionChanged(addr);
 }
 
 void CutterCore::jmpReverse(RVA addr)
 {
-    cmdRawAt("wao recj", addr);
+    writeCode("wao recj", addr, 16);
     emit instructionChanged(addr);
 }
 
 void CutterCore::editBytes(RVA addr, const QString &bytes)
 {
-    cmdRawAt(QString("wx %1").arg(bytes), addr);
+    cmdEdit(QString("wx %1").arg(bytes), addr);
     emit instructionChanged(addr);
 }
 
@@ -720,7 +795,7 @@ void CutterCore::editBytesEndian(RVA addr, const QString &bytes)
 
 void CutterCore::setToCode(RVA addr)
 {
-    cmdRawAt("Cd-", addr);
+    cmdEdit("Cd-", addr);
     emit instructionChanged(addr);
 }
 
@@ -756,13 +831,13 @@ void CutterCore::setAsString(RVA addr, int size, StringTypeFormats type)
 
     seekAndShow(addr);
 
-    cmdRawAt(QString("%1 %2").arg(command).arg(size), addr);
+    cmdEdit(QString("%1 %2").arg(command).arg(size), addr);
     emit instructionChanged(addr);
 }
 
 void CutterCore::removeString(RVA addr)
 {
-    cmdRawAt("Cs-", addr);
+    cmdEdit("Cs-", addr);
     emit instructionChanged(addr);
 }
 
@@ -776,8 +851,8 @@ void CutterCore::setToData(RVA addr, int size, int repeat)
     if (size <= 0 || repeat <= 0) {
         return;
     }
-    cmdRawAt("Cd-", addr);
-    cmdRawAt(QString("Cd %1 %2").arg(size).arg(repeat), addr);
+    cmdEdit("Cd-", addr);
+    cmdEdit(QString("Cd %1 %2").arg(size).arg(repeat), addr);
     emit instructionChanged(addr);
 }
 
@@ -790,13 +865,13 @@ int CutterCore::sizeofDataMeta(RVA addr)
 
 void CutterCore::setComment(RVA addr, const QString &cmt)
 {
-    cmdRawAt(QString("CCu base64:%1").arg(QString(cmt.toLocal8Bit().toBase64())), addr);
+    cmdEdit(QString("CCu base64:%1").arg(QString(cmt.toLocal8Bit().toBase64())), addr);
     emit commentsChanged();
 }
 
 void CutterCore::delComment(RVA addr)
 {
-    cmdRawAt("CC-", addr);
+    cmdEdit("CC-", addr);
     emit commentsChanged();
 }
 
@@ -817,7 +892,7 @@ void CutterCore::setImmediateBase(const QString &r2BaseName, RVA offset)
         offset = getOffset();
     }
 
-    this->cmdRawAt(QString("ahi %1").arg(r2BaseName), offset);
+    cmdEdit(QString("ahi %1").arg(r2BaseName), offset);
     emit instructionChanged(offset);
 }
 
@@ -827,7 +902,7 @@ void CutterCore::setCurrentBits(int bits, RVA offset)
         offset = getOffset();
     }
 
-    this->cmdRawAt(QString("ahb %1").arg(bits), offset);
+    cmdEdit(QString("ahb %1").arg(bits), offset);
     emit instructionChanged(offset);
 }
 
@@ -837,7 +912,7 @@ void CutterCore::applyStructureOffset(const QString &structureOffset, RVA offset
         offset = getOffset();
     }
 
-    this->cmdRawAt("aht " + structureOffset, offset);
+    cmdEdit("aht " + structureOffset, offset);
     emit instructionChanged(offset);
 }
 
@@ -907,14 +982,22 @@ void CutterCore::updateSeek()
 
 RVA CutterCore::prevOpAddr(RVA startAddr, int count)
 {
+    RVA offset;
+    if (InstructionBoundaryIndex::instance()->previous(startAddr, count, &offset)) {
+        return offset;
+    }
     CORE_LOCK();
     bool ok;
-    RVA offset = cmdRawAt(QString("/O %1").arg(count), startAddr).toULongLong(&ok, 16);
+    offset = cmdRawAt(QString("/O %1").arg(count), startAddr).toULongLong(&ok, 16);
     return ok ? offset : startAddr - count;
 }
 
 RVA CutterCore::nextOpAddr(RVA startAddr, int count)
 {
+    RVA offset;
+    if (InstructionBoundaryIndex::instance()->next(startAddr, count, &offset)) {
+        return offset;
+    }
     CORE_LOCK();
 
     QJsonArray array = Core()->cmdj("pdj " + QString::number(count + 1) + "@" + QString::number(
@@ -929,7 +1012,7 @@ RVA CutterCore::nextOpAddr(RVA startAddr, int count)
     }
 
     bool ok;
-    RVA offset = instValue.toObject()[RJsonKey::offset].toVariant().toULongLong(&ok);
+    offset = instValue.toObject()[RJsonKey::offset].toVariant().toULongLong(&ok);
     if (!ok) {
         return startAddr + 1;
     }
@@ -1174,7 +1257,7 @@ void CutterCore::cmdEsil(const char *command)
 
 QString CutterCore::createFunctionAt(RVA addr)
 {
-    QString ret = cmdRaw(QString("af %1").arg(addr));
+    QString ret = cmdEdit(QString("af %1").arg(addr));
     emit functionsChanged();
     return ret;
 }
@@ -1183,7 +1266,7 @@ QString CutterCore::createFunctionAt(RVA addr, QString name)
 {
     static const QRegularExpression regExp("[^a-zA-Z0-9_]");
     name.remove(regExp);
-    QString ret = cmdRawAt(QString("af %1").arg(name), addr);
+    QString ret = cmdEdit(QString("af %1").arg(name), addr);
     emit functionsChanged();
     return ret;
 }
@@ -1533,6 +1616,48 @@ QVector<RegisterRefValueDescription> CutterCore::getRegisterRefValues()
     return result;
 }
 
+RegisterArena CutterCore::getRegisterArena()
+{
+    RegisterArena result;
+    if (!currentlyDebugging) {
+        return result;
+    }
+
+    CORE_LOCK();
+    RReg *reg = core->dbg->reg;
+    if (!reg) {
+        return result;
+    }
+    r_debug_reg_sync(core->dbg, R_REG_TYPE_ALL, false);
+
+    result.bigEndian = reg->big_endian;
+    result.arenas.resize(R_REG_TYPE_LAST);
+    for (int type = 0; type < R_REG_TYPE_LAST; type++) {
+        RRegSet *regset = r_reg_regset_get(reg, type);
+        if (!regset || !regset->arena || !regset->arena->bytes) {
+            continue;
+        }
+        result.arenas[type] = QByteArray(reinterpret_cast<const char *>(regset->arena->bytes),
+                                         regset->arena->size);
+    }
+
+    RListIter *it;
+    RRegItem *item;
+    CutterRListForeach(reg->allregs, it, RRegItem, item) {
+        if (!item->name || item->arena < 0 || item->arena >= R_REG_TYPE_LAST) {
+            continue;
+        }
+        RegisterDescription desc;
+        desc.name = item->name;
+        desc.type = item->type;
+        desc.size = item->size;
+        desc.offset = item->offset;
+        desc.arena = item->arena;
+        result.registers.append(desc);
+    }
+    return result;
+}
+
 QString CutterCore::getRegisterName(QString registerRole)
 {
     return cmdRaw("drn " + registerRole).trimmed();
@@ -1552,6 +1677,18 @@ RVA CutterCore::getProgramCounterValue()
     return RVA_INVALID;
 }
 
+RVA CutterCore::getStackPointerValue()
+{
+    bool ok;
+    if (currentlyDebugging) {
+        RVA addr = cmd("dr?`drn SP`").toULongLong(&ok, 16);
+        if (ok) {
+            return addr;
+        }
+    }
+    return RVA_INVALID;
+}
+
 void CutterCore::setRegister(QString regName, QString regValue)
 {
     cmdRaw(QString("dr %1=%2").arg(regName).arg(regValue));
@@ -1837,6 +1974,22 @@ void CutterCore::syncAndSeekProgramCounter()
     emit registersChanged();
 }
 
+void CutterCore::startDebugTask(std::function<bool()> resume)
+{
+    connect(debugTask.data(), &R2Task::finished, this, [this, resume] () {
+        debugTask.clear();
+        if (!currentlyEmulating && debugStopFilter && debugStopFilter() && resume && resume()) {
+            return;
+        }
+        syncAndSeekProgramCounter();
+        emit stackChanged();
+        emit refreshCodeViews();
+        emit debugTaskStateChanged();
+    });
+
+    debugTask->startTask();
+}
+
 void CutterCore::continueDebug()
 {
     if (!currentlyDebugging) {
@@ -1854,15 +2007,10 @@ void CutterCore::continueDebug()
     }
 
     emit debugTaskStateChanged();
-    connect(debugTask.data(), &R2Task::finished, this, [this] () {
-        debugTask.clear();
-        syncAndSeekProgramCounter();
-        emit registersChanged();
-        emit refreshCodeViews();
-        emit debugTaskStateChanged();
+    startDebugTask([this] () {
+        continueDebug();
+        return isDebugTaskInProgress();
     });
-
-    debugTask->startTask();
 }
 
 void CutterCore::continueUntilDebug(QString offset)
@@ -1882,16 +2030,10 @@ void CutterCore::continueUntilDebug(QString offset)
     }
 
     emit debugTaskStateChanged();
-    connect(debugTask.data(), &R2Task::finished, this, [this] () {
-        debugTask.clear();
-        syncAndSeekProgramCounter();
-        emit registersChanged();
-        emit stackChanged();
-        emit refreshCodeViews();
-        emit debugTaskStateChanged();
+    startDebugTask([this, offset] () {
+        continueUntilDebug(offset);
+        return isDebugTaskInProgress();
     });
-
-    debugTask->startTask();
 }
 
 void CutterCore::continueUntilCall()
@@ -1911,13 +2053,10 @@ void CutterCore::continueUntilCall()
     }
 
     emit debugTaskStateChanged();
-    connect(debugTask.data(), &R2Task::finished, this, [this] () {
-        debugTask.clear();
-        syncAndSeekProgramCounter();
-        emit debugTaskStateChanged();
+    startDebugTask([this] () {
+        continueUntilCall();
+        return isDebugTaskInProgress();
     });
-
-    debugTask->startTask();
 }
 
 void CutterCore::continueUntilSyscall()
@@ -1937,13 +2076,10 @@ void CutterCore::continueUntilSyscall()
     }
 
     emit debugTaskStateChanged();
-    connect(debugTask.data(), &R2Task::finished, this, [this] () {
-        debugTask.clear();
-        syncAndSeekProgramCounter();
-        emit debugTaskStateChanged();
+    startDebugTask([this] () {
+        continueUntilSyscall();
+        return isDebugTaskInProgress();
     });
-
-    debugTask->startTask();
 }
 
 void CutterCore::stepDebug()
@@ -1963,13 +2099,8 @@ void CutterCore::stepDebug()
     }
 
     emit debugTaskStateChanged();
-    connect(debugTask.data(), &R2Task::finished, this, [this] () {
-        debugTask.clear();
-        syncAndSeekProgramCounter();
-        emit debugTaskStateChanged();
-    });
-
-    debugTask->startTask();
+    // The stop filter executes the faulting instruction, which completes the step
+    startDebugTask(nullptr);
 }
 
 void CutterCore::stepOverDebug()
@@ -1978,24 +2109,27 @@ void CutterCore::stepOverDebug()
         return;
     }
 
+    RVA next = RVA_INVALID;
     if (currentlyEmulating) {
         if (!asyncCmdEsil("aeso", debugTask)) {
             return;
         }
     } else {
+        next = nextOpAddr(getProgramCounterValue(), 1);
         if (!asyncCmd("dso", debugTask)) {
             return;
         }
     }
 
     emit debugTaskStateChanged();
-    connect(debugTask.data(), &R2Task::finished, this, [this] () {
-        debugTask.clear();
-        syncAndSeekProgramCounter();
-        emit debugTaskStateChanged();
+    startDebugTask([this, next] () {
+        // Stopped within a call, the step is complete once it returns
+        if (next == RVA_INVALID || getProgramCounterValue() == next) {
+            return false;
+        }
+        continueUntilDebug(RAddressString(next));
+        return isDebugTaskInProgress();
     });
-
-    debugTask->startTask();
 }
 
 void CutterCore::stepOutDebug()
@@ -2005,17 +2139,23 @@ void CutterCore::stepOutDebug()
     }
 
     emit debugTaskStateChanged();
+    stepOutOfFrame(getStackPointerValue());
+}
+
+bool CutterCore::stepOutOfFrame(RVA frame)
+{
     if (!asyncCmd("dsf", debugTask)) {
-        return;
+        return false;
     }
-
-    connect(debugTask.data(), &R2Task::finished, this, [this] () {
-        debugTask.clear();
-        syncAndSeekProgramCounter();
-        emit debugTaskStateChanged();
+    startDebugTask([this, frame] () {
+        // A stop within the frame ended dsf early
+        RVA stackPointer = getStackPointerValue();
+        if (frame == RVA_INVALID || stackPointer == RVA_INVALID || stackPointer > frame) {
+            return false;
+        }
+        return stepOutOfFrame(frame);
     });
-
-    debugTask->startTask();
+    return true;
 }
 
 QStringList CutterCore::getDebugPlugins()
@@ -2543,22 +2683,27 @@ QList<ImportDescription> CutterCore::getAllImports()
     CORE_LOCK();
     QList<ImportDescription> ret;
 
-    QJsonArray importsArray = cmdj("iij").array();
-
-    for (const QJsonValue &value : importsArray) {
-        QJsonObject importObject = value.toObject();
-
-        ImportDescription import;
-
-        import.plt = importObject[RJsonKey::plt].toVariant().toULongLong();
-        import.ordinal = importObject[RJsonKey::ordinal].toInt();
-        import.bind = importObject[RJsonKey::bind].toString();
-        import.type = importObject[RJsonKey::type].toString();
-        import.libname = importObject[RJsonKey::libname].toString();
-        import.name = importObject[RJsonKey::name].toString();
-
-        ret << import;
-    }
+    cmdjStream("iij", [&ret](JsonReader &reader) {
+        reader.readArray([&ret](JsonReader &reader) {
+            ImportDescription import {};
+            reader.readObject([&import](const JsonReader::Key &key, JsonReader &reader) {
+                if (key == RJsonKey::plt) {
+                    import.plt = reader.readUInt64();
+                } else if (key == RJsonKey::ordinal) {
+                    import.ordinal = reader.readInt();
+                } else if (key == RJsonKey::bind) {
+                    import.bind = reader.readString();
+                } else if (key == RJsonKey::type) {
+                    import.type = reader.readString();
+                } else if (key == RJsonKey::libname) {
+                    import.libname = reader.readString();
+                } else if (key == RJsonKey::name) {
+                    import.name = reader.readString();
+                }
+            });
+            ret << import;
+        });
+    });
 
     return ret;
 }
@@ -2568,22 +2713,27 @@ QList<ExportDescription> CutterCore::getAllExports()
     CORE_LOCK();
     QList<ExportDescription> ret;
 
-    QJsonArray exportsArray = cmdj("iEj").array();
-
-    for (const QJsonValue &value : exportsArray) {
-        QJsonObject exportObject = value.toObject();
-
-        ExportDescription exp;
-
-        exp.vaddr = exportObject[RJsonKey::vaddr].toVariant().toULongLong();
-        exp.paddr = exportObject[RJsonKey::paddr].toVariant().toULongLong();
-        exp.size = exportObject[RJsonKey::size].toVariant().toULongLong();
-        exp.type = exportObject[RJsonKey::type].toString();
-        exp.name = exportObject[RJsonKey::name].toString();
-        exp.flag_name = exportObject[RJsonKey::flagname].toString();
-
-        ret << exp;
-    }
+    cmdjStream("iEj", [&ret](JsonReader &reader) {
+        reader.readArray([&ret](JsonReader &reader) {
+            ExportDescription exp {};
+            reader.readObject([&exp](const JsonReader::Key &key, JsonReader &reader) {
+                if (key == RJsonKey::vaddr) {
+                    exp.vaddr = reader.readUInt64();
+                } else if (key == RJsonKey::paddr) {
+                    exp.paddr = reader.readUInt64();
+                } else if (key == RJsonKey::size) {
+                    exp.size = reader.readUInt64();
+                } else if (key == RJsonKey::type) {
+                    exp.type = reader.readString();
+                } else if (key == RJsonKey::name) {
+                    exp.name = reader.readString();
+                } else if (key == RJsonKey::flagname) {
+                    exp.flag_name = reader.readString();
+                }
+            });
+            ret << exp;
+        });
+    });
 
     return ret;
 }
@@ -2682,20 +2832,24 @@ QList<CommentDescription> CutterCore::getAllComments(const QString &filterType)
     CORE_LOCK();
     QList<CommentDescription> ret;
 
-    QJsonArray commentsArray = cmdj("CCj").array();
-    for (const QJsonValue &value : commentsArray) {
-        QJsonObject commentObject = value.toObject();
-
-        QString type = commentObject[RJsonKey::type].toString();
-        if (type != filterType)
-            continue;
-
-        CommentDescription comment;
-        comment.offset = commentObject[RJsonKey::offset].toVariant().toULongLong();
-        comment.name = commentObject[RJsonKey::name].toString();
-
-        ret << comment;
-    }
+    cmdjStream("CCj", [&ret, &filterType](JsonReader &reader) {
+        reader.readArray([&ret, &filterType](JsonReader &reader) {
+            CommentDescription comment {};
+            QString type;
+            reader.readObject([&comment, &type](const JsonReader::Key &key, JsonReader &reader) {
+                if (key == RJsonKey::type) {
+                    type = reader.readString();
+                } else if (key == RJsonKey::offset) {
+                    comment.offset = reader.readUInt64();
+                } else if (key == RJsonKey::name) {
+                    comment.name = reader.readString();
+                }
+            });
+            if (type == filterType) {
+                ret << comment;
+            }
+        });
+    });
     return ret;
 }
 
@@ -2729,7 +2883,31 @@ QList<RelocDescription> CutterCore::getAllRelocs()
 
 QList<StringDescription> CutterCore::getAllStrings()
 {
-    return parseStringsJson(cmdjTask("izzj"));
+    QList<StringDescription> ret;
+
+    cmdjTaskStream("izzj", [&ret](JsonReader &reader) {
+        reader.readArray([&ret](JsonReader &reader) {
+            StringDescription string {};
+            reader.readObject([&string](const JsonReader::Key &key, JsonReader &reader) {
+                if (key == RJsonKey::string) {
+                    string.string = reader.readString();
+                } else if (key == RJsonKey::vaddr) {
+                    string.vaddr = reader.readUInt64();
+                } else if (key == RJsonKey::type) {
+                    string.type = reader.readString();
+                } else if (key == RJsonKey::size) {
+                    string.size = static_cast<ut32>(reader.readUInt64());
+                } else if (key == RJsonKey::length) {
+                    string.length = static_cast<ut32>(reader.readUInt64());
+                } else if (key == RJsonKey::section) {
+                    string.section = reader.readString();
+                }
+            });
+            ret << string;
+        });
+    });
+
+    return ret;
 }
 
 QList<StringDescription> CutterCore::parseStringsJson(const QJsonDocument &doc)
@@ -2783,19 +2961,23 @@ QList<FlagDescription> CutterCore::getAllFlags(QString flagspace)
     else
         cmdRaw("fs *");
 
-    QJsonArray flagsArray = cmdj("fj").array();
-    for (const QJsonValue &value : flagsArray) {
-        QJsonObject flagObject = value.toObject();
-
-        FlagDescription flag;
-
-        flag.offset = flagObject[RJsonKey::offset].toVariant().toULongLong();
-        flag.size = flagObject[RJsonKey::size].toVariant().toULongLong();
-        flag.name = flagObject[RJsonKey::name].toString();
-        flag.realname = flagObject[RJsonKey::realname].toString();
-
-        ret << flag;
-    }
+    cmdjStream("fj", [&ret](JsonReader &reader) {
+        reader.readArray([&ret](JsonReader &reader) {
+            FlagDescription flag {};
+            reader.readObject([&flag](const JsonReader::Key &key, JsonReader &reader) {
+                if (key == RJsonKey::offset) {
+                    flag.offset = reader.readUInt64();
+                } else if (key == RJsonKey::size) {
+                    flag.size = reader.readUInt64();
+                } else if (key == RJsonKey::name) {
+                    flag.name = reader.readString();
+                } else if (key == RJsonKey::realname) {
+                    flag.realname = reader.readString();
+                }
+            });
+            ret << flag;
+        });
+    });
     return ret;
 }
 
@@ -2804,28 +2986,36 @@ QList<SectionDescription> CutterCore::getAllSections()
     CORE_LOCK();
     QList<SectionDescription> sections;
 
-    QJsonDocument sectionsDoc = cmdj("iSj entropy");
-    QJsonObject sectionsObj = sectionsDoc.object();
-    QJsonArray sectionsArray = sectionsObj[RJsonKey::sections].toArray();
-
-    for (const QJsonValue &value : sectionsArray) {
-        QJsonObject sectionObject = value.toObject();
-
-        QString name = sectionObject[RJsonKey::name].toString();
-        if (name.isEmpty())
-            continue;
-
-        SectionDescription section;
-        section.name = name;
-        section.vaddr = sectionObject[RJsonKey::vaddr].toVariant().toULongLong();
-        section.vsize = sectionObject[RJsonKey::vsize].toVariant().toULongLong();
-        section.paddr = sectionObject[RJsonKey::paddr].toVariant().toULongLong();
-        section.size = sectionObject[RJsonKey::size].toVariant().toULongLong();
-        section.perm = sectionObject[RJsonKey::perm].toString();
-        section.entropy =  sectionObject[RJsonKey::entropy].toString();
-
-        sections << section;
-    }
+    cmdjStream("iSj entropy", [&sections](JsonReader &reader) {
+        reader.readObject([&sections](const JsonReader::Key &key, JsonReader &reader) {
+            if (key != RJsonKey::sections) {
+                return;
+            }
+            reader.readArray([&sections](JsonReader &reader) {
+                SectionDescription section {};
+                reader.readObject([&section](const JsonReader::Key &key, JsonReader &reader) {
+                    if (key == RJsonKey::name) {
+                        section.name = reader.readString();
+                    } else if (key == RJsonKey::vaddr) {
+                        section.vaddr = reader.readUInt64();
+                    } else if (key == RJsonKey::vsize) {
+                        section.vsize = reader.readUInt64();
+                    } else if (key == RJsonKey::paddr) {
+                        section.paddr = reader.readUInt64();
+                    } else if (key == RJsonKey::size) {
+                        section.size = reader.readUInt64();
+                    } else if (key == RJsonKey::perm) {
+                        section.perm = reader.readString();
+                    } else if (key == RJsonKey::entropy) {
+                        section.entropy = reader.readString();
+                    }
+                });
+                if (!section.name.isEmpty()) {
+                    sections << section;
+                }
+            });
+        });
+    });
     return sections;
 }
 
@@ -2846,25 +3036,29 @@ QList<SegmentDescription> CutterCore::getAllSegments()
     CORE_LOCK();
     QList<SegmentDescription> ret;
 
-    QJsonArray segments = cmdj("iSSj").array();
-
-    for (const QJsonValue &value : segments) {
-        QJsonObject segmentObject = value.toObject();
-
-        QString name = segmentObject[RJsonKey::name].toString();
-        if (name.isEmpty())
-            continue;
-
-        SegmentDescription segment;
-        segment.name = name;
-        segment.vaddr = segmentObject[RJsonKey::vaddr].toVariant().toULongLong();
-        segment.paddr = segmentObject[RJsonKey::paddr].toVariant().toULongLong();
-        segment.size = segmentObject[RJsonKey::size].toVariant().toULongLong();
-        segment.vsize = segmentObject[RJsonKey::vsize].toVariant().toULongLong();
-        segment.perm =  segmentObject[RJsonKey::perm].toString();
-
-        ret << segment;
-    }
+    cmdjStream("iSSj", [&ret](JsonReader &reader) {
+        reader.readArray([&ret](JsonReader &reader) {
+            SegmentDescription segment {};
+            reader.readObject([&segment](const JsonReader::Key &key, JsonReader &reader) {
+                if (key == RJsonKey::name) {
+                    segment.name = reader.readString();
+                } else if (key == RJsonKey::vaddr) {
+                    segment.vaddr = reader.readUInt64();
+                } else if (key == RJsonKey::paddr) {
+                    segment.paddr = reader.readUInt64();
+                } else if (key == RJsonKey::size) {
+                    segment.size = reader.readUInt64();
+                } else if (key == RJsonKey::vsize) {
+                    segment.vsize = reader.readUInt64();
+                } else if (key == RJsonKey::perm) {
+                    segment.perm = reader.readString();
+                }
+            });
+            if (!segment.name.isEmpty()) {
+                ret << segment;
+            }
+        });
+    });
     return ret;
 }
 
@@ -3092,18 +3286,21 @@ void CutterCore::createNewClass(const QString &cls)
 {
     CORE_LOCK();
     r_anal_class_create(core->anal, cls.toUtf8().constData());
+    EditJournal::instance()->recordCommand("ac " + cls);
 }
 
 void CutterCore::renameClass(const QString &oldName, const QString &newName)
 {
     CORE_LOCK();
     r_anal_class_rename(core->anal, oldName.toUtf8().constData(), newName.toUtf8().constData());
+    EditJournal::instance()->recordCommand(QString("acn %1 %2").arg(oldName).arg(newName));
 }
 
 void CutterCore::deleteClass(const QString &cls)
 {
     CORE_LOCK();
     r_anal_class_delete(core->anal, cls.toUtf8().constData());
+    EditJournal::instance()->recordCommand("ac- " + cls);
 }
 
 bool CutterCore::getAnalMethod(const QString &cls, const QString &meth, AnalMethodDescription *desc)
@@ -3129,12 +3326,17 @@ void CutterCore::setAnalMethod(const QString &className, const AnalMethodDescrip
     analMeth.vtable_offset = meth.vtableOffset;
     r_anal_class_method_set(core->anal, className.toUtf8().constData(), &analMeth);
     r_anal_class_method_fini(&analMeth);
+    EditJournal::instance()->recordCommand(QString("acm %1 %2 %3 %4").arg(className)
+                                           .arg(meth.name).arg(RAddressString(meth.addr))
+                                           .arg(meth.vtableOffset));
 }
 
 void CutterCore::renameAnalMethod(const QString &className, const QString &oldMethodName, const QString &newMethodName)
 {
     CORE_LOCK();
     r_anal_class_method_rename(core->anal, className.toUtf8().constData(), oldMethodName.toUtf8().constData(), newMethodName.toUtf8().constData());
+    EditJournal::instance()->recordCommand(QString("acmn %1 %2 %3").arg(className)
+                                           .arg(oldMethodName).arg(newMethodName));
 }
 
 QList<ResourcesDescription> CutterCore::getAllResources()
@@ -3350,6 +3552,36 @@ bool CutterCore::isAddressMapped(RVA addr)
     return !Core()->cmdRawAt(QString("om."), addr).isEmpty();
 }
 
+QList<RVA> CutterCore::getConstantUses(RVA value, bool comparedOnly)
+{
+    if (!ConstantIndex::isIndexed(value)) {
+        return {};
+    }
+    ConstantIndex *index = ConstantIndex::instance();
+    if (QThread::currentThread() != index->thread()) {
+        // Scripts hold the GIL while waiting, which cancelling them needs on the GUI thread
+        RunScriptTask *script = RunScriptTask::current();
+        auto isCancelled = [script]() {
+            return script && script->isInterrupted();
+        };
+        if (!index->waitUntilReady(-1, isCancelled) && isCancelled()) {
+            return {};
+        }
+    } else if (!index->isReady()) {
+        index->build();
+    }
+    QList<RVA> result;
+    for (const ConstantUse &use : index->find(value, comparedOnly ? ConstantUse::Compare : 0xff)) {
+        result.append(use.address);
+    }
+    return result;
+}
+
+bool CutterCore::isConstantIndexReady()
+{
+    return ConstantIndex::instance()->isReady();
+}
+
 QList<SearchDescription> CutterCore::getAllSearch(QString search_for, QString space)
 {
     CORE_LOCK();
@@ -3447,50 +3679,54 @@ QList<XrefDescription> CutterCore::getXRefs(RVA addr, bool to, bool whole_functi
 {
     QList<XrefDescription> xrefList = QList<XrefDescription>();
 
-    QJsonArray xrefsArray;
-
-    if (to) {
-        xrefsArray = cmdj("axtj@" + QString::number(addr)).array();
-    } else {
-        xrefsArray = cmdj("axfj@" + QString::number(addr)).array();
-    }
-
-    for (const QJsonValue &value : xrefsArray) {
-        QJsonObject xrefObject = value.toObject();
-
-        XrefDescription xref;
-
-        xref.type = xrefObject[RJsonKey::type].toString();
+    // Most references share few targets, "fd" is only run once for each of them
+    QHash<RVA, QString> targetNames;
+    QString command = (to ? "axtj@" : "axfj@") + QString::number(addr);
+    cmdjStream(command, [&](JsonReader &reader) {
+        reader.readArray([&](JsonReader &reader) {
+            XrefDescription xref {};
+            QString fcn;
+            RVA fcnAddr = 0;
+            bool hasTo = false;
+            reader.readObject([&](const JsonReader::Key &key, JsonReader &reader) {
+                if (key == RJsonKey::type) {
+                    xref.type = reader.readString();
+                } else if (key == RJsonKey::from) {
+                    xref.from = reader.readUInt64();
+                } else if (key == RJsonKey::to) {
+                    xref.to = reader.readUInt64();
+                    hasTo = true;
+                } else if (key == RJsonKey::fcn_name) {
+                    fcn = reader.readString();
+                } else if (key == RJsonKey::fcn_addr) {
+                    fcnAddr = reader.readUInt64();
+                }
+            });
 
-        if (!filterType.isNull() && filterType != xref.type)
-            continue;
+            if (!filterType.isNull() && filterType != xref.type) {
+                return;
+            }
+            if (!whole_function && !to && xref.from != addr) {
+                return;
+            }
 
-        xref.from = xrefObject[RJsonKey::from].toVariant().toULongLong();
-        if (!to) {
-            xref.from_str = RAddressString(xref.from);
-        } else {
-            QString fcn = xrefObject[RJsonKey::fcn_name].toString();
-            if (!fcn.isEmpty()) {
-                RVA fcnAddr = xrefObject[RJsonKey::fcn_addr].toVariant().toULongLong();
+            if (to && !fcn.isEmpty()) {
                 xref.from_str = fcn + " + 0x" + QString::number(xref.from - fcnAddr, 16);
             } else {
                 xref.from_str = RAddressString(xref.from);
             }
-        }
-
-        if (!whole_function && !to && xref.from != addr) {
-            continue;
-        }
-
-        if (to && !xrefObject.contains(RJsonKey::to)) {
-            xref.to = addr;
-        } else {
-            xref.to = xrefObject[RJsonKey::to].toVariant().toULongLong();
-        }
-        xref.to_str = Core()->cmdRaw(QString("fd %1").arg(xref.to)).trimmed();
+            if (to && !hasTo) {
+                xref.to = addr;
+            }
+            auto name = targetNames.constFind(xref.to);
+            if (name == targetNames.constEnd()) {
+                name = targetNames.insert(xref.to, Core()->cmdRaw(QString("fd %1").arg(xref.to)).trimmed());
+            }
+            xref.to_str = name.value();
 
-        xrefList << xref;
-    }
+            xrefList << xref;
+        });
+    });
 
     return xrefList;
 }
@@ -3498,7 +3734,7 @@ QList<XrefDescription> CutterCore::getXRefs(RVA addr, bool to, bool whole_functi
 void CutterCore::addFlag(RVA offset, QString name, RVA size)
 {
     name = sanitizeStringForCommand(name);
-    cmdRawAt(QString("f %1 %2").arg(name).arg(size), offset);
+    cmdEdit(QString("f %1 %2").arg(name).arg(size), offset);
     emit flagsChanged();
 }
 
@@ -3586,7 +3822,9 @@ void CutterCore::triggerFunctionRenamed(const QString &prevName, const QString &
 
 void CutterCore::loadPDB(const QString &file)
 {
-    cmdRaw("idp " + sanitizeStringForCommand(file));
+    // DebugInfo starts its task from the GUI thread
+    QMetaObject::invokeMethod(DebugInfo::instance(), "load", Qt::QueuedConnection,
+                              Q_ARG(QString, file));
 }
 
 void CutterCore::openProject(const QString &name)
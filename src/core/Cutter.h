@@ -16,8 +16,11 @@
 #include <QMutex>
 #include <QDir>
 
+#include <functional>
+
 class AsyncTaskManager;
 class BasicInstructionHighlighter;
+class JsonReader;
 class CutterCore;
 class Decompiler;
 class R2Task;
@@ -105,6 +108,14 @@ public:
      * @brief a wrapper around cmdRawAt(const char *cmd, RVA address).
      */
     QString cmdRawAt(const QString &str, RVA address) { return cmdRawAt(str.toUtf8().constData(), address); }
+
+    /**
+     * @brief Execute a raw command editing the analysis or the binary, like cmdRawAt(), and
+     * record it in the EditJournal so that the edit can be recovered after a crash.
+     * @param address - an address to which Cutter will temporarily seek, RVA_INVALID for
+     * commands which do not depend on the offset
+     */
+    QString cmdEdit(const QString &cmd, RVA address = RVA_INVALID);
     
     QJsonDocument cmdj(const char *str);
     QJsonDocument cmdj(const QString &str) { return cmdj(str.toUtf8().constData()); }
@@ -112,6 +123,19 @@ public:
     QStringList cmdList(const QString &str) { return cmdList(str.toUtf8().constData()); }
     QString cmdTask(const QString &str);
     QJsonDocument cmdjTask(const QString &str);
+    /**
+     * @brief Execute a JSON command and walk its output with a JsonReader instead of
+     * building a QJsonDocument. Prefer this for commands with large outputs.
+     * @param handler called once with a reader positioned at the start of the output,
+     *        not called if the output is empty
+     * @return false if the output was empty or malformed
+     */
+    bool cmdjStream(const char *str, const std::function<void(JsonReader &)> &handler);
+    bool cmdjStream(const QString &str, const std::function<void(JsonReader &)> &handler)
+    {
+        return cmdjStream(str.toUtf8().constData(), handler);
+    }
+    bool cmdjTaskStream(const QString &str, const std::function<void(JsonReader &)> &handler);
     /**
      * @brief send a command to radare2 and check for ESIL errors
      * @param command the command you want to execute
@@ -139,6 +163,9 @@ public:
         return parseJson(res, cmd.isNull() ? nullptr : cmd.toLocal8Bit().constData());
     }
 
+    bool parseJsonStream(const char *res, const char *cmd,
+                         const std::function<void(JsonReader &)> &handler);
+
     QStringList autocomplete(const QString &cmd, RLinePromptType promptType, size_t limit = 4096);
 
     /* Functions methods */
@@ -331,6 +358,7 @@ public:
     QJsonDocument getRegisterValues();
     QString getRegisterName(QString registerRole);
     RVA getProgramCounterValue();
+    RVA getStackPointerValue();
     void setRegister(QString regName, QString regValue);
     void setCurrentDebugThread(int tid);
     /**
@@ -417,6 +445,12 @@ public:
     QStringList getDebugPlugins();
     void setDebugPlugin(QString plugin);
     bool isDebugTaskInProgress();
+    /**
+     * @brief Set a function called whenever a continue or step stops, returning true resumes
+     * the command right away. It handles stops that are internal to a debugger feature, like
+     * memory watch faults.
+     */
+    void setDebugStopFilter(std::function<bool()> filter) { debugStopFilter = filter; }
     /**
      * @brief Check if we can use output/input redirection with the currently debugged process
      */
@@ -453,6 +487,9 @@ public:
     QList<QString> regs;
     void setSettings();
 
+    /**
+     * @brief Load a PDB file in the background, see DebugInfo. May be called from any thread.
+     */
     void loadPDB(const QString &file);
 
     QByteArray ioRead(RVA addr, int len);
@@ -554,6 +591,16 @@ public:
 
     QList<MemoryMapDescription> getMemoryMap();
     QList<SearchDescription> getAllSearch(QString search_for, QString space);
+    /**
+     * @brief Addresses of the analyzed instructions using value as an immediate or displacement.
+     * Answers from the constant index, which is built in the background on the first call.
+     * Called from another thread, e.g. by a script, it waits until the index is ready. On the
+     * GUI thread the result may be incomplete until isConstantIndexReady(). 0 and -1 are not
+     * indexed, see ConstantIndex::isIndexed().
+     * @param comparedOnly only return instructions comparing or testing value
+     */
+    QList<RVA> getConstantUses(RVA value, bool comparedOnly = false);
+    bool isConstantIndexReady();
     BlockStatistics getBlockStatistics(unsigned int blocksCount);
     QList<BreakpointDescription> getBreakpoints();
     QList<ProcessDescription> getAllProcesses();
@@ -563,6 +610,11 @@ public:
      */
     QList<QJsonObject> getRegisterRefs(int depth = 6);
     QVector<RegisterRefValueDescription> getRegisterRefValues();
+    /**
+     * @brief Read the register profile and the raw arenas of every register type
+     * with a single register sync. No telescoping or formatting is done.
+     */
+    RegisterArena getRegisterArena();
     QList<VariableDescription> getVariables(RVA at);
 
     QList<XrefDescription> getXRefs(RVA addr, bool to, bool whole_function,
@@ -711,7 +763,22 @@ private:
     BasicInstructionHighlighter biHighlighter;
 
     QSharedPointer<R2Task> debugTask;
+    std::function<bool()> debugStopFilter;
     R2TaskDialog *debugTaskDialog;
+
+    /**
+     * @brief Start debugTask and update the views when it ends.
+     * @param resume called instead if debugStopFilter handled the stop, returns whether it
+     * resumed, nullptr if handling the stop already completed the command
+     */
+    void startDebugTask(std::function<bool()> resume);
+    bool stepOutOfFrame(RVA frame);
+    /**
+     * @brief Run a write command depending on the code at address, like "wa" or "wao", and
+     * journal the bytes it wrote as "wx", so that replaying it writes the same again.
+     * @param maxBytes upper bound of the bytes cmd writes
+     */
+    void writeCode(const QString &cmd, RVA address, int maxBytes);
     
     QVector<QString> getCutterRCFilePaths() const;
 };
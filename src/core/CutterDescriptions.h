@@ -7,6 +7,8 @@
 
 #include <QString>
 #include <QList>
+#include <QVector>
+#include <QByteArray>
 #include <QStringList>
 #include <QMetaType>
 #include <QColor>
@@ -327,6 +329,24 @@ struct RegisterRefValueDescription {
     QString ref;
 };
 
+struct RegisterDescription {
+    QString name;
+    int type;   // R_REG_TYPE_*
+    int size;   // in bits
+    int offset; // in bits, relative to the start of the arena
+    int arena;  // index into RegisterArena::arenas
+};
+
+/**
+ * @brief Snapshot of the register profile together with the raw arena bytes
+ * of the current thread, read in a single pass.
+ */
+struct RegisterArena {
+    QVector<RegisterDescription> registers;
+    QVector<QByteArray> arenas;
+    bool bigEndian = false;
+};
+
 Q_DECLARE_METATYPE(FunctionDescription)
 Q_DECLARE_METATYPE(ImportDescription)
 Q_DECLARE_METATYPE(ExportDescription)
@@ -365,5 +385,6 @@ Q_DECLARE_METATYPE(BreakpointDescription::PositionType)
 Q_DECLARE_METATYPE(ProcessDescription)
 Q_DECLARE_METATYPE(RefDescription)
 Q_DECLARE_METATYPE(VariableDescription)
+Q_DECLARE_METATYPE(RegisterDescription)
 
 #endif // DESCRIPTIONS_H
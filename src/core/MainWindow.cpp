@@ -11,6 +11,11 @@
 #include "common/TempConfig.h"
 #include "common/RunScriptTask.h"
 #include "common/PythonManager.h"
+#include "common/FunctionSimilarity.h"
+#include "common/ConstantIndex.h"
+#include "common/DataClassifier.h"
+#include "common/DebugInfo.h"
+#include "common/EditJournal.h"
 #include "plugins/PluginManager.h"
 #include "CutterConfig.h"
 #include "CutterApplication.h"
@@ -57,9 +62,12 @@
 #include "widgets/VTablesWidget.h"
 #include "widgets/HeadersWidget.h"
 #include "widgets/ZignaturesWidget.h"
+#include "widgets/MemoryUsageWidget.h"
 #include "widgets/DebugActions.h"
 #include "widgets/MemoryMapWidget.h"
 #include "widgets/BreakpointWidget.h"
+#include "widgets/MemoryWatchWidget.h"
+#include "widgets/FlameGraphWidget.h"
 #include "widgets/RegisterRefsWidget.h"
 #include "widgets/DisassemblyWidget.h"
 #include "widgets/StackWidget.h"
@@ -68,6 +76,7 @@
 #include "widgets/RegistersWidget.h"
 #include "widgets/BacktraceWidget.h"
 #include "widgets/HexdumpWidget.h"
+#include "widgets/ByteMapWidget.h"
 #include "widgets/DecompilerWidget.h"
 #include "widgets/HexWidget.h"
 
@@ -144,6 +153,7 @@ void MainWindow::initUI()
     connect(ui->actionExtraGraph, &QAction::triggered, this, &MainWindow::addExtraGraph);
     connect(ui->actionExtraDisassembly, &QAction::triggered, this, &MainWindow::addExtraDisassembly);
     connect(ui->actionExtraHexdump, &QAction::triggered, this, &MainWindow::addExtraHexdump);
+    connect(ui->actionExtraByteMap, &QAction::triggered, this, &MainWindow::addExtraByteMap);
     connect(ui->actionCommitChanges, &QAction::triggered, this, [this]() {
         Core()->commitWriteCache();
     });
@@ -154,6 +164,7 @@ void MainWindow::initUI()
     widgetTypeToConstructorMap.insert(DisassemblyWidget::getWidgetType(),
                                       getNewInstance<DisassemblyWidget>);
     widgetTypeToConstructorMap.insert(HexdumpWidget::getWidgetType(), getNewInstance<HexdumpWidget>);
+    widgetTypeToConstructorMap.insert(ByteMapWidget::getWidgetType(), getNewInstance<ByteMapWidget>);
 
     initToolBar();
     initDocks();
@@ -197,6 +208,10 @@ void MainWindow::initUI()
     connect(core, &CutterCore::showMemoryWidgetRequested,
             this, static_cast<void(MainWindow::*)()>(&MainWindow::showMemoryWidget));
 
+    connect(DebugInfo::instance(), &DebugInfo::loaded, this, [this](const QString &file) {
+        core->message(tr("%1 loaded.").arg(file));
+    });
+
     updateTasksIndicator();
     connect(core->getAsyncTaskManager(), &AsyncTaskManager::tasksChanged, this,
             &MainWindow::updateTasksIndicator);
@@ -346,6 +361,7 @@ void MainWindow::initDocks()
     searchDock = new SearchWidget(this);
     commentsDock = new CommentsWidget(this);
     stringsDock = new StringsWidget(this);
+    memoryUsageDock = new MemoryUsageWidget(this);
 
     QList<CutterDockWidget *> debugDocks = {
         stackDock = new StackWidget(this),
@@ -355,7 +371,9 @@ void MainWindow::initDocks()
         registersDock = new RegistersWidget(this),
         memoryMapDock = new MemoryMapWidget(this),
         breakpointDock = new BreakpointWidget(this),
-        registerRefsDock = new RegisterRefsWidget(this)
+        registerRefsDock = new RegisterRefsWidget(this),
+        memoryWatchDock = new MemoryWatchWidget(this),
+        flameGraphDock = new FlameGraphWidget(this)
     };
 
     QList<CutterDockWidget *> infoDocks = {
@@ -405,6 +423,7 @@ void MainWindow::initDocks()
     QList<CutterDockWidget *> windowDocks2 = {
         consoleDock,
         commentsDock,
+        memoryUsageDock,
         nullptr,
     };
     ui->menuWindows->addActions(makeActionList(windowDocks2));
@@ -447,6 +466,12 @@ void MainWindow::addExtraHexdump()
     addExtraWidget(extraDock);
 }
 
+void MainWindow::addExtraByteMap()
+{
+    auto *extraDock = new ByteMapWidget(this);
+    addExtraWidget(extraDock);
+}
+
 void MainWindow::addExtraDisassembly()
 {
     auto *extraDock = new DisassemblyWidget(this);
@@ -636,6 +661,36 @@ void MainWindow::finalizeOpen()
             }
         }
     }
+
+    if (Config()->getSimilarityAutoIndex()) {
+        AsyncTask::Ptr indexTask(new SimilarityIndexTask());
+        core->getAsyncTaskManager()->start(indexTask);
+    }
+
+    if (Config()->getCryptoConstantTagging()) {
+        ConstantIndex::instance()->build();
+    }
+
+    EditJournal *journal = EditJournal::instance();
+    QString projectName = core->getConfig("prj.name");
+    if (projectName.isEmpty()) {
+        journal->openFile(filename);
+    } else {
+        journal->openProject(projectName);
+    }
+    if (journal->recoverableCount() > 0) {
+        QMessageBox::StandardButton ret = QMessageBox::question(this, APPNAME,
+                                                                tr("Cutter was not closed properly the last time %1 was open.\n"
+                                                                   "Do you want to recover the %2 unsaved edits?")
+                                                                .arg(projectName.isEmpty() ? filename : projectName)
+                                                                .arg(journal->recoverableCount()),
+                                                                (QMessageBox::StandardButtons)(QMessageBox::Yes | QMessageBox::Discard));
+        if (ret == QMessageBox::Yes) {
+            core->message(tr("Recovered %1 edits.").arg(journal->replay()));
+        } else {
+            journal->discard();
+        }
+    }
 }
 
 bool MainWindow::saveProject(bool quit)
@@ -689,6 +744,9 @@ void MainWindow::closeEvent(QCloseEvent *event)
         event->ignore();
         return;
     }
+    if (ret == QMessageBox::Discard) {
+        EditJournal::instance()->discard();
+    }
 
     if (!core->currentlyDebugging) {
         saveSettings();
@@ -823,6 +881,8 @@ void MainWindow::restoreDocks()
     tabifyDockWidget(dashboardDock, memoryMapDock);
     tabifyDockWidget(dashboardDock, breakpointDock);
     tabifyDockWidget(dashboardDock, registerRefsDock);
+    tabifyDockWidget(dashboardDock, memoryWatchDock);
+    tabifyDockWidget(dashboardDock, flameGraphDock);
     for (const auto &it : dockWidgets) {
         // Check whether or not current widgets is graph, hexdump or disasm
         if (isExtraMemoryWidget(it)) {
@@ -834,6 +894,7 @@ void MainWindow::restoreDocks()
     splitDockWidget(consoleDock, sectionsDock, Qt::Horizontal);
     tabifyDockWidget(sectionsDock, segmentsDock);
     tabifyDockWidget(sectionsDock, commentsDock);
+    tabifyDockWidget(sectionsDock, memoryUsageDock);
 
     // Add Stack, Registers, Threads and Backtrace vertically stacked
     splitDockWidget(stackDock, registersDock, Qt::Vertical);
@@ -855,13 +916,16 @@ bool MainWindow::isDebugWidget(QDockWidget *dock) const
            dock == memoryMapDock ||
            dock == breakpointDock ||
            dock == processesDock ||
-           dock == registerRefsDock;
+           dock == registerRefsDock ||
+           dock == memoryWatchDock ||
+           dock == flameGraphDock;
 }
 
 bool MainWindow::isExtraMemoryWidget(QDockWidget *dock) const
 {
     return qobject_cast<GraphWidget*>(dock) ||
             qobject_cast<HexdumpWidget*>(dock) ||
+            qobject_cast<ByteMapWidget*>(dock) ||
             qobject_cast<DisassemblyWidget*>(dock);
 }
 
@@ -945,6 +1009,7 @@ QMenu *MainWindow::createShowInMenu(QWidget *parent, RVA address)
     createAddNewWidgetAction(tr("New disassembly"), MemoryWidgetType::Disassembly);
     createAddNewWidgetAction(tr("New graph"), MemoryWidgetType::Graph);
     createAddNewWidgetAction(tr("New hexdump"), MemoryWidgetType::Hexdump);
+    createAddNewWidgetAction(tr("New byte map"), MemoryWidgetType::ByteMap);
 
     return menu;
 }
@@ -979,6 +1044,9 @@ MemoryDockWidget *MainWindow::addNewMemoryWidget(MemoryWidgetType type, RVA addr
     case MemoryWidgetType::Decompiler:
         memoryWidget = new DecompilerWidget(this);
         break;
+    case MemoryWidgetType::ByteMap:
+        memoryWidget = new ByteMapWidget(this);
+        break;
     }
     auto seekable = memoryWidget->getSeekable();
     seekable->setSynchronization(synchronized);
@@ -1584,9 +1652,25 @@ void MainWindow::on_actionImportPDB_triggered()
 
     if (!pdbFile.isEmpty()) {
         core->loadPDB(pdbFile);
-        core->message(tr("%1 loaded.").arg(pdbFile));
-        this->refreshAll();
+        core->message(tr("Loading %1 in the background...").arg(pdbFile));
+    }
+}
+
+void MainWindow::on_actionDetectDataTypes_triggered()
+{
+    if (dataClassifierTask) {
+        return;
     }
+    dataClassifierTask = QSharedPointer<DataClassifierTask>(new DataClassifierTask());
+    connect(dataClassifierTask.data(), &AsyncTask::finished, this, [this]() {
+        if (!dataClassifierTask->isInterrupted()) {
+            const QList<DataRegion> &regions = dataClassifierTask->getRegions();
+            DataClassifierTask::apply(regions);
+            core->message(tr("%n data regions detected.", nullptr, regions.size()));
+        }
+        dataClassifierTask.clear();
+    });
+    core->getAsyncTaskManager()->start(dataClassifierTask);
 }
 
 void MainWindow::on_actionExport_as_code_triggered()
@@ -1669,6 +1753,12 @@ void MainWindow::projectSaved(bool successfully, const QString &name)
         core->message(tr("Project saved: %1").arg(name));
     else
         core->message(tr("Failed to save project: %1").arg(name));
+
+    if (successfully && Config()->getSimilarityAutoIndex()) {
+        // Functions renamed since the last time are names to take in other binaries
+        AsyncTask::Ptr indexTask(new SimilarityIndexTask());
+        core->getAsyncTaskManager()->start(indexTask);
+    }
 }
 
 void MainWindow::toggleDebugView()
@@ -38,6 +38,7 @@ class SectionsWidget;
 class SegmentsWidget;
 class ConsoleWidget;
 class EntrypointWidget;
+class DataClassifierTask;
 class DisassemblerGraphView;
 class ClassesWidget;
 class ResourcesWidget;
@@ -45,6 +46,7 @@ class VTablesWidget;
 class TypesWidget;
 class HeadersWidget;
 class ZignaturesWidget;
+class MemoryUsageWidget;
 class SearchWidget;
 class QDockWidget;
 class DisassemblyWidget;
@@ -162,6 +164,7 @@ private slots:
     void on_actionIssue_triggered();
     void addExtraGraph();
     void addExtraHexdump();
+    void addExtraByteMap();
     void addExtraDisassembly();
 
     void on_actionRefresh_Panels_triggered();
@@ -195,6 +198,7 @@ private slots:
     void on_actionAnalyze_triggered();
 
     void on_actionImportPDB_triggered();
+    void on_actionDetectDataTypes_triggered();
 
     void on_actionExport_as_code_triggered();
 
@@ -231,6 +235,7 @@ private:
     ProgressIndicator *tasksProgressIndicator;
     QByteArray emptyState;
     IOModesController ioModesController;
+    QSharedPointer<DataClassifierTask> dataClassifierTask;
 
     Configuration *configuration;
 
@@ -256,6 +261,7 @@ private:
     SectionsWidget     *sectionsDock = nullptr;
     SegmentsWidget     *segmentsDock = nullptr;
     ZignaturesWidget   *zignaturesDock = nullptr;
+    MemoryUsageWidget  *memoryUsageDock = nullptr;
     ConsoleWidget      *consoleDock = nullptr;
     ClassesWidget      *classesDock = nullptr;
     ResourcesWidget    *resourcesDock = nullptr;
@@ -269,6 +275,8 @@ private:
     NewFileDialog      *newFileDialog = nullptr;
     CutterDockWidget        *breakpointDock = nullptr;
     CutterDockWidget        *registerRefsDock = nullptr;
+    CutterDockWidget        *memoryWatchDock = nullptr;
+    CutterDockWidget        *flameGraphDock = nullptr;
 
     QMenu *disassemblyContextMenuExtensions = nullptr;
     QMenu *addressableContextMenuExtensions = nullptr;
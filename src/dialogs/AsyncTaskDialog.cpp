@@ -18,6 +18,7 @@ AsyncTaskDialog::AsyncTaskDialog(AsyncTask::Ptr task, QWidget *parent)
     }
 
     connect(task.data(), &AsyncTask::logChanged, this, &AsyncTaskDialog::updateLog);
+    connect(task.data(), &AsyncTask::progressChanged, this, &AsyncTaskDialog::updateProgress);
     connect(task.data(), &AsyncTask::finished, this, [this]() {
         close();
     });
@@ -41,6 +42,13 @@ void AsyncTaskDialog::updateLog(const QString &log)
     ui->logTextEdit->setPlainText(log);
 }
 
+void AsyncTaskDialog::updateProgress(int value, int maximum)
+{
+    ui->progressBar->setMaximum(qMax(maximum, 0));
+    ui->progressBar->setValue(qBound(0, value, qMax(maximum, 0)));
+    ui->progressBar->setTextVisible(maximum > 0);
+}
+
 void AsyncTaskDialog::updateProgressTimer()
 {
     int secondsElapsed = (task->getElapsedTime() + 500) / 1000;
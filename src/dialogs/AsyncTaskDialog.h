@@ -29,6 +29,7 @@ public slots:
 
 private slots:
     void updateLog(const QString &log);
+    void updateProgress(int value, int maximum);
     void updateProgressTimer();
 
 protected:
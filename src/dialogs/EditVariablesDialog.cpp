@@ -9,7 +9,8 @@
 
 EditVariablesDialog::EditVariablesDialog(RVA offset, QString initialVar, QWidget *parent) :
     QDialog(parent),
-    ui(new Ui::EditVariablesDialog)
+    ui(new Ui::EditVariablesDialog),
+    functionAddr(offset)
 {
     ui->setupUi(this);
     connect(ui->buttonBox, SIGNAL(accepted()), this, SLOT(applyFields()));
@@ -55,14 +56,15 @@ void EditVariablesDialog::applyFields()
     }
     VariableDescription desc = ui->dropdownLocalVars->currentData().value<VariableDescription>();
 
-    Core()->cmdRaw(QString("afvt %1 %2").arg(desc.name).arg(ui->typeComboBox->currentText()));
+    Core()->cmdEdit(QString("afvt %1 %2").arg(desc.name).arg(ui->typeComboBox->currentText()),
+                    functionAddr);
 
     // TODO Remove all those replace once r2 command parser is fixed
     QString newName = ui->nameEdit->text().replace(QLatin1Char(' '), QLatin1Char('_'))
             .replace(QLatin1Char('\\'), QLatin1Char('_'))
             .replace(QLatin1Char('/'), QLatin1Char('_'));
     if (newName != desc.name) {
-        Core()->cmdRaw(QString("afvn %1 %2").arg(newName).arg(desc.name));
+        Core()->cmdEdit(QString("afvn %1 %2").arg(newName).arg(desc.name), functionAddr);
     }
 
     // Refresh the views to reflect the changes to vars
@@ -23,6 +23,7 @@ private slots:
 
 private:
     Ui::EditVariablesDialog *ui;
+    RVA functionAddr;
     QList<VariableDescription> variables;
 
     void populateTypesComboBox();
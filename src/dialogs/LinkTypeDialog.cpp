@@ -59,10 +59,10 @@ void LinkTypeDialog::done(int r)
             QString type = ui->structureTypeComboBox->currentText();
             if (type == tr("(No Type)")) {
                 // Delete link
-                Core()->cmdRaw("tl- " + address);
+                Core()->cmdEdit("tl- " + address);
             } else {
                 // Create link
-                Core()->cmdRaw(QString("tl %1 = %2").arg(type).arg(address));
+                Core()->cmdEdit(QString("tl %1 = %2").arg(type).arg(address));
             }
             QDialog::done(r);
 
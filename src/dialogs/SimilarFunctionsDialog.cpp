@@ -0,0 +1,142 @@
+#include "SimilarFunctionsDialog.h"
+
+#include "common/Helpers.h"
+
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+static const int SINGLE_FUNCTION_RESULTS = 20;
+static const double MIN_SIMILARITY = 0.5;
+static const double AUTO_CHECK_SIMILARITY = 0.9;
+static const int SourceNameRole = Qt::UserRole;
+
+SimilarFunctionsDialog::SimilarFunctionsDialog(const QList<FunctionDescription> &functions,
+                                               QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle(tr("Similar Functions"));
+    resize(720, 420);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    statusLabel = new QLabel(this);
+    layout->addWidget(statusLabel);
+
+    matchesTree = new QTreeWidget(this);
+    matchesTree->setColumnCount(ColumnCount);
+    matchesTree->setHeaderLabels({ tr("Function"), tr("Match"), tr("Binary"), tr("Similarity") });
+    matchesTree->setRootIsDecorated(false);
+    matchesTree->setUniformRowHeights(true);
+    matchesTree->header()->setSectionResizeMode(MatchColumn, QHeaderView::Stretch);
+    layout->addWidget(matchesTree);
+
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Cancel, this);
+    QPushButton *renameButton = buttonBox->addButton(tr("Rename Checked"), QDialogButtonBox::AcceptRole);
+    renameButton->setDefault(true);
+    connect(buttonBox, &QDialogButtonBox::accepted, this, &SimilarFunctionsDialog::applyRenames);
+    connect(buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout->addWidget(buttonBox);
+
+    connect(matchesTree, &QTreeWidget::itemChanged, this, &SimilarFunctionsDialog::onItemChanged);
+
+    statusLabel->setText(tr("Searching for similar functions..."));
+    bool single = functions.size() == 1;
+    task = QSharedPointer<SimilarFunctionsTask>(new SimilarFunctionsTask(functions,
+                                                single ? SINGLE_FUNCTION_RESULTS : 4,
+                                                MIN_SIMILARITY));
+    connect(task.data(), &AsyncTask::finished, this, [this]() {
+        if (!task->isInterrupted()) {
+            showMatches();
+        }
+    });
+    Core()->getAsyncTaskManager()->start(task);
+}
+
+SimilarFunctionsDialog::~SimilarFunctionsDialog()
+{
+    task->interrupt();
+}
+
+void SimilarFunctionsDialog::showMatches()
+{
+    bool single = task->getResults().size() == 1;
+    int matchedFunctions = 0;
+    for (const SimilarFunctionsTask::Result &result : task->getResults()) {
+        const FunctionDescription &function = result.function;
+        bool added = false;
+        for (const SimilarFunctionMatch &match : result.matches) {
+            if (match.name == function.name) {
+                continue;
+            }
+            // Unnamed matches give no name to take, but still tell where the code appeared
+            bool named = !FunctionSimilarity::isAutoName(match.name);
+            if (!named && !single) {
+                continue;
+            }
+            QTreeWidgetItem *item = new QTreeWidgetItem();
+            item->setText(FunctionColumn, function.name);
+            item->setData(FunctionColumn, SourceNameRole, function.name);
+            item->setText(MatchColumn, named ? match.name
+                                             : tr("Unnamed at %1").arg(RAddressString(match.offset)));
+            item->setText(BinaryColumn, match.binary);
+            item->setText(SimilarityColumn, QString("%1%").arg(qRound(match.similarity * 100)));
+            if (named) {
+                item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+                bool check = !single && match.similarity >= AUTO_CHECK_SIMILARITY;
+                item->setCheckState(FunctionColumn, check ? Qt::Checked : Qt::Unchecked);
+            }
+            matchesTree->addTopLevelItem(item);
+            added = true;
+            if (!single) {
+                break;
+            }
+        }
+        if (added) {
+            matchedFunctions++;
+        }
+    }
+
+    if (task->getIndexedFunctionCount() == 0) {
+        statusLabel->setText(tr("The similarity index is empty. Functions are indexed after the "
+                                "analysis of each binary and whenever the project is saved."));
+    } else {
+        statusLabel->setText(tr("%1 of %2 functions matched among %3 indexed functions in %4 ms.")
+                             .arg(matchedFunctions)
+                             .arg(task->getResults().size())
+                             .arg(task->getIndexedFunctionCount())
+                             .arg(task->getElapsedTime()));
+    }
+    qhelpers::adjustColumns(matchesTree, 0);
+}
+
+void SimilarFunctionsDialog::onItemChanged(QTreeWidgetItem *item, int column)
+{
+    if (column != FunctionColumn || item->checkState(FunctionColumn) != Qt::Checked) {
+        return;
+    }
+    // A function can only take one name, uncheck the other matches of the same function
+    QString sourceName = item->data(FunctionColumn, SourceNameRole).toString();
+    for (int i = 0; i < matchesTree->topLevelItemCount(); i++) {
+        QTreeWidgetItem *other = matchesTree->topLevelItem(i);
+        if (other != item && other->checkState(FunctionColumn) == Qt::Checked
+                && other->data(FunctionColumn, SourceNameRole).toString() == sourceName) {
+            other->setCheckState(FunctionColumn, Qt::Unchecked);
+        }
+    }
+}
+
+void SimilarFunctionsDialog::applyRenames()
+{
+    for (int i = 0; i < matchesTree->topLevelItemCount(); i++) {
+        QTreeWidgetItem *item = matchesTree->topLevelItem(i);
+        if (item->checkState(FunctionColumn) != Qt::Checked) {
+            continue;
+        }
+        Core()->renameFunction(item->data(FunctionColumn, SourceNameRole).toString(),
+                               item->text(MatchColumn));
+    }
+    accept();
+}
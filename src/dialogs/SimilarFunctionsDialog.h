@@ -0,0 +1,44 @@
+#ifndef SIMILARFUNCTIONSDIALOG_H
+#define SIMILARFUNCTIONSDIALOG_H
+
+#include "core/Cutter.h"
+#include "common/FunctionSimilarity.h"
+
+#include <QDialog>
+
+class QLabel;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+/**
+ * @brief Show functions from FunctionSimilarityIndex that are similar to the given ones
+ * and rename the given functions after the checked matches.
+ *
+ * With a single function all good matches are listed, with several functions only the
+ * best match of each is listed and matches above a high similarity are checked already.
+ * The matches are looked up in the background, see SimilarFunctionsTask.
+ */
+class SimilarFunctionsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit SimilarFunctionsDialog(const QList<FunctionDescription> &functions,
+                                    QWidget *parent = nullptr);
+    ~SimilarFunctionsDialog() override;
+
+private slots:
+    void applyRenames();
+
+private:
+    enum Column { FunctionColumn = 0, MatchColumn, BinaryColumn, SimilarityColumn, ColumnCount };
+
+    QTreeWidget *matchesTree;
+    QLabel *statusLabel;
+    QSharedPointer<SimilarFunctionsTask> task;
+
+    void showMatches();
+    void onItemChanged(QTreeWidgetItem *item, int column);
+};
+
+#endif // SIMILARFUNCTIONSDIALOG_H
@@ -3,6 +3,7 @@
 
 #include "core/Cutter.h"
 #include "common/Configuration.h"
+#include "common/EditJournal.h"
 #include "common/SyntaxHighlighter.h"
 #include "widgets/TypesWidget.h"
 
@@ -56,8 +57,10 @@ void TypesInteractionDialog::on_plainTextEdit_textChanged()
 void TypesInteractionDialog::done(int r)
 {
     if (r == QDialog::Accepted) {
-        QString error = Core()->addTypes(ui->plainTextEdit->toPlainText());
+        QString types = ui->plainTextEdit->toPlainText();
+        QString error = Core()->addTypes(types);
         if (error.isEmpty()) {
+            EditJournal::instance()->recordTypes(types);
             emit newTypesLoaded();
             QDialog::done(r);
             return;
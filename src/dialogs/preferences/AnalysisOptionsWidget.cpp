@@ -0,0 +1,44 @@
+#include "AnalysisOptionsWidget.h"
+#include "ui_AnalysisOptionsWidget.h"
+
+#include "PreferencesDialog.h"
+
+#include "common/ConstantIndex.h"
+#include "common/Helpers.h"
+#include "common/Configuration.h"
+
+AnalysisOptionsWidget::AnalysisOptionsWidget(PreferencesDialog *dialog)
+    : QDialog(dialog),
+      ui(new Ui::AnalysisOptionsWidget)
+{
+    ui->setupUi(this);
+    qhelpers::setCheckedWithoutSignals(ui->similarityAutoIndexCheckBox,
+                                       Config()->getSimilarityAutoIndex());
+    qhelpers::setCheckedWithoutSignals(ui->cryptoConstantTaggingCheckBox,
+                                       Config()->getCryptoConstantTagging());
+    qhelpers::setCheckedWithoutSignals(ui->runPythonScriptsInCutterCheckBox,
+                                       Config()->getRunPythonScriptsInCutter());
+#ifndef CUTTER_ENABLE_PYTHON
+    ui->runPythonScriptsInCutterCheckBox->setVisible(false);
+#endif
+}
+
+AnalysisOptionsWidget::~AnalysisOptionsWidget() {}
+
+void AnalysisOptionsWidget::on_similarityAutoIndexCheckBox_toggled(bool checked)
+{
+    Config()->setSimilarityAutoIndex(checked);
+}
+
+void AnalysisOptionsWidget::on_cryptoConstantTaggingCheckBox_toggled(bool checked)
+{
+    Config()->setCryptoConstantTagging(checked);
+    if (!Core()->getConfig("file.path").isEmpty()) {
+        ConstantIndex::instance()->updateCryptoTags();
+    }
+}
+
+void AnalysisOptionsWidget::on_runPythonScriptsInCutterCheckBox_toggled(bool checked)
+{
+    Config()->setRunPythonScriptsInCutter(checked);
+}
@@ -0,0 +1,32 @@
+#ifndef ANALYSISOPTIONSWIDGET_H
+#define ANALYSISOPTIONSWIDGET_H
+
+#include <QDialog>
+#include <memory>
+
+#include "core/Cutter.h"
+
+class PreferencesDialog;
+
+namespace Ui {
+class AnalysisOptionsWidget;
+}
+
+class AnalysisOptionsWidget : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit AnalysisOptionsWidget(PreferencesDialog *dialog);
+    ~AnalysisOptionsWidget();
+
+private:
+    std::unique_ptr<Ui::AnalysisOptionsWidget> ui;
+
+private slots:
+    void on_similarityAutoIndexCheckBox_toggled(bool checked);
+    void on_cryptoConstantTaggingCheckBox_toggled(bool checked);
+    void on_runPythonScriptsInCutterCheckBox_toggled(bool checked);
+};
+
+#endif // ANALYSISOPTIONSWIDGET_H
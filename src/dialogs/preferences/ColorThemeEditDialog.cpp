@@ -3,6 +3,7 @@
 
 #include "common/ColorThemeWorker.h"
 #include "common/Configuration.h"
+#include "common/CodePalette.h"
 
 #include "widgets/ColorThemeListView.h"
 #include "widgets/DisassemblyWidget.h"
@@ -38,8 +39,9 @@ ColorThemeEditDialog::ColorThemeEditDialog(QWidget *parent) :
     ui->colorPickerAndPreviewLayout->addWidget(previewDisasmWidget);
 
 
+    // Code views recolor on the palette change, including the preview
     connect(ui->colorThemeListView, &ColorThemeListView::blink,
-            previewDisasmWidget, &DisassemblyWidget::colorsUpdatedSlot);
+            CodePalette::instance(), &CodePalette::updateColors);
 
     connect(ui->colorThemeListView, &ColorThemeListView::itemChanged,
             this, [this](const QColor& color) {
@@ -136,7 +138,7 @@ void ColorThemeEditDialog::colorOptionChanged(const QColor& newColor)
     if (!ColorThemeWorker::cutterSpecificOptions.contains(currOption.optionName)) {
         Core()->cmdRaw(QString("ec %1 %2").arg(currOption.optionName).arg(currOption.color.name()));
     }
-    previewDisasmWidget->colorsUpdatedSlot();
+    CodePalette::instance()->updateColors();
 }
 
 void ColorThemeEditDialog::editThemeChanged(const QString& newTheme)
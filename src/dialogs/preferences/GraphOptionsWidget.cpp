@@ -33,6 +33,9 @@ void GraphOptionsWidget::updateOptionsFromVars()
     ui->maxColsSpinBox->blockSignals(true);
     ui->maxColsSpinBox->setValue(Config()->getGraphBlockMaxChars());
     ui->maxColsSpinBox->blockSignals(false);
+    ui->collapseBlocksSpinBox->blockSignals(true);
+    ui->collapseBlocksSpinBox->setValue(Config()->getGraphCollapseBlockCount());
+    ui->collapseBlocksSpinBox->blockSignals(false);
 }
 
 
@@ -49,6 +52,12 @@ void GraphOptionsWidget::on_maxColsSpinBox_valueChanged(int value)
     triggerOptionsChanged();
 }
 
+void GraphOptionsWidget::on_collapseBlocksSpinBox_valueChanged(int value)
+{
+    Config()->setGraphCollapseBlockCount(value);
+    triggerOptionsChanged();
+}
+
 void GraphOptionsWidget::on_graphOffsetCheckBox_toggled(bool checked)
 {
     Config()->setConfig("graph.offset", checked);
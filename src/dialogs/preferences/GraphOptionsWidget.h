@@ -30,6 +30,7 @@ private slots:
     void updateOptionsFromVars();
 
     void on_maxColsSpinBox_valueChanged(int value);
+    void on_collapseBlocksSpinBox_valueChanged(int value);
     void on_graphOffsetCheckBox_toggled(bool checked);
 
     void checkTransparentStateChanged(int checked);
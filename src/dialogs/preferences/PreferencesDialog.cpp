@@ -5,6 +5,7 @@
 #include "AsmOptionsWidget.h"
 #include "GraphOptionsWidget.h"
 #include "DebugOptionsWidget.h"
+#include "AnalysisOptionsWidget.h"
 #include "PluginsOptionsWidget.h"
 #include "InitializationFileEditor.h"
 
@@ -43,6 +44,11 @@ PreferencesDialog::PreferencesDialog(QWidget *parent)
             new DebugOptionsWidget(this),
             QIcon(":/img/icons/bug.svg")
         },
+        {
+            tr("Analysis"),
+            new AnalysisOptionsWidget(this),
+            QIcon(":/img/icons/cog.svg")
+        },
         {
             tr("Appearance"),
             new AppearanceOptionsWidget(this),
@@ -12,6 +12,7 @@
 #include "dialogs/EditStringDialog.h"
 #include "dialogs/BreakpointsDialog.h"
 #include "MainWindow.h"
+#include "common/DebugInfo.h"
 
 #include <QtCore>
 #include <QShortcut>
@@ -20,6 +21,16 @@
 #include <QApplication>
 #include <QPushButton>
 
+namespace {
+
+/**
+ * Structures of debug information offered for one displacement at most, a small offset is
+ * shared by most of them.
+ */
+const int MAX_PENDING_STRUCT_OFFSETS = 32;
+
+}
+
 DisassemblyContextMenu::DisassemblyContextMenu(QWidget *parent, MainWindow *mainWindow)
     :   QMenu(parent),
         offset(0),
@@ -451,6 +462,11 @@ void DisassemblyContextMenu::aboutToShowSlot()
             }
             structureOffsetMenu->addAction("[" + memBaseReg + " + " + val + "]")->setData(val);
         }
+        // Structures of debug information are only added to r2 once picked
+        for (const QString &val : DebugInfo::instance()->pendingMembersAt(memDisp.toLongLong(),
+                                                                          MAX_PENDING_STRUCT_OFFSETS)) {
+            structureOffsetMenu->addAction("[" + memBaseReg + " + " + val + "]")->setData(val);
+        }
         if (structureOffsetMenu->isEmpty()) {
             // No possible offset was found so hide the menu
             structureOffsetMenu->menuAction()->setVisible(false);
@@ -842,7 +858,7 @@ void DisassemblyContextMenu::on_actionRenameUsedHere_triggered()
     if (dialog.exec()) {
         QString newName = dialog.getName().trimmed();
         if (!newName.isEmpty()) {
-            Core()->cmdRawAt(QString("an %1").arg(newName), offset);
+            Core()->cmdEdit(QString("an %1").arg(newName), offset);
 
             if (type == ThingUsedHere::Type::Address || type == ThingUsedHere::Type::Flag) {
                 Core()->triggerFlagsChanged();
@@ -963,6 +979,8 @@ void DisassemblyContextMenu::on_actionSetToDataEx_triggered()
 
 void DisassemblyContextMenu::on_actionStructureOffsetMenu_triggered(QAction *action)
 {
+    QString type = action->data().toString().section('.', 0, 0);
+    DebugInfo::instance()->materializeType(type);
     Core()->applyStructureOffset(action->data().toString(), offset);
 }
 
@@ -1020,7 +1038,7 @@ void DisassemblyContextMenu::on_actionEditFunction_triggered()
             fcn->addr = Core()->math(new_start_addr);
             QString new_stack_size = dialog.getStackSizeText();
             fcn->stack = int(Core()->math(new_stack_size));
-            Core()->cmdRaw("afc " + dialog.getCallConSelected());
+            Core()->cmdEdit("afc " + dialog.getCallConSelected(), fcn->addr);
             emit Core()->functionsChanged();
         }
     }
@@ -1,4 +1,12 @@
 import json
+import os
+import pickle
+import selectors
+import signal
+import struct
+import traceback
+
+import _cutter
 from _cutter import *
 
 try:
@@ -15,3 +23,136 @@ def cmdj(command):
     return json.loads(cmd(command))
 
 
+# Frame header of the parallel_map() result channel: item index, status, payload length
+_FRAME = struct.Struct('<IBI')
+_STATUS_OK = 0
+_STATUS_ERROR = 1
+
+
+def _run_worker(fn, items, indices, fd):
+    with os.fdopen(fd, 'wb', buffering=1 << 16) as channel:
+        for index in indices:
+            try:
+                payload = pickle.dumps(fn(items[index]), pickle.HIGHEST_PROTOCOL)
+                status = _STATUS_OK
+            except Exception:
+                payload = traceback.format_exc().encode('utf-8')
+                status = _STATUS_ERROR
+            channel.write(_FRAME.pack(index, status, len(payload)))
+            channel.write(payload)
+
+
+def _map_sequential(fn, items):
+    results = []
+    for item in items:
+        results.append(fn(item))
+        progress(len(results), len(items))
+        check_cancel()
+    return results
+
+
+def parallel_map(fn, functions=None, workers=None, batch_size=64):
+    """Apply fn to every item of functions in forked worker processes.
+
+    Each worker runs on a private copy of the current session, so cmd() and cmdj()
+    can be used inside fn, but changes made by fn are not visible in Cutter.
+    Results must be picklable and are returned in the order of functions.
+    functions defaults to the output of aflj. Where fork() is not available
+    the items are processed sequentially instead."""
+    if functions is None:
+        functions = cmdj('aflj') or []
+    functions = list(functions)
+    if not functions:
+        return []
+    batch_count = (len(functions) + batch_size - 1) // batch_size
+    workers = max(1, min(workers or os.cpu_count() or 1, batch_count))
+    if not hasattr(os, 'fork') or workers == 1:
+        return _map_sequential(fn, functions)
+
+    # Batches are dealt out round robin so that every worker gets a mix of the address space
+    batches = [range(start, min(start + batch_size, len(functions)))
+               for start in range(0, len(functions), batch_size)]
+    assignments = [[index for batch in batches[worker::workers] for index in batch]
+                   for worker in range(workers)]
+
+    children = []
+    _cutter._fork_prepare()
+    try:
+        for assignment in assignments:
+            read_fd, write_fd = os.pipe()
+            pid = os.fork()
+            if pid == 0:
+                code = 0
+                try:
+                    os.close(read_fd)
+                    for _, fd in children:
+                        os.close(fd)
+                    _cutter._fork_child()
+                    _run_worker(fn, functions, assignment, write_fd)
+                except BaseException:
+                    code = 1
+                finally:
+                    os._exit(code)
+            os.close(write_fd)
+            children.append((pid, read_fd))
+    except BaseException:
+        for pid, fd in children:
+            os.close(fd)
+            os.kill(pid, signal.SIGKILL)
+            os.waitpid(pid, 0)
+        raise
+    finally:
+        _cutter._fork_parent()
+
+    results = [None] * len(functions)
+    done = 0
+    error = None
+    buffers = {fd: bytearray() for _, fd in children}
+    selector = selectors.DefaultSelector()
+    for fd in buffers:
+        selector.register(fd, selectors.EVENT_READ)
+    try:
+        while buffers and error is None:
+            for key, _ in selector.select(timeout=0.1):
+                chunk = os.read(key.fd, 1 << 16)
+                if not chunk:
+                    selector.unregister(key.fd)
+                    os.close(key.fd)
+                    del buffers[key.fd]
+                    continue
+                buf = buffers[key.fd]
+                buf += chunk
+                offset = 0
+                while len(buf) - offset >= _FRAME.size:
+                    index, status, length = _FRAME.unpack_from(buf, offset)
+                    end = offset + _FRAME.size + length
+                    if len(buf) < end:
+                        break
+                    payload = bytes(buf[offset + _FRAME.size:end])
+                    if status == _STATUS_OK:
+                        results[index] = pickle.loads(payload)
+                    elif error is None:
+                        error = payload.decode('utf-8', 'replace')
+                    offset = end
+                    done += 1
+                del buf[:offset]
+            progress(done, len(functions))
+            check_cancel()
+        if error is not None:
+            raise RuntimeError('parallel_map() worker failed:\n' + error)
+        if done != len(functions):
+            raise RuntimeError('parallel_map() worker exited unexpectedly')
+    except BaseException:
+        for pid, _ in children:
+            try:
+                os.kill(pid, signal.SIGKILL)
+            except OSError:
+                pass
+        raise
+    finally:
+        selector.close()
+        for fd in buffers:
+            os.close(fd)
+        for pid, _ in children:
+            os.waitpid(pid, 0)
+    return results
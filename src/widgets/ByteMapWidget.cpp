@@ -0,0 +1,472 @@
+#include "ByteMapWidget.h"
+
+#include "common/Configuration.h"
+#include "common/CutterSeekable.h"
+#include "core/MainWindow.h"
+
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QHelpEvent>
+#include <QLabel>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QSignalBlocker>
+#include <QToolTip>
+#include <QVBoxLayout>
+#include <QWheelEvent>
+
+#include <climits>
+
+namespace {
+
+/**
+ * Tile cache size in KiB, the cost unit of the cache.
+ */
+const int TILE_CACHE_KIB = 64 * 1024;
+/**
+ * Tiles rendered by one task, later ones are requested again once it finished.
+ */
+const int MAX_TILES_PER_TASK = 16;
+const int DEFAULT_ZOOM_LEVEL = 4;
+
+}
+
+ByteMapView::ByteMapView(QWidget *parent)
+    : QAbstractScrollArea(parent),
+      renderer(ByteMapLayout(), ByteMapColoring::ByteClass, DEFAULT_ZOOM_LEVEL),
+      tiles(TILE_CACHE_KIB),
+      account(QStringLiteral("Byte map tiles"), [this](size_t) {
+          tiles.clear();
+          updateAccount();
+      })
+{
+    setMouseTracking(true);
+    viewport()->setMouseTracking(true);
+    verticalScrollBar()->setSingleStep(16);
+}
+
+ByteMapView::~ByteMapView()
+{
+    if (task) {
+        task->interrupt();
+    }
+}
+
+void ByteMapView::setMapLayout(const ByteMapLayout &layout)
+{
+    if (task) {
+        task->interrupt();
+        task.clear();
+    }
+    renderer = ByteMapRenderer(layout, renderer.getColoring(), renderer.getZoomLevel());
+    clearTiles();
+    updateScrollBars();
+}
+
+void ByteMapView::setColoring(ByteMapColoring coloring)
+{
+    if (coloring == renderer.getColoring()) {
+        return;
+    }
+    renderer = renderer.withView(coloring, renderer.getZoomLevel());
+    viewport()->update();
+}
+
+void ByteMapView::setZoomLevel(int zoomLevel)
+{
+    setZoomLevel(zoomLevel, viewport()->rect().center());
+}
+
+void ByteMapView::setZoomLevel(int zoomLevel, const QPoint &anchor)
+{
+    zoomLevel = qBound(0, zoomLevel, ByteMapRenderer::MaxZoomLevel);
+    if (zoomLevel == renderer.getZoomLevel()) {
+        return;
+    }
+    RVA anchorAddress = addressAt(anchor);
+    if (anchorAddress == RVA_INVALID) {
+        anchorAddress = cursorAddress;
+    }
+    renderer = renderer.withView(renderer.getColoring(), zoomLevel);
+    updateScrollBars();
+    scrollToAddress(anchorAddress, anchor.y());
+    viewport()->update();
+    emit zoomLevelChanged(zoomLevel);
+}
+
+void ByteMapView::setCursorAddress(RVA address, bool scrollTo)
+{
+    cursorAddress = address;
+    if (scrollTo) {
+        RVA position = renderer.getLayout().positionOf(address);
+        if (position != RVA_INVALID) {
+            const int scale = pixelScale();
+            const qint64 row = static_cast<qint64>(position / renderer.bytesPerPixel() / ByteMapRenderer::TileSize);
+            const qint64 firstRow = verticalScrollBar()->value();
+            const qint64 visibleRows = viewport()->height() / scale;
+            if (row < firstRow || row >= firstRow + visibleRows) {
+                scrollToAddress(address, viewport()->height() / 2);
+            }
+        }
+    }
+    viewport()->update();
+}
+
+void ByteMapView::scrollToAddress(RVA address, int viewportY)
+{
+    RVA position = renderer.getLayout().positionOf(address);
+    if (position == RVA_INVALID) {
+        return;
+    }
+    const qint64 row = static_cast<qint64>(position / renderer.bytesPerPixel() / ByteMapRenderer::TileSize);
+    const qint64 value = row - viewportY / pixelScale();
+    verticalScrollBar()->setValue(static_cast<int>(qBound<qint64>(0, value, INT_MAX)));
+}
+
+void ByteMapView::clearTiles()
+{
+    tiles.clear();
+    updateAccount();
+    viewport()->update();
+}
+
+int ByteMapView::pixelScale() const
+{
+    return qMax(1, viewport()->width() / ByteMapRenderer::TileSize);
+}
+
+quint64 ByteMapView::rowCount() const
+{
+    const RVA pixels = (renderer.getLayout().getTotalSize() + renderer.bytesPerPixel() - 1)
+                       / renderer.bytesPerPixel();
+    return (pixels + ByteMapRenderer::TileSize - 1) / ByteMapRenderer::TileSize;
+}
+
+quint64 ByteMapView::tileCount() const
+{
+    return (rowCount() + ByteMapRenderer::TileSize - 1) / ByteMapRenderer::TileSize;
+}
+
+RVA ByteMapView::addressAt(const QPoint &point) const
+{
+    const int scale = pixelScale();
+    const int x = point.x() + horizontalScrollBar()->value();
+    if (x < 0 || point.y() < 0 || x >= ByteMapRenderer::TileSize * scale) {
+        return RVA_INVALID;
+    }
+    const quint64 row = quint64(verticalScrollBar()->value()) + quint64(point.y() / scale);
+    const quint64 pixel = row * ByteMapRenderer::TileSize + quint64(x / scale);
+    return renderer.getLayout().addressAt(pixel * renderer.bytesPerPixel());
+}
+
+void ByteMapView::updateScrollBars()
+{
+    const int scale = pixelScale();
+    const int visibleRows = viewport()->height() / scale;
+    const quint64 rows = rowCount();
+    const qint64 maximum = static_cast<qint64>(qMin<quint64>(rows, INT_MAX)) - visibleRows;
+    verticalScrollBar()->setRange(0, static_cast<int>(qMax<qint64>(0, maximum)));
+    verticalScrollBar()->setPageStep(qMax(1, visibleRows));
+    horizontalScrollBar()->setRange(0, qMax(0, ByteMapRenderer::TileSize * scale - viewport()->width()));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+}
+
+void ByteMapView::paintEvent(QPaintEvent *)
+{
+    QPainter p(viewport());
+    p.fillRect(viewport()->rect(), Config()->getColor("gui.background"));
+    if (renderer.getLayout().isEmpty()) {
+        return;
+    }
+
+    const int scale = pixelScale();
+    const int tileExtent = ByteMapRenderer::TileSize * scale;
+    const int xOffset = -horizontalScrollBar()->value();
+    const qint64 firstRow = verticalScrollBar()->value();
+    const qint64 lastRow = firstRow + viewport()->height() / scale;
+    const quint64 tileTotal = tileCount();
+    const quint64 firstTile = static_cast<quint64>(firstRow) / ByteMapRenderer::TileSize;
+    const quint64 lastTile = qMin<quint64>(static_cast<quint64>(lastRow) / ByteMapRenderer::TileSize,
+                                           tileTotal ? tileTotal - 1 : 0);
+
+    QList<quint64> missing;
+    for (quint64 tile = firstTile; tile <= lastTile && tile < tileTotal; tile++) {
+        const qint64 y = (static_cast<qint64>(tile) * ByteMapRenderer::TileSize - firstRow) * scale;
+        const QRect target(xOffset, static_cast<int>(y), tileExtent, tileExtent);
+        const quint64 key = ByteMapRenderer::tileKey(renderer.getColoring(),
+                                                     renderer.getZoomLevel(), tile);
+        if (QImage *image = tiles.object(key)) {
+            p.drawImage(target, *image);
+        } else {
+            missing.append(tile);
+        }
+    }
+    if (!missing.isEmpty()) {
+        // Prefetch the tiles just outside of the viewport while scrolling
+        if (firstTile > 0 && !tiles.contains(ByteMapRenderer::tileKey(renderer.getColoring(),
+                                                                      renderer.getZoomLevel(), firstTile - 1))) {
+            missing.append(firstTile - 1);
+        }
+        if (lastTile + 1 < tileTotal && !tiles.contains(ByteMapRenderer::tileKey(renderer.getColoring(),
+                                                                                 renderer.getZoomLevel(), lastTile + 1))) {
+            missing.append(lastTile + 1);
+        }
+        requestTiles(missing);
+    } else {
+        account.touch();
+    }
+
+    RVA position = renderer.getLayout().positionOf(cursorAddress);
+    if (position != RVA_INVALID) {
+        const quint64 pixel = position / renderer.bytesPerPixel();
+        const qint64 row = static_cast<qint64>(pixel / ByteMapRenderer::TileSize) - firstRow;
+        const int column = static_cast<int>(pixel % ByteMapRenderer::TileSize);
+        if (row >= 0 && row <= lastRow - firstRow) {
+            const int y = static_cast<int>(row * scale);
+            const int x = xOffset + column * scale;
+            QColor cursorColor = Config()->getColor("gui.navbar.seek");
+            p.setPen(cursorColor);
+            // Marks at the sides of the row stay visible when a pixel is hard to make out
+            p.drawLine(xOffset - 6, y, xOffset - 2, y);
+            p.drawLine(xOffset + tileExtent + 1, y, xOffset + tileExtent + 5, y);
+            p.setBrush(Qt::NoBrush);
+            p.drawRect(x - 1, y - 1, scale + 1, scale + 1);
+        }
+    }
+}
+
+void ByteMapView::requestTiles(const QList<quint64> &missing)
+{
+    if (task) {
+        // Requested again when the running task finished
+        return;
+    }
+    task = QSharedPointer<ByteMapTileTask>(new ByteMapTileTask(renderer,
+                                                               missing.mid(0, MAX_TILES_PER_TASK)));
+    connect(task.data(), &ByteMapTileTask::tileRendered, this, &ByteMapView::onTileRendered);
+    connect(task.data(), &AsyncTask::finished, this, &ByteMapView::onTaskFinished);
+    Core()->getAsyncTaskManager()->start(task);
+}
+
+void ByteMapView::onTileRendered(quint64 key, QImage image)
+{
+    if (sender() != task.data()) {
+        return;
+    }
+    tiles.insert(key, new QImage(image), qMax(1, image.bytesPerLine() * image.height() / 1024));
+    updateAccount();
+    viewport()->update();
+}
+
+void ByteMapView::onTaskFinished()
+{
+    if (sender() != task.data()) {
+        return;
+    }
+    task.clear();
+    viewport()->update();
+}
+
+void ByteMapView::updateAccount()
+{
+    account.update(static_cast<size_t>(tiles.totalCost()) * 1024, static_cast<size_t>(tiles.count()));
+}
+
+void ByteMapView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void ByteMapView::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() != Qt::LeftButton) {
+        QAbstractScrollArea::mousePressEvent(event);
+        return;
+    }
+    RVA address = addressAt(event->pos());
+    if (address != RVA_INVALID) {
+        emit addressClicked(address);
+    }
+}
+
+void ByteMapView::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!(event->buttons() & Qt::LeftButton)) {
+        return;
+    }
+    RVA address = addressAt(event->pos());
+    if (address != RVA_INVALID && address != cursorAddress) {
+        emit addressClicked(address);
+    }
+}
+
+void ByteMapView::wheelEvent(QWheelEvent *event)
+{
+    if (event->modifiers() & Qt::ControlModifier) {
+        int steps = event->angleDelta().y() / 120;
+        if (steps) {
+            setZoomLevel(renderer.getZoomLevel() - steps, event->pos());
+        }
+        event->accept();
+        return;
+    }
+    QAbstractScrollArea::wheelEvent(event);
+}
+
+bool ByteMapView::viewportEvent(QEvent *event)
+{
+    if (event->type() == QEvent::ToolTip) {
+        auto *helpEvent = static_cast<QHelpEvent *>(event);
+        RVA address = addressAt(helpEvent->pos());
+        if (address == RVA_INVALID) {
+            QToolTip::hideText();
+        } else if (renderer.bytesPerPixel() > 1) {
+            QToolTip::showText(helpEvent->globalPos(),
+                               tr("%1 (%2 bytes)").arg(RAddressString(address))
+                               .arg(renderer.bytesPerPixel()));
+        } else {
+            QToolTip::showText(helpEvent->globalPos(), RAddressString(address));
+        }
+        return true;
+    }
+    return QAbstractScrollArea::viewportEvent(event);
+}
+
+ByteMapWidget::ByteMapWidget(MainWindow *main)
+    : MemoryDockWidget(MemoryWidgetType::ByteMap, main)
+{
+    setObjectName(main
+                  ? main->getUniqueObjectName(getWidgetType())
+                  : getWidgetType());
+
+    auto *container = new QWidget(this);
+    auto *layout = new QVBoxLayout(container);
+    layout->setContentsMargins(0, 0, 0, 0);
+    auto *toolLayout = new QHBoxLayout();
+    toolLayout->setContentsMargins(6, 4, 6, 0);
+
+    coloringComboBox = new QComboBox(container);
+    coloringComboBox->addItem(tr("Byte class"), static_cast<int>(ByteMapColoring::ByteClass));
+    coloringComboBox->addItem(tr("Byte value"), static_cast<int>(ByteMapColoring::ByteValue));
+    coloringComboBox->addItem(tr("Entropy"), static_cast<int>(ByteMapColoring::Entropy));
+    coloringComboBox->addItem(tr("Analysis"), static_cast<int>(ByteMapColoring::AnalysisType));
+
+    zoomComboBox = new QComboBox(container);
+    for (int level = 0; level <= ByteMapRenderer::MaxZoomLevel; level++) {
+        int bytes = 1 << level;
+        zoomComboBox->addItem(bytes >= 1024
+                              ? tr("%1 KiB per pixel").arg(bytes / 1024)
+                              : tr("%1 B per pixel").arg(bytes), level);
+    }
+
+    toolLayout->addWidget(new QLabel(tr("Coloring:"), container));
+    toolLayout->addWidget(coloringComboBox);
+    toolLayout->addWidget(new QLabel(tr("Zoom:"), container));
+    toolLayout->addWidget(zoomComboBox);
+    toolLayout->addStretch();
+    layout->addLayout(toolLayout);
+
+    view = new ByteMapView(container);
+    layout->addWidget(view);
+    setWidget(container);
+    zoomComboBox->setCurrentIndex(zoomComboBox->findData(view->getZoomLevel()));
+
+    setWindowTitle(getWindowTitle());
+
+    refreshDeferrer = createRefreshDeferrer([this]() {
+        refreshLayout();
+    });
+
+    connect(coloringComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+    this, [this](int) {
+        view->setColoring(static_cast<ByteMapColoring>(coloringComboBox->currentData().toInt()));
+    });
+    connect(zoomComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+    this, [this](int) {
+        view->setZoomLevel(zoomComboBox->currentData().toInt());
+    });
+    connect(view, &ByteMapView::zoomLevelChanged, this, [this](int zoomLevel) {
+        QSignalBlocker blocker(zoomComboBox);
+        zoomComboBox->setCurrentIndex(zoomComboBox->findData(zoomLevel));
+    });
+    connect(view, &ByteMapView::addressClicked, this, &ByteMapWidget::onAddressClicked);
+    connect(seekable, &CutterSeekable::seekableSeekChanged, this, &ByteMapWidget::onSeekChanged);
+
+    connect(Core(), &CutterCore::refreshAll, this, &ByteMapWidget::refreshLayout);
+    connect(Core(), &CutterCore::codeRebased, this, &ByteMapWidget::refreshLayout);
+    connect(Core(), &CutterCore::ioModeChanged, this, &ByteMapWidget::refreshLayout);
+    connect(Core(), &CutterCore::instructionChanged, view, &ByteMapView::clearTiles);
+    connect(Core(), &CutterCore::ioCacheChanged, view, &ByteMapView::clearTiles);
+    connect(Core(), &CutterCore::functionsChanged, this, [this]() {
+        if (view->getColoring() == ByteMapColoring::AnalysisType) {
+            refreshLayout();
+        }
+    });
+
+    refreshLayout();
+}
+
+ByteMapWidget::~ByteMapWidget() {}
+
+QString ByteMapWidget::getWidgetType()
+{
+    return "ByteMap";
+}
+
+QString ByteMapWidget::getWindowTitle() const
+{
+    return tr("Byte Map");
+}
+
+QWidget *ByteMapWidget::widgetToFocusOnRaise()
+{
+    return view;
+}
+
+void ByteMapWidget::refreshLayout()
+{
+    if (!refreshDeferrer->attemptRefresh(nullptr)) {
+        return;
+    }
+    // A new layout also starts over with the analysis data of the renderer
+    view->setMapLayout(ByteMapLayout::fromCore());
+    view->setCursorAddress(seekable->getOffset(), true);
+}
+
+void ByteMapWidget::onSeekChanged(RVA addr)
+{
+    if (sentSeek) {
+        return;
+    }
+    view->setCursorAddress(addr, true);
+}
+
+void ByteMapWidget::onAddressClicked(RVA addr)
+{
+    view->setCursorAddress(addr, false);
+    sentSeek = true;
+    seekable->seek(addr);
+    sentSeek = false;
+}
+
+QVariantMap ByteMapWidget::serializeViewProprties()
+{
+    auto result = MemoryDockWidget::serializeViewProprties();
+    result["coloring"] = static_cast<int>(view->getColoring());
+    result["zoomLevel"] = view->getZoomLevel();
+    return result;
+}
+
+void ByteMapWidget::deserializeViewProperties(const QVariantMap &properties)
+{
+    MemoryDockWidget::deserializeViewProperties(properties);
+    int coloring = properties.value("coloring", static_cast<int>(ByteMapColoring::ByteClass)).toInt();
+    int coloringIndex = coloringComboBox->findData(coloring);
+    coloringComboBox->setCurrentIndex(coloringIndex >= 0 ? coloringIndex : 0);
+    int zoomIndex = zoomComboBox->findData(properties.value("zoomLevel", DEFAULT_ZOOM_LEVEL).toInt());
+    if (zoomIndex >= 0) {
+        zoomComboBox->setCurrentIndex(zoomIndex);
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef BYTEMAPWIDGET_H
+#define BYTEMAPWIDGET_H
+
+#include "MemoryDockWidget.h"
+#include "common/ByteMapRenderer.h"
+#include "common/MemoryAccounting.h"
+
+#include <QAbstractScrollArea>
+#include <QCache>
+#include <QSharedPointer>
+
+class QComboBox;
+class RefreshDeferrer;
+
+/**
+ * @brief Scrollable byte map, one pixel per 2^zoomLevel bytes of the mapped address space.
+ *
+ * Tiles are rendered by ByteMapTileTask in the background and kept in a cache shared by all
+ * colorings and zoom levels, so switching back and forth does not render them again.
+ */
+class ByteMapView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit ByteMapView(QWidget *parent = nullptr);
+    ~ByteMapView() override;
+
+    void setMapLayout(const ByteMapLayout &layout);
+    void setColoring(ByteMapColoring coloring);
+    ByteMapColoring getColoring() const     { return renderer.getColoring(); }
+    void setZoomLevel(int zoomLevel);
+    int getZoomLevel() const                { return renderer.getZoomLevel(); }
+    void setCursorAddress(RVA address, bool scrollTo);
+
+    /**
+     * @brief Drop all rendered tiles, for example after the data changed.
+     */
+    void clearTiles();
+
+signals:
+    void addressClicked(RVA address);
+    void zoomLevelChanged(int zoomLevel);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    bool viewportEvent(QEvent *event) override;
+
+private:
+    ByteMapRenderer renderer;
+    QCache<quint64, QImage> tiles;
+    MemoryAccount account;
+    QSharedPointer<ByteMapTileTask> task;
+    RVA cursorAddress = RVA_INVALID;
+
+    void setZoomLevel(int zoomLevel, const QPoint &anchor);
+    /**
+     * @brief Scroll so that the row of address is shown at viewportY
+     */
+    void scrollToAddress(RVA address, int viewportY);
+    int pixelScale() const;
+    quint64 rowCount() const;
+    quint64 tileCount() const;
+    /**
+     * @return address under point in viewport coordinates, RVA_INVALID outside of the map
+     */
+    RVA addressAt(const QPoint &point) const;
+    void updateScrollBars();
+    void requestTiles(const QList<quint64> &missing);
+    void onTileRendered(quint64 key, QImage image);
+    void onTaskFinished();
+    void updateAccount();
+};
+
+class ByteMapWidget : public MemoryDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ByteMapWidget(MainWindow *main);
+    ~ByteMapWidget() override;
+
+    static QString getWidgetType();
+
+    QVariantMap serializeViewProprties() override;
+    void deserializeViewProperties(const QVariantMap &properties) override;
+
+protected:
+    QWidget *widgetToFocusOnRaise() override;
+
+private:
+    ByteMapView *view;
+    QComboBox *coloringComboBox;
+    QComboBox *zoomComboBox;
+    RefreshDeferrer *refreshDeferrer;
+    bool sentSeek = false;
+
+    QString getWindowTitle() const override;
+    void refreshLayout();
+
+private slots:
+    void onSeekChanged(RVA addr);
+    void onAddressClicked(RVA addr);
+};
+
+#endif // BYTEMAPWIDGET_H
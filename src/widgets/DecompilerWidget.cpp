@@ -6,6 +6,7 @@
 #include "common/Helpers.h"
 #include "common/TempConfig.h"
 #include "common/SelectionHighlight.h"
+#include "common/DebugInfo.h"
 #include "common/Decompiler.h"
 #include "common/CutterSeekable.h"
 
@@ -161,12 +162,17 @@ void DecompilerWidget::doRefresh(RVA addr)
 
     if (addr == RVA_INVALID) {
         ui->textEdit->setPlainText(tr("Click Refresh to generate Decompiler from current offset."));
+        tokenIndex.clear();
         return;
     }
 
     // Clear all selections since we just refreshed
     ui->textEdit->setExtraSelections({});
     decompiledFunctionAddr = Core()->getFunctionStart(addr);
+    if (decompiledFunctionAddr != RVA_INVALID) {
+        // The decompiler only knows types that are in r2
+        DebugInfo::instance()->materializeFunctionTypes(decompiledFunctionAddr);
+    }
     dec->decompileAt(addr);
     if (dec->isRunning()) {
         ui->progressLabel->setVisible(true);
@@ -202,10 +208,12 @@ void DecompilerWidget::decompilationFinished(AnnotatedCode code)
     this->code = code;
     if (code.code.isEmpty()) {
         ui->textEdit->setPlainText(tr("Cannot decompile at this address (Not a function?)"));
+        tokenIndex.clear();
         return;
     } else {
         connectCursorPositionChanged(true);
         ui->textEdit->setPlainText(code.code);
+        tokenIndex.setDocument(ui->textEdit->document());
         connectCursorPositionChanged(false);
         updateCursorPosition();
         highlightPC();
@@ -303,7 +311,7 @@ void DecompilerWidget::updateSelection()
     // Highlight all the words in the document same as the current one
     cursor.select(QTextCursor::WordUnderCursor);
     QString searchString = cursor.selectedText();
-    extraSelections.append(createSameWordsSelections(ui->textEdit, searchString));
+    extraSelections.append(createSameWordsSelections(ui->textEdit, tokenIndex, searchString));
 
     ui->textEdit->setExtraSelections(extraSelections);
     // Highlight PC after updating the selected line
@@ -7,6 +7,7 @@
 #include "core/Cutter.h"
 #include "MemoryDockWidget.h"
 #include "Decompiler.h"
+#include "common/TokenIndex.h"
 
 namespace Ui {
 class DecompilerWidget;
@@ -57,6 +58,7 @@ private:
 
     RVA decompiledFunctionAddr;
     AnnotatedCode code;
+    TokenIndex tokenIndex;
 
     bool seekFromCursor = false;
 
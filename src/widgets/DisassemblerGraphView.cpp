@@ -10,6 +10,7 @@
 #include "common/SyntaxHighlighter.h"
 #include "common/BasicBlockHighlighter.h"
 #include "common/BasicInstructionHighlighter.h"
+#include "common/Profiler.h"
 #include "dialogs/MultitypeFileSaveDialog.h"
 #include "common/Helpers.h"
 
@@ -32,11 +33,14 @@
 #include <QApplication>
 #include <QAction>
 
+#include <algorithm>
 #include <cmath>
 
 const int DisassemblerGraphView::KEY_ZOOM_IN = Qt::Key_Plus + Qt::ControlModifier;
 const int DisassemblerGraphView::KEY_ZOOM_OUT = Qt::Key_Minus + Qt::ControlModifier;
 const int DisassemblerGraphView::KEY_ZOOM_RESET = Qt::Key_Equal + Qt::ControlModifier;
+const size_t DisassemblerGraphView::SWITCH_BUNDLE_MIN_TARGETS = 16;
+const size_t DisassemblerGraphView::SWITCH_BUNDLE_MAX_LINES = 64;
 
 DisassemblerGraphView::DisassemblerGraphView(QWidget *parent, CutterSeekable *seekable,
                                              MainWindow *mainWindow, QList<QAction *> additionalMenuActions)
@@ -44,10 +48,15 @@ DisassemblerGraphView::DisassemblerGraphView(QWidget *parent, CutterSeekable *se
       mFontMetrics(nullptr),
       blockMenu(new DisassemblyContextMenu(this, mainWindow)),
       contextMenu(new QMenu(this)),
+      regionMenu(new QMenu(this)),
       seekable(seekable),
       actionExportGraph(this),
       actionUnhighlight(this),
-      actionUnhighlightInstruction(this)
+      actionUnhighlightInstruction(this),
+      actionExpandRegion(this),
+      actionCollapseRegion(this),
+      actionExpandAllRegions(this),
+      actionCollapseAllRegions(this)
 {
     highlight_token = nullptr;
     auto *layout = new QVBoxLayout(this);
@@ -64,7 +73,11 @@ DisassemblerGraphView::DisassemblerGraphView(QWidget *parent, CutterSeekable *se
     connect(Core(), SIGNAL(asmOptionsChanged()), this, SLOT(refreshView()));
     connect(Core(), SIGNAL(refreshCodeViews()), this, SLOT(refreshView()));
 
-    connect(Config(), SIGNAL(colorsUpdated()), this, SLOT(colorsUpdatedSlot()));
+    connect(CodePalette::instance(), &CodePalette::colorsChanged, this,
+            &DisassemblerGraphView::colorsUpdatedSlot);
+    connect(Profiler::instance(), &Profiler::profileChanged, this, [this]() {
+        viewport()->update();
+    });
     connect(Config(), SIGNAL(fontsUpdated()), this, SLOT(fontsUpdatedSlot()));
     connectSeekChanged(false);
 
@@ -125,6 +138,22 @@ DisassemblerGraphView::DisassemblerGraphView(QWidget *parent, CutterSeekable *se
         }
     }
     layoutMenu->addActions(layoutGroup->actions());
+
+    // Regions of loops, switches and conditionals shown as single nodes
+    actionExpandRegion.setText(tr("Expand Region"));
+    connect(&actionExpandRegion, &QAction::triggered, this,
+            &DisassemblerGraphView::onActionExpandRegionTriggered);
+    actionCollapseRegion.setText(tr("Collapse Region"));
+    connect(&actionCollapseRegion, &QAction::triggered, this,
+            &DisassemblerGraphView::onActionCollapseRegionTriggered);
+    actionExpandAllRegions.setText(tr("Expand All Regions"));
+    connect(&actionExpandAllRegions, &QAction::triggered, this,
+            &DisassemblerGraphView::onActionExpandAllRegionsTriggered);
+    actionCollapseAllRegions.setText(tr("Collapse All Regions"));
+    connect(&actionCollapseAllRegions, &QAction::triggered, this,
+            &DisassemblerGraphView::onActionCollapseAllRegionsTriggered);
+    contextMenu->addAction(&actionExpandAllRegions);
+    contextMenu->addAction(&actionCollapseAllRegions);
     contextMenu->addSeparator();
     contextMenu->addActions(additionalMenuActions);
 
@@ -172,12 +201,16 @@ DisassemblerGraphView::DisassemblerGraphView(QWidget *parent, CutterSeekable *se
     blockMenu->addAction(&actionUnhighlight);
     blockMenu->addAction(highlightBI);
     blockMenu->addAction(&actionUnhighlightInstruction);
+    blockMenu->addAction(&actionCollapseRegion);
 
 
     // Include all actions from generic context menu in block specific menu
     blockMenu->addSeparator();
     blockMenu->addActions(contextMenu->actions());
 
+    regionMenu->addAction(&actionExpandRegion);
+    regionMenu->addSeparator();
+    regionMenu->addActions(contextMenu->actions());
 
     initFont();
     colorsUpdatedSlot();
@@ -219,6 +252,8 @@ void DisassemblerGraphView::refreshView()
 
 void DisassemblerGraphView::loadCurrentGraph()
 {
+    // Colors are taken from CodePalette when painting, a theme change only repaints
+    CodeTokenProbe probe;
     TempConfig tempConfig;
     tempConfig.set("scr.color", COLOR_MODE_16M)
     .set("asm.bb.line", false)
@@ -227,19 +262,26 @@ void DisassemblerGraphView::loadCurrentGraph()
 
     QJsonArray functions;
     RAnalFunction *fcn = Core()->functionIn(seekable->getOffset());
+    switchTables.clear();
     if (fcn) {
         currentFcnAddr = fcn->addr;
         QJsonDocument functionsDoc = Core()->cmdj("agJ " + RAddressString(fcn->addr));
         functions = functionsDoc.array();
+        switchTables = SwitchTableCache::instance()->tables(fcn->addr);
     }
 
     disassembly_blocks.clear();
+    summaryBlocks.clear();
+    functionBlocks.clear();
     blocks.clear();
 
     if (highlight_token) {
         delete highlight_token;
         highlight_token = nullptr;
     }
+    tokenIndex.clear();
+    tokenLines.clear();
+    highlightSpans.clear();
 
     emptyGraph = functions.isEmpty();
     if (emptyGraph) {
@@ -272,7 +314,6 @@ void DisassemblerGraphView::loadCurrentGraph()
 
     RVA entry = func["offset"].toVariant().toULongLong();
 
-    setEntry(entry);
     for (const QJsonValueRef &value : func["blocks"].toArray()) {
         QJsonObject block = value.toObject();
         RVA block_entry = block["offset"].toVariant().toULongLong();
@@ -297,17 +338,11 @@ void DisassemblerGraphView::loadCurrentGraph()
             gb.edges.emplace_back(block_jump);
         }
 
-        QJsonObject switchOp = block["switchop"].toObject();
-        if (!switchOp.isEmpty()) {
-            QJsonArray caseArray = switchOp["cases"].toArray();
-            for (QJsonValue caseOpValue : caseArray) {
-                QJsonObject caseOp = caseOpValue.toObject();
-                bool ok;
-                RVA caseJump = caseOp["jump"].toVariant().toULongLong(&ok);
-                if (!ok) {
-                    continue;
-                }
-                gb.edges.emplace_back(caseJump);
+        // Cases come from the cached tables, already reduced to their distinct targets
+        if (const SwitchTable *table = switchTableAt(block_entry)) {
+            gb.edges.reserve(gb.edges.size() + table->targets.size());
+            for (RVA target : table->targets) {
+                gb.edges.emplace_back(target);
             }
         }
 
@@ -345,17 +380,326 @@ void DisassemblerGraphView::loadCurrentGraph()
             db.instrs.push_back(i);
         }
         disassembly_blocks[db.entry] = db;
-        prepareGraphNode(gb);
-
-        addBlock(gb);
+        functionBlocks[gb.entry] = gb;
+    }
+    for (const auto &blockIt : disassembly_blocks) {
+        const std::vector<Instr> &instrs = blockIt.second.instrs;
+        for (size_t i = 0; i < instrs.size(); i++) {
+            tokenIndex.addLine(instrs[i].plainText);
+            tokenLines.emplace_back(blockIt.first, i);
+        }
     }
     cleanupEdges();
 
-    if (!func["blocks"].toArray().isEmpty()) {
-        computeGraph(entry);
+    functionEntry = entry;
+    updateRegions(entry);
+    setEntry(entry);
+    updateVisibleGraph();
+}
+
+void DisassemblerGraphView::updateRegions(ut64 entry)
+{
+    // Only a different graph needs the structure computed again, which also keeps the
+    // regions collapsed while the same function is refreshed
+    size_t signature = std::hash<ut64>()(entry);
+    for (const auto &blockIt : functionBlocks) {
+        size_t blockHash = std::hash<ut64>()(blockIt.first);
+        for (const auto &edge : blockIt.second.edges) {
+            blockHash = blockHash * 31 + std::hash<ut64>()(edge.target);
+        }
+        signature += blockHash * 0x9e3779b9;
+    }
+    if (signature == regionsSignature) {
+        return;
+    }
+    regionsSignature = signature;
+    collapsedRegions.clear();
+    expandedSwitches.clear();
+
+    CfgRegions::Successors successors;
+    successors.reserve(functionBlocks.size());
+    for (const auto &blockIt : functionBlocks) {
+        auto &targets = successors[blockIt.first];
+        for (const auto &edge : blockIt.second.edges) {
+            targets.push_back(edge.target);
+        }
+    }
+    regions.compute(successors, entry);
+
+    int collapseBlockCount = Config()->getGraphCollapseBlockCount();
+    if (collapseBlockCount > 0 && functionBlocks.size() > static_cast<size_t>(collapseBlockCount)) {
+        // Start with only the top level structure, expanded step by step
+        for (size_t i = 0; i < regions.getRegions().size(); i++) {
+            collapsedRegions.insert(static_cast<int>(i));
+        }
+    }
+}
+
+void DisassemblerGraphView::updateVisibleGraph()
+{
+    blocks.clear();
+    summaryBlocks.clear();
+
+    for (const auto &blockIt : functionBlocks) {
+        int region = collapsedRegionOf(blockIt.first);
+        if (region < 0) {
+            GraphBlock gb;
+            gb.entry = blockIt.first;
+            blocks[gb.entry] = gb;
+            continue;
+        }
+        const CfgRegions::Region &r = regions.getRegions()[static_cast<size_t>(region)];
+        if (summaryBlocks.find(r.header) != summaryBlocks.end()) {
+            continue;
+        }
+        size_t instructionCount = 0;
+        for (ut64 block : r.blocks) {
+            instructionCount += disassembly_blocks[block].instrs.size();
+        }
+        DisassemblyBlock summary;
+        summary.entry = r.header;
+        summary.true_path = RVA_INVALID;
+        summary.false_path = RVA_INVALID;
+        summary.header_text = Text(tr("%1 at %2").arg(CfgRegions::kindName(r.kind),
+                                                     RAddressString(r.header)),
+                                   QStringLiteral("comment"));
+        summary.header_text.lines.push_back(Text(tr("%1 blocks, %2 instructions")
+                                                 .arg(r.blocks.size()).arg(instructionCount),
+                                                 QStringLiteral("comment")).lines.front());
+        summaryBlocks[r.header] = summary;
+        GraphBlock gb;
+        gb.entry = r.header;
+        blocks[gb.entry] = gb;
+    }
+
+    // Edges between the shown nodes, edges inside of a collapsed region disappear
+    for (const auto &blockIt : functionBlocks) {
+        ut64 from = visibleBlockOf(blockIt.first);
+        bool summarized = from != blockIt.first || summaryBlocks.find(from) != summaryBlocks.end();
+        auto &edges = blocks[from].edges;
+        for (const auto &edge : blockIt.second.edges) {
+            ut64 to = visibleBlockOf(edge.target);
+            if (summarized && to == from) {
+                continue;
+            }
+            auto existing = std::find_if(edges.begin(), edges.end(), [to](const GraphEdge &e) {
+                return e.target == to;
+            });
+            if (existing == edges.end()) {
+                edges.emplace_back(to);
+            }
+        }
+    }
+
+    bundleSwitches();
+
+    for (auto &blockIt : blocks) {
+        prepareGraphNode(blockIt.second);
+    }
+    if (!blocks.empty()) {
+        computeGraph(visibleBlockOf(functionEntry));
+    }
+}
+
+const SwitchTable *DisassemblerGraphView::switchTableAt(ut64 block) const
+{
+    if (!switchTables) {
+        return nullptr;
+    }
+    auto it = std::lower_bound(switchTables->begin(), switchTables->end(), block,
+    [](const SwitchTable &table, ut64 block) {
+        return table.block < block;
+    });
+    return it != switchTables->end() && it->block == block ? &*it : nullptr;
+}
+
+void DisassemblerGraphView::bundleSwitches()
+{
+    switchBundles.clear();
+    hiddenBySwitch.clear();
+    if (!switchTables || switchTables->isEmpty()) {
+        return;
+    }
+    ut64 root = visibleBlockOf(functionEntry);
+    std::unordered_set<ut64> reachableBefore = reachableBlocks(root);
+    std::vector<std::pair<ut64, std::vector<ut64>>> bundledTargets;
+    // Bundle nodes need ids that are no block address
+    ut64 nextId = RVA_INVALID - 1;
+
+    for (const SwitchTable &table : *switchTables) {
+        if (table.targets.size() < SWITCH_BUNDLE_MIN_TARGETS
+                || expandedSwitches.find(table.block) != expandedSwitches.end()
+                || summaryBlocks.find(table.block) != summaryBlocks.end()) {
+            continue;
+        }
+        auto blockIt = blocks.find(table.block);
+        if (blockIt == blocks.end()) {
+            continue;
+        }
+        const DisassemblyBlock &db = disassembly_blocks[table.block];
+        std::unordered_set<ut64> bundled;
+        for (RVA target : table.targets) {
+            ut64 to = visibleBlockOf(target);
+            if (to != db.true_path && to != db.false_path && blocks.find(to) != blocks.end()) {
+                bundled.insert(to);
+            }
+        }
+        auto &edges = blockIt->second.edges;
+        edges.erase(std::remove_if(edges.begin(), edges.end(), [&bundled](const GraphEdge &edge) {
+            return bundled.find(edge.target) != bundled.end();
+        }), edges.end());
+        ut64 id = nextId--;
+        edges.emplace_back(id);
+
+        SwitchBundle bundle;
+        bundle.switchBlock = table.block;
+        DisassemblyBlock summary;
+        summary.entry = id;
+        summary.true_path = RVA_INVALID;
+        summary.false_path = RVA_INVALID;
+        summary.header_text = Text(tr("Switch at %1: %2 cases, %3 targets")
+                                   .arg(RAddressString(table.address))
+                                   .arg(table.cases.size()).arg(table.targets.size()),
+                                   QStringLiteral("comment"));
+        auto addLine = [&summary](const QString &line, const QString &paletteKey) {
+            summary.header_text.lines.push_back(Text(line, paletteKey).lines.front());
+        };
+        if (table.stride) {
+            addLine(tr("Table at %1, %2 bytes per entry").arg(RAddressString(table.tableBase))
+                    .arg(table.stride), QStringLiteral("comment"));
+        }
+        bundle.firstTargetLine = static_cast<int>(summary.header_text.lines.size());
+        size_t listed = std::min(table.targets.size(), SWITCH_BUNDLE_MAX_LINES);
+        for (size_t i = 0; i < listed; i++) {
+            addLine(tr("%1  case %2").arg(RAddressString(table.targets[i]),
+                                          table.caseLabel(static_cast<quint32>(i))), QStringLiteral("offset"));
+            bundle.listedTargets.push_back(table.targets[i]);
+        }
+        if (listed < table.targets.size()) {
+            addLine(tr("... %n more, double click to expand", nullptr,
+                       static_cast<int>(table.targets.size() - listed)), QStringLiteral("comment"));
+        }
+        summaryBlocks[id] = summary;
+        switchBundles[id] = bundle;
+        GraphBlock gb;
+        gb.entry = id;
+        blocks[id] = gb;
+        bundledTargets.emplace_back(table.block, std::vector<ut64>(bundled.begin(), bundled.end()));
+    }
+    if (switchBundles.empty()) {
+        return;
+    }
+
+    // Blocks still reachable otherwise stay, the rest is listed in the bundle node instead
+    std::unordered_set<ut64> reachableAfter = reachableBlocks(root);
+    for (const auto &bundle : bundledTargets) {
+        std::vector<ut64> queue = bundle.second;
+        while (!queue.empty()) {
+            ut64 block = queue.back();
+            queue.pop_back();
+            if (reachableBefore.find(block) == reachableBefore.end()
+                    || reachableAfter.find(block) != reachableAfter.end()
+                    || !hiddenBySwitch.emplace(block, bundle.first).second) {
+                continue;
+            }
+            for (const auto &edge : blocks[block].edges) {
+                queue.push_back(edge.target);
+            }
+        }
+    }
+    for (const auto &hidden : hiddenBySwitch) {
+        blocks.erase(hidden.first);
+    }
+    for (auto &blockIt : blocks) {
+        auto &edges = blockIt.second.edges;
+        edges.erase(std::remove_if(edges.begin(), edges.end(), [this](const GraphEdge &edge) {
+            return blocks.find(edge.target) == blocks.end();
+        }), edges.end());
+    }
+}
+
+std::unordered_set<ut64> DisassemblerGraphView::reachableBlocks(ut64 entry) const
+{
+    std::unordered_set<ut64> reachable;
+    std::vector<ut64> queue { entry };
+    while (!queue.empty()) {
+        ut64 block = queue.back();
+        queue.pop_back();
+        auto it = blocks.find(block);
+        if (it == blocks.end() || !reachable.insert(block).second) {
+            continue;
+        }
+        for (const auto &edge : it->second.edges) {
+            queue.push_back(edge.target);
+        }
+    }
+    return reachable;
+}
+
+bool DisassemblerGraphView::expandSwitchHiding(ut64 block)
+{
+    bool changed = false;
+    // Bundles may be nested, every pass opens the one hiding block in the current graph
+    for (auto it = hiddenBySwitch.find(block); it != hiddenBySwitch.end();
+            it = hiddenBySwitch.find(block)) {
+        expandedSwitches.insert(it->second);
+        updateVisibleGraph();
+        changed = true;
+    }
+    return changed;
+}
+
+void DisassemblerGraphView::regionsChanged(ut64 focus)
+{
+    updateVisibleGraph();
+    viewport()->update();
+    emit viewRefreshed();
+    auto it = blocks.find(visibleBlockOf(focus));
+    if (it != blocks.end()) {
+        transition_dont_seek = true;
+        showBlock(it->second, true);
     }
 }
 
+int DisassemblerGraphView::collapsedRegionOf(ut64 block) const
+{
+    if (collapsedRegions.empty()) {
+        return -1;
+    }
+    const auto &all = regions.getRegions();
+    int result = -1;
+    for (int region = regions.innermostRegion(block); region >= 0;
+            region = all[static_cast<size_t>(region)].parent) {
+        if (collapsedRegions.find(region) != collapsedRegions.end()) {
+            result = region;
+        }
+    }
+    return result;
+}
+
+ut64 DisassemblerGraphView::visibleBlockOf(ut64 block) const
+{
+    int region = collapsedRegionOf(block);
+    return region < 0 ? block : regions.getRegions()[static_cast<size_t>(region)].header;
+}
+
+bool DisassemblerGraphView::expandRegionsContaining(ut64 block)
+{
+    bool changed = false;
+    const auto &all = regions.getRegions();
+    for (int region = regions.innermostRegion(block); region >= 0;
+            region = all[static_cast<size_t>(region)].parent) {
+        changed |= collapsedRegions.erase(region) > 0;
+    }
+    return changed;
+}
+
+DisassemblerGraphView::DisassemblyBlock &DisassemblerGraphView::blockData(ut64 entry)
+{
+    auto it = summaryBlocks.find(entry);
+    return it != summaryBlocks.end() ? it->second : disassembly_blocks[entry];
+}
+
 DisassemblerGraphView::EdgeConfigurationMapping DisassemblerGraphView::getEdgeConfigurations()
 {
     EdgeConfigurationMapping result;
@@ -369,22 +713,18 @@ DisassemblerGraphView::EdgeConfigurationMapping DisassemblerGraphView::getEdgeCo
 
 void DisassemblerGraphView::prepareGraphNode(GraphBlock &block)
 {
-    DisassemblyBlock &db = disassembly_blocks[block.entry];
+    DisassemblyBlock &db = blockData(block.entry);
     int width = 0;
     int height = 0;
-    for (auto &line : db.header_text.lines) {
-        int lw = 0;
-        for (auto &part : line)
-            lw += mFontMetrics->width(part.text);
+    for (auto &layout : db.header_text.getLayouts(mFontMetrics.get())) {
+        int lw = static_cast<int>(layout.width());
         if (lw > width)
             width = lw;
         height += 1;
     }
     for (Instr &instr : db.instrs) {
-        for (auto &line : instr.text.lines) {
-            int lw = 0;
-            for (auto &part : line)
-                lw += mFontMetrics->width(part.text);
+        for (auto &layout : instr.text.getLayouts(mFontMetrics.get())) {
+            int lw = static_cast<int>(layout.width());
             if (lw > width)
                 width = lw;
             height += 1;
@@ -397,14 +737,14 @@ void DisassemblerGraphView::prepareGraphNode(GraphBlock &block)
 
 void DisassemblerGraphView::cleanupEdges()
 {
-    for (auto &blockIt : blocks) {
+    for (auto &blockIt : functionBlocks) {
         auto &block = blockIt.second;
         auto outIt = block.edges.begin();
         std::unordered_set<ut64> seenEdges;
         for (auto it = block.edges.begin(), end = block.edges.end(); it != end; ++it) {
             // remove edges going  to different functions
             // and remove duplicate edges, common in switch statements
-            if (blocks.find(it->target) != blocks.end() &&
+            if (functionBlocks.find(it->target) != functionBlocks.end() &&
                     seenEdges.find(it->target) == seenEdges.end()) {
                 *outIt++ = *it;
                 seenEdges.insert(it->target);
@@ -422,7 +762,7 @@ void DisassemblerGraphView::initFont()
     charWidth = metrics.width('X');
     charHeight = static_cast<int>(metrics.height());
     charOffset = 0;
-    mFontMetrics.reset(new CachedFontMetrics<qreal>(font()));
+    mFontMetrics = CachedFontMetrics<qreal>::shared(font());
 }
 
 void DisassemblerGraphView::drawBlock(QPainter &p, GraphView::GraphBlock &block, bool interactive)
@@ -439,7 +779,7 @@ void DisassemblerGraphView::drawBlock(QPainter &p, GraphView::GraphBlock &block,
     breakpoints = Core()->getBreakpointsAddresses();
 
     // Render node
-    DisassemblyBlock &db = disassembly_blocks[block.entry];
+    DisassemblyBlock &db = blockData(block.entry);
     bool block_selected = false;
     RVA selected_instruction = RVA_INVALID;
 
@@ -480,6 +820,11 @@ void DisassemblerGraphView::drawBlock(QPainter &p, GraphView::GraphBlock &block,
         p.setBrush(color);
         p.drawRect(blockRect);
     }
+    if (summaryBlocks.find(block.entry) != summaryBlocks.end()) {
+        // Double border for nodes standing in for a collapsed region
+        p.setBrush(Qt::NoBrush);
+        p.drawRect(blockRect.adjusted(3, 3, -3, -3));
+    }
 
     const int firstInstructionY = block.y + getInstructionOffset(db, 0).y();
 
@@ -492,51 +837,47 @@ void DisassemblerGraphView::drawBlock(QPainter &p, GraphView::GraphBlock &block,
     }
 
     // Highlight selected tokens
-    if (interactive && highlight_token != nullptr) {
-        int y = firstInstructionY;
+    auto spansIt = highlightSpans.find(block.entry);
+    if (interactive && highlight_token != nullptr && spansIt != highlightSpans.end()) {
         qreal tokenWidth = mFontMetrics->width(highlight_token->content);
+        QColor selectionColor = ConfigColor("wordHighlight");
+        size_t lineInstr = 0;
+        int y = firstInstructionY;
 
-        for (const Instr &instr : db.instrs) {
-            int pos = -1;
-
-            while ((pos = instr.plainText.indexOf(highlight_token->content, pos + 1)) != -1) {
-                int tokenEnd = pos + highlight_token->content.length();
-
-                if ((pos > 0 && instr.plainText[pos - 1].isLetterOrNumber())
-                        || (tokenEnd < instr.plainText.length() && instr.plainText[tokenEnd].isLetterOrNumber())) {
-                    continue;
-                }
-
-                qreal widthBefore = mFontMetrics->width(instr.plainText.left(pos));
-                if (charWidth * 3 + widthBefore > block.width - (10 + padding)) {
-                    continue;
-                }
-
-                qreal highlightWidth = tokenWidth;
-                if (charWidth * 3 + widthBefore + tokenWidth >= block.width - (10 + padding)) {
-                    highlightWidth = block.width - widthBefore - (10 +  2 * padding);
-                }
+        // Spans are ordered by instruction
+        for (const TokenSpan &span : spansIt->second) {
+            for (; lineInstr < span.instr; lineInstr++) {
+                y += int(db.instrs[lineInstr].text.lines.size()) * charHeight;
+            }
+            const Instr &instr = db.instrs[span.instr];
 
-                QColor selectionColor = ConfigColor("wordHighlight");
+            qreal widthBefore = mFontMetrics->width(instr.plainText.left(span.start));
+            if (charWidth * 3 + widthBefore > block.width - (10 + padding)) {
+                continue;
+            }
 
-                p.fillRect(QRectF(block.x + charWidth * 3 + widthBefore, y, highlightWidth,
-                                  charHeight), selectionColor);
+            qreal highlightWidth = tokenWidth;
+            if (charWidth * 3 + widthBefore + tokenWidth >= block.width - (10 + padding)) {
+                highlightWidth = block.width - widthBefore - (10 +  2 * padding);
             }
 
-            y += int(instr.text.lines.size()) * charHeight;
+            p.fillRect(QRectF(block.x + charWidth * 3 + widthBefore, y, highlightWidth,
+                              charHeight), selectionColor);
         }
     }
 
     // Render node text
     auto x = block.x + padding;
     int y = block.y + getTextOffset(0).y();
-    for (auto &line : db.header_text.lines) {
-        RichTextPainter::paintRichText<qreal>(&p, x, y, block.width, charHeight, 0, line,
-                                              mFontMetrics.get());
+    const auto &headerLayouts = db.header_text.getLayouts(mFontMetrics.get());
+    for (size_t i = 0; i < db.header_text.lines.size(); i++) {
+        RichTextPainter::paintRichText<qreal>(&p, x, y, block.width, charHeight, 0,
+                                              db.header_text.lines[i], headerLayouts[i]);
         y += charHeight;
     }
 
     auto bih = Core()->getBIHighlighter();
+    Profiler *profiler = Profiler::instance();
     for (const Instr &instr : db.instrs) {
         const QRect instrRect = QRect(static_cast<int>(block.x + charWidth), y,
                                       static_cast<int>(block.width - (10 + padding)),
@@ -554,12 +895,17 @@ void DisassemblerGraphView::drawBlock(QPainter &p, GraphView::GraphBlock &block,
         if (instrColor.isValid()) {
             p.fillRect(instrRect, instrColor);
         }
+        double heat = profiler->instructionHeat(instr.addr);
+        if (heat > 0) {
+            p.fillRect(instrRect, Profiler::heatColor(heat));
+        }
 
         if (selected_instruction != RVA_INVALID && selected_instruction == instr.addr) {
             p.fillRect(instrRect, disassemblySelectionColor);
         }
 
-        for (auto &line : instr.text.lines) {
+        const auto &layouts = instr.text.getLayouts(mFontMetrics.get());
+        for (size_t i = 0; i < instr.text.lines.size(); i++) {
             int rectSize = qRound(charWidth);
             if (rectSize % 2) {
                 rectSize++;
@@ -570,8 +916,8 @@ void DisassemblerGraphView::drawBlock(QPainter &p, GraphView::GraphBlock &block,
             Q_UNUSED(bpRect);
 
             RichTextPainter::paintRichText<qreal>(&p, x + charWidth, y,
-                                                  block.width - charWidth, charHeight, 0, line,
-                                                  mFontMetrics.get());
+                                                  block.width - charWidth, charHeight, 0,
+                                                  instr.text.lines[i], layouts[i]);
             y += charHeight;
 
         }
@@ -583,7 +929,7 @@ GraphView::EdgeConfiguration DisassemblerGraphView::edgeConfiguration(GraphView:
                                                                       bool interactive)
 {
     EdgeConfiguration ec;
-    DisassemblyBlock &db = disassembly_blocks[from.entry];
+    DisassemblyBlock &db = blockData(from.entry);
     if (to->entry == db.true_path) {
         ec.color = brtrueColor;
     } else if (to->entry == db.false_path) {
@@ -606,7 +952,7 @@ GraphView::EdgeConfiguration DisassemblerGraphView::edgeConfiguration(GraphView:
 
 RVA DisassemblerGraphView::getAddrForMouseEvent(GraphBlock &block, QPoint *point)
 {
-    DisassemblyBlock &db = disassembly_blocks[block.entry];
+    DisassemblyBlock &db = blockData(block.entry);
 
     // Remove header and margin
     int off_y = getInstructionOffset(db, 0).y();
@@ -631,7 +977,7 @@ RVA DisassemblerGraphView::getAddrForMouseEvent(GraphBlock &block, QPoint *point
 DisassemblerGraphView::Instr *DisassemblerGraphView::getInstrForMouseEvent(
     GraphView::GraphBlock &block, QPoint *point, bool force)
 {
-    DisassemblyBlock &db = disassembly_blocks[block.entry];
+    DisassemblyBlock &db = blockData(block.entry);
 
     // Remove header and margin
     int off_y = getInstructionOffset(db, 0).y();
@@ -661,6 +1007,9 @@ DisassemblerGraphView::Instr *DisassemblerGraphView::getInstrForMouseEvent(
 
 QRectF DisassemblerGraphView::getInstrRect(GraphView::GraphBlock &block, RVA addr) const
 {
+    if (summaryBlocks.find(block.entry) != summaryBlocks.end()) {
+        return QRectF();
+    }
     auto blockIt = disassembly_blocks.find(block.entry);
     if (blockIt == disassembly_blocks.end()) {
         return QRectF();
@@ -716,9 +1065,8 @@ void DisassemblerGraphView::colorsUpdatedSlot()
     brtrueColor = ConfigColor("graph.true");
     brfalseColor = ConfigColor("graph.false");
 
-    mCommentColor = ConfigColor("comment");
-    initFont();
-    refreshView();
+    // Text colors are looked up by role when painting, the graph does not need to be reloaded
+    viewport()->update();
 }
 
 void DisassemblerGraphView::fontsUpdatedSlot()
@@ -771,6 +1119,15 @@ void DisassemblerGraphView::onSeekChanged(RVA addr)
         switchFunction = true;
     }
     if (db) {
+        bool changed = expandRegionsContaining(db->entry);
+        if (changed) {
+            updateVisibleGraph();
+        }
+        changed |= expandSwitchHiding(db->entry);
+        if (changed) {
+            viewport()->update();
+            emit viewRefreshed();
+        }
         // This is a local address! We animated to it.
         transition_dont_seek = true;
         showBlock(&blocks[db->entry], !switchFunction);
@@ -938,6 +1295,18 @@ DisassemblerGraphView::Token *DisassemblerGraphView::getToken(Instr *instr, int
     return nullptr;
 }
 
+void DisassemblerGraphView::updateHighlightSpans()
+{
+    highlightSpans.clear();
+    if (!highlight_token) {
+        return;
+    }
+    for (const TokenIndex::Occurrence &occurrence : tokenIndex.find(highlight_token->content)) {
+        const auto &line = tokenLines[static_cast<size_t>(occurrence.line)];
+        highlightSpans[line.first].push_back({ line.second, occurrence.start });
+    }
+}
+
 QPoint DisassemblerGraphView::getTextOffset(int line) const
 {
     int padding = static_cast<int>(2 * charWidth);
@@ -960,6 +1329,7 @@ void DisassemblerGraphView::blockClicked(GraphView::GraphBlock &block, QMouseEve
     currentBlockAddress = block.entry;
 
     highlight_token = getToken(instr, pos.x());
+    updateHighlightSpans();
 
     RVA addr = instr->addr;
     seekLocal(addr);
@@ -975,10 +1345,22 @@ void DisassemblerGraphView::blockClicked(GraphView::GraphBlock &block, QMouseEve
 void DisassemblerGraphView::blockContextMenuRequested(GraphView::GraphBlock &block,
                                                       QContextMenuEvent *event, QPoint pos)
 {
+    event->accept();
+    if (switchBundles.find(block.entry) != switchBundles.end()) {
+        contextMenu->exec(event->globalPos());
+        return;
+    }
+    if (summaryBlocks.find(block.entry) != summaryBlocks.end()) {
+        menuRegion = collapsedRegionOf(block.entry);
+        regionMenu->exec(event->globalPos());
+        return;
+    }
+    menuRegion = regions.innermostRegion(block.entry);
+    actionCollapseRegion.setVisible(menuRegion >= 0);
+
     const RVA offset = this->seekable->getOffset();
     actionUnhighlight.setVisible(Core()->getBBHighlighter()->getBasicBlock(block.entry));
     actionUnhighlightInstruction.setVisible(Core()->getBIHighlighter()->getBasicInstruction(offset));
-    event->accept();
     blockMenu->exec(event->globalPos());
 }
 
@@ -996,6 +1378,25 @@ void DisassemblerGraphView::blockDoubleClicked(GraphView::GraphBlock &block, QMo
                                                QPoint pos)
 {
     Q_UNUSED(event);
+    auto bundle = switchBundles.find(block.entry);
+    if (bundle != switchBundles.end()) {
+        // A target line seeks there, which opens the bundle, anywhere else opens it in place
+        int line = (pos.y() - getTextOffset(0).y()) / charHeight - bundle->second.firstTargetLine;
+        if (pos.y() >= getTextOffset(0).y() && line >= 0
+                && static_cast<size_t>(line) < bundle->second.listedTargets.size()) {
+            seekable->seek(bundle->second.listedTargets[static_cast<size_t>(line)]);
+        } else {
+            ut64 switchBlock = bundle->second.switchBlock;
+            expandedSwitches.insert(switchBlock);
+            regionsChanged(switchBlock);
+        }
+        return;
+    }
+    if (summaryBlocks.find(block.entry) != summaryBlocks.end()) {
+        menuRegion = collapsedRegionOf(block.entry);
+        onActionExpandRegionTriggered();
+        return;
+    }
     seekable->seekToReference(getAddrForMouseEvent(block, &pos));
 }
 
@@ -1155,6 +1556,40 @@ void DisassemblerGraphView::onActionUnhighlightBITriggered()
     Config()->colorsUpdated();
 }
 
+void DisassemblerGraphView::onActionExpandRegionTriggered()
+{
+    if (menuRegion < 0 || static_cast<size_t>(menuRegion) >= regions.getRegions().size()) {
+        return;
+    }
+    // Nested regions stay collapsed, so large regions open up one level at a time
+    collapsedRegions.erase(menuRegion);
+    regionsChanged(regions.getRegions()[static_cast<size_t>(menuRegion)].header);
+}
+
+void DisassemblerGraphView::onActionCollapseRegionTriggered()
+{
+    if (menuRegion < 0 || static_cast<size_t>(menuRegion) >= regions.getRegions().size()) {
+        return;
+    }
+    collapsedRegions.insert(menuRegion);
+    regionsChanged(regions.getRegions()[static_cast<size_t>(menuRegion)].header);
+}
+
+void DisassemblerGraphView::onActionExpandAllRegionsTriggered()
+{
+    collapsedRegions.clear();
+    regionsChanged(seekable->getOffset());
+}
+
+void DisassemblerGraphView::onActionCollapseAllRegionsTriggered()
+{
+    for (size_t i = 0; i < regions.getRegions().size(); i++) {
+        collapsedRegions.insert(static_cast<int>(i));
+    }
+    DisassemblyBlock *db = blockForAddress(seekable->getOffset());
+    regionsChanged(db ? db->entry : functionEntry);
+}
+
 void DisassemblerGraphView::exportGraph(QString filePath, GraphExportType type)
 {
     bool graphTransparent = Config()->getBitmapTransparentState();
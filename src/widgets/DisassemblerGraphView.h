@@ -12,6 +12,12 @@
 #include "menus/DisassemblyContextMenu.h"
 #include "common/RichTextPainter.h"
 #include "common/CutterSeekable.h"
+#include "common/CfgRegions.h"
+#include "common/SwitchTableCache.h"
+#include "common/CodePalette.h"
+#include "common/TokenIndex.h"
+
+#include <unordered_set>
 
 class QTextEdit;
 class FallbackSyntaxHighlighter;
@@ -38,6 +44,18 @@ class DisassemblerGraphView : public GraphView
             lines.push_back(richText);
         }
 
+        /**
+         * @brief Single line in the color of the r2 palette key paletteKey, see CodePalette
+         */
+        Text(const QString &text, const QString &paletteKey)
+        {
+            RichTextPainter::CustomRichText_t rt;
+            rt.text = text;
+            rt.colorRole = CodePalette::instance()->role(paletteKey);
+            rt.flags = RichTextPainter::FlagColor;
+            lines.push_back({ rt });
+        }
+
         Text(const RichTextPainter::List &richText)
         {
             lines.push_back(richText);
@@ -53,6 +71,26 @@ class DisassemblerGraphView : public GraphView
             }
             return result;
         }
+
+        /**
+         * @brief Layouts of all lines, measured again only when fontMetrics changed
+         */
+        const std::vector<RichTextPainter::Layout<qreal>> &getLayouts(
+            CachedFontMetrics<qreal> *fontMetrics) const
+        {
+            if (layouts.size() != lines.size()
+                    || (!layouts.empty() && !layouts.front().isValidFor(fontMetrics))) {
+                layouts.clear();
+                layouts.reserve(lines.size());
+                for (const auto &line : lines) {
+                    layouts.push_back(RichTextPainter::layout<qreal>(line, fontMetrics));
+                }
+            }
+            return layouts;
+        }
+
+    private:
+        mutable std::vector<RichTextPainter::Layout<qreal>> layouts;
     };
 
     struct Instr {
@@ -159,13 +197,31 @@ private slots:
     void on_actionExportGraph_triggered();
     void onActionHighlightBITriggered();
     void onActionUnhighlightBITriggered();
+    void onActionExpandRegionTriggered();
+    void onActionCollapseRegionTriggered();
+    void onActionExpandAllRegionsTriggered();
+    void onActionCollapseAllRegionsTriggered();
 
 private:
     bool transition_dont_seek = false;
 
     Token *highlight_token;
+    /**
+     * Words of all instructions, line i of tokenIndex is instruction tokenLines[i].second
+     * of the block at tokenLines[i].first
+     */
+    TokenIndex tokenIndex;
+    std::vector<std::pair<ut64, size_t>> tokenLines;
+    struct TokenSpan {
+        size_t instr;
+        int start;
+    };
+    /**
+     * Occurrences of highlight_token by block, looked up once when it changes
+     */
+    std::unordered_map<ut64, std::vector<TokenSpan>> highlightSpans;
     // Font data
-    std::unique_ptr<CachedFontMetrics<qreal>> mFontMetrics;
+    std::shared_ptr<CachedFontMetrics<qreal>> mFontMetrics;
     qreal charWidth;
     int charHeight;
     int charOffset;
@@ -175,13 +231,71 @@ private:
 
     DisassemblyContextMenu *blockMenu;
     QMenu *contextMenu;
+    QMenu *regionMenu;
+
+    /**
+     * All blocks of the current function, blocks only holds the ones shown, where
+     * each collapsed region is replaced by a summary node at the address of its header.
+     */
+    std::unordered_map<ut64, GraphBlock> functionBlocks;
+    std::unordered_map<ut64, DisassemblyBlock> summaryBlocks;
+    CfgRegions regions;
+    std::unordered_set<int> collapsedRegions;
+    ut64 functionEntry = RVA_INVALID;
+    size_t regionsSignature = 0;
+    int menuRegion = -1;
+
+    /**
+     * Node standing in for the case edges of a large switch, listing its targets
+     */
+    struct SwitchBundle {
+        ut64 switchBlock;
+        int firstTargetLine;                ///< header line of listedTargets.front()
+        std::vector<ut64> listedTargets;
+    };
+    QSharedPointer<const SwitchTables> switchTables;
+    std::unordered_map<ut64, SwitchBundle> switchBundles;
+    std::unordered_set<ut64> expandedSwitches;
+    /**
+     * Blocks only reachable through a bundled switch, mapped to the switch block
+     */
+    std::unordered_map<ut64, ut64> hiddenBySwitch;
 
     void connectSeekChanged(bool disconnect);
 
     void initFont();
     void prepareGraphNode(GraphBlock &block);
     void cleanupEdges();
+    void updateRegions(ut64 entry);
+    /**
+     * @brief Rebuild blocks from functionBlocks with the collapsed regions summarized and lay
+     * them out again.
+     */
+    void updateVisibleGraph();
+    void regionsChanged(ut64 focus);
+    const SwitchTable *switchTableAt(ut64 block) const;
+    /**
+     * @brief Replace the case edges of switches with many targets by one edge to a node
+     * listing the targets, dropping the blocks that are only reachable through them.
+     */
+    void bundleSwitches();
+    std::unordered_set<ut64> reachableBlocks(ut64 entry) const;
+    /**
+     * @return true if any switch had to be expanded to show block
+     */
+    bool expandSwitchHiding(ut64 block);
+    /**
+     * @return the outermost collapsed region containing block, -1 if it is shown
+     */
+    int collapsedRegionOf(ut64 block) const;
+    ut64 visibleBlockOf(ut64 block) const;
+    /**
+     * @return true if any region had to be expanded to show block
+     */
+    bool expandRegionsContaining(ut64 block);
+    DisassemblyBlock &blockData(ut64 entry);
     Token *getToken(Instr *instr, int x);
+    void updateHighlightSpans();
     QPoint getTextOffset(int line) const;
     QPoint getInstructionOffset(const DisassemblyBlock &block, int line) const;
     RVA getAddrForMouseEvent(GraphBlock &block, QPoint *point);
@@ -214,12 +328,10 @@ private:
     QColor indirectcallShadowColor;
     QColor mAutoCommentColor;
     QColor mAutoCommentBackgroundColor;
-    QColor mCommentColor;
     QColor mCommentBackgroundColor;
     QColor mLabelColor;
     QColor mLabelBackgroundColor;
     QColor graphNodeColor;
-    QColor mAddressColor;
     QColor mAddressBackgroundColor;
     QColor mCipColor;
     QColor mBreakpointColor;
@@ -228,12 +340,18 @@ private:
     QAction actionExportGraph;
     QAction actionUnhighlight;
     QAction actionUnhighlightInstruction;
+    QAction actionExpandRegion;
+    QAction actionCollapseRegion;
+    QAction actionExpandAllRegions;
+    QAction actionCollapseAllRegions;
 
     QLabel *emptyText = nullptr;
 
     static const int KEY_ZOOM_IN;
     static const int KEY_ZOOM_OUT;
     static const int KEY_ZOOM_RESET;
+    static const size_t SWITCH_BUNDLE_MIN_TARGETS;
+    static const size_t SWITCH_BUNDLE_MAX_LINES;
 signals:
     void viewRefreshed();
     void viewZoomed();
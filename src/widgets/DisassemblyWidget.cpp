@@ -3,6 +3,8 @@
 #include "common/Configuration.h"
 #include "common/Helpers.h"
 #include "common/TempConfig.h"
+#include "common/CodePalette.h"
+#include "common/Profiler.h"
 #include "common/SelectionHighlight.h"
 #include "core/MainWindow.h"
 
@@ -160,7 +162,10 @@ DisassemblyWidget::DisassemblyWidget(MainWindow *main)
     connect(Core(), SIGNAL(refreshCodeViews()), this, SLOT(refreshDisasm()));
 
     connect(Config(), SIGNAL(fontsUpdated()), this, SLOT(fontsUpdatedSlot()));
-    connect(Config(), SIGNAL(colorsUpdated()), this, SLOT(colorsUpdatedSlot()));
+    connect(CodePalette::instance(), &CodePalette::colorsChanged, this,
+            &DisassemblyWidget::colorsUpdatedSlot);
+    connect(Profiler::instance(), &Profiler::profileChanged, this,
+            &DisassemblyWidget::highlightCurrentLine);
 
     connect(Core(), &CutterCore::refreshAll, this, [this]() {
         refreshDisasm(seekable->getOffset());
@@ -267,6 +272,7 @@ void DisassemblyWidget::refreshDisasm(RVA offset)
     if (maxLines <= 0) {
         connectCursorPositionChanged(true);
         mDisasTextEdit->clear();
+        tokenIndex.clear();
         connectCursorPositionChanged(false);
         return;
     }
@@ -275,8 +281,9 @@ void DisassemblyWidget::refreshDisasm(RVA offset)
     int horizontalScrollValue = mDisasTextEdit->horizontalScrollBar()->value();
     mDisasTextEdit->setLockScroll(true); // avoid flicker
 
-    // Retrieve disassembly lines
+    // Retrieve disassembly lines, colored by role so that a theme change only recolors them
     {
+        CodeTokenProbe probe;
         TempConfig tempConfig;
         tempConfig.set("scr.color", COLOR_MODE_16M)
 		.set("asm.lines", false);
@@ -303,6 +310,7 @@ void DisassemblyWidget::refreshDisasm(RVA offset)
         cursor.insertBlock();
         cursor.setBlockFormat(regular);
     }
+    CodePalette::instance()->bindRoles(mDisasTextEdit->document());
 
     if (!lines.isEmpty()) {
         bottomOffset = lines[qMin(lines.size(), maxLines) - 1].offset;
@@ -321,6 +329,8 @@ void DisassemblyWidget::refreshDisasm(RVA offset)
     tc.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
     tc.removeSelectedText();
 
+    tokenIndex.setDocument(mDisasTextEdit->document());
+
     connectCursorPositionChanged(false);
 
     updateCursorPosition();
@@ -376,6 +386,23 @@ void DisassemblyWidget::highlightCurrentLine()
     QColor highlightColor = ConfigColor("lineHighlight");
     QColor highlightPCColor = ConfigColor("highlightPC");
 
+    // Heat of sampled instructions, below the other highlights
+    Profiler *profiler = Profiler::instance();
+    if (profiler->getProfile().sampleCount > 0) {
+        QTextDocument *document = mDisasTextEdit->document();
+        for (QTextBlock block = document->begin(); block != document->end(); block = block.next()) {
+            auto *userData = getUserData(block);
+            double heat = userData ? profiler->instructionHeat(userData->line.offset) : 0;
+            if (heat > 0) {
+                QTextEdit::ExtraSelection heatSelection;
+                heatSelection.cursor = QTextCursor(block);
+                heatSelection.format.setBackground(Profiler::heatColor(heat));
+                heatSelection.format.setProperty(QTextFormat::FullWidthSelection, true);
+                extraSelections.append(heatSelection);
+            }
+        }
+    }
+
     // Highlight the current word
     QTextCursor cursor = mDisasTextEdit->textCursor();
     cursor.select(QTextCursor::WordUnderCursor);
@@ -405,7 +432,7 @@ void DisassemblyWidget::highlightCurrentLine()
     }
 
     // Highlight all the words in the document same as the current one
-    extraSelections.append(createSameWordsSelections(mDisasTextEdit, curHighlightedWord));
+    extraSelections.append(createSameWordsSelections(mDisasTextEdit, tokenIndex, curHighlightedWord));
 
     // highlight PC line
     RVA PCAddr = Core()->getProgramCounterValue();
@@ -469,7 +496,7 @@ void DisassemblyWidget::updateCursorPosition()
 
     if (offset < topOffset || (offset > bottomOffset && bottomOffset != RVA_INVALID)) {
         mDisasTextEdit->moveCursor(QTextCursor::Start);
-        mDisasTextEdit->setExtraSelections(createSameWordsSelections(mDisasTextEdit, curHighlightedWord));
+        mDisasTextEdit->setExtraSelections(createSameWordsSelections(mDisasTextEdit, tokenIndex, curHighlightedWord));
     } else {
         RVA currentCursorOffset = readCurrentDisassemblyOffset();
         QTextCursor originalCursor = mDisasTextEdit->textCursor();
@@ -681,7 +708,27 @@ void DisassemblyWidget::fontsUpdatedSlot()
 void DisassemblyWidget::colorsUpdatedSlot()
 {
     setupColors();
-    refreshDisasm();
+
+    // Recolor the lines in place, they are only fetched again when scrolling
+    connectCursorPositionChanged(true);
+    QTextDocument *document = mDisasTextEdit->document();
+    CodePalette::instance()->applyColors(document);
+    QColor breakpointBackground = ConfigColor("gui.breakpoint_background");
+    QTextCursor cursor(document);
+    for (QTextBlock block = document->begin(); block != document->end(); block = block.next()) {
+        auto *userData = getUserData(block);
+        if (!userData || !Core()->isBreakpoint(breakpoints, userData->line.offset)
+                || block.blockFormat().background().color() == breakpointBackground) {
+            continue;
+        }
+        QTextBlockFormat format;
+        format.setBackground(breakpointBackground);
+        cursor.setPosition(block.position());
+        cursor.mergeBlockFormat(format);
+    }
+    connectCursorPositionChanged(false);
+    highlightCurrentLine();
+    leftPanel->update();
 }
 
 void DisassemblyWidget::setupFonts()
@@ -6,6 +6,7 @@
 #include "common/CutterSeekable.h"
 #include "common/RefreshDeferrer.h"
 #include "common/CachedFontMetrics.h"
+#include "common/TokenIndex.h"
 
 #include <QTextEdit>
 #include <QPlainTextEdit>
@@ -59,6 +60,7 @@ private:
     int maxLines;
 
     QString curHighlightedWord;
+    TokenIndex tokenIndex;
 
     /**
      * offset of lines below the first line of the current seek
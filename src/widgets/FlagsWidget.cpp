@@ -3,6 +3,7 @@
 #include "core/MainWindow.h"
 #include "dialogs/RenameDialog.h"
 #include "common/Helpers.h"
+#include "common/XrefGraph.h"
 
 #include <QComboBox>
 #include <QMenu>
@@ -14,6 +15,11 @@ FlagsModel::FlagsModel(QList<FlagDescription> *flags, QObject *parent)
     : AddressableItemModel<QAbstractListModel>(parent),
       flags(flags)
 {
+    connect(XrefIndex::instance(), &XrefIndex::updated, this, [this]() {
+        if (!this->flags->isEmpty()) {
+            emit dataChanged(index(0, XREFS), index(this->flags->size() - 1, XREFS));
+        }
+    });
 }
 
 int FlagsModel::rowCount(const QModelIndex &) const
@@ -44,6 +50,11 @@ QVariant FlagsModel::data(const QModelIndex &index, int role) const
             return flag.name;
         case REALNAME:
             return flag.realname;
+        case XREFS:
+            if (!XrefIndex::instance()->isReady()) {
+                return QVariant();
+            }
+            return QString::number(XrefIndex::instance()->inDegree(flag.offset));
         default:
             return QVariant();
         }
@@ -67,6 +78,8 @@ QVariant FlagsModel::headerData(int section, Qt::Orientation, int role) const
             return tr("Name");
         case REALNAME:
             return tr("Real Name");
+        case XREFS:
+            return tr("Xrefs");
         default:
             return QVariant();
         }
@@ -128,6 +141,14 @@ bool FlagsSortFilterProxyModel::lessThan(const QModelIndex &left, const QModelIn
     case FlagsModel::REALNAME:
         return left_flag->realname < right_flag->realname;
 
+    case FlagsModel::XREFS: {
+        int leftXrefs = XrefIndex::instance()->inDegree(left_flag->offset);
+        int rightXrefs = XrefIndex::instance()->inDegree(right_flag->offset);
+        if (leftXrefs != rightXrefs)
+            return leftXrefs < rightXrefs;
+        return left_flag->offset < right_flag->offset;
+    }
+
     default:
         break;
     }
@@ -261,6 +282,13 @@ void FlagsWidget::refreshFlags()
     flags = Core()->getAllFlags(flagspace);
     flags_model->endResetModel();
 
+    size_t bytes = 0;
+    for (const FlagDescription &flag : flags) {
+        bytes += sizeof(FlagDescription) + MemoryAccounting::stringSize(flag.name)
+                 + MemoryAccounting::stringSize(flag.realname);
+    }
+    flagsAccount.update(bytes, flags.size());
+
     tree->showItemsNumber(flags_proxy_model->rowCount());
 
     // TODO: this is not a very good place for the following:
@@ -12,6 +12,7 @@
 #include "CutterTreeWidget.h"
 #include "AddressableItemList.h"
 #include "AddressableItemModel.h"
+#include "common/MemoryAccounting.h"
 
 class MainWindow;
 class QTreeWidgetItem;
@@ -26,7 +27,7 @@ private:
     QList<FlagDescription> *flags;
 
 public:
-    enum Columns { OFFSET = 0, SIZE, NAME, REALNAME, COUNT };
+    enum Columns { OFFSET = 0, SIZE, NAME, REALNAME, XREFS, COUNT };
     static const int FlagDescriptionRole = Qt::UserRole;
 
     FlagsModel(QList<FlagDescription> *flags, QObject *parent = nullptr);
@@ -89,6 +90,7 @@ private:
     FlagsModel *flags_model;
     FlagsSortFilterProxyModel *flags_proxy_model;
     QList<FlagDescription> flags;
+    MemoryAccount flagsAccount { QStringLiteral("Flag list") };
     CutterTreeWidget *tree;
 
     void refreshFlags();
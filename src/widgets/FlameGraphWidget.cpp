@@ -0,0 +1,274 @@
+#include "FlameGraphWidget.h"
+
+#include "core/MainWindow.h"
+#include "common/Configuration.h"
+
+#include <QHBoxLayout>
+#include <QHelpEvent>
+#include <QLabel>
+#include <QMessageBox>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPushButton>
+#include <QScrollArea>
+#include <QSpinBox>
+#include <QToolTip>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+FlameGraphView::FlameGraphView(QWidget *parent)
+    : QWidget(parent)
+{
+    setMouseTracking(true);
+    connect(Profiler::instance(), &Profiler::profileChanged, this, &FlameGraphView::updateProfile);
+    connect(Config(), &Configuration::fontsUpdated, this, &FlameGraphView::updateProfile);
+    updateProfile();
+}
+
+int FlameGraphView::rowHeight() const
+{
+    return fontMetrics().height() + 4;
+}
+
+QSize FlameGraphView::sizeHint() const
+{
+    return QSize(400, (depth + 1) * rowHeight());
+}
+
+void FlameGraphView::updateProfile()
+{
+    const Profile &profile = Profiler::instance()->getProfile();
+    if (zoomNode >= static_cast<int>(profile.nodes.size())) {
+        zoomNode = 0;
+    }
+    // Children are always added after their parent
+    std::vector<int> levels(profile.nodes.size(), 0);
+    depth = 0;
+    for (size_t i = 1; i < profile.nodes.size(); i++) {
+        levels[i] = levels[static_cast<size_t>(profile.nodes[i].parent)] + 1;
+        depth = qMax(depth, levels[i]);
+    }
+    setMinimumHeight((depth + 1) * rowHeight());
+    updateGeometry();
+    update();
+}
+
+int FlameGraphView::depthOf(int node) const
+{
+    const Profile &profile = Profiler::instance()->getProfile();
+    int level = 0;
+    while (node > 0) {
+        node = profile.nodes[static_cast<size_t>(node)].parent;
+        level++;
+    }
+    return level;
+}
+
+QString FlameGraphView::nodeName(int node) const
+{
+    const Profile &profile = Profiler::instance()->getProfile();
+    int function = profile.nodes[static_cast<size_t>(node)].function;
+    return function < 0 ? tr("all") : profile.functions[static_cast<size_t>(function)].name;
+}
+
+QColor FlameGraphView::frameColor(const QString &name)
+{
+    // Warm colors as usual for flame graphs, stable for every name
+    uint hash = qHash(name);
+    return QColor(205 + int(hash % 50), int((hash / 50) % 230), int((hash / 11500) % 55));
+}
+
+void FlameGraphView::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), Config()->getColor("gui.background"));
+    nodeRects.clear();
+
+    const Profile &profile = Profiler::instance()->getProfile();
+    if (profile.sampleCount == 0) {
+        painter.setPen(Config()->getColor("gui.navbar.empty"));
+        painter.drawText(rect(), Qt::AlignCenter, Profiler::canSample()
+                         ? tr("Start sampling and continue the debuggee.")
+                         : tr("Start debugging a local process to sample it."));
+        return;
+    }
+
+    // The callers of the zoomed frame span the whole width as well
+    std::vector<int> path;
+    for (int node = zoomNode; node > 0; node = profile.nodes[static_cast<size_t>(node)].parent) {
+        path.push_back(node);
+    }
+    path.push_back(0);
+    std::reverse(path.begin(), path.end());
+    for (size_t level = 0; level + 1 < path.size(); level++) {
+        int node = path[level];
+        QRectF rect(0, height() - int(level + 1) * rowHeight(), width(), rowHeight());
+        painter.fillRect(rect.adjusted(0, 0, -1, -1), frameColor(nodeName(node)).lighter(130));
+        painter.setPen(Qt::black);
+        painter.drawText(rect.adjusted(4, 0, -4, 0), Qt::AlignVCenter | Qt::AlignLeft,
+                         fontMetrics().elidedText(nodeName(node), Qt::ElideRight, width() - 8));
+        nodeRects.push_back({ rect, node });
+    }
+    paintNode(painter, zoomNode, 0, width(), static_cast<int>(path.size()) - 1);
+}
+
+void FlameGraphView::paintNode(QPainter &painter, int node, qreal x, qreal width, int level)
+{
+    const Profile &profile = Profiler::instance()->getProfile();
+    const FlameNode &flameNode = profile.nodes[static_cast<size_t>(node)];
+    QRectF rect(x, height() - (level + 1) * rowHeight(), width, rowHeight());
+    QString name = nodeName(node);
+    painter.fillRect(rect.adjusted(0, 0, -1, -1), node == 0 ? QColor(Qt::lightGray) : frameColor(name));
+    if (width > 3 * fontMetrics().averageCharWidth()) {
+        painter.setPen(Qt::black);
+        painter.drawText(rect.adjusted(2, 0, -2, 0), Qt::AlignVCenter | Qt::AlignLeft,
+                         fontMetrics().elidedText(name, Qt::ElideRight, int(width) - 4));
+    }
+    nodeRects.push_back({ rect, node });
+
+    // Children in order of their names, so that frames do not move between updates
+    std::vector<int> children = flameNode.children;
+    std::sort(children.begin(), children.end(), [this](int a, int b) {
+        return nodeName(a) < nodeName(b);
+    });
+    for (int child : children) {
+        qreal childWidth = width * profile.nodes[static_cast<size_t>(child)].samples / flameNode.samples;
+        if (childWidth >= 1) {
+            paintNode(painter, child, x, childWidth, level + 1);
+        }
+        x += childWidth;
+    }
+}
+
+int FlameGraphView::nodeAt(const QPoint &pos) const
+{
+    for (const NodeRect &nodeRect : nodeRects) {
+        if (nodeRect.rect.contains(pos)) {
+            return nodeRect.node;
+        }
+    }
+    return -1;
+}
+
+void FlameGraphView::mousePressEvent(QMouseEvent *event)
+{
+    int node = nodeAt(event->pos());
+    if (event->button() != Qt::LeftButton || node < 0) {
+        return;
+    }
+    zoomNode = node;
+    update();
+}
+
+void FlameGraphView::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    int node = nodeAt(event->pos());
+    if (node <= 0) {
+        return;
+    }
+    const Profile &profile = Profiler::instance()->getProfile();
+    int function = profile.nodes[static_cast<size_t>(node)].function;
+    RVA address = profile.functions[static_cast<size_t>(function)].address;
+    if (address != RVA_INVALID) {
+        Core()->seekAndShow(address);
+    }
+}
+
+bool FlameGraphView::event(QEvent *event)
+{
+    if (event->type() != QEvent::ToolTip) {
+        return QWidget::event(event);
+    }
+    auto helpEvent = static_cast<QHelpEvent *>(event);
+    int node = nodeAt(helpEvent->pos());
+    if (node < 0) {
+        QToolTip::hideText();
+        event->ignore();
+        return true;
+    }
+    const Profile &profile = Profiler::instance()->getProfile();
+    const FlameNode &flameNode = profile.nodes[static_cast<size_t>(node)];
+    QString text = tr("%1\n%2 samples, %3%")
+                   .arg(nodeName(node))
+                   .arg(flameNode.samples)
+                   .arg(100.0 * flameNode.samples / qMax<quint64>(profile.sampleCount, 1), 0, 'f', 2);
+    if (flameNode.function >= 0) {
+        const ProfileFunction &function = profile.functions[static_cast<size_t>(flameNode.function)];
+        text += tr("\nSelf: %1 samples, %2%")
+                .arg(function.selfSamples)
+                .arg(100.0 * function.selfSamples / qMax<quint64>(profile.sampleCount, 1), 0, 'f', 2);
+    }
+    QToolTip::showText(helpEvent->globalPos(), text);
+    return true;
+}
+
+FlameGraphWidget::FlameGraphWidget(MainWindow *main) :
+    CutterDockWidget(main)
+{
+    setObjectName("FlameGraphWidget");
+    setWindowTitle(tr("Flame Graph"));
+
+    QWidget *contents = new QWidget(this);
+    QVBoxLayout *layout = new QVBoxLayout(contents);
+    layout->setContentsMargins(0, 0, 0, 0);
+
+    QHBoxLayout *controlsLayout = new QHBoxLayout();
+    controlsLayout->setContentsMargins(6, 6, 6, 0);
+    startButton = new QPushButton(contents);
+    controlsLayout->addWidget(startButton);
+    frequencySpinBox = new QSpinBox(contents);
+    frequencySpinBox->setRange(10, 10000);
+    frequencySpinBox->setSingleStep(100);
+    frequencySpinBox->setValue(Profiler::DefaultFrequency);
+    frequencySpinBox->setSuffix(tr(" Hz"));
+    frequencySpinBox->setToolTip(tr("Samples per second of CPU time of every thread"));
+    controlsLayout->addWidget(frequencySpinBox);
+    QPushButton *clearButton = new QPushButton(tr("Clear"), contents);
+    controlsLayout->addWidget(clearButton);
+    statusLabel = new QLabel(contents);
+    controlsLayout->addWidget(statusLabel, 1);
+    layout->addLayout(controlsLayout);
+
+    view = new FlameGraphView(contents);
+    QScrollArea *scrollArea = new QScrollArea(contents);
+    scrollArea->setWidget(view);
+    scrollArea->setWidgetResizable(true);
+    scrollArea->setFrameShape(QFrame::NoFrame);
+    layout->addWidget(scrollArea);
+    setWidget(contents);
+
+    connect(startButton, &QPushButton::clicked, this, &FlameGraphWidget::toggleSampling);
+    connect(clearButton, &QPushButton::clicked, Profiler::instance(), &Profiler::clear);
+    connect(Profiler::instance(), &Profiler::runningChanged, this, &FlameGraphWidget::updateState);
+    connect(Profiler::instance(), &Profiler::profileChanged, this, &FlameGraphWidget::updateState);
+    connect(Profiler::instance(), &Profiler::error, this, [this](const QString &message) {
+        QMessageBox::warning(this, tr("Flame Graph"), message);
+    });
+    connect(Core(), &CutterCore::refreshAll, this, &FlameGraphWidget::updateState);
+    connect(Core(), &CutterCore::debugTaskStateChanged, this, &FlameGraphWidget::updateState);
+
+    updateState();
+}
+
+FlameGraphWidget::~FlameGraphWidget() = default;
+
+void FlameGraphWidget::toggleSampling()
+{
+    Profiler *profiler = Profiler::instance();
+    if (profiler->isRunning()) {
+        profiler->stop();
+    } else {
+        profiler->start(frequencySpinBox->value());
+    }
+}
+
+void FlameGraphWidget::updateState()
+{
+    Profiler *profiler = Profiler::instance();
+    bool running = profiler->isRunning();
+    startButton->setText(running ? tr("Stop Sampling") : tr("Start Sampling"));
+    startButton->setEnabled(running || Profiler::canSample());
+    frequencySpinBox->setEnabled(!running);
+    statusLabel->setText(tr("%n sample(s)", nullptr, int(profiler->getProfile().sampleCount)));
+}
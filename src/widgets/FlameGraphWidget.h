@@ -0,0 +1,79 @@
+#ifndef FLAMEGRAPHWIDGET_H
+#define FLAMEGRAPHWIDGET_H
+
+#include "CutterDockWidget.h"
+#include "common/Profiler.h"
+
+#include <QRectF>
+#include <QWidget>
+
+#include <vector>
+
+class MainWindow;
+class QLabel;
+class QPushButton;
+class QSpinBox;
+
+/**
+ * @brief Flame graph of a Profile: callers below their callees, every function as wide as
+ * the samples it appears in. Clicking a frame zooms into it, clicking the root zooms out.
+ */
+class FlameGraphView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit FlameGraphView(QWidget *parent = nullptr);
+
+    QSize sizeHint() const override;
+
+public slots:
+    void updateProfile();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+    bool event(QEvent *event) override;
+
+private:
+    struct NodeRect {
+        QRectF rect;
+        int node;
+    };
+
+    int zoomNode = 0;
+    int depth = 0;
+    std::vector<NodeRect> nodeRects;     ///< as painted last
+
+    int rowHeight() const;
+    void paintNode(QPainter &painter, int node, qreal x, qreal width, int level);
+    int nodeAt(const QPoint &pos) const;
+    int depthOf(int node) const;
+    QString nodeName(int node) const;
+    static QColor frameColor(const QString &name);
+};
+
+/**
+ * @brief Samples the debugged process and shows where it spends its time, see Profiler.
+ */
+class FlameGraphWidget : public CutterDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit FlameGraphWidget(MainWindow *main);
+    ~FlameGraphWidget() override;
+
+private slots:
+    void toggleSampling();
+    void updateState();
+
+private:
+    QPushButton *startButton;
+    QSpinBox *frequencySpinBox;
+    QLabel *statusLabel;
+    FlameGraphView *view;
+};
+
+#endif // FLAMEGRAPHWIDGET_H
@@ -4,8 +4,13 @@
 #include "core/MainWindow.h"
 #include "common/Helpers.h"
 #include "dialogs/RenameDialog.h"
+#include "dialogs/SimilarFunctionsDialog.h"
+#include "common/FunctionSimilarity.h"
 #include "common/FunctionsTask.h"
 #include "common/TempConfig.h"
+#include "common/XrefGraph.h"
+#include "common/FunctionMetrics.h"
+#include "common/Profiler.h"
 #include "menus/AddressableItemContextMenu.h"
 
 #include <algorithm>
@@ -16,6 +21,7 @@
 #include <QShortcut>
 #include <QJsonArray>
 #include <QJsonObject>
+#include <QRegularExpression>
 
 namespace {
 
@@ -40,6 +46,17 @@ FunctionModel::FunctionModel(QList<FunctionDescription> *functions, QSet<RVA> *i
     connect(Core(), SIGNAL(seekChanged(RVA)), this, SLOT(seekChanged(RVA)));
     connect(Core(), SIGNAL(functionRenamed(const QString &, const QString &)), this,
             SLOT(functionRenamed(QString, QString)));
+    connect(XrefIndex::instance(), &XrefIndex::updated, this, [this]() {
+        if (!this->nested && !this->functions->isEmpty()) {
+            emit dataChanged(index(0, XrefsColumn), index(this->functions->size() - 1, XrefsColumn));
+        }
+    });
+    connect(FunctionMetrics::instance(), &FunctionMetrics::updated, this, [this]() {
+        if (!this->nested && !this->functions->isEmpty()) {
+            emit dataChanged(index(0, ColumnCount),
+                             index(this->functions->size() - 1, columnCount() - 1));
+        }
+    });
 }
 
 QModelIndex FunctionModel::index(int row, int column, const QModelIndex &parent) const
@@ -80,7 +97,7 @@ int FunctionModel::columnCount(const QModelIndex &/*parent*/) const
     if (nested)
         return 1;
     else
-        return ColumnCount;
+        return ColumnCount + FunctionMetrics::definitions().size();
 }
 
 bool FunctionModel::functionIsImport(ut64 addr) const
@@ -136,6 +153,8 @@ QVariant FunctionModel::data(const QModelIndex &index, int role) const
                     return tr("Edges: %1").arg(function.edges);
                 case 8:
                     return tr("StackFrame: %1").arg(function.stackframe);
+                case 9:
+                    return tr("Xrefs: %1").arg(XrefIndex::instance()->inDegree(function.offset));
                 default:
                     return QVariant();
                 }
@@ -161,7 +180,19 @@ QVariant FunctionModel::data(const QModelIndex &index, int role) const
                 return QString::number(function.edges);
             case FrameColumn:
                 return QString::number(function.stackframe);
+            case XrefsColumn:
+                if (!XrefIndex::instance()->isReady()) {
+                    return QVariant();
+                }
+                return QString::number(XrefIndex::instance()->inDegree(function.offset));
             default:
+                if (index.column() >= ColumnCount) {
+                    int metric = index.column() - ColumnCount;
+                    const QVector<float> *metrics = FunctionMetrics::instance()->metrics(function.offset);
+                    if (metrics && metric < metrics->size()) {
+                        return FunctionMetrics::formatValue(metric, metrics->at(metric));
+                    }
+                }
                 return QVariant();
             }
         }
@@ -180,7 +211,7 @@ QVariant FunctionModel::data(const QModelIndex &index, int role) const
         return defaultFont;
 
     case Qt::TextAlignmentRole:
-        if (index.column() == 1)
+        if (index.column() == 1 || (!nested && index.column() >= ColumnCount))
             return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
         return static_cast<int>(Qt::AlignLeft | Qt::AlignVCenter);
 
@@ -219,10 +250,21 @@ QVariant FunctionModel::data(const QModelIndex &index, int role) const
             toolTipContent += tr("<div><strong>Highlights</strong>:<br>%1</div>")
                               .arg(highlights.join(QLatin1Char('\n')).toHtmlEscaped().replace(QLatin1Char('\n'), "<br>"));
         }
+
+        const Profile &profile = Profiler::instance()->getProfile();
+        if (const ProfileFunction *sampled = Profiler::instance()->functionAt(function.offset)) {
+            toolTipContent += tr("<div style=\"margin-top: 10px;\"><strong>Samples</strong>: %1 self, %2 total of %3</div>")
+                              .arg(sampled->selfSamples).arg(sampled->totalSamples).arg(profile.sampleCount);
+        }
         toolTipContent += "</div></html>";
         return toolTipContent;
     }
 
+    case Qt::BackgroundRole: {
+        double heat = subnode ? 0 : Profiler::instance()->functionHeat(function.offset);
+        return heat > 0 ? QVariant(Profiler::heatColor(heat)) : QVariant();
+    }
+
     case Qt::ForegroundRole:
         if (functionIsImport(function.offset))
             return QVariant(ConfigColor("gui.imports"));
@@ -268,11 +310,21 @@ QVariant FunctionModel::headerData(int section, Qt::Orientation orientation, int
                 return tr("Edges");
             case FrameColumn:
                 return tr("StackFrame");
+            case XrefsColumn:
+                return tr("Xrefs");
             default:
+                if (section >= ColumnCount && section < columnCount()) {
+                    return FunctionMetrics::definitions()[section - ColumnCount].name;
+                }
                 return QVariant();
             }
         }
     }
+    if (role == Qt::ToolTipRole && orientation == Qt::Horizontal && !nested
+            && section >= ColumnCount && section < columnCount()) {
+        const FunctionMetricDefinition &metric = FunctionMetrics::definitions()[section - ColumnCount];
+        return tr("%1\nFilter with %2>N, %2<N or %2=N").arg(metric.description, metric.id);
+    }
 
     return QVariant();
 }
@@ -358,7 +410,77 @@ bool FunctionSortFilterProxyModel::filterAcceptsRow(int row, const QModelIndex &
     QModelIndex index = sourceModel()->index(row, 0, parent);
     FunctionDescription function = index.data(
                                        FunctionModel::FunctionDescriptionRole).value<FunctionDescription>();
-    return function.name.contains(filterRegExp());
+    if (filterRegExp().pattern() != filterPattern) {
+        parseFilter(filterRegExp().pattern());
+    }
+    if (!metricConditions.isEmpty()) {
+        const QVector<float> *metrics = FunctionMetrics::instance()->metrics(function.offset);
+        if (!metrics) {
+            return false;
+        }
+        for (const MetricCondition &condition : metricConditions) {
+            if (!condition.matches(metrics->at(condition.metric))) {
+                return false;
+            }
+        }
+    }
+    return function.name.contains(nameFilter);
+}
+
+bool FunctionSortFilterProxyModel::MetricCondition::matches(float value) const
+{
+    switch (op) {
+    case '<':
+        return value < threshold;
+    case '>':
+        return value > threshold;
+    case 'l':
+        return value <= threshold;
+    case 'g':
+        return value >= threshold;
+    default:
+        return qFuzzyCompare(value + 1.0f, threshold + 1.0f);
+    }
+}
+
+void FunctionSortFilterProxyModel::parseFilter(const QString &pattern) const
+{
+    // Terms like "cc>10" filter by metrics, the remaining text by name as before
+    static const QRegularExpression conditionRegex(
+        QStringLiteral("^(\\w+)(<=|>=|<|>|=)([0-9]+(?:\\.[0-9]+)?)$"));
+    filterPattern = pattern;
+    metricConditions.clear();
+    QStringList nameTerms;
+    for (const QString &term : pattern.split(QLatin1Char(' '), QString::SkipEmptyParts)) {
+        QRegularExpressionMatch match = conditionRegex.match(term);
+        int metric = match.hasMatch() ? FunctionMetrics::metricIndex(match.captured(1)) : -1;
+        if (metric < 0) {
+            nameTerms.append(term);
+            continue;
+        }
+        MetricCondition condition;
+        condition.metric = metric;
+        QString op = match.captured(2);
+        condition.op = op == QLatin1String("<=") ? 'l'
+                       : op == QLatin1String(">=") ? 'g'
+                       : op.at(0).toLatin1();
+        condition.threshold = match.captured(3).toFloat();
+        metricConditions.append(condition);
+    }
+    if (metricConditions.isEmpty()) {
+        nameFilter = filterRegExp();
+    } else {
+        nameFilter = QRegExp(nameTerms.join(QLatin1Char(' ')), filterCaseSensitivity(),
+                             QRegExp::Wildcard);
+    }
+}
+
+bool FunctionSortFilterProxyModel::hasMetricFilter() const
+{
+    if (filterRegExp().pattern() != filterPattern) {
+        parseFilter(filterRegExp().pattern());
+    }
+    return !metricConditions.isEmpty();
 }
 
 bool FunctionSortFilterProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
@@ -416,8 +538,29 @@ bool FunctionSortFilterProxyModel::lessThan(const QModelIndex &left, const QMode
             if (left_function.stackframe != right_function.stackframe)
                 return left_function.stackframe < right_function.stackframe;
             break;
-        default:
-            return false;
+        case FunctionModel::XrefsColumn: {
+            int leftXrefs = XrefIndex::instance()->inDegree(left_function.offset);
+            int rightXrefs = XrefIndex::instance()->inDegree(right_function.offset);
+            if (leftXrefs != rightXrefs)
+                return leftXrefs < rightXrefs;
+            break;
+        }
+        default: {
+            int metric = left.column() - FunctionModel::ColumnCount;
+            if (metric < 0)
+                return false;
+            const QVector<float> *leftMetrics = FunctionMetrics::instance()->metrics(left_function.offset);
+            const QVector<float> *rightMetrics = FunctionMetrics::instance()->metrics(right_function.offset);
+            if (!leftMetrics || !rightMetrics) {
+                // Functions without metrics yet sort first
+                if (leftMetrics != rightMetrics)
+                    return !leftMetrics;
+                break;
+            }
+            if (leftMetrics->at(metric) != rightMetrics->at(metric))
+                return leftMetrics->at(metric) < rightMetrics->at(metric);
+            break;
+        }
         }
 
         return left_function.offset < right_function.offset;
@@ -428,6 +571,8 @@ FunctionsWidget::FunctionsWidget(MainWindow *main) :
     ListDockWidget(main),
     actionRename(tr("Rename"), this),
     actionUndefine(tr("Undefine"), this),
+    actionFindSimilar(tr("Find Similar Functions"), this),
+    actionIndexSimilarity(tr("Index Functions for Similarity Search"), this),
     actionHorizontal(tr("Horizontal"), this),
     actionVertical(tr("Vertical"), this)
 {
@@ -436,6 +581,9 @@ FunctionsWidget::FunctionsWidget(MainWindow *main) :
 
     setTooltipStylesheet();
     connect(Config(), SIGNAL(colorsUpdated()), this, SLOT(setTooltipStylesheet()));
+    connect(Profiler::instance(), &Profiler::profileChanged, this, [this]() {
+        ui->treeView->viewport()->update();
+    });
 
     QFontInfo font_info = ui->treeView->fontInfo();
     QFont default_font = QFont(font_info.family(), font_info.pointSize());
@@ -458,17 +606,48 @@ FunctionsWidget::FunctionsWidget(MainWindow *main) :
     connect(&actionVertical, &QAction::toggled, this, &FunctionsWidget::onActionVerticalToggled);
     titleContextMenu->addActions(viewTypeGroup->actions());
 
+    QMenu *metricsMenu = titleContextMenu->addMenu(tr("Metric Columns"));
+    for (int i = 0; i < FunctionMetrics::definitions().size(); i++) {
+        const FunctionMetricDefinition &metric = FunctionMetrics::definitions()[i];
+        QAction *action = metricsMenu->addAction(metric.name);
+        action->setToolTip(metric.description);
+        action->setCheckable(true);
+        connect(action, &QAction::toggled, this, [this, i](bool checked) {
+            if (checked) {
+                visibleMetrics.insert(i);
+                updateMetrics();
+            } else {
+                visibleMetrics.remove(i);
+            }
+            updateMetricColumns();
+        });
+    }
+    updateMetricColumns();
+
+    connect(ui->quickFilterView, &QuickFilterView::filterTextChanged, this, [this] {
+        if (functionProxyModel->hasMetricFilter()) {
+            updateMetrics();
+        }
+    });
+
     actionRename.setShortcut({Qt::Key_N});
     actionRename.setShortcutContext(Qt::ShortcutContext::WidgetWithChildrenShortcut);
     connect(&actionRename, &QAction::triggered, this,
             &FunctionsWidget::onActionFunctionsRenameTriggered);
     connect(&actionUndefine, &QAction::triggered, this,
             &FunctionsWidget::onActionFunctionsUndefineTriggered);
+    connect(&actionFindSimilar, &QAction::triggered, this,
+            &FunctionsWidget::onActionFindSimilarTriggered);
+    connect(&actionIndexSimilarity, &QAction::triggered, this,
+            &FunctionsWidget::onActionIndexSimilarityTriggered);
 
     auto itemConextMenu = ui->treeView->getItemContextMenu();
     itemConextMenu->addSeparator();
     itemConextMenu->addAction(&actionRename);
     itemConextMenu->addAction(&actionUndefine);
+    itemConextMenu->addSeparator();
+    itemConextMenu->addAction(&actionFindSimilar);
+    itemConextMenu->addAction(&actionIndexSimilarity);
     itemConextMenu->setWholeFunction(true);
 
     addActions(itemConextMenu->actions());
@@ -498,6 +677,12 @@ void FunctionsWidget::refreshTree()
         functionModel->beginResetModel();
 
         this->functions = functions;
+        size_t bytes = 0;
+        for (const FunctionDescription &function : functions) {
+            bytes += sizeof(FunctionDescription) + MemoryAccounting::stringSize(function.name)
+                     + MemoryAccounting::stringSize(function.calltype);
+        }
+        functionsAccount.update(bytes, functions.size());
 
         importAddresses.clear();
         for (const ImportDescription &import : Core()->getAllImports()) {
@@ -508,6 +693,10 @@ void FunctionsWidget::refreshTree()
 
         functionModel->updateCurrentIndex();
         functionModel->endResetModel();
+        updateMetricColumns();
+        if (!visibleMetrics.isEmpty() || functionProxyModel->hasMetricFilter()) {
+            updateMetrics();
+        }
 
         // resize offset and size columns
         qhelpers::adjustColumns(ui->treeView, 3, 0);
@@ -515,6 +704,19 @@ void FunctionsWidget::refreshTree()
     Core()->getAsyncTaskManager()->start(task);
 }
 
+void FunctionsWidget::updateMetricColumns()
+{
+    for (int i = 0; i < FunctionMetrics::definitions().size(); i++) {
+        ui->treeView->setColumnHidden(FunctionModel::ColumnCount + i, !visibleMetrics.contains(i));
+    }
+}
+
+void FunctionsWidget::updateMetrics()
+{
+    // Only functions whose content changed since the last update are analyzed again
+    FunctionMetrics::instance()->update(functions);
+}
+
 void FunctionsWidget::changeSizePolicy(QSizePolicy::Policy hor, QSizePolicy::Policy ver)
 {
     ui->dockWidgetContents->setSizePolicy(hor, ver);
@@ -558,6 +760,31 @@ void FunctionsWidget::onActionFunctionsUndefineTriggered()
     }
 }
 
+void FunctionsWidget::onActionFindSimilarTriggered()
+{
+    QList<FunctionDescription> selectedFunctions;
+    QSet<RVA> offsets;
+    for (const QModelIndex &index : ui->treeView->selectionModel()->selectedRows()) {
+        FunctionDescription function = index.data(
+                                           FunctionModel::FunctionDescriptionRole).value<FunctionDescription>();
+        if (!offsets.contains(function.offset)) {
+            offsets.insert(function.offset);
+            selectedFunctions.append(function);
+        }
+    }
+    if (selectedFunctions.isEmpty()) {
+        return;
+    }
+    SimilarFunctionsDialog dialog(selectedFunctions, this);
+    dialog.exec();
+}
+
+void FunctionsWidget::onActionIndexSimilarityTriggered()
+{
+    AsyncTask::Ptr indexTask(new SimilarityIndexTask());
+    Core()->getAsyncTaskManager()->start(indexTask);
+}
+
 void FunctionsWidget::showTitleContextMenu(const QPoint &pt)
 {
     titleContextMenu->exec(this->mapToGlobal(pt));
@@ -568,6 +795,7 @@ void FunctionsWidget::onActionHorizontalToggled(bool enable)
     if (enable) {
         functionModel->setNested(false);
         ui->treeView->setIndentation(8);
+        updateMetricColumns();
     }
 }
 
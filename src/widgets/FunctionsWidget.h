@@ -6,6 +6,7 @@
 #include "core/Cutter.h"
 #include "CutterDockWidget.h"
 #include "widgets/ListDockWidget.h"
+#include "common/MemoryAccounting.h"
 
 class MainWindow;
 class FunctionsTask;
@@ -38,7 +39,7 @@ public:
     static const int IsImportRole = Qt::UserRole + 1;
 
     enum Column { NameColumn = 0, SizeColumn, ImportColumn, OffsetColumn, NargsColumn, NlocalsColumn,
-                  NbbsColumn, CalltypeColumn, EdgesColumn, FrameColumn, ColumnCount
+                  NbbsColumn, CalltypeColumn, EdgesColumn, FrameColumn, XrefsColumn, ColumnCount
                 };
 
     FunctionModel(QList<FunctionDescription> *functions, QSet<RVA> *importAddresses, ut64 *mainAdress,
@@ -80,9 +81,30 @@ class FunctionSortFilterProxyModel : public AddressableFilterProxyModel
 public:
     FunctionSortFilterProxyModel(FunctionModel *source_model, QObject *parent = nullptr);
 
+    /**
+     * @return whether the filter contains metric conditions like "cc>10"
+     */
+    bool hasMetricFilter() const;
+
 protected:
     bool filterAcceptsRow(int row, const QModelIndex &parent) const override;
     bool lessThan(const QModelIndex &left, const QModelIndex &right) const override;
+
+private:
+    struct MetricCondition {
+        int metric;
+        char op;    ///< '<', '>', '=', 'l' for <= or 'g' for >=
+        float threshold;
+
+        bool matches(float value) const;
+    };
+
+    // Parsed from the filter pattern on first use
+    mutable QString filterPattern;
+    mutable QList<MetricCondition> metricConditions;
+    mutable QRegExp nameFilter;
+
+    void parseFilter(const QString &pattern) const;
 };
 
 
@@ -99,6 +121,8 @@ public:
 private slots:
     void onActionFunctionsRenameTriggered();
     void onActionFunctionsUndefineTriggered();
+    void onActionFindSimilarTriggered();
+    void onActionIndexSimilarityTriggered();
     void onActionHorizontalToggled(bool enable);
     void onActionVerticalToggled(bool enable);
     void showTitleContextMenu(const QPoint &pt);
@@ -106,17 +130,24 @@ private slots:
     void refreshTree();
 
 private:
+    void updateMetricColumns();
+    void updateMetrics();
+
     QSharedPointer<FunctionsTask> task;
     QList<FunctionDescription> functions;
+    MemoryAccount functionsAccount { QStringLiteral("Function list") };
     QSet<RVA> importAddresses;
     ut64 mainAdress;
     FunctionModel *functionModel;
     FunctionSortFilterProxyModel *functionProxyModel;
 
     QMenu *titleContextMenu;
+    QSet<int> visibleMetrics;
 
     QAction actionRename;
     QAction actionUndefine;
+    QAction actionFindSimilar;
+    QAction actionIndexSimilarity;
     QAction actionHorizontal;
     QAction actionVertical;
 };
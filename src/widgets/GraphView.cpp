@@ -27,6 +27,9 @@ GraphView::GraphView(QWidget *parent)
     , cacheTexture(0)
     , cacheFBO(0)
 #endif
+    , cacheAccount(QStringLiteral("Graph render cache"), [this](size_t) {
+        dropCache();
+    })
 {
 #ifndef CUTTER_NO_OPENGL_GRAPH
     if (useGL) {
@@ -207,6 +210,7 @@ void GraphView::paintEvent(QPaintEvent *)
         paintGraphCache();
         cacheDirty = false;
     }
+    cacheAccount.touch();
 
     if (useGL) {
 #ifndef CUTTER_NO_OPENGL_GRAPH
@@ -303,6 +307,20 @@ void GraphView::paintGraphCache()
     paint(p, offset, this->viewport()->rect(), current_scale);
 
     p.end();
+
+    QSize size = getCacheSize();
+    cacheAccount.update(static_cast<size_t>(size.width()) * size.height() * 4, 1);
+}
+
+void GraphView::dropCache()
+{
+    if (useGL) {
+        // The texture can only be released with the GL context current
+        return;
+    }
+    pixmap = QPixmap();
+    setCacheDirty();
+    cacheAccount.clear();
 }
 
 void GraphView::paint(QPainter &p, QPoint offset, QRect viewport, qreal scale, bool interactive)
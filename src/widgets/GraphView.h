@@ -16,6 +16,7 @@
 
 #include "core/Cutter.h"
 #include "widgets/GraphLayout.h"
+#include "common/MemoryAccounting.h"
 
 #if defined(QT_NO_OPENGL) || QT_VERSION < QT_VERSION_CHECK(5, 6, 0)
 // QOpenGLExtraFunctions were introduced in 5.6
@@ -180,6 +181,11 @@ private:
      * @brief flag to control if the cache is invalid and should be re-created in the next draw
      */
     bool cacheDirty = true;
+    /**
+     * @brief accounts the cache pixmap or texture, only the pixmap can be evicted
+     */
+    MemoryAccount cacheAccount;
+    void dropCache();
     QSize getCacheSize();
     qreal getCacheDevicePixelRatioF();
     QSize getRequiredCacheSize();
@@ -1,6 +1,7 @@
 #include "HexWidget.h"
 #include "Cutter.h"
 #include "Configuration.h"
+#include "common/EditJournal.h"
 #include "dialogs/WriteCommandsDialogs.h"
 
 #include <QPainter>
@@ -703,7 +704,7 @@ void HexWidget::w_writeString()
     QString str = d.getText(this, tr("Write string"),
                             tr("String:"), QLineEdit::Normal, "", &ok);
     if (ok && !str.isEmpty()) {
-        Core()->cmdRawAt(QString("w %1")
+        Core()->cmdEdit(QString("w %1")
                             .arg(str),
                             getLocationAddress());
         refresh();
@@ -721,7 +722,7 @@ void HexWidget::w_increaseDecrease()
         return;
     }
     QString mode = d.getMode() == IncrementDecrementDialog::Increase ? "+" : "-";
-    Core()->cmdRawAt(QString("w%1%2 %3")
+    Core()->cmdEdit(QString("w%1%2 %3")
                         .arg(QString::number(d.getNBytes()))
                         .arg(mode)
                         .arg(QString::number(d.getValue())),
@@ -745,7 +746,7 @@ void HexWidget::w_writeZeros()
     QString str = QString::number(d.getInt(this, tr("Write zeros"),
                                            tr("Number of zeros:"), size, 1, 0x7FFFFFFF, 1, &ok));
     if (ok && !str.isEmpty()) {
-        Core()->cmdRawAt(QString("w0 %1")
+        Core()->cmdEdit(QString("w0 %1")
                             .arg(str),
                             getLocationAddress());
         refresh();
@@ -773,7 +774,7 @@ void HexWidget::w_write64()
         return;
     }
 
-    Core()->cmdRawAt(QString("w6%1 %2")
+    Core()->cmdEdit(QString("w6%1 %2")
                         .arg(mode)
                         .arg((mode == "e" ? str.toHex() : str).toStdString().c_str()),
                         getLocationAddress());
@@ -795,9 +796,13 @@ void HexWidget::w_writeRandom()
     QString nbytes = QString::number(d.getInt(this, tr("Write random"),
                                            tr("Number of bytes:"), size, 1, 0x7FFFFFFF, 1, &ok));
     if (ok && !nbytes.isEmpty()) {
+        RVA addr = getLocationAddress();
         Core()->cmdRawAt(QString("wr %1")
                             .arg(nbytes),
-                            getLocationAddress());
+                            addr);
+        // Replaying wr would write other bytes, journal the written ones instead
+        EditJournal::instance()->recordCommand("wx " + Core()->ioRead(addr, nbytes.toInt()).toHex(),
+                                               addr);
         refresh();
     }
 }
@@ -814,7 +819,7 @@ void HexWidget::w_duplFromOffset()
     }
     RVA copyFrom = d.getOffset();
     QString nBytes = QString::number(d.getNBytes());
-    Core()->cmdRawAt(QString("wd %1 %2")
+    Core()->cmdEdit(QString("wd %1 %2")
                             .arg(copyFrom)
                             .arg(nBytes),
                             getLocationAddress());
@@ -832,7 +837,7 @@ void HexWidget::w_writePascalString()
     QString str = d.getText(this, tr("Write Pascal string"),
                             tr("String:"), QLineEdit::Normal, "", &ok);
     if (ok && !str.isEmpty()) {
-        Core()->cmdRawAt(QString("ws %1")
+        Core()->cmdEdit(QString("ws %1")
                             .arg(str),
                             getLocationAddress());
         refresh();
@@ -850,7 +855,7 @@ void HexWidget::w_writeWideString()
     QString str = d.getText(this, tr("Write wide string"),
                             tr("String:"), QLineEdit::Normal, "", &ok);
     if (ok && !str.isEmpty()) {
-        Core()->cmdRawAt(QString("ww %1")
+        Core()->cmdEdit(QString("ww %1")
                             .arg(str),
                             getLocationAddress());
         refresh();
@@ -868,7 +873,7 @@ void HexWidget::w_writeCString()
     QString str = d.getText(this, tr("Write zero-terminated string"),
                             tr("String:"), QLineEdit::Normal, "", &ok);
     if (ok && !str.isEmpty()) {
-        Core()->cmdRawAt(QString("wz %1")
+        Core()->cmdEdit(QString("wz %1")
                             .arg(str),
                             getLocationAddress());
         refresh();
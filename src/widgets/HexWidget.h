@@ -4,6 +4,7 @@
 #include "Cutter.h"
 #include "dialogs/HexdumpRangeDialog.h"
 #include "common/IOModesController.h"
+#include "common/MemoryAccounting.h"
 
 #include <QScrollArea>
 #include <QTimer>
@@ -143,6 +144,7 @@ public:
         for (ut64 i = 0; i < len / blockSize; ++i, addr += blockSize) {
             m_blocks.append(Core()->ioRead(addr, blockSize));
         }
+        m_account.update(m_blocks.size() * BLOCK_SIZE, m_blocks.size());
     }
 
     bool copy(void *out, uint64_t addr, size_t len) override {
@@ -176,6 +178,7 @@ public:
 
 private:
     QVector<QByteArray> m_blocks;
+    MemoryAccount m_account { QStringLiteral("Hex view blocks") };
     uint64_t m_firstBlockAddr = 0;
     uint64_t m_lastValidAddr = 0;
 };
@@ -3,6 +3,7 @@
 #include "WidgetShortcuts.h"
 #include "core/MainWindow.h"
 #include "common/Helpers.h"
+#include "common/XrefGraph.h"
 
 #include <QPainter>
 #include <QPen>
@@ -12,7 +13,13 @@
 ImportsModel::ImportsModel(QList<ImportDescription> *imports, QObject *parent) :
     AddressableItemModel(parent),
     imports(imports)
-{}
+{
+    connect(XrefIndex::instance(), &XrefIndex::updated, this, [this]() {
+        if (!this->imports->isEmpty()) {
+            emit dataChanged(index(0, XrefsColumn), index(this->imports->size() - 1, XrefsColumn));
+        }
+    });
+}
 
 int ImportsModel::rowCount(const QModelIndex &parent) const
 {
@@ -50,6 +57,11 @@ QVariant ImportsModel::data(const QModelIndex &index, int role) const
             return import.libname;
         case ImportsModel::NameColumn:
             return import.name;
+        case ImportsModel::XrefsColumn:
+            if (!XrefIndex::instance()->isReady() || import.plt == 0) {
+                return QVariant();
+            }
+            return QString::number(XrefIndex::instance()->inDegree(import.plt));
         default:
             break;
         }
@@ -78,6 +90,8 @@ QVariant ImportsModel::headerData(int section, Qt::Orientation, int role) const
             return tr("Library");
         case ImportsModel::NameColumn:
             return tr("Name");
+        case ImportsModel::XrefsColumn:
+            return tr("Xrefs");
         default:
             break;
         }
@@ -142,6 +156,9 @@ bool ImportsProxyModel::lessThan(const QModelIndex &left, const QModelIndex &rig
     // Fallthrough. Sort by Library and then by import name
     case ImportsModel::NameColumn:
         return leftImport.name < rightImport.name;
+    case ImportsModel::XrefsColumn:
+        return XrefIndex::instance()->inDegree(leftImport.plt)
+               < XrefIndex::instance()->inDegree(rightImport.plt);
         
     default:
         break;
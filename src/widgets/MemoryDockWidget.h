@@ -8,8 +8,8 @@
 
 class CutterSeekable;
 
-/* Disassembly/Graph/Hexdump/Decompiler view priority */
-enum class MemoryWidgetType { Disassembly, Graph, Hexdump, Decompiler };
+/* Disassembly/Graph/Hexdump/Decompiler/ByteMap view priority */
+enum class MemoryWidgetType { Disassembly, Graph, Hexdump, Decompiler, ByteMap };
 
 class MemoryDockWidget : public CutterDockWidget
 {
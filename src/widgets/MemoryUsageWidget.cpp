@@ -0,0 +1,229 @@
+#include "MemoryUsageWidget.h"
+
+#include "core/MainWindow.h"
+#include "widgets/CutterTreeView.h"
+
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QVBoxLayout>
+
+static const size_t MiB = 1024 * 1024;
+
+MemoryUsageModel::MemoryUsageModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+void MemoryUsageModel::refresh()
+{
+    QList<MemoryAccounting::CategoryUsage> newUsage = MemoryAccounting::instance()->getUsage();
+    bool sameCategories = newUsage.size() == usage.size();
+    for (int i = 0; sameCategories && i < usage.size(); i++) {
+        sameCategories = usage[i].category == newUsage[i].category;
+    }
+    if (!sameCategories) {
+        beginResetModel();
+        usage = newUsage;
+        endResetModel();
+        return;
+    }
+    // Keep the editor and selection alive while numbers change
+    usage = newUsage;
+    if (!usage.isEmpty()) {
+        emit dataChanged(index(0, InstancesColumn), index(usage.size() - 1, BudgetColumn));
+    }
+}
+
+QString MemoryUsageModel::formatSize(size_t bytes)
+{
+    if (bytes >= 1024 * MiB) {
+        return QString("%1 GiB").arg(bytes / double(1024 * MiB), 0, 'f', 2);
+    }
+    if (bytes >= MiB) {
+        return QString("%1 MiB").arg(bytes / double(MiB), 0, 'f', 1);
+    }
+    if (bytes >= 1024) {
+        return QString("%1 KiB").arg(bytes / 1024.0, 0, 'f', 1);
+    }
+    return QString("%1 B").arg(bytes);
+}
+
+int MemoryUsageModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : usage.size();
+}
+
+int MemoryUsageModel::columnCount(const QModelIndex &) const
+{
+    return ColumnCount;
+}
+
+QVariant MemoryUsageModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= usage.size()) {
+        return QVariant();
+    }
+    const MemoryAccounting::CategoryUsage &category = usage[index.row()];
+
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case CategoryColumn:
+            return category.category;
+        case InstancesColumn:
+            return category.accounts;
+        case EntriesColumn:
+            return static_cast<qulonglong>(category.entries);
+        case SizeColumn:
+            return formatSize(category.bytes);
+        case BudgetColumn:
+            if (!category.evictable) {
+                return tr("n/a");
+            }
+            return category.budget ? formatSize(category.budget) : tr("Unlimited");
+        default:
+            return QVariant();
+        }
+    case Qt::EditRole:
+        if (index.column() == BudgetColumn) {
+            return static_cast<qulonglong>(category.budget / MiB);
+        }
+        return QVariant();
+    case Qt::ToolTipRole:
+        if (index.column() == BudgetColumn) {
+            return category.evictable
+                   ? tr("Budget in MiB, least recently used data is evicted above it. 0 for unlimited.")
+                   : tr("This data is in use and can not be evicted.");
+        }
+        return QVariant();
+    case Qt::TextAlignmentRole:
+        if (index.column() != CategoryColumn) {
+            return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+        }
+        return QVariant();
+    default:
+        return QVariant();
+    }
+}
+
+bool MemoryUsageModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (role != Qt::EditRole || !(flags(index) & Qt::ItemIsEditable)) {
+        return false;
+    }
+    bool ok;
+    qulonglong budget = value.toULongLong(&ok);
+    if (!ok) {
+        return false;
+    }
+    MemoryAccounting::instance()->setBudget(usage[index.row()].category, budget * MiB);
+    refresh();
+    return true;
+}
+
+Qt::ItemFlags MemoryUsageModel::flags(const QModelIndex &index) const
+{
+    Qt::ItemFlags flags = QAbstractTableModel::flags(index);
+    if (index.isValid() && index.column() == BudgetColumn && usage[index.row()].evictable) {
+        flags |= Qt::ItemIsEditable;
+    }
+    return flags;
+}
+
+QVariant MemoryUsageModel::headerData(int section, Qt::Orientation, int role) const
+{
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    switch (section) {
+    case CategoryColumn:
+        return tr("Cache");
+    case InstancesColumn:
+        return tr("Instances");
+    case EntriesColumn:
+        return tr("Entries");
+    case SizeColumn:
+        return tr("Size");
+    case BudgetColumn:
+        return tr("Budget");
+    default:
+        return QVariant();
+    }
+}
+
+MemoryUsageWidget::MemoryUsageWidget(MainWindow *main) :
+    CutterDockWidget(main)
+{
+    setObjectName("MemoryUsageWidget");
+    setWindowTitle(tr("Memory Usage"));
+
+    QWidget *contents = new QWidget(this);
+    QVBoxLayout *layout = new QVBoxLayout(contents);
+    layout->setContentsMargins(0, 0, 0, 0);
+
+    QHBoxLayout *budgetLayout = new QHBoxLayout();
+    budgetLayout->setContentsMargins(6, 6, 6, 0);
+    totalLabel = new QLabel(contents);
+    budgetLayout->addWidget(totalLabel);
+    budgetLayout->addStretch();
+    budgetLayout->addWidget(new QLabel(tr("Global budget:"), contents));
+    globalBudgetSpinBox = new QSpinBox(contents);
+    globalBudgetSpinBox->setRange(0, 1024 * 1024);
+    globalBudgetSpinBox->setSingleStep(64);
+    globalBudgetSpinBox->setSuffix(tr(" MiB"));
+    globalBudgetSpinBox->setSpecialValueText(tr("Unlimited"));
+    globalBudgetSpinBox->setValue(static_cast<int>(MemoryAccounting::instance()->getGlobalBudget() / MiB));
+    budgetLayout->addWidget(globalBudgetSpinBox);
+    QPushButton *trimButton = new QPushButton(tr("Trim caches"), contents);
+    trimButton->setToolTip(tr("Release everything that can be recreated on demand"));
+    budgetLayout->addWidget(trimButton);
+    layout->addLayout(budgetLayout);
+
+    model = new MemoryUsageModel(this);
+    treeView = new CutterTreeView(contents);
+    treeView->setModel(model);
+    treeView->setRootIsDecorated(false);
+    treeView->setUniformRowHeights(true);
+    treeView->setFrameShape(QFrame::NoFrame);
+    treeView->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::EditKeyPressed);
+    treeView->header()->setSectionResizeMode(MemoryUsageModel::CategoryColumn, QHeaderView::Stretch);
+    treeView->header()->setStretchLastSection(false);
+    layout->addWidget(treeView);
+
+    setWidget(contents);
+
+    refreshDeferrer = createRefreshDeferrer([this]() {
+        refreshUsage();
+    });
+
+    connect(MemoryAccounting::instance(), &MemoryAccounting::usageChanged,
+            this, &MemoryUsageWidget::refreshUsage);
+    connect(globalBudgetSpinBox, &QSpinBox::editingFinished, this, [this]() {
+        MemoryAccounting::instance()->setGlobalBudget(static_cast<size_t>(globalBudgetSpinBox->value()) * MiB);
+    });
+    connect(trimButton, &QPushButton::clicked, this, []() {
+        MemoryAccounting::instance()->evictAll();
+    });
+}
+
+MemoryUsageWidget::~MemoryUsageWidget() = default;
+
+void MemoryUsageWidget::refreshUsage()
+{
+    if (!refreshDeferrer->attemptRefresh(nullptr)) {
+        return;
+    }
+    model->refresh();
+
+    size_t total = MemoryAccounting::instance()->getTotalBytes();
+    size_t budget = MemoryAccounting::instance()->getGlobalBudget();
+    if (budget) {
+        totalLabel->setText(tr("Total: %1 of %2").arg(MemoryUsageModel::formatSize(total),
+                                                      MemoryUsageModel::formatSize(budget)));
+    } else {
+        totalLabel->setText(tr("Total: %1").arg(MemoryUsageModel::formatSize(total)));
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef MEMORYUSAGEWIDGET_H
+#define MEMORYUSAGEWIDGET_H
+
+#include "CutterDockWidget.h"
+#include "common/MemoryAccounting.h"
+
+#include <QAbstractTableModel>
+
+class MainWindow;
+class QLabel;
+class QSpinBox;
+class CutterTreeView;
+
+class MemoryUsageModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column { CategoryColumn = 0, InstancesColumn, EntriesColumn, SizeColumn, BudgetColumn, ColumnCount };
+
+    explicit MemoryUsageModel(QObject *parent = nullptr);
+
+    void refresh();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    static QString formatSize(size_t bytes);
+
+private:
+    QList<MemoryAccounting::CategoryUsage> usage;
+};
+
+/**
+ * @brief Breakdown of the memory reported through MemoryAccounting, with editable budgets.
+ */
+class MemoryUsageWidget : public CutterDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MemoryUsageWidget(MainWindow *main);
+    ~MemoryUsageWidget() override;
+
+private slots:
+    void refreshUsage();
+
+private:
+    MemoryUsageModel *model;
+    CutterTreeView *treeView;
+    QLabel *totalLabel;
+    QSpinBox *globalBudgetSpinBox;
+    RefreshDeferrer *refreshDeferrer;
+};
+
+#endif // MEMORYUSAGEWIDGET_H
@@ -0,0 +1,268 @@
+#include "MemoryWatchWidget.h"
+
+#include "core/MainWindow.h"
+#include "widgets/CutterTreeView.h"
+
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSplitter>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+MemoryWatchLogModel::MemoryWatchLogModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+    rows = static_cast<int>(MemoryWatch::instance()->getChanges().size());
+    connect(MemoryWatch::instance(), &MemoryWatch::changesAdded, this,
+            &MemoryWatchLogModel::onChangesAdded);
+    connect(MemoryWatch::instance(), &MemoryWatch::changesReset, this,
+            &MemoryWatchLogModel::onChangesReset);
+}
+
+void MemoryWatchLogModel::onChangesAdded(int first)
+{
+    int size = static_cast<int>(MemoryWatch::instance()->getChanges().size());
+    if (first != rows || size <= rows) {
+        onChangesReset();
+        return;
+    }
+    beginInsertRows(QModelIndex(), rows, size - 1);
+    rows = size;
+    endInsertRows();
+}
+
+void MemoryWatchLogModel::onChangesReset()
+{
+    beginResetModel();
+    rows = static_cast<int>(MemoryWatch::instance()->getChanges().size());
+    endResetModel();
+}
+
+int MemoryWatchLogModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : rows;
+}
+
+int MemoryWatchLogModel::columnCount(const QModelIndex &) const
+{
+    return ColumnCount;
+}
+
+QVariant MemoryWatchLogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows) {
+        return QVariant();
+    }
+    const MemoryWatchChange &change = MemoryWatch::instance()->getChanges()[static_cast<size_t>(index.row())];
+
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case IndexColumn:
+            return index.row() + 1;
+        case AddressColumn:
+            return RAddressString(change.address);
+        case PcColumn:
+            return RAddressString(change.pc);
+        case OldValueColumn:
+            return RHexString(change.oldValue).rightJustified(change.size * 2 + 2, ' ');
+        case NewValueColumn:
+            return RHexString(change.newValue).rightJustified(change.size * 2 + 2, ' ');
+        default:
+            return QVariant();
+        }
+    case Qt::ToolTipRole:
+        if (index.column() == PcColumn) {
+            return Core()->cmdRawAt("pi 1", change.pc).trimmed();
+        }
+        return QVariant();
+    case AddressRole:
+        return QVariant::fromValue(index.column() == PcColumn ? change.pc : change.address);
+    default:
+        return QVariant();
+    }
+}
+
+QVariant MemoryWatchLogModel::headerData(int section, Qt::Orientation, int role) const
+{
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    switch (section) {
+    case IndexColumn:
+        return tr("#");
+    case AddressColumn:
+        return tr("Address");
+    case PcColumn:
+        return tr("Written by");
+    case OldValueColumn:
+        return tr("Old value");
+    case NewValueColumn:
+        return tr("New value");
+    default:
+        return QVariant();
+    }
+}
+
+MemoryWatchLogProxyModel::MemoryWatchLogProxyModel(QObject *parent)
+    : QSortFilterProxyModel(parent)
+{
+    setFilterCaseSensitivity(Qt::CaseInsensitive);
+}
+
+bool MemoryWatchLogProxyModel::filterAcceptsRow(int row, const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    const QString pattern = filterRegExp().pattern();
+    if (pattern.isEmpty()) {
+        return true;
+    }
+    const MemoryWatchChange &change = MemoryWatch::instance()->getChanges()[static_cast<size_t>(row)];
+    QString address = RAddressString(change.address);
+    QString pc = RAddressString(change.pc);
+    for (const QString &term : pattern.split(QLatin1Char(' '), QString::SkipEmptyParts)) {
+        if (!address.contains(term, Qt::CaseInsensitive) && !pc.contains(term, Qt::CaseInsensitive)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+MemoryWatchWidget::MemoryWatchWidget(MainWindow *main) :
+    CutterDockWidget(main)
+{
+    setObjectName("MemoryWatchWidget");
+    setWindowTitle(tr("Memory Watches"));
+
+    QWidget *contents = new QWidget(this);
+    QVBoxLayout *layout = new QVBoxLayout(contents);
+    layout->setContentsMargins(0, 0, 0, 0);
+
+    QHBoxLayout *addLayout = new QHBoxLayout();
+    addLayout->setContentsMargins(6, 6, 6, 0);
+    addressEdit = new QLineEdit(contents);
+    addressEdit->setPlaceholderText(tr("Address or expression"));
+    addLayout->addWidget(addressEdit);
+    sizeCombo = new QComboBox(contents);
+    for (int size : { 1, 2, 4, 8 }) {
+        sizeCombo->addItem(tr("%n byte(s)", nullptr, size), size);
+    }
+    sizeCombo->setCurrentIndex(2);
+    addLayout->addWidget(sizeCombo);
+    QPushButton *addButton = new QPushButton(tr("Watch"), contents);
+    addLayout->addWidget(addButton);
+    QPushButton *removeButton = new QPushButton(tr("Remove"), contents);
+    addLayout->addWidget(removeButton);
+    layout->addLayout(addLayout);
+
+    QSplitter *splitter = new QSplitter(Qt::Vertical, contents);
+    watchList = new QTreeWidget(splitter);
+    watchList->setHeaderLabels({ tr("Address"), tr("Size"), tr("Value") });
+    watchList->setRootIsDecorated(false);
+    watchList->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    watchList->setFrameShape(QFrame::NoFrame);
+
+    QWidget *logContents = new QWidget(splitter);
+    QVBoxLayout *logLayout = new QVBoxLayout(logContents);
+    logLayout->setContentsMargins(0, 0, 0, 0);
+    QHBoxLayout *filterLayout = new QHBoxLayout();
+    filterLayout->setContentsMargins(6, 0, 6, 0);
+    filterEdit = new QLineEdit(logContents);
+    filterEdit->setPlaceholderText(tr("Filter by address or instruction"));
+    filterEdit->setClearButtonEnabled(true);
+    filterLayout->addWidget(filterEdit);
+    QPushButton *clearButton = new QPushButton(tr("Clear log"), logContents);
+    filterLayout->addWidget(clearButton);
+    logLayout->addLayout(filterLayout);
+
+    logModel = new MemoryWatchLogModel(this);
+    logProxyModel = new MemoryWatchLogProxyModel(this);
+    logProxyModel->setSourceModel(logModel);
+    logView = new CutterTreeView(logContents);
+    logView->setModel(logProxyModel);
+    logView->setRootIsDecorated(false);
+    logView->setUniformRowHeights(true);
+    logView->setFrameShape(QFrame::NoFrame);
+    logLayout->addWidget(logView);
+
+    splitter->setStretchFactor(1, 3);
+    layout->addWidget(splitter);
+    setWidget(contents);
+
+    connect(addButton, &QPushButton::clicked, this, &MemoryWatchWidget::addWatch);
+    connect(addressEdit, &QLineEdit::returnPressed, this, &MemoryWatchWidget::addWatch);
+    connect(removeButton, &QPushButton::clicked, this, &MemoryWatchWidget::removeSelectedWatches);
+    connect(clearButton, &QPushButton::clicked, MemoryWatch::instance(), &MemoryWatch::clearChanges);
+    connect(filterEdit, &QLineEdit::textChanged, logProxyModel,
+            &QSortFilterProxyModel::setFilterFixedString);
+    connect(logView, &QAbstractItemView::doubleClicked, this, [](const QModelIndex &index) {
+        Core()->seekAndShow(index.data(MemoryWatchLogModel::AddressRole).toULongLong());
+    });
+    connect(watchList, &QTreeWidget::itemDoubleClicked, this, [](QTreeWidgetItem *item) {
+        Core()->seekAndShow(item->data(0, Qt::UserRole).toULongLong());
+    });
+    connect(MemoryWatch::instance(), &MemoryWatch::watchesChanged, this,
+            &MemoryWatchWidget::refreshWatches);
+    connect(MemoryWatch::instance(), &MemoryWatch::changesAdded, this,
+            &MemoryWatchWidget::refreshWatches);
+    connect(MemoryWatch::instance(), &MemoryWatch::changesReset, this,
+            &MemoryWatchWidget::refreshWatches);
+
+    refreshWatches();
+}
+
+MemoryWatchWidget::~MemoryWatchWidget() = default;
+
+void MemoryWatchWidget::addWatch()
+{
+    QString expression = addressEdit->text().trimmed();
+    if (expression.isEmpty()) {
+        return;
+    }
+    RVA address = Core()->math(expression);
+    int size = sizeCombo->currentData().toInt();
+    if (!MemoryWatch::instance()->addWatch(address, size)) {
+        QMessageBox::warning(this, tr("Memory Watches"),
+                             tr("Can not watch %1 bytes at %2. The location must be mapped "
+                                "and may not cross a page boundary.")
+                             .arg(size).arg(RAddressString(address)));
+        return;
+    }
+    addressEdit->clear();
+}
+
+void MemoryWatchWidget::removeSelectedWatches()
+{
+    QList<RVA> addresses;
+    for (QTreeWidgetItem *item : watchList->selectedItems()) {
+        addresses.append(item->data(0, Qt::UserRole).toULongLong());
+    }
+    for (RVA address : addresses) {
+        MemoryWatch::instance()->removeWatch(address);
+    }
+}
+
+void MemoryWatchWidget::refreshWatches()
+{
+    const auto &watches = MemoryWatch::instance()->getWatches();
+    if (watchList->topLevelItemCount() != watches.size()) {
+        watchList->clear();
+        for (auto it = watches.constBegin(); it != watches.constEnd(); ++it) {
+            QTreeWidgetItem *item = new QTreeWidgetItem(watchList);
+            item->setData(0, Qt::UserRole, QVariant::fromValue(it.key()));
+        }
+    }
+    int row = 0;
+    for (auto it = watches.constBegin(); it != watches.constEnd(); ++it, ++row) {
+        QTreeWidgetItem *item = watchList->topLevelItem(row);
+        item->setData(0, Qt::UserRole, QVariant::fromValue(it.key()));
+        item->setText(0, RAddressString(it.key()));
+        item->setText(1, QString::number(it->size));
+        item->setText(2, RHexString(it->value));
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef MEMORYWATCHWIDGET_H
+#define MEMORYWATCHWIDGET_H
+
+#include "CutterDockWidget.h"
+#include "common/MemoryWatch.h"
+
+#include <QAbstractTableModel>
+#include <QSortFilterProxyModel>
+
+class MainWindow;
+class QComboBox;
+class QLineEdit;
+class QTreeWidget;
+class CutterTreeView;
+
+class MemoryWatchLogModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column { IndexColumn = 0, AddressColumn, PcColumn, OldValueColumn, NewValueColumn, ColumnCount };
+    enum Role { AddressRole = Qt::UserRole };
+
+    explicit MemoryWatchLogModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    int rows = 0;
+
+    void onChangesAdded(int first);
+    void onChangesReset();
+};
+
+/**
+ * @brief Filters the change log by address or writing instruction, all terms must match.
+ */
+class MemoryWatchLogProxyModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit MemoryWatchLogProxyModel(QObject *parent = nullptr);
+
+protected:
+    bool filterAcceptsRow(int row, const QModelIndex &parent) const override;
+};
+
+/**
+ * @brief Watched memory locations and the log of their changes, see MemoryWatch.
+ */
+class MemoryWatchWidget : public CutterDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MemoryWatchWidget(MainWindow *main);
+    ~MemoryWatchWidget() override;
+
+private slots:
+    void addWatch();
+    void removeSelectedWatches();
+    void refreshWatches();
+
+private:
+    QLineEdit *addressEdit;
+    QComboBox *sizeCombo;
+    QTreeWidget *watchList;
+    MemoryWatchLogModel *logModel;
+    MemoryWatchLogProxyModel *logProxyModel;
+    CutterTreeView *logView;
+    QLineEdit *filterEdit;
+};
+
+#endif // MEMORYWATCHWIDGET_H
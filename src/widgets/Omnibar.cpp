@@ -1,6 +1,7 @@
 #include "Omnibar.h"
 #include "core/MainWindow.h"
 #include "CutterSeekable.h"
+#include "common/ConstantIndex.h"
 
 #include <QStringListModel>
 #include <QCompleter>
@@ -15,7 +16,7 @@ Omnibar::Omnibar(MainWindow *main, QWidget *parent) :
     // QLineEdit basic features
     this->setMinimumHeight(16);
     this->setFrame(false);
-    this->setPlaceholderText(tr("Type flag name or address here"));
+    this->setPlaceholderText(tr("Type flag name, address or #constant here"));
     this->setStyleSheet("border-radius: 5px; padding: 0 8px; margin: 5px 0;");
     this->setTextMargins(10, 0, 0, 0);
     this->setClearButtonEnabled(true);
@@ -26,6 +27,14 @@ Omnibar::Omnibar(MainWindow *main, QWidget *parent) :
     QShortcut *clear_shortcut = new QShortcut(QKeySequence(Qt::Key_Escape), this);
     connect(clear_shortcut, SIGNAL(activated()), this, SLOT(clear()));
     clear_shortcut->setContext(Qt::WidgetWithChildrenShortcut);
+
+    connect(ConstantIndex::instance(), &ConstantIndex::ready, this, [this]() {
+        if (!pendingConstant.isEmpty()) {
+            QString constant = pendingConstant;
+            pendingConstant.clear();
+            seekToConstant(constant);
+        }
+    });
 }
 
 void Omnibar::setupCompleter()
@@ -69,7 +78,9 @@ void Omnibar::clear()
 void Omnibar::on_gotoEntry_returnPressed()
 {
     QString str = this->text();
-    if (!str.isEmpty()) {
+    if (str.startsWith(QLatin1Char('#'))) {
+        seekToConstant(str.mid(1).trimmed());
+    } else if (!str.isEmpty()) {
         if (auto memoryWidget = main->getLastMemoryWidget()) {
             RVA offset = Core()->math(str);
             memoryWidget->getSeekable()->seek(offset);
@@ -83,3 +94,38 @@ void Omnibar::on_gotoEntry_returnPressed()
     this->clearFocus();
     this->restoreCompleter();
 }
+
+void Omnibar::seekToConstant(const QString &constant)
+{
+    ConstantIndex *index = ConstantIndex::instance();
+    if (!index->isReady()) {
+        // Answered once the changed functions are indexed
+        pendingConstant = constant;
+        index->build();
+        if (!index->isReady()) {
+            return;
+        }
+        pendingConstant.clear();
+    }
+    ut64 value = Core()->math(constant);
+    std::vector<ConstantUse> uses = index->find(value);
+    if (uses.empty()) {
+        Core()->message(tr("No analyzed instruction uses the constant %1").arg(constant));
+        return;
+    }
+    // Entering the same constant again steps through its uses
+    RVA current = Core()->getOffset();
+    RVA target = uses.front().address;
+    for (const ConstantUse &use : uses) {
+        if (use.address > current) {
+            target = use.address;
+            break;
+        }
+    }
+    if (auto memoryWidget = main->getLastMemoryWidget()) {
+        memoryWidget->getSeekable()->seek(target);
+        memoryWidget->raiseMemoryWidget();
+    } else {
+        Core()->seekAndShow(target);
+    }
+}
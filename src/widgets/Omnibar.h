@@ -23,9 +23,14 @@ public slots:
 
 private:
     void setupCompleter();
+    /**
+     * @brief Seek to the next instruction using the constant, see ConstantIndex
+     */
+    void seekToConstant(const QString &constant);
 
     MainWindow          *main;
     QStringList         flags;
+    QString             pendingConstant;
 };
 
 #endif // OMNIBAR_H
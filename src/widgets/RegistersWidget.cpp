@@ -1,12 +1,271 @@
 #include "RegistersWidget.h"
 #include "ui_RegistersWidget.h"
-#include "common/JsonModel.h"
 
 #include "core/MainWindow.h"
+#include "common/Helpers.h"
 
-#include <QCollator>
-#include <QLabel>
-#include <QLineEdit>
+#include <algorithm>
+
+constexpr int RegistersModel::LaneBits;
+constexpr int RegistersModel::TelescopeDepth;
+
+RegistersModel::RegistersModel(QObject *parent)
+    : QAbstractItemModel(parent),
+      refCacheAccount(QStringLiteral("Register references"), [this](size_t) {
+          // Telescoping is resolved again lazily for the rows still displayed
+          refCache.clear();
+          refCacheBytes = 0;
+          refCacheAccount.clear();
+      })
+{
+}
+
+void RegistersModel::setArena(RegisterArena newArena)
+{
+    bool sameProfile = arena.registers.size() == newArena.registers.size();
+    for (int i = 0; sameProfile && i < newArena.registers.size(); i++) {
+        sameProfile = arena.registers[i].name == newArena.registers[i].name
+                      && arena.registers[i].size == newArena.registers[i].size;
+    }
+
+    QVector<bool> newChanged(newArena.registers.size(), false);
+    if (sameProfile) {
+        for (int i = 0; i < newArena.registers.size(); i++) {
+            const RegisterDescription &reg = newArena.registers[i];
+            if (isVector(reg)) {
+                newChanged[i] = registerBytes(arena, arena.registers[i]) != registerBytes(newArena, reg);
+            } else {
+                newChanged[i] = registerValue(arena, arena.registers[i]) != registerValue(newArena, reg);
+            }
+        }
+    }
+
+    if (!sameProfile) {
+        beginResetModel();
+    }
+    arena = std::move(newArena);
+    changed = std::move(newChanged);
+    refCache.clear();
+    refCacheBytes = 0;
+    refCacheAccount.clear();
+    if (!sameProfile) {
+        endResetModel();
+    } else if (!arena.registers.isEmpty()) {
+        // Keep expanded vector registers and the selection, only the values are stale
+        emit dataChanged(index(0, 0), index(arena.registers.size() - 1, ColumnCount - 1));
+        for (int i = 0; i < arena.registers.size(); i++) {
+            int lanes = rowCount(index(i, 0));
+            if (lanes > 0) {
+                QModelIndex parentIndex = index(i, 0);
+                emit dataChanged(index(0, 0, parentIndex), index(lanes - 1, ColumnCount - 1, parentIndex));
+            }
+        }
+    }
+}
+
+bool RegistersModel::isVector(const RegisterDescription &reg)
+{
+    return reg.size > LaneBits;
+}
+
+QByteArray RegistersModel::registerBytes(const RegisterArena &arena, const RegisterDescription &reg)
+{
+    const QByteArray &bytes = arena.arenas.value(reg.arena);
+    int start = reg.offset / 8;
+    int length = (reg.offset % 8 + reg.size + 7) / 8;
+    if (start + length > bytes.size()) {
+        return QByteArray();
+    }
+    return bytes.mid(start, length);
+}
+
+ut64 RegistersModel::registerValue(const RegisterArena &arena, const RegisterDescription &reg)
+{
+    const QByteArray &bytes = arena.arenas.value(reg.arena);
+    int size = qMin(reg.size, LaneBits);
+    if (size <= 0 || (reg.offset + size + 7) / 8 > bytes.size()) {
+        return 0;
+    }
+
+    ut64 value = 0;
+    if (reg.offset % 8 == 0 && size % 8 == 0) {
+        int start = reg.offset / 8;
+        int count = size / 8;
+        for (int i = 0; i < count; i++) {
+            int byteIndex = arena.bigEndian ? start + i : start + count - 1 - i;
+            value = (value << 8) | static_cast<ut8>(bytes[byteIndex]);
+        }
+        return value;
+    }
+
+    // Sub-byte registers such as single flags, same bit numbering as r_reg_get_value
+    for (int i = 0; i < size; i++) {
+        int bit = reg.offset + i;
+        if (static_cast<ut8>(bytes[bit / 8]) & (1 << (bit % 8))) {
+            value |= 1ULL << i;
+        }
+    }
+    return value;
+}
+
+ut64 RegistersModel::laneValue(const RegisterDescription &reg, int lane) const
+{
+    RegisterDescription laneReg = reg;
+    laneReg.size = LaneBits;
+    laneReg.offset = reg.offset + lane * LaneBits;
+    return registerValue(arena, laneReg);
+}
+
+QString RegistersModel::formatValue(const RegisterDescription &reg) const
+{
+    if (!isVector(reg)) {
+        return RHexString(registerValue(arena, reg));
+    }
+    QByteArray bytes = registerBytes(arena, reg);
+    if (!arena.bigEndian) {
+        std::reverse(bytes.begin(), bytes.end());
+    }
+    return "0x" + QString::fromLatin1(bytes.toHex());
+}
+
+const RefDescription &RegistersModel::refDescription(int row) const
+{
+    auto it = refCache.find(row);
+    if (it == refCache.end()) {
+        const RegisterDescription &reg = arena.registers[row];
+        RefDescription desc;
+        if (reg.type == R_REG_TYPE_GPR && reg.size >= 16 && reg.size <= LaneBits) {
+            RVA value = registerValue(arena, reg);
+            desc = Core()->formatRefDesc(Core()->getAddrRefs(value, TelescopeDepth));
+        }
+        refCacheBytes += sizeof(RefDescription) + MemoryAccounting::stringSize(desc.ref);
+        it = refCache.insert(row, desc);
+        refCacheAccount.update(refCacheBytes, refCache.size());
+    }
+    refCacheAccount.touch();
+    return it.value();
+}
+
+QModelIndex RegistersModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent)) {
+        return QModelIndex();
+    }
+    // Top level rows have id 0, vector lanes store their register's row + 1
+    quintptr id = parent.isValid() ? static_cast<quintptr>(parent.row()) + 1 : 0;
+    return createIndex(row, column, id);
+}
+
+QModelIndex RegistersModel::parent(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.internalId() == 0) {
+        return QModelIndex();
+    }
+    return createIndex(static_cast<int>(index.internalId() - 1), 0, static_cast<quintptr>(0));
+}
+
+int RegistersModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) {
+        return arena.registers.size();
+    }
+    if (parent.internalId() != 0 || parent.column() != NameColumn) {
+        return 0;
+    }
+    const RegisterDescription &reg = arena.registers[parent.row()];
+    return isVector(reg) ? (reg.size + LaneBits - 1) / LaneBits : 0;
+}
+
+int RegistersModel::columnCount(const QModelIndex &) const
+{
+    return ColumnCount;
+}
+
+QVariant RegistersModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    bool isLane = index.internalId() != 0;
+    int row = isLane ? static_cast<int>(index.internalId() - 1) : index.row();
+    if (row >= arena.registers.size()) {
+        return QVariant();
+    }
+    const RegisterDescription &reg = arena.registers[row];
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+        switch (index.column()) {
+        case NameColumn:
+            return isLane ? QString("%1[%2]").arg(reg.name).arg(index.row()) : reg.name;
+        case ValueColumn:
+            return isLane ? RHexString(laneValue(reg, index.row())) : formatValue(reg);
+        case RefColumn:
+            return isLane ? QVariant() : refDescription(row).ref;
+        default:
+            return QVariant();
+        }
+    case Qt::ForegroundRole:
+        if (index.column() == ValueColumn && changed.value(row)) {
+            return ConfigColor("graph.true");
+        }
+        if (index.column() == RefColumn && !isLane) {
+            return refDescription(row).refColor;
+        }
+        return QVariant();
+    case Qt::ToolTipRole:
+        if (isLane) {
+            return QVariant();
+        }
+        return tr("%1 bits").arg(reg.size);
+    case OffsetRole:
+        if (isLane) {
+            return QVariant::fromValue(laneValue(reg, index.row()));
+        }
+        return QVariant::fromValue(registerValue(arena, reg));
+    default:
+        return QVariant();
+    }
+}
+
+bool RegistersModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (role != Qt::EditRole || !(flags(index) & Qt::ItemIsEditable)) {
+        return false;
+    }
+    // registersChanged will bring in a fresh snapshot
+    Core()->setRegister(arena.registers[index.row()].name, value.toString());
+    return true;
+}
+
+Qt::ItemFlags RegistersModel::flags(const QModelIndex &index) const
+{
+    Qt::ItemFlags flags = QAbstractItemModel::flags(index);
+    if (index.isValid() && index.internalId() == 0 && index.column() == ValueColumn
+            && !isVector(arena.registers[index.row()])) {
+        flags |= Qt::ItemIsEditable;
+    }
+    return flags;
+}
+
+QVariant RegistersModel::headerData(int section, Qt::Orientation, int role) const
+{
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    switch (section) {
+    case NameColumn:
+        return tr("Register");
+    case ValueColumn:
+        return tr("Value");
+    case RefColumn:
+        return tr("Reference");
+    default:
+        return QVariant();
+    }
+}
 
 RegistersWidget::RegistersWidget(MainWindow *main) :
     CutterDockWidget(main),
@@ -15,10 +274,12 @@ RegistersWidget::RegistersWidget(MainWindow *main) :
 {
     ui->setupUi(this);
 
-    // setup register layout
-    registerLayout->setVerticalSpacing(0);
-    registerLayout->setAlignment(Qt::AlignLeft |  Qt::AlignTop) ;
-    ui->verticalLayout->addLayout(registerLayout);
+    registersModel = new RegistersModel(this);
+    ui->registersTreeView->setModel(registersModel);
+    ui->registersTreeView->setFont(Config()->getFont());
+    ui->registersTreeView->setEditTriggers(QAbstractItemView::DoubleClicked
+                                           | QAbstractItemView::EditKeyPressed);
+    qhelpers::setVerticalScrollMode(ui->registersTreeView);
 
     refreshDeferrer = createRefreshDeferrer([this]() {
         updateContents();
@@ -26,6 +287,15 @@ RegistersWidget::RegistersWidget(MainWindow *main) :
 
     connect(Core(), &CutterCore::refreshAll, this, &RegistersWidget::updateContents);
     connect(Core(), &CutterCore::registersChanged, this, &RegistersWidget::updateContents);
+    connect(Config(), &Configuration::fontsUpdated, this, [this]() {
+        ui->registersTreeView->setFont(Config()->getFont());
+    });
+
+    connect(ui->registersTreeView, &QAbstractItemView::doubleClicked,
+            this, &RegistersWidget::onDoubleClicked);
+    ui->registersTreeView->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(ui->registersTreeView, &QWidget::customContextMenuRequested,
+            this, &RegistersWidget::openContextMenu);
 
     // Hide shortcuts because there is no way of selecting an item and triger them
     for (auto &action : addressContextMenu.actions()) {
@@ -41,79 +311,30 @@ void RegistersWidget::updateContents()
     if (!refreshDeferrer->attemptRefresh(nullptr)) {
         return;
     }
-    setRegisterGrid();
-}
-
-void RegistersWidget::setRegisterGrid()
-{
-    int i = 0;
-    int col = 0;
-    QString regValue;
-    QLabel *registerLabel;
-    QLineEdit *registerEditValue;
-    const auto registerRefs = Core()->getRegisterRefValues();
-
-    registerLen = registerRefs.size();
-    for (auto &reg : registerRefs) {
-        regValue = "0x" + reg.value;
-        // check if we already filled this grid space with label/value
-        if (!registerLayout->itemAtPosition(i, col)) {
-            registerLabel = new QLabel;
-            registerLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
-            registerLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
-            registerLabel->setMaximumWidth(60);
-            registerLabel->setStyleSheet("font-weight: bold; font-family: mono;");
-            registerEditValue = new QLineEdit;
-            registerEditValue->setMaximumWidth(140);
-            registerEditValue->setFont(Config()->getFont());
-            registerLabel->setContextMenuPolicy(Qt::CustomContextMenu);
-            connect(registerLabel, &QWidget::customContextMenuRequested, this, [this, registerEditValue, registerLabel](QPoint p){
-                openContextMenu(registerLabel->mapToGlobal(p), registerEditValue->text());
-            });
-            registerEditValue->setContextMenuPolicy(Qt::CustomContextMenu);
-            connect(registerEditValue, &QWidget::customContextMenuRequested, this, [this, registerEditValue](QPoint p){
-                openContextMenu(registerEditValue->mapToGlobal(p), registerEditValue->text());
-            });
-            // add label and register value to grid
-            registerLayout->addWidget(registerLabel, i, col);
-            registerLayout->addWidget(registerEditValue, i, col + 1);
-            connect(registerEditValue, &QLineEdit::editingFinished, [ = ]() {
-                QString regNameString = registerLabel->text();
-                QString regValueString = registerEditValue->text();
-                Core()->setRegister(regNameString, regValueString);
-            });
-        } else {
-            QWidget *regNameWidget = registerLayout->itemAtPosition(i, col)->widget();
-            QWidget *regValueWidget = registerLayout->itemAtPosition(i, col + 1)->widget();
-            registerLabel = qobject_cast<QLabel *>(regNameWidget);
-            registerEditValue = qobject_cast<QLineEdit *>(regValueWidget);
-        }
-        // decide to highlight QLine Box in case of change of register value
-        if (regValue != registerEditValue->text() && registerEditValue->text() != 0) {
-            registerEditValue->setStyleSheet("border: 1px solid green;");
-        } else {
-            // reset stylesheet
-            registerEditValue->setStyleSheet("");
-        }
-        // define register label and value
-        registerLabel->setText(reg.name);
-
-        registerLabel->setToolTip(reg.ref);
-        registerEditValue->setToolTip(reg.ref);
-
-        registerEditValue->setPlaceholderText(regValue);
-        registerEditValue->setText(regValue);
-        i++;
-        // decide if we should change column
-        if (i >= (registerLen + numCols - 1) / numCols) {
-            i = 0;
-            col += 2;
-        }
+    registersModel->setArena(Core()->getRegisterArena());
+
+    if (!columnsResized && registersModel->rowCount() > 0) {
+        ui->registersTreeView->resizeColumnToContents(RegistersModel::NameColumn);
+        ui->registersTreeView->resizeColumnToContents(RegistersModel::ValueColumn);
+        columnsResized = true;
+    }
+}
+
+void RegistersWidget::onDoubleClicked(const QModelIndex &index)
+{
+    // The value column is edited in place, other columns seek to the register value
+    if (index.column() == RegistersModel::ValueColumn) {
+        return;
     }
+    Core()->seekAndShow(index.data(RegistersModel::OffsetRole).toULongLong());
 }
 
-void RegistersWidget::openContextMenu(QPoint point, QString address)
+void RegistersWidget::openContextMenu(QPoint point)
 {
-    addressContextMenu.setTarget(address.toULongLong(nullptr, 16));
-    addressContextMenu.exec(point);
+    QModelIndex index = ui->registersTreeView->indexAt(point);
+    if (!index.isValid()) {
+        return;
+    }
+    addressContextMenu.setTarget(index.data(RegistersModel::OffsetRole).toULongLong());
+    addressContextMenu.exec(ui->registersTreeView->viewport()->mapToGlobal(point));
 }
@@ -1,14 +1,13 @@
 #pragma once
 
-#include <QTextEdit>
-#include <QPlainTextEdit>
-#include <QGridLayout>
-#include <QJsonObject>
+#include <QAbstractItemModel>
+#include <QHash>
 #include <memory>
 
 #include "core/Cutter.h"
 #include "CutterDockWidget.h"
 #include "menus/AddressableItemContextMenu.h"
+#include "common/MemoryAccounting.h"
 
 class MainWindow;
 
@@ -16,6 +15,56 @@ namespace Ui {
 class RegistersWidget;
 }
 
+/**
+ * @brief Tree model over a RegisterArena snapshot.
+ *
+ * Values are decoded from the raw arena bytes when requested by the view, vector registers
+ * expose their 64-bit lanes as children and telescoping is only resolved for rows
+ * that are actually displayed.
+ */
+class RegistersModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum Column { NameColumn = 0, ValueColumn, RefColumn, ColumnCount };
+    enum Role { OffsetRole = Qt::UserRole };
+
+    explicit RegistersModel(QObject *parent = nullptr);
+
+    /**
+     * @brief Replace the current snapshot, marking registers whose value differs
+     * from the previous one as changed.
+     */
+    void setArena(RegisterArena newArena);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &index) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    static constexpr int LaneBits = 64;
+    static constexpr int TelescopeDepth = 6;
+
+    RegisterArena arena;
+    QVector<bool> changed;
+    mutable QHash<int, RefDescription> refCache;
+    mutable MemoryAccount refCacheAccount;
+    mutable size_t refCacheBytes = 0;
+
+    static bool isVector(const RegisterDescription &reg);
+    static QByteArray registerBytes(const RegisterArena &arena, const RegisterDescription &reg);
+    static ut64 registerValue(const RegisterArena &arena, const RegisterDescription &reg);
+    ut64 laneValue(const RegisterDescription &reg, int lane) const;
+    QString formatValue(const RegisterDescription &reg) const;
+    const RefDescription &refDescription(int row) const;
+};
+
 class RegistersWidget : public CutterDockWidget
 {
     Q_OBJECT
@@ -26,14 +75,13 @@ public:
 
 private slots:
     void updateContents();
-    void setRegisterGrid();
-    void openContextMenu(QPoint point, QString address);
+    void onDoubleClicked(const QModelIndex &index);
+    void openContextMenu(QPoint point);
 
 private:
     std::unique_ptr<Ui::RegistersWidget> ui;
-    QGridLayout *registerLayout = new QGridLayout;
+    RegistersModel *registersModel;
     AddressableItemContextMenu addressContextMenu;
-    int numCols = 2;
-    int registerLen = 0;
     RefreshDeferrer *refreshDeferrer;
+    bool columnsResized = false;
 };
@@ -2,17 +2,34 @@
 #include "ui_SearchWidget.h"
 #include "core/MainWindow.h"
 #include "common/Helpers.h"
+#include "common/RopGadgetIndex.h"
+#include "common/ConstantIndex.h"
+#include "common/DisassemblyTextIndex.h"
 
 #include <QDockWidget>
 #include <QTreeWidget>
 #include <QComboBox>
 #include <QShortcut>
+#include <QTimer>
 
 namespace {
 
 static const int kMaxTooltipWidth = 500;
 static const int kMaxTooltipDisasmPreviewLines = 10;
 static const int kMaxTooltipHexdumpBytes = 64;
+static const int kMaxRopResults = 10000;
+static const int kMaxConstantResults = 10000;
+static const int kMaxDisassemblyResults = 10000;
+/**
+ * Time spent per event loop iteration on a disassembly search, results are shown in between
+ */
+static const int kDisassemblySearchSliceMs = 20;
+
+static const QString kRopSearchspace = QStringLiteral("/Rj");
+static const QString kRopRegexSearchspace = QStringLiteral("/Rj regex");
+static const QString kConstantSearchspace = QStringLiteral("constant");
+static const QString kComparedConstantSearchspace = QStringLiteral("constant compared");
+static const QString kDisassemblySearchspace = QStringLiteral("disassembly regex");
 
 }
 
@@ -184,6 +201,10 @@ SearchWidget::SearchWidget(MainWindow *main) :
 
     setScrollMode();
 
+    disassemblySearchTimer = new QTimer(this);
+    disassemblySearchTimer->setInterval(0);
+    connect(disassemblySearchTimer, &QTimer::timeout, this, &SearchWidget::continueDisassemblySearch);
+
     connect(Core(), &CutterCore::toggleDebugView, this, &SearchWidget::updateSearchBoundaries);
     connect(Core(), &CutterCore::refreshAll, this, &SearchWidget::refreshSearchspaces);
 
@@ -199,6 +220,25 @@ SearchWidget::SearchWidget(MainWindow *main) :
 
     connect(ui->searchspaceCombo, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
             this, [this](int index) { updatePlaceholderText(index);});
+
+    connect(RopGadgetIndex::instance(), &RopGadgetIndex::ready, this, [this]() {
+        QString searchspace = ui->searchspaceCombo->currentData().toString();
+        if (searchspace == kRopSearchspace || searchspace == kRopRegexSearchspace) {
+            refreshSearch();
+        }
+    });
+    connect(DisassemblyTextIndex::instance(), &DisassemblyTextIndex::ready, this, [this]() {
+        if (ui->searchspaceCombo->currentData().toString() == kDisassemblySearchspace
+                && !disassemblySearch) {
+            refreshSearch();
+        }
+    });
+    connect(ConstantIndex::instance(), &ConstantIndex::ready, this, [this]() {
+        QString searchspace = ui->searchspaceCombo->currentData().toString();
+        if (searchspace == kConstantSearchspace || searchspace == kComparedConstantSearchspace) {
+            refreshSearch();
+        }
+    });
 }
 
 SearchWidget::~SearchWidget() {}
@@ -243,8 +283,13 @@ void SearchWidget::refreshSearchspaces()
     ui->searchspaceCombo->addItem(tr("asm code"),   QVariant("/acj"));
     ui->searchspaceCombo->addItem(tr("string"),     QVariant("/j"));
     ui->searchspaceCombo->addItem(tr("hex string"), QVariant("/xj"));
-    ui->searchspaceCombo->addItem(tr("ROP gadgets"), QVariant("/Rj"));
+    ui->searchspaceCombo->addItem(tr("ROP gadgets"), QVariant(kRopSearchspace));
+    ui->searchspaceCombo->addItem(tr("ROP gadgets (regex)"), QVariant(kRopRegexSearchspace));
     ui->searchspaceCombo->addItem(tr("32bit value"), QVariant("/vj"));
+    ui->searchspaceCombo->addItem(tr("constant in code"), QVariant(kConstantSearchspace));
+    ui->searchspaceCombo->addItem(tr("constant compared in code"),
+                                  QVariant(kComparedConstantSearchspace));
+    ui->searchspaceCombo->addItem(tr("disassembly (regex)"), QVariant(kDisassemblySearchspace));
 
     if (cur_idx > 0)
         ui->searchspaceCombo->setCurrentIndex(cur_idx);
@@ -258,13 +303,122 @@ void SearchWidget::refreshSearch()
     QVariant searchspace_data = ui->searchspaceCombo->currentData();
     QString searchspace = searchspace_data.toString();
 
+    disassemblySearchTimer->stop();
+    disassemblySearch.clear();
+
     search_model->beginResetModel();
-    search = Core()->getAllSearch(search_for, searchspace);
+    if (searchspace == kDisassemblySearchspace) {
+        search.clear();
+        startDisassemblySearch(search_for);
+    } else if (searchspace == kRopSearchspace || searchspace == kRopRegexSearchspace) {
+        search = searchRopGadgets(search_for, searchspace == kRopRegexSearchspace);
+    } else if (searchspace == kConstantSearchspace || searchspace == kComparedConstantSearchspace) {
+        search = searchConstant(search_for, searchspace == kComparedConstantSearchspace);
+    } else {
+        search = Core()->getAllSearch(search_for, searchspace);
+    }
     search_model->endResetModel();
 
     qhelpers::adjustColumns(ui->searchTreeView, 3, 0);
 }
 
+QList<SearchDescription> SearchWidget::searchRopGadgets(const QString &query, bool regex)
+{
+    RopGadgetIndex *index = RopGadgetIndex::instance();
+    if (!index->isReady()) {
+        // The index is built once in the background, the search is repeated when it is ready
+        if (!query.isEmpty()) {
+            index->build();
+        }
+        return {};
+    }
+    QString error;
+    QList<SearchDescription> results = index->query(query, regex
+                                                    ? RopGadgetIndex::QueryMode::Regex
+                                                    : RopGadgetIndex::QueryMode::Instructions,
+                                                    kMaxRopResults, &error);
+    if (!error.isEmpty()) {
+        Core()->message(tr("Invalid regular expression: %1").arg(error));
+    }
+    return results;
+}
+
+QList<SearchDescription> SearchWidget::searchConstant(const QString &query, bool compared)
+{
+    if (query.isEmpty()) {
+        return {};
+    }
+    ConstantIndex *index = ConstantIndex::instance();
+    if (!index->isReady()) {
+        // Changed functions are indexed in the background, the search is repeated when it is ready
+        index->build();
+        if (!index->isReady()) {
+            return {};
+        }
+    }
+    // Plain numbers are taken as they are, anything else must evaluate to something
+    bool ok = false;
+    ut64 value = query.toULongLong(&ok, 0);
+    if (!ok) {
+        value = static_cast<ut64>(query.toLongLong(&ok, 0));
+    }
+    if (!ok) {
+        value = Core()->math(query);
+        ok = value != 0;
+    }
+    if (!ok) {
+        Core()->message(tr("Invalid constant: %1").arg(query));
+        return {};
+    }
+    if (!ConstantIndex::isIndexed(value)) {
+        Core()->message(tr("0 and -1 are not indexed, r2 gives them for operands without a value."));
+        return {};
+    }
+    return index->search(value, compared ? ConstantUse::Compare : 0xff, kMaxConstantResults);
+}
+
+void SearchWidget::startDisassemblySearch(const QString &pattern)
+{
+    if (pattern.isEmpty()) {
+        return;
+    }
+    DisassemblyTextIndex *index = DisassemblyTextIndex::instance();
+    if (!index->isReady()) {
+        // Changed functions are indexed in the background, the search is repeated when it is ready
+        index->build();
+        if (!index->isReady()) {
+            return;
+        }
+    }
+    disassemblySearch = index->query(pattern);
+    if (!disassemblySearch->isValid()) {
+        Core()->message(tr("Invalid regular expression: %1").arg(disassemblySearch->errorString()));
+        disassemblySearch.clear();
+        return;
+    }
+    disassemblySearchTimer->start();
+}
+
+void SearchWidget::continueDisassemblySearch()
+{
+    if (!disassemblySearch) {
+        disassemblySearchTimer->stop();
+        return;
+    }
+    QList<SearchDescription> found;
+    disassemblySearch->run(kDisassemblySearchSliceMs, &found, kMaxDisassemblyResults);
+    if (!found.isEmpty()) {
+        search_model->beginInsertRows(QModelIndex(), search.size(), search.size() + found.size() - 1);
+        search += found;
+        search_model->endInsertRows();
+    }
+    if (disassemblySearch->isFinished()) {
+        disassemblySearchTimer->stop();
+        disassemblySearch.clear();
+        qhelpers::adjustColumns(ui->searchTreeView, 3, 0);
+    }
+}
+
 void SearchWidget::setScrollMode()
 {
     qhelpers::setVerticalScrollMode(ui->searchTreeView);
@@ -280,11 +434,23 @@ void SearchWidget::updatePlaceholderText(int index)
         ui->filterLineEdit->setPlaceholderText("deadbeef");
         break;
     case 3: // ROP gadgets
-        ui->filterLineEdit->setPlaceholderText("pop,,pop");
+        ui->filterLineEdit->setPlaceholderText("pop rdi; ret");
+        break;
+    case 4: // ROP gadgets (regex)
+        ui->filterLineEdit->setPlaceholderText("pop r[ds]i; ret$");
         break;
-    case 4: // 32bit value
+    case 5: // 32bit value
         ui->filterLineEdit->setPlaceholderText("0xdeadbeef");
         break;
+    case 6: // constant in code
+        ui->filterLineEdit->setPlaceholderText("0x5a827999");
+        break;
+    case 7: // constant compared in code
+        ui->filterLineEdit->setPlaceholderText("0x1337");
+        break;
+    case 8: // disassembly (regex)
+        ui->filterLineEdit->setPlaceholderText("call.*alloc");
+        break;
     default:
         ui->filterLineEdit->setPlaceholderText("jmp rax");
     }
@@ -5,6 +5,7 @@
 
 #include <QAbstractItemModel>
 #include <QSortFilterProxyModel>
+#include <QSharedPointer>
 
 #include "core/Cutter.h"
 #include "CutterDockWidget.h"
@@ -13,6 +14,8 @@
 class MainWindow;
 class QTreeWidgetItem;
 class SearchWidget;
+class DisassemblyTextQuery;
+class QTimer;
 
 
 class SearchModel: public AddressableItemModel<QAbstractListModel>
@@ -79,8 +82,14 @@ private:
     SearchModel *search_model;
     SearchSortFilterProxyModel *search_proxy_model;
     QList<SearchDescription> search;
+    QSharedPointer<DisassemblyTextQuery> disassemblySearch;
+    QTimer *disassemblySearchTimer;
 
     void refreshSearch();
+    QList<SearchDescription> searchRopGadgets(const QString &query, bool regex);
+    QList<SearchDescription> searchConstant(const QString &query, bool compared);
+    void startDisassemblySearch(const QString &pattern);
+    void continueDisassemblySearch();
     void setScrollMode();
     void updatePlaceholderText(int index);
 };
@@ -5,14 +5,16 @@
 #include "common/Configuration.h"
 #include "ui_ListDockWidget.h"
 
-#include <QGraphicsSceneMouseEvent>
-#include <QGraphicsTextItem>
-#include <QGraphicsView>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
 #include <QShortcut>
 #include <QToolTip>
 
+#include <algorithm>
+
 SectionsModel::SectionsModel(QList<SectionDescription> *sections, QObject *parent)
     : AddressableItemModel<QAbstractListModel>(parent),
       sections(sections)
@@ -31,20 +33,6 @@ int SectionsModel::columnCount(const QModelIndex &) const
 
 QVariant SectionsModel::data(const QModelIndex &index, int role) const
 {
-    // TODO: create unique colors, e. g. use HSV color space and rotate in H for 360/size
-    static const QList<QColor> colors = { QColor("#1ABC9C"),    //TURQUOISE
-                                          QColor("#2ECC71"),    //EMERALD
-                                          QColor("#3498DB"),    //PETER RIVER
-                                          QColor("#9B59B6"),    //AMETHYST
-                                          QColor("#34495E"),    //WET ASPHALT
-                                          QColor("#F1C40F"),    //SUN FLOWER
-                                          QColor("#E67E22"),    //CARROT
-                                          QColor("#E74C3C"),    //ALIZARIN
-                                          QColor("#ECF0F1"),    //CLOUDS
-                                          QColor("#BDC3C7"),    //SILVER
-                                          QColor("#95A5A6")     //COBCRETE
-                                        };
-
     if (index.row() >= sections->count()) {
         return QVariant();
     }
@@ -73,7 +61,7 @@ QVariant SectionsModel::data(const QModelIndex &index, int role) const
         }
     case Qt::DecorationRole:
         if (index.column() == 0)
-            return colors[index.row() % colors.size()];
+            return sectionColor(index.row());
         return QVariant();
     case SectionsModel::SectionDescriptionRole:
         return QVariant::fromValue(section);
@@ -121,6 +109,25 @@ QString SectionsModel::name(const QModelIndex &index) const
     return section.name;
 }
 
+QColor SectionsModel::sectionColor(int row)
+{
+    // TODO: create unique colors, e. g. use HSV color space and rotate in H for 360/size
+    static const QList<QColor> colors = { QColor("#1ABC9C"),    //TURQUOISE
+                                          QColor("#2ECC71"),    //EMERALD
+                                          QColor("#3498DB"),    //PETER RIVER
+                                          QColor("#9B59B6"),    //AMETHYST
+                                          QColor("#34495E"),    //WET ASPHALT
+                                          QColor("#F1C40F"),    //SUN FLOWER
+                                          QColor("#E67E22"),    //CARROT
+                                          QColor("#E74C3C"),    //ALIZARIN
+                                          QColor("#ECF0F1"),    //CLOUDS
+                                          QColor("#BDC3C7"),    //SILVER
+                                          QColor("#95A5A6")     //COBCRETE
+                                        };
+
+    return colors[row % colors.size()];
+}
+
 SectionsProxyModel::SectionsProxyModel(SectionsModel *sourceModel, QObject *parent)
     : AddressableFilterProxyModel(sourceModel, parent)
 {
@@ -250,6 +257,8 @@ void SectionsWidget::refreshSections()
     sections = Core()->getAllSections();
     sectionsModel->endResetModel();
     qhelpers::adjustColumns(ui->treeView, SectionsModel::ColumnCount, 0);
+    rawAddrDock->updateDock();
+    virtualAddrDock->updateDock();
     refreshDocks();
 }
 
@@ -258,30 +267,16 @@ void SectionsWidget::refreshDocks()
     if (!dockRefreshDeferrer->attemptRefresh(nullptr)) {
         return;
     }
-    rawAddrDock->updateDock();
-    virtualAddrDock->updateDock();
     drawIndicatorOnAddrDocks();
 }
 
 void SectionsWidget::drawIndicatorOnAddrDocks()
 {
-    RVA offset = Core()->getOffset();
-    for (int i = 0; i != virtualAddrDock->proxyModel->rowCount(); i++) {
-        QModelIndex idx = virtualAddrDock->proxyModel->index(i, 0);
-        RVA vaddr = idx.data(SectionsModel::SectionDescriptionRole).value<SectionDescription>().vaddr;
-        int vsize = idx.data(SectionsModel::SectionDescriptionRole).value<SectionDescription>().vsize;
-        RVA end = vaddr + vsize;
-        if (offset < end) {
-            QString name = idx.data(SectionsModel::SectionDescriptionRole).value<SectionDescription>().name;
-            float ratio = 0;
-            if (vsize > 0 && offset > vaddr) {
-                ratio = (float)(offset - vaddr) / (float)vsize;
-            }
-            rawAddrDock->drawIndicator(name, ratio);
-            virtualAddrDock->drawIndicator(name, ratio);
-            return;
-        }
-    }
+    // Both docks share the same row order, so the row only has to be looked up once
+    float ratio = 0;
+    int row = virtualAddrDock->findSectionRow(Core()->getOffset(), &ratio);
+    rawAddrDock->drawIndicator(row, ratio);
+    virtualAddrDock->drawIndicator(row, ratio);
 }
 
 void SectionsWidget::resizeEvent(QResizeEvent *event) {
@@ -299,16 +294,8 @@ void SectionsWidget::updateToggle()
 
 AbstractAddrDock::AbstractAddrDock(SectionsModel *model, QWidget *parent) :
     QDockWidget(parent),
-    addrDockScene(new AddrDockScene(this)),
-    graphicsView(new QGraphicsView(this))
+    model(model)
 {
-    graphicsView->setScene(addrDockScene);
-    setWidget(graphicsView);
-    setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
-    proxyModel = new SectionsProxyModel(model, this);
-
-    setWidget(graphicsView);
-
     indicatorHeight = 5;
     indicatorParamPosY = 20;
     heightThreshold = 30;
@@ -318,69 +305,64 @@ AbstractAddrDock::AbstractAddrDock(SectionsModel *model, QWidget *parent) :
     rectWidthMax = 400;
     indicatorColor = ConfigColor("gui.navbar.seek");
     textColor = ConfigColor("gui.dataoffset");
+
+    addrDockView = new AddrDockView(this);
+    setWidget(addrDockView);
+    setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
 }
 
 AbstractAddrDock::~AbstractAddrDock() {}
 
 void AbstractAddrDock::updateDock()
 {
-    addrDockScene->clear();
-
-    const QBrush bg = QBrush(ConfigColor("gui.background"));
-    addrDockScene->setBackgroundBrush(bg);
-
+    indicatorColor = ConfigColor("gui.navbar.seek");
     textColor = ConfigColor("gui.dataoffset");
 
-    int y = 0;
-    int validMinSize = getValidMinSize();
-    int rectWidth = getRectWidth();
-    proxyModel->sort(SectionsModel::AddressColumn, Qt::AscendingOrder);
-    for (int i = 0; i < proxyModel->rowCount(); ++i) {
-        QModelIndex idx = proxyModel->index(i, 0);
-        auto desc = idx.data(SectionsModel::SectionDescriptionRole).value<SectionDescription>();
-
-        QString name = desc.name;
-
-        addrDockScene->seekAddrMap[name] = desc.vaddr;
-        addrDockScene->seekAddrSizeMap[name] = desc.vsize;
-
-        RVA addr = getAddressOfSection(desc);
-        RVA size = getSizeOfSection(desc);
-        addrDockScene->nameAddrMap[name] = addr;
-        addrDockScene->nameAddrSizeMap[name] = size;
-
-        int drawSize = getAdjustedSize(size, validMinSize);
-
-        QGraphicsRectItem *rect = new QGraphicsRectItem(rectOffset, y, rectWidth, drawSize);
-        rect->setBrush(QBrush(idx.data(Qt::DecorationRole).value<QColor>()));
-        addrDockScene->addItem(rect);
-
-        addTextItem(textColor, QPoint(0, y), RAddressString(addr));
-        addTextItem(textColor, QPoint(rectOffset, y), RSizeString(size));
-        addTextItem(textColor, QPoint(rectOffset + rectWidth, y), name);
-
-        addrDockScene->namePosYMap[name] = y;
-        addrDockScene->nameHeightMap[name] = drawSize;
-
-        y += drawSize;
+    const QList<SectionDescription> &sections = *model->sections;
+    QVector<int> order(sections.size());
+    for (int i = 0; i < order.size(); i++) {
+        order[i] = i;
     }
+    std::stable_sort(order.begin(), order.end(), [&sections](int a, int b) {
+        const SectionDescription &left = sections[a];
+        const SectionDescription &right = sections[b];
+        if (left.vaddr != right.vaddr) {
+            return left.vaddr < right.vaddr;
+        }
+        return left.vsize < right.vsize;
+    });
 
-    graphicsView->setSceneRect(addrDockScene->itemsBoundingRect());
-}
+    RVA validMinSize = getValidMinSize();
+    std::vector<AddrDockView::Row> rows;
+    rows.reserve(order.size());
+    int y = 0;
+    for (int i : order) {
+        const SectionDescription &section = sections[i];
+        AddrDockView::Row row;
+        row.addr = getAddressOfSection(section);
+        row.size = getSizeOfSection(section);
+        row.seekAddr = section.vaddr;
+        row.seekSize = section.vsize;
+        row.y = y;
+        row.height = getAdjustedSize(row.size, validMinSize);
+        row.color = SectionsModel::sectionColor(i);
+        row.addrText.setText(RAddressString(row.addr));
+        row.sizeText.setText(RSizeString(row.size));
+        row.nameText.setText(section.name);
+        row.addrText.setTextFormat(Qt::PlainText);
+        row.sizeText.setTextFormat(Qt::PlainText);
+        row.nameText.setTextFormat(Qt::PlainText);
+        y += row.height;
+        rows.push_back(std::move(row));
+    }
 
-void AbstractAddrDock::addTextItem(QColor color, QPoint pos, QString string)
-{
-    QGraphicsTextItem *text = new QGraphicsTextItem;
-    text->setDefaultTextColor(color);
-    text->setPos(pos);
-    text->setPlainText(string);
-    addrDockScene->addItem(text);
+    addrDockView->setRows(std::move(rows));
 }
 
-int AbstractAddrDock::getAdjustedSize(int size, int validMinSize)
+int AbstractAddrDock::getAdjustedSize(RVA size, RVA validMinSize)
 {
     if (size == 0) {
-        return size;
+        return 0;
     }
     if (size == validMinSize) {
         return heightThreshold;
@@ -401,52 +383,162 @@ int AbstractAddrDock::getIndicatorWidth()
     return getRectWidth() + 200;
 }
 
-int AbstractAddrDock::getValidMinSize()
+RVA AbstractAddrDock::getValidMinSize()
 {
-    proxyModel->sort(SectionsModel::SizeColumn, Qt::AscendingOrder);
-    for (int i = 0; i < proxyModel->rowCount(); i++) {
-        QModelIndex idx = proxyModel->index(i, 0);
-        int size = getSizeOfSection(idx.data(SectionsModel::SectionDescriptionRole).value<SectionDescription>());
-        if (size > 0) {
-            return size;
+    RVA minSize = 0;
+    for (const SectionDescription &section : *model->sections) {
+        RVA size = getSizeOfSection(section);
+        if (size > 0 && (minSize == 0 || size < minSize)) {
+            minSize = size;
         }
     }
-    return 0;
+    return minSize;
 }
 
-void AbstractAddrDock::drawIndicator(QString name, float ratio)
+int AbstractAddrDock::findSectionRow(RVA offset, float *ratio) const
 {
-    RVA offset = Core()->getOffset();
-    float padding = addrDockScene->nameHeightMap[name] * ratio;
-    int y = addrDockScene->namePosYMap[name] + (int)padding;
-    QColor color = indicatorColor;
-    QGraphicsRectItem *indicator = new QGraphicsRectItem(QRectF(0, y, getIndicatorWidth(), indicatorHeight));
-    indicator->setBrush(QBrush(color));
-    addrDockScene->addItem(indicator);
+    const std::vector<AddrDockView::Row> &rows = addrDockView->getRows();
+    *ratio = 0;
+
+    // First section starting after offset, the one before it is the only candidate containing it
+    auto it = std::upper_bound(rows.begin(), rows.end(), offset,
+                               [](RVA offset, const AddrDockView::Row &row) {
+        return offset < row.seekAddr;
+    });
+    if (it != rows.begin()) {
+        auto prev = it - 1;
+        if (offset < prev->seekAddr + prev->seekSize) {
+            if (prev->seekSize > 0 && offset > prev->seekAddr) {
+                *ratio = (float)(offset - prev->seekAddr) / (float)prev->seekSize;
+            }
+            return static_cast<int>(prev - rows.begin());
+        }
+    }
+    if (it == rows.end()) {
+        return -1;
+    }
+    return static_cast<int>(it - rows.begin());
+}
 
-    if (!addrDockScene->disableCenterOn) {
-        graphicsView->centerOn(indicator);
+void AbstractAddrDock::drawIndicator(int row, float ratio)
+{
+    if (row < 0) {
+        addrDockView->clearIndicator();
+        return;
     }
+    addrDockView->setIndicator(row, ratio, Core()->getOffset());
+}
+
+AddrDockView::AddrDockView(AbstractAddrDock *dock) :
+    QAbstractScrollArea(dock),
+    dock(dock)
+{
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    viewport()->setMouseTracking(true);
+}
+
+AddrDockView::~AddrDockView() {}
 
-    addTextItem(color, QPoint(rectOffset + getRectWidth(), y - indicatorParamPosY), name);
-    addTextItem(color, QPoint(0, y - indicatorParamPosY), QString("0x%1").arg(offset, 0, 16));
+void AddrDockView::setRows(std::vector<Row> newRows)
+{
+    rows = std::move(newRows);
+    indicatorRow = -1;
+    contentHeight = rows.empty() ? 0 : rows.back().y + rows.back().height;
+    updateScrollBars();
+    viewport()->update();
 }
 
-AddrDockScene::AddrDockScene(QWidget *parent) :
-    QGraphicsScene(parent)
+void AddrDockView::setIndicator(int row, float ratio, RVA offset)
 {
-    disableCenterOn = false;
+    if (row < 0 || row >= static_cast<int>(rows.size())) {
+        clearIndicator();
+        return;
+    }
+    indicatorRow = row;
+    indicatorRatio = ratio;
+    indicatorText = QString("0x%1").arg(offset, 0, 16);
+    if (!disableCenterOn) {
+        verticalScrollBar()->setValue(indicatorPosY() - viewport()->height() / 2);
+    }
+    viewport()->update();
 }
 
-AddrDockScene::~AddrDockScene() {}
+void AddrDockView::clearIndicator()
+{
+    indicatorRow = -1;
+    viewport()->update();
+}
 
-void AddrDockScene::mousePressEvent(QGraphicsSceneMouseEvent *event)
+int AddrDockView::indicatorPosY() const
 {
-    RVA addr = getAddrFromPos((int)event->scenePos().y(), false);
+    const Row &row = rows[indicatorRow];
+    return row.y + (int)(row.height * indicatorRatio);
+}
+
+void AddrDockView::updateScrollBars()
+{
+    // Leave room for the labels of the last row
+    int height = contentHeight + fontMetrics().height() + 2 * textMargin;
+    verticalScrollBar()->setRange(0, qMax(0, height - viewport()->height()));
+    verticalScrollBar()->setPageStep(viewport()->height());
+    verticalScrollBar()->setSingleStep((int)dock->heightThreshold);
+}
+
+void AddrDockView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void AddrDockView::paintEvent(QPaintEvent *)
+{
+    QPainter painter(viewport());
+    painter.fillRect(viewport()->rect(), ConfigColor("gui.background"));
+
+    int top = verticalScrollBar()->value();
+    int bottom = top + viewport()->height();
+    int rectWidth = dock->getRectWidth();
+    int labelX = dock->rectOffset + rectWidth + textMargin;
+    int textHeight = fontMetrics().height() + 2 * textMargin;
+    painter.translate(0, -top);
+
+    // Labels may extend below short rows, so begin with the last row starting above them
+    auto it = std::upper_bound(rows.begin(), rows.end(), top - textHeight,
+                               [](int y, const Row &row) {
+        return y < row.y;
+    });
+    if (it != rows.begin()) {
+        --it;
+    }
+    for (; it != rows.end() && it->y <= bottom; ++it) {
+        painter.setPen(QPen());
+        painter.setBrush(it->color);
+        painter.drawRect(dock->rectOffset, it->y, rectWidth, it->height);
+
+        painter.setPen(dock->textColor);
+        painter.drawStaticText(textMargin, it->y + textMargin, it->addrText);
+        painter.drawStaticText(dock->rectOffset + textMargin, it->y + textMargin, it->sizeText);
+        painter.drawStaticText(labelX, it->y + textMargin, it->nameText);
+    }
+
+    if (indicatorRow >= 0) {
+        int y = indicatorPosY();
+        int textY = y - dock->indicatorParamPosY + textMargin;
+        painter.fillRect(0, y, dock->getIndicatorWidth(), dock->indicatorHeight, dock->indicatorColor);
+        painter.setPen(dock->indicatorColor);
+        painter.drawStaticText(labelX, textY, rows[indicatorRow].nameText);
+        painter.drawText(textMargin, textY + fontMetrics().ascent(), indicatorText);
+    }
+}
+
+void AddrDockView::mousePressEvent(QMouseEvent *event)
+{
+    int posY = event->pos().y() + verticalScrollBar()->value();
+    RVA addr = getAddrFromPos(posY, false);
     if (addr != RVA_INVALID) {
-        QToolTip::showText(event->screenPos(), RAddressString(addr));
+        QToolTip::showText(event->globalPos(), RAddressString(addr));
         if (event->buttons() & Qt::LeftButton) {
-            RVA seekAddr = getAddrFromPos((int)event->scenePos().y(), true);
+            RVA seekAddr = getAddrFromPos(posY, true);
             disableCenterOn = true;
             Core()->seekAndShow(seekAddr);
             disableCenterOn = false;
@@ -457,28 +549,39 @@ void AddrDockScene::mousePressEvent(QGraphicsSceneMouseEvent *event)
     }
 }
 
-void AddrDockScene::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
+void AddrDockView::mouseMoveEvent(QMouseEvent *event)
 {
     mousePressEvent(event);
 }
 
-RVA AddrDockScene::getAddrFromPos(int posY, bool seek)
+int AddrDockView::rowAt(int posY) const
 {
-    QHash<QString, int>::const_iterator it;
-    QHash<QString, RVA> addrMap = seek ? seekAddrMap : nameAddrMap;
-    QHash<QString, RVA> addrSizeMap = seek ? seekAddrSizeMap : nameAddrSizeMap;
-    for (it = namePosYMap.constBegin(); it != namePosYMap.constEnd(); ++it) {
-        QString name = it.key();
-        int y = it.value();
-        int h = nameHeightMap[name];
-        if (posY >= y && y + h >= posY) {
-            if (h == 0) {
-                return addrMap[name];
-            }
-            return addrMap[name] + (float)addrSizeMap[name] * ((float)(posY - y) / (float)h);
-        }
+    auto it = std::upper_bound(rows.begin(), rows.end(), posY, [](int y, const Row &row) {
+        return y < row.y;
+    });
+    if (it == rows.begin()) {
+        return -1;
+    }
+    --it;
+    if (posY > it->y + it->height) {
+        return -1;
+    }
+    return static_cast<int>(it - rows.begin());
+}
+
+RVA AddrDockView::getAddrFromPos(int posY, bool seek) const
+{
+    int index = rowAt(posY);
+    if (index < 0) {
+        return RVA_INVALID;
+    }
+    const Row &row = rows[index];
+    RVA addr = seek ? row.seekAddr : row.addr;
+    RVA size = seek ? row.seekSize : row.size;
+    if (row.height == 0) {
+        return addr;
     }
-    return RVA_INVALID;
+    return addr + (float)size * ((float)(posY - row.y) / (float)row.height);
 }
 
 RawAddrDock::RawAddrDock(SectionsModel *model, QWidget *parent) :
@@ -3,11 +3,13 @@
 
 #include <memory>
 #include <map>
+#include <vector>
 
 #include <QtWidgets/QToolButton>
 #include <QAbstractListModel>
 #include <QSortFilterProxyModel>
-#include <QGraphicsScene>
+#include <QAbstractScrollArea>
+#include <QStaticText>
 #include <QLabel>
 #include <QHash>
 
@@ -18,19 +20,17 @@
 class QAbstractItemView;
 class SectionsWidget;
 class AbstractAddrDock;
-class AddrDockScene;
-class QGraphicsSceneMouseEvent;
+class AddrDockView;
 class RawAddrDock;
 class VirtualAddrDock;
 class QuickFilterView;
-class QGraphicsView;
-class QGraphicsRectItem;
 
 class SectionsModel : public AddressableItemModel<QAbstractListModel>
 {
     Q_OBJECT
 
     friend SectionsWidget;
+    friend AbstractAddrDock;
 
 private:
     QList<SectionDescription> *sections;
@@ -49,6 +49,8 @@ public:
 
     RVA address(const QModelIndex &index) const override;
     QString name(const QModelIndex &index) const override;
+
+    static QColor sectionColor(int row);
 };
 
 class SectionsProxyModel : public AddressableFilterProxyModel
@@ -109,6 +111,7 @@ class AbstractAddrDock : public QDockWidget
     Q_OBJECT
 
     friend SectionsWidget;
+    friend AddrDockView;
 
 public:
     explicit AbstractAddrDock(SectionsModel *model, QWidget *parent = nullptr);
@@ -126,46 +129,80 @@ protected:
     int rectWidthMax;
     QColor indicatorColor;
     QColor textColor;
-    AddrDockScene *addrDockScene;
-    QGraphicsView *graphicsView;
-    SectionsProxyModel *proxyModel;
+    AddrDockView *addrDockView;
+    SectionsModel *model;
 
-    void addTextItem(QColor color, QPoint pos, QString string);
-    int getAdjustedSize(int size, int validMinSize);
+    int getAdjustedSize(RVA size, RVA validMinSize);
     int getRectWidth();
     int getIndicatorWidth();
-    int getValidMinSize();
+    RVA getValidMinSize();
 
     virtual RVA getSizeOfSection(const SectionDescription &section) =0;
     virtual RVA getAddressOfSection(const SectionDescription &section) =0;
 
 private:
-    void drawIndicator(QString name, float ratio);
+    /**
+     * @brief Find the row of the section containing offset, or the next one if offset is in a gap
+     * @param ratio position of offset inside the section, from 0 to 1
+     * @return row index or -1
+     */
+    int findSectionRow(RVA offset, float *ratio) const;
+    void drawIndicator(int row, float ratio);
 };
 
-class AddrDockScene : public QGraphicsScene
+/**
+ * @brief Custom painted address map of the sections of an AbstractAddrDock.
+ *
+ * The layout is computed once per refresh into a vector sorted by position, painting
+ * and hit-testing only touch the rows intersecting the viewport using binary search.
+ */
+class AddrDockView : public QAbstractScrollArea
 {
     Q_OBJECT
 
 public:
-    explicit AddrDockScene(QWidget *parent = nullptr);
-    ~AddrDockScene();
-
-    bool disableCenterOn;
-
-    QHash<QString, RVA> nameAddrMap;
-    QHash<QString, RVA> nameAddrSizeMap;
-    QHash<QString, RVA> seekAddrMap;
-    QHash<QString, RVA> seekAddrSizeMap;
-    QHash<QString, int> namePosYMap;
-    QHash<QString, int> nameHeightMap;
+    struct Row {
+        RVA addr;
+        RVA size;
+        RVA seekAddr;
+        RVA seekSize;
+        int y;
+        int height;
+        QColor color;
+        QStaticText addrText;
+        QStaticText sizeText;
+        QStaticText nameText;
+    };
+
+    explicit AddrDockView(AbstractAddrDock *dock);
+    ~AddrDockView();
+
+    void setRows(std::vector<Row> newRows);
+    const std::vector<Row> &getRows() const { return rows; }
+    void setIndicator(int row, float ratio, RVA offset);
+    void clearIndicator();
 
 protected:
-    void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
-    void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
 
 private:
-    RVA getAddrFromPos(int posY, bool seek);
+    static constexpr int textMargin = 4;
+
+    AbstractAddrDock *dock;
+    std::vector<Row> rows;
+    int contentHeight = 0;
+    int indicatorRow = -1;
+    float indicatorRatio = 0;
+    QString indicatorText;
+    bool disableCenterOn = false;
+
+    int indicatorPosY() const;
+    int rowAt(int posY) const;
+    RVA getAddrFromPos(int posY, bool seek) const;
+    void updateScrollBars();
 };
 
 class RawAddrDock : public AbstractAddrDock
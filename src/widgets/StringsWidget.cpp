@@ -2,6 +2,7 @@
 #include "ui_StringsWidget.h"
 #include "core/MainWindow.h"
 #include "common/Helpers.h"
+#include "common/XrefGraph.h"
 #include "WidgetShortcuts.h"
 
 #include <QClipboard>
@@ -13,6 +14,11 @@ StringsModel::StringsModel(QList<StringDescription> *strings, QObject *parent)
     : AddressableItemModel<QAbstractListModel>(parent),
       strings(strings)
 {
+    connect(XrefIndex::instance(), &XrefIndex::updated, this, [this]() {
+        if (!this->strings->isEmpty()) {
+            emit dataChanged(index(0, XrefsColumn), index(this->strings->size() - 1, XrefsColumn));
+        }
+    });
 }
 
 int StringsModel::rowCount(const QModelIndex &) const
@@ -47,6 +53,11 @@ QVariant StringsModel::data(const QModelIndex &index, int role) const
             return QString::number(str.size);
         case StringsModel::SectionColumn:
             return str.section;
+        case StringsModel::XrefsColumn:
+            if (!XrefIndex::instance()->isReady()) {
+                return QVariant();
+            }
+            return QString::number(XrefIndex::instance()->inDegree(str.vaddr));
         default:
             return QVariant();
         }
@@ -74,6 +85,8 @@ QVariant StringsModel::headerData(int section, Qt::Orientation, int role) const
             return tr("Size");
         case StringsModel::SectionColumn:
             return tr("Section");
+        case StringsModel::XrefsColumn:
+            return tr("Xrefs");
         default:
             return QVariant();
         }
@@ -129,6 +142,13 @@ bool StringsProxyModel::lessThan(const QModelIndex &left, const QModelIndex &rig
         return leftStr->length < rightStr->length;
     case StringsModel::SectionColumn:
         return leftStr->section < rightStr->section;
+    case StringsModel::XrefsColumn: {
+        int leftXrefs = XrefIndex::instance()->inDegree(leftStr->vaddr);
+        int rightXrefs = XrefIndex::instance()->inDegree(rightStr->vaddr);
+        if (leftXrefs != rightXrefs)
+            return leftXrefs < rightXrefs;
+        break;
+    }
     default:
         break;
     }
@@ -246,6 +266,13 @@ void StringsWidget::stringSearchFinished(const QList<StringDescription> &strings
     this->strings = strings;
     model->endResetModel();
 
+    size_t bytes = 0;
+    for (const StringDescription &string : strings) {
+        bytes += sizeof(StringDescription) + MemoryAccounting::stringSize(string.string)
+                 + MemoryAccounting::stringSize(string.type) + MemoryAccounting::stringSize(string.section);
+    }
+    stringsAccount.update(bytes, strings.size());
+
     tree->showItemsNumber(proxyModel->rowCount());
 
     task.clear();
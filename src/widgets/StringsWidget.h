@@ -8,6 +8,7 @@
 #include "common/StringsTask.h"
 #include "CutterTreeWidget.h"
 #include "AddressableItemModel.h"
+#include "common/MemoryAccounting.h"
 
 #include <QAbstractListModel>
 #include <QSortFilterProxyModel>
@@ -30,7 +31,7 @@ private:
     QList<StringDescription> *strings;
 
 public:
-    enum Column { OffsetColumn = 0, StringColumn, TypeColumn, LengthColumn, SizeColumn, SectionColumn, ColumnCount };
+    enum Column { OffsetColumn = 0, StringColumn, TypeColumn, LengthColumn, SizeColumn, SectionColumn, XrefsColumn, ColumnCount };
     static const int StringDescriptionRole = Qt::UserRole;
 
     StringsModel(QList<StringDescription> *strings, QObject *parent = nullptr);
@@ -88,6 +89,7 @@ private:
     StringsModel *model;
     StringsProxyModel *proxyModel;
     QList<StringDescription> strings;
+    MemoryAccount stringsAccount { QStringLiteral("String list") };
     CutterTreeWidget *tree;
 };
 
@@ -2,6 +2,7 @@
 #include "ui_TypesWidget.h"
 #include "core/MainWindow.h"
 #include "common/Helpers.h"
+#include "common/DebugInfo.h"
 #include "dialogs/TypesInteractionDialog.h"
 #include "dialogs/LinkTypeDialog.h"
 
@@ -77,7 +78,9 @@ QVariant TypesModel::headerData(int section, Qt::Orientation, int role) const
 
 bool TypesModel::removeRows(int row, int count, const QModelIndex &parent)
 {
-    Core()->cmdRaw("t-" + types->at(row).type);
+    // A type of debug information that was not added yet would be listed again
+    DebugInfo::instance()->discardType(types->at(row).type);
+    Core()->cmdEdit("t-" + types->at(row).type);
     beginRemoveRows(parent, row, row + count - 1);
     while (count--) {
         types->removeAt(row);
@@ -172,6 +175,7 @@ TypesWidget::TypesWidget(MainWindow *main) :
     clearShortcut->setContext(Qt::WidgetWithChildrenShortcut);
 
     connect(Core(), SIGNAL(refreshAll()), this, SLOT(refreshTypes()));
+    connect(DebugInfo::instance(), &DebugInfo::typesChanged, this, &TypesWidget::refreshTypes);
 
     connect(
         ui->quickFilterView->comboBox(), &QComboBox::currentTextChanged, this,
@@ -196,6 +200,8 @@ void TypesWidget::refreshTypes()
 {
     types_model->beginResetModel();
     types = Core()->getAllTypes();
+    // Listed before their definitions are added to r2, see viewType()
+    types.append(DebugInfo::instance()->pendingTypes());
     types_model->endResetModel();
 
     QStringList categories;
@@ -302,6 +308,7 @@ void TypesWidget::viewType(bool readOnly)
     } else {
         dialog.setWindowTitle(tr("View Type: ") + t.type + tr(" (Read Only)"));
     }
+    DebugInfo::instance()->materializeType(t.type);
     dialog.fillTextArea(Core()->getTypeAsC(t.type, t.category));
     dialog.exec();
 }
@@ -348,6 +355,7 @@ void TypesWidget::typeItemDoubleClicked(const QModelIndex &index) {
     if (t.category == "Primitive") {
         return;
     }
+    DebugInfo::instance()->materializeType(t.type);
     dialog.fillTextArea(Core()->getTypeAsC(t.type, t.category));
     dialog.setWindowTitle(tr("View Type: ") + t.type + tr(" (Read Only)"));
     dialog.exec();